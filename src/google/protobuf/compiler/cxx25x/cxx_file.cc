@@ -160,6 +160,7 @@ void FileGenerator::GenerateHeader(io::Printer* printer) {
   if (HasGenericServices(file_)) {
     printer->Print(
       "#include <google/protobuf/rpc/rpc_service.h>\n"
+      "#include <google/protobuf/rpc/rpc_stream.h>\n"
       "#include <google/protobuf/rpc/rpc_client.h>\n");
   }
 
@@ -42,6 +42,14 @@ namespace protobuf {
 namespace compiler {
 namespace cxx {
 
+namespace {
+
+bool IsStreaming(const MethodDescriptor* method) {
+  return method->client_streaming() || method->server_streaming();
+}
+
+}  // namespace
+
 ServiceGenerator::ServiceGenerator(const ServiceDescriptor* descriptor,
                                    const Options& options)
   : descriptor_(descriptor) {
@@ -99,6 +107,13 @@ void ServiceGenerator::GenerateInterface(io::Printer* printer) {
     "const ::google::protobuf::Message& GetResponsePrototype(\n"
     "  const ::google::protobuf::MethodDescriptor* method) const;\n");
 
+  if (HasStreamingMethods()) {
+    printer->Print(
+      "const ::google::protobuf::rpc::Error CallStreamMethod(\n"
+      "  const ::google::protobuf::MethodDescriptor* method,\n"
+      "  ::google::protobuf::rpc::Stream* stream);\n");
+  }
+
   printer->Outdent();
   printer->Print(vars_,
     "\n"
@@ -125,6 +140,22 @@ void ServiceGenerator::GenerateStubDefinition(io::Printer* printer) {
 
   GenerateMethodSignatures(NON_VIRTUAL, printer);
 
+  printer->Print(
+    "\n"
+    "// asynchronous calls, see Caller::CallMethodAsync ------------------\n"
+    "\n");
+
+  GenerateAsyncMethodSignatures(printer);
+
+  if (HasStreamingMethods()) {
+    printer->Print(
+      "\n"
+      "// streaming calls, see Caller::NewStream ---------------------------\n"
+      "\n");
+
+    GenerateStreamMethodSignatures(printer);
+  }
+
   printer->Outdent();
   printer->Print(vars_,
     "\n"
@@ -146,11 +177,81 @@ void ServiceGenerator::GenerateMethodSignatures(
     sub_vars["output_type"] = ClassName(method->output_type(), true);
     sub_vars["virtual"] = virtual_or_non == VIRTUAL ? "virtual " : "";
 
+    // the stub has other signatures for the streaming methods
+    if (method->client_streaming() && method->server_streaming()) {
+      if (virtual_or_non == VIRTUAL) {
+        printer->Print(sub_vars,
+          "$virtual$const ::google::protobuf::rpc::Error $name$(\n"
+          "  ::google::protobuf::rpc::StreamReaderWriter< $output_type$, $input_type$>* stream);\n");
+      }
+    } else if (method->client_streaming()) {
+      if (virtual_or_non == VIRTUAL) {
+        printer->Print(sub_vars,
+          "$virtual$const ::google::protobuf::rpc::Error $name$(\n"
+          "  ::google::protobuf::rpc::StreamReader< $input_type$>* reader,\n"
+          "  $output_type$* response);\n");
+      }
+    } else if (method->server_streaming()) {
+      if (virtual_or_non == VIRTUAL) {
+        printer->Print(sub_vars,
+          "$virtual$const ::google::protobuf::rpc::Error $name$(\n"
+          "  const $input_type$* request,\n"
+          "  ::google::protobuf::rpc::StreamWriter< $output_type$>* writer);\n");
+      }
+    } else {
+      printer->Print(sub_vars,
+        "$virtual$const ::google::protobuf::rpc::Error $name$(\n"
+        "  const $input_type$* request,\n"
+        "  $output_type$* response);\n");
+    }
+  }
+}
+
+void ServiceGenerator::GenerateAsyncMethodSignatures(io::Printer* printer) {
+  for (int i = 0; i < descriptor_->method_count(); i++) {
+    const MethodDescriptor* method = descriptor_->method(i);
+    if (IsStreaming(method)) continue;
+    map<string, string> sub_vars;
+    sub_vars["name"] = method->name();
+    sub_vars["input_type"] = ClassName(method->input_type(), true);
+    sub_vars["output_type"] = ClassName(method->output_type(), true);
+
     printer->Print(sub_vars,
-      "$virtual$const ::google::protobuf::rpc::Error $name$(\n"
+      "::std::shared_ptr< ::google::protobuf::rpc::Future> $name$Async(\n"
       "  const $input_type$* request,\n"
-      "  $output_type$* response);\n");
+      "  $output_type$* response,\n"
+      "  const ::google::protobuf::rpc::Callback& done = ::google::protobuf::rpc::Callback());\n");
+  }
+}
+
+void ServiceGenerator::GenerateStreamMethodSignatures(io::Printer* printer) {
+  for (int i = 0; i < descriptor_->method_count(); i++) {
+    const MethodDescriptor* method = descriptor_->method(i);
+    map<string, string> sub_vars;
+    sub_vars["name"] = method->name();
+    sub_vars["input_type"] = ClassName(method->input_type(), true);
+    sub_vars["output_type"] = ClassName(method->output_type(), true);
+
+    if (method->client_streaming() && method->server_streaming()) {
+      printer->Print(sub_vars,
+        "::std::unique_ptr< ::google::protobuf::rpc::ClientReaderWriter< $input_type$, $output_type$> > $name$();\n");
+    } else if (method->client_streaming()) {
+      printer->Print(sub_vars,
+        "::std::unique_ptr< ::google::protobuf::rpc::ClientWriter< $input_type$, $output_type$> > $name$(\n"
+        "  $output_type$* response);\n");
+    } else if (method->server_streaming()) {
+      printer->Print(sub_vars,
+        "::std::unique_ptr< ::google::protobuf::rpc::ClientReader< $output_type$> > $name$(\n"
+        "  const $input_type$* request);\n");
+    }
+  }
+}
+
+bool ServiceGenerator::HasStreamingMethods() {
+  for (int i = 0; i < descriptor_->method_count(); i++) {
+    if (IsStreaming(descriptor_->method(i))) return true;
   }
+  return false;
 }
 
 // ===================================================================
@@ -185,6 +286,9 @@ void ServiceGenerator::GenerateImplementation(io::Printer* printer) {
   // Generate methods of the interface.
   GenerateNotImplementedMethods(printer);
   GenerateCallMethod(printer);
+  if (HasStreamingMethods()) {
+    GenerateCallStreamMethod(printer);
+  }
   GenerateGetPrototype(REQUEST, printer);
   GenerateGetPrototype(RESPONSE, printer);
 
@@ -214,10 +318,27 @@ void ServiceGenerator::GenerateNotImplementedMethods(io::Printer* printer) {
     sub_vars["input_type"] = ClassName(method->input_type(), true);
     sub_vars["output_type"] = ClassName(method->output_type(), true);
 
+    if (method->client_streaming() && method->server_streaming()) {
+      printer->Print(sub_vars,
+        "const ::google::protobuf::rpc::Error $classname$::$name$(\n"
+        "  ::google::protobuf::rpc::StreamReaderWriter< $output_type$, $input_type$>*) {\n");
+    } else if (method->client_streaming()) {
+      printer->Print(sub_vars,
+        "const ::google::protobuf::rpc::Error $classname$::$name$(\n"
+        "  ::google::protobuf::rpc::StreamReader< $input_type$>*,\n"
+        "  $output_type$*) {\n");
+    } else if (method->server_streaming()) {
+      printer->Print(sub_vars,
+        "const ::google::protobuf::rpc::Error $classname$::$name$(\n"
+        "  const $input_type$*,\n"
+        "  ::google::protobuf::rpc::StreamWriter< $output_type$>*) {\n");
+    } else {
+      printer->Print(sub_vars,
+        "const ::google::protobuf::rpc::Error $classname$::$name$(\n"
+        "  const $input_type$*,\n"
+        "  $output_type$*) {\n");
+    }
     printer->Print(sub_vars,
-      "const ::google::protobuf::rpc::Error $classname$::$name$(\n"
-      "  const $input_type$*,\n"
-      "  $output_type$*) {\n"
       "  return ::google::protobuf::rpc::Error(\"Method $classname$::$name$() not implemented.\");\n"
       "}\n"
       "\n");
@@ -241,6 +362,14 @@ void ServiceGenerator::GenerateCallMethod(io::Printer* printer) {
     sub_vars["input_type"] = ClassName(method->input_type(), true);
     sub_vars["output_type"] = ClassName(method->output_type(), true);
 
+    if (IsStreaming(method)) {
+      sub_vars["classname"] = descriptor_->name();
+      printer->Print(sub_vars,
+        "    case $index$:\n"
+        "      return ::google::protobuf::rpc::Error(\"Method $classname$::$name$() is a streaming method.\");\n");
+      continue;
+    }
+
     // Note:  down_cast does not work here because it only works on pointers,
     //   not references.
     printer->Print(sub_vars,
@@ -258,6 +387,61 @@ void ServiceGenerator::GenerateCallMethod(io::Printer* printer) {
     "\n");
 }
 
+void ServiceGenerator::GenerateCallStreamMethod(io::Printer* printer) {
+  printer->Print(vars_,
+    "const ::google::protobuf::rpc::Error $classname$::CallStreamMethod(\n"
+    "  const ::google::protobuf::MethodDescriptor* method,\n"
+    "  ::google::protobuf::rpc::Stream* stream) {\n"
+    "  GOOGLE_DCHECK_EQ(method->service(), $classname$_descriptor_);\n"
+    "  switch(method->index()) {\n");
+
+  for (int i = 0; i < descriptor_->method_count(); i++) {
+    const MethodDescriptor* method = descriptor_->method(i);
+    map<string, string> sub_vars;
+    sub_vars["classname"] = descriptor_->name();
+    sub_vars["name"] = method->name();
+    sub_vars["index"] = SimpleItoa(i);
+    sub_vars["input_type"] = ClassName(method->input_type(), true);
+    sub_vars["output_type"] = ClassName(method->output_type(), true);
+
+    if (method->client_streaming() && method->server_streaming()) {
+      printer->Print(sub_vars,
+        "    case $index$: {\n"
+        "      ::google::protobuf::rpc::StreamReaderWriter< $output_type$, $input_type$> rw(stream);\n"
+        "      return $name$(&rw);\n"
+        "    }\n");
+    } else if (method->client_streaming()) {
+      printer->Print(sub_vars,
+        "    case $index$: {\n"
+        "      ::google::protobuf::rpc::StreamReader< $input_type$> reader(stream);\n"
+        "      $output_type$ response;\n"
+        "      ::google::protobuf::rpc::Error err = $name$(&reader, &response);\n"
+        "      if (err.IsNil()) {\n"
+        "        err = stream->Write(&response);\n"
+        "      }\n"
+        "      return err;\n"
+        "    }\n");
+    } else if (method->server_streaming()) {
+      printer->Print(sub_vars,
+        "    case $index$: {\n"
+        "      $input_type$ request;\n"
+        "      if (!stream->Read(&request)) {\n"
+        "        return ::google::protobuf::rpc::Error(\"Method $classname$::$name$(): no request.\");\n"
+        "      }\n"
+        "      ::google::protobuf::rpc::StreamWriter< $output_type$> writer(stream);\n"
+        "      return $name$(&request, &writer);\n"
+        "    }\n");
+    }
+  }
+
+  printer->Print(vars_,
+    "    default:\n"
+    "      return ::google::protobuf::rpc::Error(\"Bad method index; this should never happen.\");\n"
+    "  }\n"
+    "}\n"
+    "\n");
+}
+
 void ServiceGenerator::GenerateGetPrototype(RequestOrResponse which,
                                             io::Printer* printer) {
   if (which == REQUEST) {
@@ -306,11 +490,50 @@ void ServiceGenerator::GenerateStubMethods(io::Printer* printer) {
     sub_vars["input_type"] = ClassName(method->input_type(), true);
     sub_vars["output_type"] = ClassName(method->output_type(), true);
 
+    if (method->client_streaming() && method->server_streaming()) {
+      printer->Print(sub_vars,
+        "::std::unique_ptr< ::google::protobuf::rpc::ClientReaderWriter< $input_type$, $output_type$> > $classname$_Stub::$name$() {\n"
+        "  return ::std::unique_ptr< ::google::protobuf::rpc::ClientReaderWriter< $input_type$, $output_type$> >(\n"
+        "    new ::google::protobuf::rpc::ClientReaderWriter< $input_type$, $output_type$>(\n"
+        "      client_->NewStream(descriptor()->method($index$))));\n"
+        "}\n");
+      continue;
+    }
+    if (method->client_streaming()) {
+      printer->Print(sub_vars,
+        "::std::unique_ptr< ::google::protobuf::rpc::ClientWriter< $input_type$, $output_type$> > $classname$_Stub::$name$(\n"
+        "  $output_type$* response) {\n"
+        "  return ::std::unique_ptr< ::google::protobuf::rpc::ClientWriter< $input_type$, $output_type$> >(\n"
+        "    new ::google::protobuf::rpc::ClientWriter< $input_type$, $output_type$>(\n"
+        "      client_->NewStream(descriptor()->method($index$)), response));\n"
+        "}\n");
+      continue;
+    }
+    if (method->server_streaming()) {
+      printer->Print(sub_vars,
+        "::std::unique_ptr< ::google::protobuf::rpc::ClientReader< $output_type$> > $classname$_Stub::$name$(\n"
+        "  const $input_type$* request) {\n"
+        "  ::std::unique_ptr< ::google::protobuf::rpc::ClientStream> stream(\n"
+        "    client_->NewStream(descriptor()->method($index$)));\n"
+        "  stream->Write(request);\n"
+        "  stream->CloseWrite();\n"
+        "  return ::std::unique_ptr< ::google::protobuf::rpc::ClientReader< $output_type$> >(\n"
+        "    new ::google::protobuf::rpc::ClientReader< $output_type$>(::std::move(stream)));\n"
+        "}\n");
+      continue;
+    }
+
     printer->Print(sub_vars,
       "const ::google::protobuf::rpc::Error $classname$_Stub::$name$(\n"
       "  const $input_type$* request,\n"
       "  $output_type$* response) {\n"
       "  return client_->CallMethod(descriptor()->method($index$), request, response);\n"
+      "}\n"
+      "::std::shared_ptr< ::google::protobuf::rpc::Future> $classname$_Stub::$name$Async(\n"
+      "  const $input_type$* request,\n"
+      "  $output_type$* response,\n"
+      "  const ::google::protobuf::rpc::Callback& done) {\n"
+      "  return client_->CallMethodAsync(descriptor()->method($index$), request, response, done);\n"
       "}\n");
   }
 }
@@ -90,6 +90,15 @@ class ServiceGenerator {
   void GenerateMethodSignatures(VirtualOrNon virtual_or_non,
                                 io::Printer* printer);
 
+  // Prints signatures for the stub's asynchronous methods.
+  void GenerateAsyncMethodSignatures(io::Printer* printer);
+
+  // Prints signatures for the stub's streaming methods.
+  void GenerateStreamMethodSignatures(io::Printer* printer);
+
+  // Whether the service has streaming methods.
+  bool HasStreamingMethods();
+
   // Source file stuff.
 
   // Generate the default implementations of the service methods, which
@@ -99,6 +108,9 @@ class ServiceGenerator {
   // Generate the CallMethod() method of the service.
   void GenerateCallMethod(io::Printer* printer);
 
+  // Generate the CallStreamMethod() method of the service.
+  void GenerateCallStreamMethod(io::Printer* printer);
+
   // Generate the Get{Request,Response}Prototype() methods.
   void GenerateGetPrototype(RequestOrResponse which, io::Printer* printer);
 
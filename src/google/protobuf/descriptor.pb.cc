@@ -248,11 +248,13 @@ void protobuf_AssignDesc_google_2fprotobuf_2fdescriptor_2eproto() {
       ::google::protobuf::MessageFactory::generated_factory(),
       sizeof(ServiceDescriptorProto));
   MethodDescriptorProto_descriptor_ = file->message_type(7);
-  static const int MethodDescriptorProto_offsets_[4] = {
+  static const int MethodDescriptorProto_offsets_[6] = {
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(MethodDescriptorProto, name_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(MethodDescriptorProto, input_type_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(MethodDescriptorProto, output_type_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(MethodDescriptorProto, options_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(MethodDescriptorProto, client_streaming_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(MethodDescriptorProto, server_streaming_),
   };
   MethodDescriptorProto_reflection_ =
     new ::google::protobuf::internal::GeneratedMessageReflection(
@@ -617,59 +619,61 @@ void protobuf_AddDesc_google_2fprotobuf_2fdescriptor_2eproto() {
     "lueOptions\"\220\001\n\026ServiceDescriptorProto\022\014\n"
     "\004name\030\001 \001(\t\0226\n\006method\030\002 \003(\0132&.google.pro"
     "tobuf.MethodDescriptorProto\0220\n\007options\030\003"
-    " \001(\0132\037.google.protobuf.ServiceOptions\"\177\n"
-    "\025MethodDescriptorProto\022\014\n\004name\030\001 \001(\t\022\022\n\n"
-    "input_type\030\002 \001(\t\022\023\n\013output_type\030\003 \001(\t\022/\n"
-    "\007options\030\004 \001(\0132\036.google.protobuf.MethodO"
-    "ptions\"\351\003\n\013FileOptions\022\024\n\014java_package\030\001"
-    " \001(\t\022\034\n\024java_outer_classname\030\010 \001(\t\022\"\n\023ja"
-    "va_multiple_files\030\n \001(\010:\005false\022,\n\035java_g"
-    "enerate_equals_and_hash\030\024 \001(\010:\005false\022F\n\014"
-    "optimize_for\030\t \001(\0162).google.protobuf.Fil"
-    "eOptions.OptimizeMode:\005SPEED\022\022\n\ngo_packa"
-    "ge\030\013 \001(\t\022\"\n\023cc_generic_services\030\020 \001(\010:\005f"
-    "alse\022$\n\025java_generic_services\030\021 \001(\010:\005fal"
-    "se\022\"\n\023py_generic_services\030\022 \001(\010:\005false\022C"
-    "\n\024uninterpreted_option\030\347\007 \003(\0132$.google.p"
-    "rotobuf.UninterpretedOption\":\n\014OptimizeM"
-    "ode\022\t\n\005SPEED\020\001\022\r\n\tCODE_SIZE\020\002\022\020\n\014LITE_RU"
-    "NTIME\020\003*\t\010\350\007\020\200\200\200\200\002\"\270\001\n\016MessageOptions\022&\n"
-    "\027message_set_wire_format\030\001 \001(\010:\005false\022.\n"
-    "\037no_standard_descriptor_accessor\030\002 \001(\010:\005"
-    "false\022C\n\024uninterpreted_option\030\347\007 \003(\0132$.g"
-    "oogle.protobuf.UninterpretedOption*\t\010\350\007\020"
-    "\200\200\200\200\002\"\276\002\n\014FieldOptions\022:\n\005ctype\030\001 \001(\0162#."
-    "google.protobuf.FieldOptions.CType:\006STRI"
-    "NG\022\016\n\006packed\030\002 \001(\010\022\023\n\004lazy\030\005 \001(\010:\005false\022"
-    "\031\n\ndeprecated\030\003 \001(\010:\005false\022\034\n\024experiment"
-    "al_map_key\030\t \001(\t\022\023\n\004weak\030\n \001(\010:\005false\022C\n"
-    "\024uninterpreted_option\030\347\007 \003(\0132$.google.pr"
-    "otobuf.UninterpretedOption\"/\n\005CType\022\n\n\006S"
-    "TRING\020\000\022\010\n\004CORD\020\001\022\020\n\014STRING_PIECE\020\002*\t\010\350\007"
-    "\020\200\200\200\200\002\"x\n\013EnumOptions\022\031\n\013allow_alias\030\002 \001"
-    "(\010:\004true\022C\n\024uninterpreted_option\030\347\007 \003(\0132"
-    "$.google.protobuf.UninterpretedOption*\t\010"
-    "\350\007\020\200\200\200\200\002\"b\n\020EnumValueOptions\022C\n\024uninterp"
-    "reted_option\030\347\007 \003(\0132$.google.protobuf.Un"
-    "interpretedOption*\t\010\350\007\020\200\200\200\200\002\"`\n\016ServiceO"
-    "ptions\022C\n\024uninterpreted_option\030\347\007 \003(\0132$."
-    "google.protobuf.UninterpretedOption*\t\010\350\007"
-    "\020\200\200\200\200\002\"_\n\rMethodOptions\022C\n\024uninterpreted"
-    "_option\030\347\007 \003(\0132$.google.protobuf.Uninter"
-    "pretedOption*\t\010\350\007\020\200\200\200\200\002\"\236\002\n\023Uninterprete"
-    "dOption\022;\n\004name\030\002 \003(\0132-.google.protobuf."
-    "UninterpretedOption.NamePart\022\030\n\020identifi"
-    "er_value\030\003 \001(\t\022\032\n\022positive_int_value\030\004 \001"
-    "(\004\022\032\n\022negative_int_value\030\005 \001(\003\022\024\n\014double"
-    "_value\030\006 \001(\001\022\024\n\014string_value\030\007 \001(\014\022\027\n\017ag"
-    "gregate_value\030\010 \001(\t\0323\n\010NamePart\022\021\n\tname_"
-    "part\030\001 \002(\t\022\024\n\014is_extension\030\002 \002(\010\"\261\001\n\016Sou"
-    "rceCodeInfo\022:\n\010location\030\001 \003(\0132(.google.p"
-    "rotobuf.SourceCodeInfo.Location\032c\n\010Locat"
-    "ion\022\020\n\004path\030\001 \003(\005B\002\020\001\022\020\n\004span\030\002 \003(\005B\002\020\001\022"
-    "\030\n\020leading_comments\030\003 \001(\t\022\031\n\021trailing_co"
-    "mments\030\004 \001(\tB)\n\023com.google.protobufB\020Des"
-    "criptorProtosH\001", 4135);
+    " \001(\0132\037.google.protobuf.ServiceOptions\"\301\001"
+    "\n\025MethodDescriptorProto\022\014\n\004name\030\001 \001(\t\022\022\n"
+    "\ninput_type\030\002 \001(\t\022\023\n\013output_type\030\003 \001(\t\022/"
+    "\n\007options\030\004 \001(\0132\036.google.protobuf.Method"
+    "Options\022\037\n\020client_streaming\030\005 \001(\010:\005false"
+    "\022\037\n\020server_streaming\030\006 \001(\010:\005false\"\351\003\n\013Fi"
+    "leOptions\022\024\n\014java_package\030\001 \001(\t\022\034\n\024java_"
+    "outer_classname\030\010 \001(\t\022\"\n\023java_multiple_f"
+    "iles\030\n \001(\010:\005false\022,\n\035java_generate_equal"
+    "s_and_hash\030\024 \001(\010:\005false\022F\n\014optimize_for\030"
+    "\t \001(\0162).google.protobuf.FileOptions.Opti"
+    "mizeMode:\005SPEED\022\022\n\ngo_package\030\013 \001(\t\022\"\n\023c"
+    "c_generic_services\030\020 \001(\010:\005false\022$\n\025java_"
+    "generic_services\030\021 \001(\010:\005false\022\"\n\023py_gene"
+    "ric_services\030\022 \001(\010:\005false\022C\n\024uninterpret"
+    "ed_option\030\347\007 \003(\0132$.google.protobuf.Unint"
+    "erpretedOption\":\n\014OptimizeMode\022\t\n\005SPEED\020"
+    "\001\022\r\n\tCODE_SIZE\020\002\022\020\n\014LITE_RUNTIME\020\003*\t\010\350\007\020"
+    "\200\200\200\200\002\"\270\001\n\016MessageOptions\022&\n\027message_set_"
+    "wire_format\030\001 \001(\010:\005false\022.\n\037no_standard_"
+    "descriptor_accessor\030\002 \001(\010:\005false\022C\n\024unin"
+    "terpreted_option\030\347\007 \003(\0132$.google.protobu"
+    "f.UninterpretedOption*\t\010\350\007\020\200\200\200\200\002\"\276\002\n\014Fie"
+    "ldOptions\022:\n\005ctype\030\001 \001(\0162#.google.protob"
+    "uf.FieldOptions.CType:\006STRING\022\016\n\006packed\030"
+    "\002 \001(\010\022\023\n\004lazy\030\005 \001(\010:\005false\022\031\n\ndeprecated"
+    "\030\003 \001(\010:\005false\022\034\n\024experimental_map_key\030\t "
+    "\001(\t\022\023\n\004weak\030\n \001(\010:\005false\022C\n\024uninterprete"
+    "d_option\030\347\007 \003(\0132$.google.protobuf.Uninte"
+    "rpretedOption\"/\n\005CType\022\n\n\006STRING\020\000\022\010\n\004CO"
+    "RD\020\001\022\020\n\014STRING_PIECE\020\002*\t\010\350\007\020\200\200\200\200\002\"x\n\013Enu"
+    "mOptions\022\031\n\013allow_alias\030\002 \001(\010:\004true\022C\n\024u"
+    "ninterpreted_option\030\347\007 \003(\0132$.google.prot"
+    "obuf.UninterpretedOption*\t\010\350\007\020\200\200\200\200\002\"b\n\020E"
+    "numValueOptions\022C\n\024uninterpreted_option\030"
+    "\347\007 \003(\0132$.google.protobuf.UninterpretedOp"
+    "tion*\t\010\350\007\020\200\200\200\200\002\"`\n\016ServiceOptions\022C\n\024uni"
+    "nterpreted_option\030\347\007 \003(\0132$.google.protob"
+    "uf.UninterpretedOption*\t\010\350\007\020\200\200\200\200\002\"_\n\rMet"
+    "hodOptions\022C\n\024uninterpreted_option\030\347\007 \003("
+    "\0132$.google.protobuf.UninterpretedOption*"
+    "\t\010\350\007\020\200\200\200\200\002\"\236\002\n\023UninterpretedOption\022;\n\004na"
+    "me\030\002 \003(\0132-.google.protobuf.Uninterpreted"
+    "Option.NamePart\022\030\n\020identifier_value\030\003 \001("
+    "\t\022\032\n\022positive_int_value\030\004 \001(\004\022\032\n\022negativ"
+    "e_int_value\030\005 \001(\003\022\024\n\014double_value\030\006 \001(\001\022"
+    "\024\n\014string_value\030\007 \001(\014\022\027\n\017aggregate_value"
+    "\030\010 \001(\t\0323\n\010NamePart\022\021\n\tname_part\030\001 \002(\t\022\024\n"
+    "\014is_extension\030\002 \002(\010\"\261\001\n\016SourceCodeInfo\022:"
+    "\n\010location\030\001 \003(\0132(.google.protobuf.Sourc"
+    "eCodeInfo.Location\032c\n\010Location\022\020\n\004path\030\001"
+    " \003(\005B\002\020\001\022\020\n\004span\030\002 \003(\005B\002\020\001\022\030\n\020leading_co"
+    "mments\030\003 \001(\t\022\031\n\021trailing_comments\030\004 \001(\tB"
+    ")\n\023com.google.protobufB\020DescriptorProtos"
+    "H\001", 4202);
   ::google::protobuf::MessageFactory::InternalRegisterGeneratedFile(
     "google/protobuf/descriptor.proto", &protobuf_RegisterTypes);
   FileDescriptorSet::default_instance_ = new FileDescriptorSet();
@@ -3962,6 +3966,8 @@ const int MethodDescriptorProto::kNameFieldNumber;
 const int MethodDescriptorProto::kInputTypeFieldNumber;
 const int MethodDescriptorProto::kOutputTypeFieldNumber;
 const int MethodDescriptorProto::kOptionsFieldNumber;
+const int MethodDescriptorProto::kClientStreamingFieldNumber;
+const int MethodDescriptorProto::kServerStreamingFieldNumber;
 #endif  // !_MSC_VER
 
 MethodDescriptorProto::MethodDescriptorProto()
@@ -3985,6 +3991,8 @@ void MethodDescriptorProto::SharedCtor() {
   input_type_ = const_cast< ::std::string*>(&::google::protobuf::internal::kEmptyString);
   output_type_ = const_cast< ::std::string*>(&::google::protobuf::internal::kEmptyString);
   options_ = NULL;
+  client_streaming_ = false;
+  server_streaming_ = false;
   ::memset(_has_bits_, 0, sizeof(_has_bits_));
 }
 
@@ -4048,6 +4056,8 @@ void MethodDescriptorProto::Clear() {
     if (has_options()) {
       if (options_ != NULL) options_->::google::protobuf::MethodOptions::Clear();
     }
+    client_streaming_ = false;
+    server_streaming_ = false;
   }
   ::memset(_has_bits_, 0, sizeof(_has_bits_));
   mutable_unknown_fields()->Clear();
@@ -4119,6 +4129,38 @@ bool MethodDescriptorProto::MergePartialFromCodedStream(
         } else {
           goto handle_uninterpreted;
         }
+        if (input->ExpectTag(40)) goto parse_client_streaming;
+        break;
+      }
+
+      // optional bool client_streaming = 5 [default = false];
+      case 5: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT) {
+         parse_client_streaming:
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   bool, ::google::protobuf::internal::WireFormatLite::TYPE_BOOL>(
+                 input, &client_streaming_)));
+          set_has_client_streaming();
+        } else {
+          goto handle_uninterpreted;
+        }
+        if (input->ExpectTag(48)) goto parse_server_streaming;
+        break;
+      }
+
+      // optional bool server_streaming = 6 [default = false];
+      case 6: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT) {
+         parse_server_streaming:
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   bool, ::google::protobuf::internal::WireFormatLite::TYPE_BOOL>(
+                 input, &server_streaming_)));
+          set_has_server_streaming();
+        } else {
+          goto handle_uninterpreted;
+        }
         if (input->ExpectAtEnd()) return true;
         break;
       }
@@ -4174,6 +4216,16 @@ void MethodDescriptorProto::SerializeWithCachedSizes(
       4, this->options(), output);
   }
 
+  // optional bool client_streaming = 5 [default = false];
+  if (has_client_streaming()) {
+    ::google::protobuf::internal::WireFormatLite::WriteBool(5, this->client_streaming(), output);
+  }
+
+  // optional bool server_streaming = 6 [default = false];
+  if (has_server_streaming()) {
+    ::google::protobuf::internal::WireFormatLite::WriteBool(6, this->server_streaming(), output);
+  }
+
   if (!unknown_fields().empty()) {
     ::google::protobuf::internal::WireFormat::SerializeUnknownFields(
         unknown_fields(), output);
@@ -4219,6 +4271,16 @@ void MethodDescriptorProto::SerializeWithCachedSizes(
         4, this->options(), target);
   }
 
+  // optional bool client_streaming = 5 [default = false];
+  if (has_client_streaming()) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteBoolToArray(5, this->client_streaming(), target);
+  }
+
+  // optional bool server_streaming = 6 [default = false];
+  if (has_server_streaming()) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteBoolToArray(6, this->server_streaming(), target);
+  }
+
   if (!unknown_fields().empty()) {
     target = ::google::protobuf::internal::WireFormat::SerializeUnknownFieldsToArray(
         unknown_fields(), target);
@@ -4258,6 +4320,16 @@ int MethodDescriptorProto::ByteSize() const {
           this->options());
     }
 
+    // optional bool client_streaming = 5 [default = false];
+    if (has_client_streaming()) {
+      total_size += 1 + 1;
+    }
+
+    // optional bool server_streaming = 6 [default = false];
+    if (has_server_streaming()) {
+      total_size += 1 + 1;
+    }
+
   }
   if (!unknown_fields().empty()) {
     total_size +=
@@ -4297,6 +4369,12 @@ void MethodDescriptorProto::MergeFrom(const MethodDescriptorProto& from) {
     if (from.has_options()) {
       mutable_options()->::google::protobuf::MethodOptions::MergeFrom(from.options());
     }
+    if (from.has_client_streaming()) {
+      set_client_streaming(from.client_streaming());
+    }
+    if (from.has_server_streaming()) {
+      set_server_streaming(from.server_streaming());
+    }
   }
   mutable_unknown_fields()->MergeFrom(from.unknown_fields());
 }
@@ -4327,6 +4405,8 @@ void MethodDescriptorProto::Swap(MethodDescriptorProto* other) {
     std::swap(input_type_, other->input_type_);
     std::swap(output_type_, other->output_type_);
     std::swap(options_, other->options_);
+    std::swap(client_streaming_, other->client_streaming_);
+    std::swap(server_streaming_, other->server_streaming_);
     std::swap(_has_bits_[0], other->_has_bits_[0]);
     _unknown_fields_.Swap(&other->_unknown_fields_);
     std::swap(_cached_size_, other->_cached_size_);
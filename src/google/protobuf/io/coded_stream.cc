@@ -247,6 +247,16 @@ bool CodedInputStream::ReadStringFallback(string* buffer, int size) {
     buffer->clear();
   }
 
+  // Reserve the whole string if a total bytes limit set by the reader
+  // vouches for its size, instead of growing it as the buffers come. The
+  // pushed limits don't count, they may come from the data.
+  if (input_ != NULL && total_bytes_limit_ != kDefaultTotalBytesLimit) {
+    int bytes_to_limit = total_bytes_limit_ - CurrentPosition();
+    if (size > 0 && size <= bytes_to_limit) {
+      buffer->reserve(size);
+    }
+  }
+
   int current_buffer_size;
   while ((current_buffer_size = BufferSize()) < size) {
     // Some STL implementations "helpfully" crash on buffer->append(NULL, 0).
@@ -0,0 +1,135 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+// source: google/protobuf/rpc/options.proto
+
+#define INTERNAL_SUPPRESS_PROTOBUF_FIELD_DEPRECATION
+#include "google/protobuf/rpc/options.pb.h"
+
+#include <algorithm>
+
+#include <google/protobuf/stubs/common.h>
+#include <google/protobuf/stubs/once.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite_inl.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/generated_message_reflection.h>
+#include <google/protobuf/reflection_ops.h>
+#include <google/protobuf/wire_format.h>
+// @@protoc_insertion_point(includes)
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+namespace {
+
+const ::google::protobuf::EnumDescriptor* Priority_descriptor_ = NULL;
+
+}  // namespace
+
+
+void protobuf_AssignDesc_google_2fprotobuf_2frpc_2foptions_2eproto() {
+  protobuf_AddDesc_google_2fprotobuf_2frpc_2foptions_2eproto();
+  const ::google::protobuf::FileDescriptor* file =
+    ::google::protobuf::DescriptorPool::generated_pool()->FindFileByName(
+      "google/protobuf/rpc/options.proto");
+  GOOGLE_CHECK(file != NULL);
+  Priority_descriptor_ = file->enum_type(0);
+}
+
+namespace {
+
+GOOGLE_PROTOBUF_DECLARE_ONCE(protobuf_AssignDescriptors_once_);
+inline void protobuf_AssignDescriptorsOnce() {
+  ::google::protobuf::GoogleOnceInit(&protobuf_AssignDescriptors_once_,
+                 &protobuf_AssignDesc_google_2fprotobuf_2frpc_2foptions_2eproto);
+}
+
+void protobuf_RegisterTypes(const ::std::string&) {
+  protobuf_AssignDescriptorsOnce();
+}
+
+}  // namespace
+
+void protobuf_ShutdownFile_google_2fprotobuf_2frpc_2foptions_2eproto() {
+}
+
+void protobuf_AddDesc_google_2fprotobuf_2frpc_2foptions_2eproto() {
+  static bool already_here = false;
+  if (already_here) return;
+  already_here = true;
+  GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+  ::google::protobuf::protobuf_AddDesc_google_2fprotobuf_2fdescriptor_2eproto();
+  ::google::protobuf::DescriptorPool::InternalAddGeneratedFile(
+    "\n!google/protobuf/rpc/options.proto\022\023goo"
+    "gle.protobuf.rpc\032 google/protobuf/descri"
+    "ptor.proto*D\n\010Priority\022\023\n\017PRIORITY_NORMA"
+    "L\020\000\022\020\n\014PRIORITY_LOW\020\001\022\021\n\rPRIORITY_HIGH\020\002"
+    ":B\n\027service_max_concurrency\022\037.google.pro"
+    "tobuf.ServiceOptions\030\270\216\003 \001(\r:Z\n\020service_"
+    "priority\022\037.google.protobuf.ServiceOption"
+    "s\030\271\216\003 \001(\0162\035.google.protobuf.rpc.Priority"
+    ":9\n\017max_concurrency\022\036.google.protobuf.Me"
+    "thodOptions\030\270\216\003 \001(\r:Q\n\010priority\022\036.google"
+    ".protobuf.MethodOptions\030\271\216\003 \001(\0162\035.google"
+    ".protobuf.rpc.Priority", 462);
+  ::google::protobuf::MessageFactory::InternalRegisterGeneratedFile(
+    "google/protobuf/rpc/options.proto", &protobuf_RegisterTypes);
+  ::google::protobuf::internal::ExtensionSet::RegisterExtension(
+    &::google::protobuf::ServiceOptions::default_instance(),
+    51000, 13, false, false);
+  ::google::protobuf::internal::ExtensionSet::RegisterEnumExtension(
+    &::google::protobuf::ServiceOptions::default_instance(),
+    51001, 14, false, false,
+    &::google::protobuf::rpc::Priority_IsValid);
+  ::google::protobuf::internal::ExtensionSet::RegisterExtension(
+    &::google::protobuf::MethodOptions::default_instance(),
+    51000, 13, false, false);
+  ::google::protobuf::internal::ExtensionSet::RegisterEnumExtension(
+    &::google::protobuf::MethodOptions::default_instance(),
+    51001, 14, false, false,
+    &::google::protobuf::rpc::Priority_IsValid);
+  ::google::protobuf::internal::OnShutdown(&protobuf_ShutdownFile_google_2fprotobuf_2frpc_2foptions_2eproto);
+}
+
+// Force AddDescriptors() to be called at static initialization time.
+struct StaticDescriptorInitializer_google_2fprotobuf_2frpc_2foptions_2eproto {
+  StaticDescriptorInitializer_google_2fprotobuf_2frpc_2foptions_2eproto() {
+    protobuf_AddDesc_google_2fprotobuf_2frpc_2foptions_2eproto();
+  }
+} static_descriptor_initializer_google_2fprotobuf_2frpc_2foptions_2eproto_;
+const ::google::protobuf::EnumDescriptor* Priority_descriptor() {
+  protobuf_AssignDescriptorsOnce();
+  return Priority_descriptor_;
+}
+bool Priority_IsValid(int value) {
+  switch(value) {
+    case 0:
+    case 1:
+    case 2:
+      return true;
+    default:
+      return false;
+  }
+}
+
+::google::protobuf::internal::ExtensionIdentifier< ::google::protobuf::ServiceOptions,
+    ::google::protobuf::internal::PrimitiveTypeTraits< ::google::protobuf::uint32 >, 13, false >
+  service_max_concurrency(kServiceMaxConcurrencyFieldNumber, 0u);
+::google::protobuf::internal::ExtensionIdentifier< ::google::protobuf::ServiceOptions,
+    ::google::protobuf::internal::EnumTypeTraits< ::google::protobuf::rpc::Priority, ::google::protobuf::rpc::Priority_IsValid>, 14, false >
+  service_priority(kServicePriorityFieldNumber, static_cast< ::google::protobuf::rpc::Priority >(0));
+::google::protobuf::internal::ExtensionIdentifier< ::google::protobuf::MethodOptions,
+    ::google::protobuf::internal::PrimitiveTypeTraits< ::google::protobuf::uint32 >, 13, false >
+  max_concurrency(kMaxConcurrencyFieldNumber, 0u);
+::google::protobuf::internal::ExtensionIdentifier< ::google::protobuf::MethodOptions,
+    ::google::protobuf::internal::EnumTypeTraits< ::google::protobuf::rpc::Priority, ::google::protobuf::rpc::Priority_IsValid>, 14, false >
+  priority(kPriorityFieldNumber, static_cast< ::google::protobuf::rpc::Priority >(0));
+
+// @@protoc_insertion_point(namespace_scope)
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
+
+// @@protoc_insertion_point(global_scope)
@@ -0,0 +1,107 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+// source: google/protobuf/rpc/options.proto
+
+#ifndef PROTOBUF_google_2fprotobuf_2frpc_2foptions_2eproto__INCLUDED
+#define PROTOBUF_google_2fprotobuf_2frpc_2foptions_2eproto__INCLUDED
+
+#include <string>
+
+#include <google/protobuf/stubs/common.h>
+
+#if GOOGLE_PROTOBUF_VERSION < 2005001
+#error This file was generated by a newer version of protoc which is
+#error incompatible with your Protocol Buffer headers.  Please update
+#error your headers.
+#endif
+#if 2005001 < GOOGLE_PROTOBUF_MIN_PROTOC_VERSION
+#error This file was generated by an older version of protoc which is
+#error incompatible with your Protocol Buffer headers.  Please
+#error regenerate this file with a newer version of protoc.
+#endif
+
+#include <google/protobuf/generated_message_util.h>
+#include <google/protobuf/repeated_field.h>
+#include <google/protobuf/extension_set.h>
+#include <google/protobuf/generated_enum_reflection.h>
+#include <google/protobuf/generated_message_reflection.h>
+#include <google/protobuf/xml/xml_message.h>
+#include "google/protobuf/descriptor.pb.h"
+// @@protoc_insertion_point(includes)
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+// Internal implementation detail -- do not call these.
+void  protobuf_AddDesc_google_2fprotobuf_2frpc_2foptions_2eproto();
+void protobuf_AssignDesc_google_2fprotobuf_2frpc_2foptions_2eproto();
+void protobuf_ShutdownFile_google_2fprotobuf_2frpc_2foptions_2eproto();
+
+
+enum Priority {
+  PRIORITY_NORMAL = 0,
+  PRIORITY_LOW = 1,
+  PRIORITY_HIGH = 2
+};
+bool Priority_IsValid(int value);
+const Priority Priority_MIN = PRIORITY_NORMAL;
+const Priority Priority_MAX = PRIORITY_HIGH;
+const int Priority_ARRAYSIZE = Priority_MAX + 1;
+
+const ::google::protobuf::EnumDescriptor* Priority_descriptor();
+inline const ::std::string& Priority_Name(Priority value) {
+  return ::google::protobuf::internal::NameOfEnum(
+    Priority_descriptor(), value);
+}
+inline bool Priority_Parse(
+    const ::std::string& name, Priority* value) {
+  return ::google::protobuf::internal::ParseNamedEnum<Priority>(
+    Priority_descriptor(), name, value);
+}
+// ===================================================================
+
+
+// ===================================================================
+
+static const int kServiceMaxConcurrencyFieldNumber = 51000;
+extern ::google::protobuf::internal::ExtensionIdentifier< ::google::protobuf::ServiceOptions,
+    ::google::protobuf::internal::PrimitiveTypeTraits< ::google::protobuf::uint32 >, 13, false >
+  service_max_concurrency;
+static const int kServicePriorityFieldNumber = 51001;
+extern ::google::protobuf::internal::ExtensionIdentifier< ::google::protobuf::ServiceOptions,
+    ::google::protobuf::internal::EnumTypeTraits< ::google::protobuf::rpc::Priority, ::google::protobuf::rpc::Priority_IsValid>, 14, false >
+  service_priority;
+static const int kMaxConcurrencyFieldNumber = 51000;
+extern ::google::protobuf::internal::ExtensionIdentifier< ::google::protobuf::MethodOptions,
+    ::google::protobuf::internal::PrimitiveTypeTraits< ::google::protobuf::uint32 >, 13, false >
+  max_concurrency;
+static const int kPriorityFieldNumber = 51001;
+extern ::google::protobuf::internal::ExtensionIdentifier< ::google::protobuf::MethodOptions,
+    ::google::protobuf::internal::EnumTypeTraits< ::google::protobuf::rpc::Priority, ::google::protobuf::rpc::Priority_IsValid>, 14, false >
+  priority;
+
+// ===================================================================
+
+
+// @@protoc_insertion_point(namespace_scope)
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
+
+#ifndef SWIG
+namespace google {
+namespace protobuf {
+
+template <>
+inline const EnumDescriptor* GetEnumDescriptor< ::google::protobuf::rpc::Priority>() {
+  return ::google::protobuf::rpc::Priority_descriptor();
+}
+
+}  // namespace google
+}  // namespace protobuf
+#endif  // SWIG
+
+// @@protoc_insertion_point(global_scope)
+
+#endif  // PROTOBUF_google_2fprotobuf_2frpc_2foptions_2eproto__INCLUDED
@@ -0,0 +1,114 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "google/protobuf/rpc/rpc_admission.h"
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+using ::google::protobuf::internal::NoBarrier_Load;
+using ::google::protobuf::internal::NoBarrier_Store;
+using ::google::protobuf::internal::NoBarrier_AtomicIncrement;
+using ::google::protobuf::internal::Barrier_AtomicIncrement;
+
+const char kOverloadedError[] = "protorpc.Server: overloaded.";
+
+Admission::Admission(): enabled_(false), inflight_(0), queued_(0),
+  queued_bytes_(0), admitted_(0), rejected_(0), shed_(0), last_empty_(0), last_delay_(0) {
+  //
+}
+Admission::~Admission() {
+  //
+}
+
+void Admission::SetLimits(const Limits& limits) {
+  limits_ = limits;
+  if(limits_.interval_ms <= 0) {
+    limits_.interval_ms = 100;
+  }
+  enabled_ = limits_.max_inflight > 0 || limits_.max_queued_bytes > 0 ||
+    limits_.target_delay_ms > 0;
+}
+
+bool Admission::Admit(int64 bytes, uint64 now) {
+  if(!enabled_) {
+    return true;
+  }
+  if(standing(now) && uint64(NoBarrier_Load(&last_delay_)) > uint64(limits_.target_delay_ms)*1000) {
+    // it would wait as long as the call started last, and be shed
+    NoBarrier_AtomicIncrement(&shed_, 1);
+    return false;
+  }
+  auto n = Barrier_AtomicIncrement(&inflight_, 1);
+  if(limits_.max_inflight > 0 && n > limits_.max_inflight) {
+    Barrier_AtomicIncrement(&inflight_, -1);
+    NoBarrier_AtomicIncrement(&rejected_, 1);
+    return false;
+  }
+  auto q = Barrier_AtomicIncrement(&queued_bytes_, AtomicWord(bytes));
+  if(limits_.max_queued_bytes > 0 && q > limits_.max_queued_bytes && q != bytes) {
+    Barrier_AtomicIncrement(&queued_bytes_, -AtomicWord(bytes));
+    Barrier_AtomicIncrement(&inflight_, -1);
+    NoBarrier_AtomicIncrement(&rejected_, 1);
+    return false;
+  }
+  if(Barrier_AtomicIncrement(&queued_, 1) == 1) {
+    // the queue was empty until now
+    NoBarrier_Store(&last_empty_, AtomicWord(now));
+  }
+  NoBarrier_AtomicIncrement(&admitted_, 1);
+  return true;
+}
+
+bool Admission::Start(int64 bytes, uint64 received, uint64 now) {
+  if(!enabled_) {
+    return true;
+  }
+  Barrier_AtomicIncrement(&queued_bytes_, -AtomicWord(bytes));
+  const bool empty = Barrier_AtomicIncrement(&queued_, -1) == 0;
+  if(empty) {
+    NoBarrier_Store(&last_empty_, AtomicWord(now));
+  }
+  if(limits_.target_delay_ms <= 0) {
+    return true;
+  }
+  const uint64 delay = (now > received)? (now - received): 0;
+  // a drained queue makes the next calls wait no longer
+  NoBarrier_Store(&last_delay_, AtomicWord(empty? 0: delay));
+  if(delay <= uint64(limits_.target_delay_ms)*1000) {
+    return true;
+  }
+  if(delay <= uint64(limits_.interval_ms)*1000 && !standing(now)) {
+    return true;
+  }
+  NoBarrier_AtomicIncrement(&shed_, 1);
+  return false;
+}
+
+void Admission::Done() {
+  if(enabled_) {
+    Barrier_AtomicIncrement(&inflight_, -1);
+  }
+}
+
+bool Admission::standing(uint64 now) {
+  if(limits_.target_delay_ms <= 0 || NoBarrier_Load(&queued_) <= 0) {
+    return false;
+  }
+  auto last_empty = uint64(NoBarrier_Load(&last_empty_));
+  return last_empty != 0 && now >= last_empty + uint64(limits_.interval_ms)*1000;
+}
+
+void Admission::GetStats(Stats* stats) {
+  stats->admitted = uint64(NoBarrier_Load(&admitted_));
+  stats->rejected = uint64(NoBarrier_Load(&rejected_));
+  stats->shed = uint64(NoBarrier_Load(&shed_));
+  stats->inflight = int(NoBarrier_Load(&inflight_));
+  stats->queued_bytes = int64(NoBarrier_Load(&queued_bytes_));
+}
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,94 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef GOOGLE_PROTOBUF_RPC_ADMISSION_H__
+#define GOOGLE_PROTOBUF_RPC_ADMISSION_H__
+
+#include <google/protobuf/stubs/common.h>
+#include <google/protobuf/stubs/atomicops.h>
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+// Error of the calls rejected or shed by the admission control, the
+// handler did not run and the client may retry on another server.
+extern const char kOverloadedError[];
+
+// Admission control of the calls of a server, shared by its connections.
+//
+// A call is admitted when its request header is received if the server
+// is under its caps, and started when a worker picks it up. The queue
+// delay of the started calls drives CoDel style shedding: while the
+// queue has not been empty for an interval (a standing queue) the calls
+// which waited longer than the target are shed, otherwise those which
+// waited longer than the interval. In a standing queue the new calls
+// are turned down at once while the call started last waited longer than
+// the target. Thread safe.
+class Admission {
+ public:
+  // 0 disables a limit, all are disabled by default.
+  struct Limits {
+    int max_inflight;        // calls admitted and not done
+    int64 max_queued_bytes;  // request bytes of the calls not started
+    int target_delay_ms;     // CoDel target of the queue delay
+    int interval_ms;         // CoDel interval, 100 by default
+
+    Limits(): max_inflight(0), max_queued_bytes(0), target_delay_ms(0), interval_ms(100) {}
+  };
+  // Counted while a limit is set.
+  struct Stats {
+    uint64 admitted;
+    uint64 rejected;  // by max_inflight or max_queued_bytes
+    uint64 shed;      // by the queue delay, when admitted or started
+    int inflight;
+    int64 queued_bytes;
+  };
+
+  Admission();
+  ~Admission();
+
+  // Set them before serving.
+  void SetLimits(const Limits& limits);
+  const Limits& GetLimits() const { return limits_; }
+  bool Enabled() const { return enabled_; }
+
+  // Admit a call whose request takes bytes received at Env::NowMicros()
+  // now, false rejects it. A call is always admitted to an empty queue,
+  // however large.
+  bool Admit(int64 bytes, uint64 now);
+  // Start an admitted call received at Env::NowMicros() received,
+  // false sheds it.
+  bool Start(int64 bytes, uint64 received, uint64 now);
+  // An admitted call is started once, then done once (also if shed).
+  void Done();
+
+  void GetStats(Stats* stats);
+
+ private:
+  typedef ::google::protobuf::internal::AtomicWord AtomicWord;
+
+  // The queue has not been empty for an interval.
+  bool standing(uint64 now);
+
+  Limits limits_;
+  bool enabled_;
+  volatile AtomicWord inflight_;
+  volatile AtomicWord queued_;  // calls not started
+  volatile AtomicWord queued_bytes_;
+  volatile AtomicWord admitted_;
+  volatile AtomicWord rejected_;
+  volatile AtomicWord shed_;
+  volatile AtomicWord last_empty_;  // Env::NowMicros() queued_ was 0 last
+  volatile AtomicWord last_delay_;  // of the call started last
+
+ private:
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(Admission);
+};
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // GOOGLE_PROTOBUF_RPC_ADMISSION_H__
@@ -4,13 +4,194 @@
 
 #include "google/protobuf/rpc/rpc_client.h"
 #include <google/protobuf/rpc/rpc_wire.h>
+#include <google/protobuf/rpc/rpc_crc32.h>
+
+#include <deque>
 
 namespace google {
 namespace protobuf {
 namespace rpc {
 
+class Client::StreamCall: public ClientStream {
+ public:
+  StreamCall(Client* client, uint64 id, uint32 methodId,
+    const wire::Compression& compression, wire::Checksum checksum):
+    client_(client), id_(id), method_id_(methodId),
+    compression_(compression), checksum_(checksum),
+    credit_(wire::kStreamWindow), write_closed_(false), done_(false), unacked_(0) {}
+  ~StreamCall();
+
+  // implements ClientStream
+  const Error Write(const ::google::protobuf::Message* msg);
+  bool Read(::google::protobuf::Message* msg);
+  const Error CloseWrite();
+  const Error Finish();
+
+  // Send a frame without client_->cv_ held.
+  Error sendFrame(wire::StreamFrame frame, uint32 window);
+  Error send(const std::string& pbHeader, const std::string& body);
+
+  Client* client_;
+  uint64 id_;
+  uint32 method_id_;
+  wire::Compression compression_;
+  wire::Checksum checksum_;
+
+  // guarded by client_->cv_
+  struct Frame {
+    wire::ResponseHeader header;
+    std::string body;
+  };
+  std::deque<Frame> in_;
+  int64 credit_;  // body bytes the server may still buffer
+  bool write_closed_;
+  bool done_;     // the server has ended the call, or the connection failed
+  Error status_;
+
+  uint32 unacked_;  // body bytes read and not granted back yet
+
+ private:
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(StreamCall);
+};
+
+Client::StreamCall::~StreamCall() {
+  bool cancel;
+  {
+    CondVarLock locker(&client_->cv_);
+    cancel = !done_;
+  }
+  if(cancel) {
+    sendFrame(wire::STREAM_CANCEL, 0);
+  }
+  CondVarLock locker(&client_->cv_);
+  client_->streams_.erase(id_);
+}
+
+Error Client::StreamCall::sendFrame(wire::StreamFrame frame, uint32 window) {
+  std::string pbHeader, body;
+  Error err = wire::MarshalStreamRequest(id_, method_id_, frame, window, NULL, &pbHeader, &body);
+  if(!err.IsNil()) {
+    return err;
+  }
+  return send(pbHeader, body);
+}
+
+Error Client::StreamCall::send(const std::string& pbHeader, const std::string& body) {
+  if(!client_->beginWrite(0, false)) {
+    return Error::New("protorpc.Client.Stream: connection closed.");
+  }
+  const std::string* frames[2] = { &pbHeader, &body };
+  bool ok = client_->conn_.SendFrames(frames, 2);
+  client_->endWrite(ok);  // the reader fails the calls
+  return ok? Error::Nil(): Error::New("protorpc.Client.Stream: SendFrames failed.");
+}
+
+const Error Client::StreamCall::Write(const ::google::protobuf::Message* msg) {
+  std::string pbHeader, body;
+  Error err = wire::MarshalStreamRequest(id_, method_id_, wire::STREAM_MESSAGE, 0, msg,
+    &pbHeader, &body, &compression_, checksum_
+  );
+  if(!err.IsNil()) {
+    return err;
+  }
+
+  {
+    CondVarLock locker(&client_->cv_);
+    while(credit_ <= 0 && !done_) {
+      client_->cv_.Wait();
+    }
+    if(done_) {
+      return status_.IsNil()? Error::New("protorpc.Client.Stream: call is done."): status_;
+    }
+    if(write_closed_) {
+      return Error::New("protorpc.Client.Stream: write is closed.");
+    }
+    credit_ -= int64(body.size());
+  }
+  return send(pbHeader, body);
+}
+
+bool Client::StreamCall::Read(::google::protobuf::Message* msg) {
+  Frame frame;
+  {
+    CondVarLock locker(&client_->cv_);
+    while(in_.empty() && !done_) {
+      client_->cv_.Wait();
+    }
+    if(in_.empty()) {
+      return false;
+    }
+    frame.header.Swap(&in_.front().header);
+    frame.body.swap(in_.front().body);
+    in_.pop_front();
+  }
+  Error err = wire::DecodeResponseBody(&frame.header, frame.body.data(), frame.body.size(), msg);
+
+  // let the server send more once half the window is read
+  uint32 window = 0;
+  bool cancel = false;
+  {
+    CondVarLock locker(&client_->cv_);
+    unacked_ += uint32(frame.body.size());
+    if(unacked_ >= wire::kStreamWindow/2 && !done_) {
+      window = unacked_;
+      unacked_ = 0;
+    }
+    if(!err.IsNil()) {
+      cancel = !done_;
+      done_ = true;
+      status_ = err;
+    }
+  }
+  if(window != 0) {
+    sendFrame(wire::STREAM_WINDOW, window);
+  }
+  if(cancel) {
+    sendFrame(wire::STREAM_CANCEL, 0);
+  }
+  return err.IsNil();
+}
+
+const Error Client::StreamCall::CloseWrite() {
+  {
+    CondVarLock locker(&client_->cv_);
+    if(done_ || write_closed_) {
+      return status_;
+    }
+    write_closed_ = true;
+  }
+  return sendFrame(wire::STREAM_END, 0);
+}
+
+const Error Client::StreamCall::Finish() {
+  CloseWrite();
+
+  for(;;) {
+    // skip the unread messages, the server may be blocked on them
+    uint32 n = 0;
+    {
+      CondVarLock locker(&client_->cv_);
+      while(in_.empty() && !done_) {
+        client_->cv_.Wait();
+      }
+      while(!in_.empty()) {
+        n += uint32(in_.front().body.size());
+        in_.pop_front();
+      }
+      if(done_) {
+        return status_;
+      }
+    }
+    sendFrame(wire::STREAM_WINDOW, n);
+  }
+}
+
 Client::Client(const char* host, int port, Env* env):
-  conn_(0,env), host_(host), port_(port), seq_(0) {
+  host_(host), port_(port), env_(env? env: Env::Default()), conn_(0,env),
+  seq_(0), reading_(false), round_trip_(false), writers_(0), timeout_ms_(0), connect_timeout_ms_(0),
+  protocol_v2_(false), crc32c_(false), version_(wire::kProtocolV1), checksum_(wire::kCRC32),
+  chunked_(false), keepalive_ms_(0), keepalive_timeout_ms_(0), last_used_(0),
+  writing_(false), last_recv_(0), ping_sent_(false), ping_deadline_(0) {
   //
 }
 Client::~Client() {
@@ -27,7 +208,7 @@ const ::google::protobuf::rpc::Error Client::CallMethod(
       std::string("protorpc.Client.CallMethod: Invalid method, method: ") + method
     );
   }
-  return callMethod(method, request, response);
+  return callMethod(method, request, response, -1);
 }
 
 const ::google::protobuf::rpc::Error Client::CallMethod(
@@ -40,61 +221,685 @@ const ::google::protobuf::rpc::Error Client::CallMethod(
       std::string("protorpc.Client.CallMethod: Invalid method, method: ") + Service::GetServiceMethodName(method)
     );
   }
-  return callMethod(Service::GetServiceMethodName(method), request, response);
+  return callMethod(Service::GetServiceMethodName(method), request, response, -1);
+}
+
+const ::google::protobuf::rpc::Error Client::CallMethod(
+  const std::string& method,
+  const ::google::protobuf::Message* request,
+  ::google::protobuf::Message* response,
+  int timeout_ms
+) {
+  if(!checkMothdValid(method, request, response)) {
+    return ::google::protobuf::rpc::Error::New(
+      std::string("protorpc.Client.CallMethod: Invalid method, method: ") + method
+    );
+  }
+  return callMethod(method, request, response, timeout_ms > 0? timeout_ms: 0);
+}
+
+const ::google::protobuf::rpc::Error Client::CallMethod(
+  const ::google::protobuf::MethodDescriptor* method,
+  const ::google::protobuf::Message* request,
+  ::google::protobuf::Message* response,
+  int timeout_ms
+) {
+  if(!checkMothdValid(method, request, response)) {
+    return ::google::protobuf::rpc::Error::New(
+      std::string("protorpc.Client.CallMethod: Invalid method, method: ") +
+      (method? Service::GetServiceMethodName(method): std::string())
+    );
+  }
+  return callMethod(Service::GetServiceMethodName(method), request, response, timeout_ms > 0? timeout_ms: 0);
+}
+
+std::shared_ptr<Future> Client::CallMethodAsync(
+  const std::string& method,
+  const ::google::protobuf::Message* request,
+  ::google::protobuf::Message* response,
+  const Callback& done
+) {
+  if(!checkMothdValid(method, request, response)) {
+    std::shared_ptr<Future> future(new Future);
+    future->Done(::google::protobuf::rpc::Error::New(
+      std::string("protorpc.Client.CallMethodAsync: Invalid method, method: ") + method
+    ), done);
+    return future;
+  }
+  return callMethodAsync(method, request, response, done, -1);
+}
+
+std::shared_ptr<Future> Client::CallMethodAsync(
+  const ::google::protobuf::MethodDescriptor* method,
+  const ::google::protobuf::Message* request,
+  ::google::protobuf::Message* response,
+  const Callback& done
+) {
+  return CallMethodAsync(method, request, response, done, -1);
+}
+
+std::shared_ptr<Future> Client::CallMethodAsync(
+  const ::google::protobuf::MethodDescriptor* method,
+  const ::google::protobuf::Message* request,
+  ::google::protobuf::Message* response,
+  const Callback& done,
+  int timeout_ms
+) {
+  if(!checkMothdValid(method, request, response)) {
+    std::shared_ptr<Future> future(new Future);
+    future->Done(::google::protobuf::rpc::Error::New(
+      std::string("protorpc.Client.CallMethodAsync: Invalid method, method: ") +
+      (method? Service::GetServiceMethodName(method): std::string())
+    ), done);
+    return future;
+  }
+  return callMethodAsync(Service::GetServiceMethodName(method), request, response, done, timeout_ms);
+}
+
+std::unique_ptr<ClientStream> Client::NewStream(
+  const ::google::protobuf::MethodDescriptor* method
+) {
+  if(method == NULL) {
+    return ClientStream::NewError(Error::New("protorpc.Client.NewStream: Invalid method."));
+  }
+  return NewStream(Service::GetServiceMethodName(method));
+}
+
+std::unique_ptr<ClientStream> Client::NewStream(
+  const std::string& method
+) {
+  StreamCall* stream;
+  {
+    CondVarLock locker(&cv_);
+    while(round_trip_) {
+      cv_.Wait();
+    }
+    Error err = dial();
+    uint32 methodId = 0;
+    if(err.IsNil() && version_ != wire::kProtocolV2) {
+      err = Error::New("protorpc.Client.NewStream: streaming calls need protocol v2.");
+    } else if(err.IsNil() && !findMethodId(method, &methodId)) {
+      err = Error::New("protorpc.Client.NewStream: Can't find ServiceMethod: " + method);
+    }
+    if(!err.IsNil()) {
+      return ClientStream::NewError(err);
+    }
+
+    // the reader delivers the messages, and fails the stream if the
+    // open frame can't be sent
+    stream = new StreamCall(this, seq_++, methodId, *getCompression(method), checksum_);
+    streams_[stream->id_] = stream;
+    if(!reading_) {
+      reading_ = true;
+      env_->StartThread(&Client::ReadProc, this);
+    }
+  }
+  stream->sendFrame(wire::STREAM_OPEN, 0);
+  return std::unique_ptr<ClientStream>(stream);
+}
+
+void Client::SetTimeout(int timeout_ms) {
+  CondVarLock locker(&cv_);
+  timeout_ms_ = (timeout_ms > 0)? timeout_ms: 0;
+}
+
+void Client::SetConnectTimeout(int timeout_ms) {
+  CondVarLock locker(&cv_);
+  connect_timeout_ms_ = (timeout_ms > 0)? timeout_ms: 0;
+}
+
+void Client::SetProtocolV2(bool enabled) {
+  CondVarLock locker(&cv_);
+  protocol_v2_ = enabled;
+}
+
+void Client::SetCRC32C(bool enabled) {
+  CondVarLock locker(&cv_);
+  crc32c_ = enabled;
+}
+
+void Client::SetMaxBodyLen(uint32 n) {
+  CondVarLock locker(&cv_);
+  conn_.SetMaxBodyLen(n);
+}
+
+void Client::SetCompression(const wire::Compression& compression) {
+  CondVarLock locker(&cv_);
+  compression_ = compression;
+}
+
+void Client::SetMethodCompression(const std::string& method, const wire::Compression& compression) {
+  CondVarLock locker(&cv_);
+  method_compression_[Service::CamelCase(method)] = compression;
+}
+
+void Client::SetKeepalive(int interval_ms, int timeout_ms) {
+  CondVarLock locker(&cv_);
+  keepalive_ms_ = (interval_ms > 0)? interval_ms: 0;
+  keepalive_timeout_ms_ = (timeout_ms > 0)? timeout_ms: keepalive_ms_;
 }
 
 // Close the connection
 void Client::Close() {
+  CondVarLock locker(&cv_);
+  while(round_trip_) {
+    cv_.Wait();
+  }
+  if(reading_) {
+    conn_.Shutdown();
+    while(reading_) {
+      cv_.Wait();
+    }
+  }
   conn_.Close();
 }
 
 // --------------------------------------------------------
 
+// timeout_ms < 0 selects the default timeout.
 const ::google::protobuf::rpc::Error Client::callMethod(
   const std::string& method,
   const ::google::protobuf::Message* request,
-  ::google::protobuf::Message* response
+  ::google::protobuf::Message* response,
+  int timeout_ms
 ) {
+  bool roundTrip = false;
+  uint64 id = 0;
+  uint32 methodId = 0;
+  int version = wire::kProtocolV1;
+  wire::Checksum checksum = wire::kCRC32;
+  bool chunked = false;
+  wire::Compression compression;
+  {
+    // No other call in flight: do a plain round trip, the calls started
+    // meanwhile go through the reader. The reader sends the keepalive
+    // pings.
+    CondVarLock locker(&cv_);
+    if(timeout_ms < 0) {
+      timeout_ms = timeout_ms_;
+    }
+    if(!reading_ && !round_trip_ && keepalive_ms_ == 0) {
+      Error err = dial();
+      if(!err.IsNil()) {
+        return err;
+      }
+      if(version_ == wire::kProtocolV2 && !findMethodId(method, &methodId)) {
+        return Error::New("protorpc.Client.callMethod: Can't find ServiceMethod: " + method);
+      }
+      id = seq_++;
+      version = version_;
+      checksum = checksum_;
+      chunked = chunked_;
+      compression = *getCompression(method);
+      round_trip_ = roundTrip = true;
+    }
+  }
+  if(roundTrip) {
+    Error err = wire::RoundTrip(&conn_, id, method, request, response, uint32(timeout_ms),
+      version, methodId, &compression, checksum, chunked
+    );
+    CondVarLock locker(&cv_);
+    round_trip_ = false;
+    cv_.SignalAll();
+    return err;
+  }
+  std::shared_ptr<Future> future = callMethodAsync(method, request, response, Callback(), timeout_ms);
+  return future->Wait();
+}
+
+std::shared_ptr<Future> Client::callMethodAsync(
+  const std::string& method,
+  const ::google::protobuf::Message* request,
+  ::google::protobuf::Message* response,
+  const Callback& done,
+  int timeout_ms
+) {
+  std::shared_ptr<Future> future(new Future);
+  Error err;
+  uint64 id = 0;
+  uint32 methodId = 0;
+  int version = wire::kProtocolV1;
+  wire::Checksum checksum = wire::kCRC32;
+  bool chunked = false;
+  wire::Compression compression;
+  {
+    CondVarLock locker(&cv_);
+    if(timeout_ms < 0) {
+      timeout_ms = timeout_ms_;
+    }
+    while(round_trip_) {
+      cv_.Wait();
+    }
+    err = dial();
+    if(err.IsNil() && version_ == wire::kProtocolV2 && !findMethodId(method, &methodId)) {
+      err = Error::New("protorpc.Client.callMethod: Can't find ServiceMethod: " + method);
+    } else if(err.IsNil()) {
+      id = seq_++;
+      PendingCall& call = pending_[id];
+      call.response = response;
+      call.future = future;
+      call.done = done;
+      call.deadline = 0;
+      if(timeout_ms > 0) {
+        call.deadline = env_->NowMicros() + uint64(timeout_ms)*1000;
+        deadlines_.insert(std::make_pair(call.deadline, id));
+      }
+      version = version_;
+      checksum = checksum_;
+      chunked = chunked_;
+      compression = *getCompression(method);
+
+      // the reader may match the response before the send returns
+      if(!reading_) {
+        reading_ = true;
+        env_->StartThread(&Client::ReadProc, this);
+      }
+    }
+  }
+  if(!err.IsNil()) {
+    future->Done(err, done);
+    return future;
+  }
+
+  // the deadline of the call bounds its send too
+  if(!beginWrite(timeout_ms, false)) {
+    err = Error::New("protorpc.Client.callMethod: connection closed.");
+  } else {
+    err = wire::SendRequest(&conn_, id, method, request, uint32(timeout_ms), version, methodId,
+      &compression, checksum, chunked
+    );
+    if(!err.IsNil() && conn_.TimedOut()) {
+      err = Error::New("protorpc.Client.callMethod: timeout.");
+    }
+    endWrite(err.IsNil());
+  }
+  if(!err.IsNil()) {
+    // unless the reader has failed it already
+    PendingCall call;
+    bool found = false;
+    {
+      CondVarLock locker(&cv_);
+      auto it = pending_.find(id);
+      if(it != pending_.end()) {
+        call = it->second;
+        if(call.deadline != 0) {
+          deadlines_.erase(std::make_pair(call.deadline, id));
+        }
+        pending_.erase(it);
+        found = true;
+      }
+    }
+    if(found) {
+      call.future->Done(err, call.done);
+    }
+  }
+  return future;
+}
+
+bool Client::beginWrite(int timeout_ms, bool try_only) {
+  {
+    CondVarLock locker(&cv_);
+    if(!conn_.IsValid()) {
+      return false;
+    }
+    writers_++;
+  }
+  bool busy = false;
+  {
+    CondVarLock locker(&write_cv_);
+    while(writing_ && !try_only) {
+      write_cv_.Wait();
+    }
+    busy = writing_;
+    writing_ = true;
+  }
+  if(busy) {
+    CondVarLock locker(&cv_);
+    writers_--;
+    cv_.SignalAll();
+    return false;
+  }
+  conn_.SetWriteTimeout(timeout_ms);
+  return true;
+}
+
+void Client::endWrite(bool ok) {
+  conn_.SetWriteTimeout(0);
+  {
+    CondVarLock locker(&write_cv_);
+    writing_ = false;
+    write_cv_.Signal();
+  }
+  CondVarLock locker(&cv_);
+  writers_--;
+  if(!ok) {
+    conn_.Shutdown();
+  }
+  if(writers_ == 0) {
+    cv_.SignalAll();
+  }
+}
+
+const ::google::protobuf::rpc::Error Client::dial() {
+  // A connection left idle may have been closed by the server (see
+  // Server::SetIdleTimeout): dial again rather than fail the call. The
+  // reader notices it by itself.
+  static const uint64 kStaleCheckMicros = 10*1000;
+
+  if(conn_.IsValid() && !reading_) {
+    uint64 now = env_->NowMicros();
+    if(now - last_used_ >= kStaleCheckMicros && conn_.WaitReadable(0)) {
+      conn_.Close();
+    }
+    last_used_ = now;
+  }
   if(!conn_.IsValid()) {
-    if(!conn_.DialTCP(host_.c_str(), port_)) {
+    if(!conn_.Dial(host_.c_str(), port_, connect_timeout_ms_)) {
       return ::google::protobuf::rpc::Error::New(
-        std::string("protorpc.Client.callMethod: DialTCP fail, ") +
+        std::string("protorpc.Client.callMethod: Dial fail, ") +
         std::string("host: ") + host_ + std::string(":") + std::to_string(static_cast<long long>(port_))
       );
     }
+    return handshake();
   }
+  return Error::Nil();
+}
 
-  Error err;
+const ::google::protobuf::rpc::Error Client::handshake() {
+  version_ = wire::kProtocolV1;
+  checksum_ = wire::kCRC32;
+  chunked_ = false;
+  method_ids_.clear();
+  if(!protocol_v2_) {
+    return Error::Nil();
+  }
 
-  uint64 id = seq_++;
-  wire::ResponseHeader respHeader;
+  wire::HandshakeRequest request;
+  wire::HandshakeResponse response;
+  request.set_version(wire::kProtocolV2);
+  request.set_crc32c(crc32c_ && HasHardwareCRC32C());
+  request.set_chunked(true);
+  Error err = wire::RoundTrip(&conn_, seq_++, wire::kHandshakeMethod, &request, &response,
+    uint32(connect_timeout_ms_)
+  );
+  if(!conn_.IsValid()) {
+    return Error::New("protorpc.Client.callMethod: Handshake fail, " + err.String());
+  }
+  // servers without v2 fail the call, stay on v1
+  if(err.IsNil() && response.version() == uint32(wire::kProtocolV2)) {
+    version_ = wire::kProtocolV2;
+    checksum_ = response.crc32c()? wire::kCRC32C: wire::kCRC32;
+    chunked_ = response.chunked();
+    for(int i = 0; i < response.methods_size(); i++) {
+      method_ids_[response.methods(i)] = uint32(i);
+    }
+  }
+  return Error::Nil();
+}
 
-  // send request
-  err = wire::SendRequest(&conn_, id, method, request);
-  if(!err.IsNil()) {
-    return err;
+bool Client::findMethodId(const std::string& method, uint32* id) const {
+  auto it = method_ids_.find(method);
+  if(it == method_ids_.end()) {
+    it = method_ids_.find(Service::CamelCase(method));
+    if(it == method_ids_.end()) {
+      return false;
+    }
   }
+  *id = it->second;
+  return true;
+}
 
-  // recv response hdr
-  err = wire::RecvResponseHeader(&conn_, &respHeader);
-  if(!err.IsNil()) {
-    return err;
+const wire::Compression* Client::getCompression(const std::string& method) const {
+  if(!method_compression_.empty()) {
+    auto it = method_compression_.find(method);
+    if(it == method_compression_.end()) {
+      it = method_compression_.find(Service::CamelCase(method));
+    }
+    if(it != method_compression_.end()) {
+      return &it->second;
+    }
   }
-  // recv response body
-  err = wire::RecvResponseBody(&conn_, &respHeader, response);
-  if(!err.IsNil()) {
-    return err;
+  return &compression_;
+}
+
+void Client::ReadProc(void* p) {
+  static_cast<Client*>(p)->readLoop();
+}
+
+int Client::expireCalls() {
+  // A call added later with an earlier deadline is noticed at the next
+  // tick at the latest.
+  static const int kMaxWaitMs = 10;
+
+  std::vector<PendingCall> expired;
+  int wait_ms = -1;
+  {
+    CondVarLock locker(&cv_);
+    uint64 now = env_->NowMicros();
+    while(!deadlines_.empty() && deadlines_.begin()->first <= now) {
+      auto it = pending_.find(deadlines_.begin()->second);
+      if(it != pending_.end()) {
+        expired.push_back(it->second);
+        pending_.erase(it);
+      }
+      deadlines_.erase(deadlines_.begin());
+    }
+    if(!deadlines_.empty()) {
+      uint64 wait = (deadlines_.begin()->first - now + 999) / 1000;
+      wait_ms = (wait < uint64(kMaxWaitMs))? int(wait): kMaxWaitMs;
+    }
   }
-  if(respHeader.id() != id) {
-    return Error::New("protorpc.Client.callMethod: unexpected call id.");
+  for(size_t i = 0; i < expired.size(); i++) {
+    expired[i].future->Done(
+      Error::New("protorpc.Client.callMethod: timeout."), expired[i].done
+    );
   }
-  if(!respHeader.error().empty()) {
-    return Error::New(respHeader.error());
+  return wait_ms;
+}
+
+int Client::checkKeepalive(bool* dead) {
+  int interval_ms, timeout_ms;
+  {
+    CondVarLock locker(&cv_);
+    interval_ms = keepalive_ms_;
+    timeout_ms = keepalive_timeout_ms_;
   }
+  uint64 now = env_->NowMicros();
+  uint64 due;
+  if(ping_sent_) {
+    due = ping_deadline_;
+    if(now >= due) {
+      *dead = true;
+      return -1;
+    }
+  } else {
+    due = last_recv_ + uint64(interval_ms)*1000;
+    if(now >= due) {
+      // The answer is skipped as the one of a call given up. The ping
+      // can't wait behind another write, which may be stuck on a dead
+      // peer: the timeout applies to that write then.
+      if(beginWrite(timeout_ms, true)) {
+        uint64 id;
+        {
+          CondVarLock locker(&cv_);
+          id = seq_++;
+        }
+        Error err = wire::SendRequest(&conn_, id, wire::kPingMethod, NULL, 0,
+          version_, wire::kPingMethodId, NULL, checksum_
+        );
+        endWrite(err.IsNil());
+        if(!err.IsNil()) {
+          *dead = true;
+          return -1;
+        }
+      }
+      ping_sent_ = true;
+      ping_deadline_ = now + uint64(timeout_ms)*1000;
+      due = ping_deadline_;
+    }
+  }
+  return int((due - now + 999) / 1000);
+}
 
+// Runs on its own thread while asynchronous calls are in flight (or
+// keepalive is on), until the connection fails or is closed.
+void Client::readLoop() {
+  bool keepalive;
+  {
+    CondVarLock locker(&cv_);
+    keepalive = keepalive_ms_ > 0;
+  }
+  last_recv_ = env_->NowMicros();
+  ping_sent_ = false;
+
+  Error err;
+  for(;;) {
+    // expire overdue calls while waiting for the next response,
+    // their late responses are skipped below
+    bool dead = false;
+    for(;;) {
+      int wait_ms = expireCalls();
+      if(keepalive) {
+        int ping_ms = checkKeepalive(&dead);
+        if(dead) {
+          break;
+        }
+        if(wait_ms < 0 || ping_ms < wait_ms) {
+          wait_ms = ping_ms;
+        }
+      }
+      if(conn_.WaitReadable(wait_ms)) {
+        break;
+      }
+    }
+    if(dead) {
+      err = Error::New("protorpc.Client.readLoop: keepalive timeout.");
+      break;
+    }
+
+    wire::ResponseHeader respHeader;
+    err = wire::RecvResponseHeader(&conn_, &respHeader, version_);
+    if(!err.IsNil()) {
+      break;
+    }
+    if(keepalive) {
+      last_recv_ = env_->NowMicros();
+      ping_sent_ = false;
+    }
+    if(respHeader.stream() != wire::STREAM_NONE) {
+      err = recvStreamFrame(respHeader);
+      if(!err.IsNil()) {
+        break;
+      }
+      continue;
+    }
+
+    PendingCall call;
+    bool found = false;
+    {
+      CondVarLock locker(&cv_);
+      auto it = pending_.find(respHeader.id());
+      if(it != pending_.end()) {
+        call = it->second;
+        if(call.deadline != 0) {
+          deadlines_.erase(std::make_pair(call.deadline, it->first));
+        }
+        pending_.erase(it);
+        found = true;
+      }
+    }
+    if(!found) {
+      // the end of a stream, or of a call given up
+      err = wire::SkipResponseBody(&conn_, &respHeader);
+      if(!err.IsNil()) {
+        break;
+      }
+      endStream(respHeader.id(), Error::New(respHeader.error()));
+      continue;
+    }
+
+    err = wire::RecvResponseBody(&conn_, &respHeader, call.response);
+    if(!err.IsNil()) {
+      call.future->Done(err, call.done);
+      break;
+    }
+    if(!respHeader.error().empty()) {
+      call.future->Done(Error::New(respHeader.error()), call.done);
+    } else {
+      call.future->Done(Error::Nil(), call.done);
+    }
+  }
+
+  // Fail the pending calls outside the lock, the callbacks may start new
+  // calls: they fail fast on the shut down connection until reading_ is
+  // cleared, then dial again.
+  for(;;) {
+    std::map<uint64, PendingCall> failed;
+    {
+      CondVarLock locker(&cv_);
+      conn_.Shutdown();
+      for(auto it = streams_.begin(); it != streams_.end(); ++it) {
+        if(!it->second->done_) {
+          it->second->done_ = true;
+          it->second->status_ = err;
+        }
+      }
+      if(pending_.empty()) {
+        // the writers fail on the shut down connection
+        if(writers_ > 0) {
+          cv_.Wait();
+          continue;
+        }
+        conn_.Close();
+        reading_ = false;
+        cv_.SignalAll();
+        break;
+      }
+      failed.swap(pending_);
+      deadlines_.clear();
+      cv_.SignalAll();
+    }
+    for(auto it = failed.begin(); it != failed.end(); ++it) {
+      it->second.future->Done(err, it->second.done);
+    }
+  }
+}
+
+Error Client::recvStreamFrame(const wire::ResponseHeader& header) {
+  int len;
+  auto body = conn_.PeekFrame(&len);
+  if(body == NULL) {
+    return Error::New("protorpc.Client.readLoop: RecvFrame failed.");
+  }
+  {
+    CondVarLock locker(&cv_);
+    auto it = streams_.find(header.id());
+    if(it != streams_.end() && !it->second->done_) {
+      auto stream = it->second;
+      if(header.stream() == wire::STREAM_MESSAGE) {
+        stream->in_.push_back(StreamCall::Frame());
+        stream->in_.back().header.CopyFrom(header);
+        stream->in_.back().body.assign(body, len);
+      } else if(header.stream() == wire::STREAM_WINDOW) {
+        stream->credit_ += header.window();
+      }
+      cv_.SignalAll();
+    }
+  }
+  conn_.Consume(len);
   return Error::Nil();
 }
 
+void Client::endStream(uint64 id, const Error& err) {
+  CondVarLock locker(&cv_);
+  auto it = streams_.find(id);
+  if(it != streams_.end() && !it->second->done_) {
+    it->second->done_ = true;
+    it->second->status_ = err;
+    cv_.SignalAll();
+  }
+}
+
 // --------------------------------------------------------
 
 bool Client::checkMothdValid(
@@ -7,6 +7,11 @@
 
 #include <google/protobuf/rpc/rpc_conn.h>
 #include <google/protobuf/rpc/rpc_service.h>
+#include <google/protobuf/rpc/rpc_stream.h>
+#include <google/protobuf/rpc/rpc_wire.h>
+
+#include <map>
+#include <set>
 
 namespace google {
 namespace protobuf {
@@ -14,8 +19,17 @@ namespace rpc {
 
 class Env;
 
+// Client is safe for concurrent use. Asynchronous calls share one
+// connection: requests are written as they come, and a reader thread
+// matches the responses to the pending calls by id.
+//
+// Calls with a timeout fail with a timeout error once it passes, and send
+// it to the server in RequestHeader.timeout_ms so that the server can skip
+// the calls nobody waits for.
 class Client: public Caller {
  public:
+  // host "unix:PATH" connects to a unix domain socket, "shm:PATH" to the
+  // shared memory transport of a Server::ListenShm listener (port is unused).
   Client(const char* host, int port, Env* env=NULL);
   ~Client();
 
@@ -28,14 +42,125 @@ class Client: public Caller {
     const ::google::protobuf::Message* request,
     ::google::protobuf::Message* response);
 
-  // Close the connection
+  // Call with a timeout in milliseconds, 0 for none.
+  const ::google::protobuf::rpc::Error CallMethod(
+    const std::string& method,
+    const ::google::protobuf::Message* request,
+    ::google::protobuf::Message* response,
+    int timeout_ms);
+  const ::google::protobuf::rpc::Error CallMethod(
+    const ::google::protobuf::MethodDescriptor* method,
+    const ::google::protobuf::Message* request,
+    ::google::protobuf::Message* response,
+    int timeout_ms);
+
+  // Start a call, see Caller::CallMethodAsync.
+  // "done" runs on the reader thread and must not Close() the client.
+  std::shared_ptr<Future> CallMethodAsync(
+    const std::string& method,
+    const ::google::protobuf::Message* request,
+    ::google::protobuf::Message* response,
+    const Callback& done = Callback());
+  std::shared_ptr<Future> CallMethodAsync(
+    const ::google::protobuf::MethodDescriptor* method,
+    const ::google::protobuf::Message* request,
+    ::google::protobuf::Message* response,
+    const Callback& done = Callback());
+  std::shared_ptr<Future> CallMethodAsync(
+    const ::google::protobuf::MethodDescriptor* method,
+    const ::google::protobuf::Message* request,
+    ::google::protobuf::Message* response,
+    const Callback& done,
+    int timeout_ms);
+
+  // Start a streaming call, see Caller::NewStream. Streams need protocol
+  // v2 (see SetProtocolV2) and a server run by Server::Serve, and must be
+  // deleted before the client. The timeouts don't apply to them.
+  std::unique_ptr<ClientStream> NewStream(
+    const std::string& method);
+  std::unique_ptr<ClientStream> NewStream(
+    const ::google::protobuf::MethodDescriptor* method);
+
+  // Timeout of the calls that don't set one, 0 (the default) for none.
+  void SetTimeout(int timeout_ms);
+  // Timeout of connecting to the server, 0 (the default) for none.
+  void SetConnectTimeout(int timeout_ms);
+
+  // Negotiate protocol v2 (see wire.proto) on the next connections, false
+  // by default. Servers without v2 (like the Go ones) fail the handshake
+  // and the connection stays on v1.
+  void SetProtocolV2(bool enabled);
+  // Ask for CRC32C body checksums in the v2 handshake, used if both sides
+  // compute it in hardware. False by default.
+  void SetCRC32C(bool enabled);
+
+  // Compression of the request bodies on v2 connections, for all the
+  // methods or for one ("Service.Method").
+  void SetCompression(const wire::Compression& compression);
+  void SetMethodCompression(const std::string& method, const wire::Compression& compression);
+
+  // Longest raw response body accepted, see Conn::SetMaxBodyLen. Set it
+  // before the first call.
+  void SetMaxBodyLen(uint32 n);
+
+  // Check the quiet connections: once nothing was received for
+  // interval_ms, send a ping (see wire.proto), and shut the connection
+  // down, failing the pending calls, if nothing comes back within
+  // timeout_ms (interval_ms if <= 0). 0 (the default) disables it. With
+  // keepalive all the calls go through the reader thread. Set it before
+  // the first call.
+  void SetKeepalive(int interval_ms, int timeout_ms);
+
+  // Close the connection, pending calls fail.
   void Close();
 
  private:
+  class StreamCall;
+
+  struct PendingCall {
+    ::google::protobuf::Message* response;
+    std::shared_ptr<Future> future;
+    Callback done;
+    uint64 deadline;  // Env::NowMicros(), 0 for none
+  };
+
   const ::google::protobuf::rpc::Error callMethod(
     const std::string& method,
     const ::google::protobuf::Message* request,
-    ::google::protobuf::Message* response);
+    ::google::protobuf::Message* response,
+    int timeout_ms);
+  std::shared_ptr<Future> callMethodAsync(
+    const std::string& method,
+    const ::google::protobuf::Message* request,
+    ::google::protobuf::Message* response,
+    const Callback& done,
+    int timeout_ms);
+
+  // Requires cv_ held.
+  const ::google::protobuf::rpc::Error dial();
+  const ::google::protobuf::rpc::Error handshake();
+  bool findMethodId(const std::string& method, uint32* id) const;
+  const wire::Compression* getCompression(const std::string& method) const;
+
+  // Take the write side of conn_, without cv_ held, the writes fail after
+  // timeout_ms (0: no limit). With try_only give up if another thread is
+  // writing. Return false if conn_ is closed, endWrite() follows a true.
+  bool beginWrite(int timeout_ms, bool try_only);
+  // Release it, a failed write shuts conn_ down (the reader fails the
+  // calls).
+  void endWrite(bool ok);
+
+  static void ReadProc(void* p);
+  void readLoop();
+  // Queue a message or window of a stream, end a stream.
+  Error recvStreamFrame(const wire::ResponseHeader& header);
+  void endStream(uint64 id, const Error& err);
+  // Fail the pending calls whose deadline has passed, return the
+  // milliseconds to wait for the next response (-1: no limit).
+  int expireCalls();
+  // Send a ping if the connection is quiet, return the milliseconds to
+  // the next check (-1: no limit). dead once the ping is not answered.
+  int checkKeepalive(bool* dead);
 
   bool checkMothdValid(
     const std::string& method,
@@ -48,9 +173,42 @@ class Client: public Caller {
 
   std::string host_;
   int port_;
+  Env* env_;
   Conn conn_;
   uint64 seq_;
 
+  // The socket I/O is done without cv_: the reader thread owns the reads,
+  // a writer owns the writes between beginWrite() and endWrite(), and a
+  // round trip owns both while there is no reader.
+  CondVar cv_;  // guards the fields below and seq_
+  std::map<uint64, PendingCall> pending_;
+  std::map<uint64, StreamCall*> streams_;
+  std::set<std::pair<uint64, uint64> > deadlines_;  // (deadline, id)
+  bool reading_;  // a reader thread owns the read side of conn_
+  bool round_trip_;  // a call owns conn_ without the reader
+  int writers_;  // between beginWrite() and endWrite(), conn_ stays open
+  int timeout_ms_;
+  int connect_timeout_ms_;
+  bool protocol_v2_;
+  bool crc32c_;
+  int version_;  // of conn_, read by the reader thread
+  wire::Checksum checksum_;
+  bool chunked_;  // large bodies are sent in chunks
+  std::map<std::string, uint32> method_ids_;  // protocol v2
+  wire::Compression compression_;
+  std::map<std::string, wire::Compression> method_compression_;
+  int keepalive_ms_;
+  int keepalive_timeout_ms_;
+  uint64 last_used_;  // Env::NowMicros() of the last dial() check
+
+  CondVar write_cv_;  // guards writing_
+  bool writing_;
+
+  // used by the reader only
+  uint64 last_recv_;      // Env::NowMicros() of the last frame received
+  bool ping_sent_;        // no frame since the ping
+  uint64 ping_deadline_;
+
  private:
   GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(Client);
 };
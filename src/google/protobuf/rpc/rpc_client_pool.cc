@@ -0,0 +1,146 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "google/protobuf/rpc/rpc_client_pool.h"
+#include <google/protobuf/rpc/rpc_wire.h>
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+ClientPool::ClientPool(const char* host, int port,
+  int max_conns, int warm_conns, Env* env
+):
+  host_(host), port_(port), max_conns_(max_conns > 0? max_conns: 1), env_(env),
+  num_conns_(0), seq_(0) {
+  if(warm_conns > max_conns_) warm_conns = max_conns_;
+  for(int i = 0; i < warm_conns; i++) {
+    Conn* conn = dial();
+    if(conn == NULL) break;
+    idle_.push_back(conn);
+    num_conns_++;
+  }
+}
+ClientPool::~ClientPool() {
+  Close();
+}
+
+const ::google::protobuf::rpc::Error ClientPool::CallMethod(
+  const std::string& method,
+  const ::google::protobuf::Message* request,
+  ::google::protobuf::Message* response
+) {
+  if(method.empty() || !request || !response) {
+    return ::google::protobuf::rpc::Error::New(
+      std::string("protorpc.ClientPool.CallMethod: Invalid method, method: ") + method
+    );
+  }
+  return callMethod(method, request, response);
+}
+
+const ::google::protobuf::rpc::Error ClientPool::CallMethod(
+  const ::google::protobuf::MethodDescriptor* method,
+  const ::google::protobuf::Message* request,
+  ::google::protobuf::Message* response
+) {
+  if(!method || !request || !response ||
+    method->input_type() != request->GetDescriptor() ||
+    method->output_type() != response->GetDescriptor()
+  ) {
+    return ::google::protobuf::rpc::Error::New(
+      std::string("protorpc.ClientPool.CallMethod: Invalid method, method: ") +
+      (method? Service::GetServiceMethodName(method): std::string())
+    );
+  }
+  return callMethod(Service::GetServiceMethodName(method), request, response);
+}
+
+void ClientPool::Close() {
+  CondVarLock locker(&cv_);
+  for(size_t i = 0; i < idle_.size(); i++) {
+    idle_[i]->Close();
+    delete idle_[i];
+  }
+  num_conns_ -= int(idle_.size());
+  idle_.clear();
+  cv_.SignalAll();
+}
+
+int ClientPool::NumConns() {
+  CondVarLock locker(&cv_);
+  return num_conns_;
+}
+
+// --------------------------------------------------------
+
+const ::google::protobuf::rpc::Error ClientPool::callMethod(
+  const std::string& method,
+  const ::google::protobuf::Message* request,
+  ::google::protobuf::Message* response
+) {
+  Conn* conn = NULL;
+  uint64 id = 0;
+  Error err = checkout(&conn, &id);
+  if(!err.IsNil()) {
+    return err;
+  }
+  err = wire::RoundTrip(conn, id, method, request, response);
+  checkin(conn);
+  return err;
+}
+
+// Take an idle connection, or reserve a slot and dial a new one.
+const ::google::protobuf::rpc::Error ClientPool::checkout(Conn** conn, uint64* id) {
+  {
+    CondVarLock locker(&cv_);
+    while(idle_.empty() && num_conns_ >= max_conns_) {
+      cv_.Wait();
+    }
+    *id = seq_++;
+    if(!idle_.empty()) {
+      *conn = idle_.back();
+      idle_.pop_back();
+      return Error::Nil();
+    }
+    num_conns_++;
+  }
+
+  // dial without holding the lock
+  *conn = dial();
+  if(*conn == NULL) {
+    CondVarLock locker(&cv_);
+    num_conns_--;
+    cv_.Signal();
+    return ::google::protobuf::rpc::Error::New(
+      std::string("protorpc.ClientPool.checkout: Dial fail, ") +
+      std::string("host: ") + host_ + std::string(":") + std::to_string(static_cast<long long>(port_))
+    );
+  }
+  return Error::Nil();
+}
+
+// Return a connection to the pool, broken ones are dropped.
+void ClientPool::checkin(Conn* conn) {
+  CondVarLock locker(&cv_);
+  if(conn->IsValid()) {
+    idle_.push_back(conn);
+  } else {
+    delete conn;
+    num_conns_--;
+  }
+  cv_.Signal();
+}
+
+Conn* ClientPool::dial() {
+  Conn* conn = new Conn(0, env_);
+  if(!conn->Dial(host_.c_str(), port_)) {
+    delete conn;
+    return NULL;
+  }
+  return conn;
+}
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
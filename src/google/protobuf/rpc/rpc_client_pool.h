@@ -0,0 +1,76 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef GOOGLE_PROTOBUF_RPC_CLIENT_POOL_H__
+#define GOOGLE_PROTOBUF_RPC_CLIENT_POOL_H__
+
+#include <google/protobuf/rpc/rpc_conn.h>
+#include <google/protobuf/rpc/rpc_service.h>
+
+#include <vector>
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+class Env;
+
+// ClientPool keeps up to max_conns connections to host:port. Each call
+// checks out an idle connection (dialing a new one while below the limit,
+// waiting otherwise) and returns it when the response is received.
+//
+// ClientPool is safe for concurrent use.
+class ClientPool: public Caller {
+ public:
+  // Dial warm_conns connections up front, dial failures are retried
+  // lazily by the calls. host may be "unix:PATH" or "shm:PATH", see Client.
+  ClientPool(const char* host, int port,
+    int max_conns=8, int warm_conns=1, Env* env=NULL
+  );
+  ~ClientPool();
+
+  const ::google::protobuf::rpc::Error CallMethod(
+    const std::string& method,
+    const ::google::protobuf::Message* request,
+    ::google::protobuf::Message* response);
+  const ::google::protobuf::rpc::Error CallMethod(
+    const ::google::protobuf::MethodDescriptor* method,
+    const ::google::protobuf::Message* request,
+    ::google::protobuf::Message* response);
+
+  // Close the idle connections.
+  void Close();
+
+  // Number of open connections, busy or idle.
+  int NumConns();
+
+ private:
+  const ::google::protobuf::rpc::Error callMethod(
+    const std::string& method,
+    const ::google::protobuf::Message* request,
+    ::google::protobuf::Message* response);
+
+  const ::google::protobuf::rpc::Error checkout(Conn** conn, uint64* id);
+  void checkin(Conn* conn);
+  Conn* dial();
+
+  std::string host_;
+  int port_;
+  int max_conns_;
+  Env* env_;
+
+  CondVar cv_;  // guards the fields below
+  std::vector<Conn*> idle_;
+  int num_conns_;
+  uint64 seq_;
+
+ private:
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(ClientPool);
+};
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // GOOGLE_PROTOBUF_RPC_CLIENT_POOL_H__
@@ -3,6 +3,11 @@
 // license that can be found in the LICENSE file.
 
 #include "google/protobuf/rpc/rpc_conn.h"
+#include "google/protobuf/rpc/rpc_env.h"
+#include "google/protobuf/rpc/rpc_wire.h"
+
+#include <string.h>
+#include <algorithm>
 
 #if (defined(_WIN32) || defined(_WIN64))
 #  include "./rpc_conn_windows.cc"
@@ -21,7 +26,7 @@ static const int maxVarintLen64 = 10;
 
 // PutUvarint encodes a uint64 into buf and returns the number of bytes written.
 // If the buffer is too small, PutUvarint will panic.
-static int putUvarint(uint8 buf[], uint64 x) {
+int PutUvarint(uint8 buf[], uint64 x) {
   auto i = 0;
   while(x >= 0x80) {
     buf[i] = uint8(x) | 0x80;
@@ -32,39 +37,172 @@ static int putUvarint(uint8 buf[], uint64 x) {
   return i + 1;
 }
 
-// ReadUvarint reads an encoded unsigned integer from r and returns it as a uint64.
-bool Conn::ReadUvarint(uint64* rx) {
-  uint64 x;
-  uint8 s, b;
+// GetUvarint decodes a uint64 from buf and returns that value and the
+// number of bytes read (> 0). If an error occurred, the value is 0
+// and the number of bytes n is <= 0 meaning:
+//
+//   n == 0: buf too small
+//   n  < 0: value larger than 64 bits (overflow)
+//           and -n is the number of bytes read
+int GetUvarint(const uint8 buf[], size_t n, uint64* rx) {
+  uint64 x = 0;
+  uint8 s = 0;
 
   *rx = 0;
-  x = 0;
-  s = 0;
-
-  for(int i = 0; ; i++) {
-    if(!Read(&b, 1)) {
-      return false;
+  for(size_t i = 0; i < n; i++) {
+    if(i == maxVarintLen64) {
+      return -int(i + 1); // overflow
     }
+    uint8 b = buf[i];
     if(b < 0x80) {
-      if(i > 9 || i == 9 && b > 1){
-        logf("protorpc.Conn.ReadUvarint: varint overflows a 64-bit integer\n");
-        return false;
+      if(i > 9 || (i == 9 && b > 1)) {
+        return -int(i + 1); // overflow
       }
       *rx = (x | uint64(b)<<s);
-      return true;
+      return int(i + 1);
     }
     x |= (uint64(b&0x7f) << s);
     s += 7;
   }
-  logf("not reachable!\n");
-  return false;
+  return 0;
+}
+
+bool Conn::fill(int n) {
+  // buffers larger than this are dropped once empty
+  static const size_t kMaxIdleBuffer = 64*1024;
+
+  if(rend_ - rpos_ >= n) {
+    return true;
+  }
+
+  // move the unread data to the front
+  if(rpos_ > 0) {
+    if(rend_ > rpos_) {
+      memmove(&rbuf_[0], &rbuf_[rpos_], rend_ - rpos_);
+    }
+    rend_ -= rpos_;
+    rpos_ = 0;
+  }
+  if(rbuf_.empty() || (rend_ == 0 && rbuf_.size() > kMaxIdleBuffer && n <= kReadBufferSize)) {
+    // back to the default size after a large frame
+    std::vector<char>(kReadBufferSize).swap(rbuf_);
+  }
+
+  // read ahead as much as the socket has
+  while(rend_ < n) {
+    // grow with the data received: n may be a frame length sent by the
+    // peer, don't allocate it ahead
+    if(rend_ == int(rbuf_.size())) {
+      rbuf_.resize(std::min(size_t(n), 2*rbuf_.size()));
+    }
+    int k = recvSome(&rbuf_[rend_], int(rbuf_.size()) - rend_);
+    if(k <= 0) {
+      return false;
+    }
+    rend_ += k;
+  }
+  return true;
+}
+
+bool Conn::Dial(const char* host, int port, int timeout_ms) {
+  if(strncmp(host, "unix:", 5) == 0) {
+    return DialUnix(host + 5);
+  }
+  if(strncmp(host, "shm:", 4) == 0) {
+    return DialShm(host + 4);
+  }
+  return DialTCP(host, port, timeout_ms);
+}
+
+void Conn::SetTimeout(int timeout_ms) {
+  deadline_ = 0;
+  if(timeout_ms > 0) {
+    deadline_ = env()->NowMicros() + uint64(timeout_ms)*1000;
+  }
+  write_deadline_ = deadline_;
+  timed_out_ = false;
+}
+
+void Conn::SetWriteTimeout(int timeout_ms) {
+  write_deadline_ = 0;
+  if(timeout_ms > 0) {
+    write_deadline_ = env()->NowMicros() + uint64(timeout_ms)*1000;
+  }
+  timed_out_ = false;
+}
+
+const char* Conn::Peek(int n) {
+  if(!fill(n)) {
+    return NULL;
+  }
+  return &rbuf_[rpos_];
+}
+
+void Conn::Consume(int n) {
+  rpos_ += n;
+  if(rpos_ >= rend_) {
+    rpos_ = rend_ = 0;
+  }
+}
+
+bool Conn::Read(void* buf, int len) {
+  char* cbuf = (char*)buf;
+
+  // 1. copy the buffered data
+  int n = (len < rend_ - rpos_)? len: (rend_ - rpos_);
+  if(n > 0) {
+    memcpy(cbuf, &rbuf_[rpos_], n);
+    Consume(n);
+    cbuf += n;
+    len -= n;
+  }
+
+  // 2. large reads go to the user buffer directly
+  while(len >= kReadBufferSize) {
+    n = recvSome(cbuf, len);
+    if(n <= 0) {
+      return false;
+    }
+    cbuf += n;
+    len -= n;
+  }
+
+  // 3. small reads refill the buffer
+  if(len > 0) {
+    if(!fill(len)) {
+      return false;
+    }
+    memcpy(cbuf, &rbuf_[rpos_], len);
+    Consume(len);
+  }
+  return true;
+}
+
+// ReadUvarint reads an encoded unsigned integer from r and returns it as a uint64.
+bool Conn::ReadUvarint(uint64* rx) {
+  *rx = 0;
+  for(int want = 1; ; want++) {
+    if(!fill(want)) {
+      return false;
+    }
+    int n = GetUvarint((const uint8*)&rbuf_[rpos_], rend_ - rpos_, rx);
+    if(n > 0) {
+      Consume(n);
+      return true;
+    }
+    if(n < 0 || rend_ - rpos_ >= maxVarintLen64) {
+      logf("protorpc.Conn.ReadUvarint: varint overflows a 64-bit integer\n");
+      return false;
+    }
+    want = rend_ - rpos_;
+  }
 }
 
 // PutUvarint encodes a uint64 into buf and returns the number of bytes written.
 // If the buffer is too small, PutUvarint will panic.
 bool Conn::WriteUvarint(uint64 x) {
   uint8 buf[maxVarintLen64];
-  int n = putUvarint(buf, x);
+  int n = PutUvarint(buf, x);
   return Write(buf, n);
 }
 
@@ -113,9 +251,17 @@ bool Conn::RecvFrame(::std::string* data) {
   if(!ReadUvarint(&size)) {
     return false;
   }
-  if(size != 0) {
-    data->resize(uint(size));
-    if(!Read((void*)data->data(), int(size))) {
+  if(size > 0x7fffffff) {
+    logf("protorpc.Conn.RecvFrame: frame larger than 2GB.\n");
+    return false;
+  }
+  // grow with the data received, as fill does
+  data->clear();
+  while(data->size() < size) {
+    size_t n = std::min(size_t(size) - data->size(), std::max(data->size(), size_t(1024*1024)));
+    size_t pos = data->size();
+    data->resize(pos + n);
+    if(!Read(&(*data)[pos], int(n))) {
       data->clear();
       return false;
     }
@@ -123,6 +269,22 @@ bool Conn::RecvFrame(::std::string* data) {
   return true;
 }
 
+const char* Conn::PeekFrame(int* len, uint64 max_len) {
+  uint64 size;
+  if(!ReadUvarint(&size)) {
+    return NULL;
+  }
+  if(max_len == 0) {
+    max_len = max_body_len_? max_body_len_: wire::kDefaultMaxBodyLen;
+  }
+  if(size > max_len || size > 0x7fffffff) {
+    logf("protorpc.Conn.PeekFrame: frame larger than %llu.\n", (unsigned long long)max_len);
+    return NULL;
+  }
+  *len = int(size);
+  return Peek(int(size));
+}
+
 bool Conn::SendFrame(const ::std::string* data) {
   if(data == NULL) {
     return WriteUvarint(uint64(0));
@@ -137,6 +299,36 @@ bool Conn::SendFrame(const ::std::string* data) {
   return true;
 }
 
+bool Conn::SendFrames(const ::std::string* const data[], int n) {
+  const int kMaxFrames = 32;
+  uint8 lens[kMaxFrames][maxVarintLen64];
+  IoVec iov[kMaxFrames*2];
+
+  for(int i = 0; i < n; i += kMaxFrames) {
+    int m = (n - i < kMaxFrames)? (n - i): kMaxFrames;
+    int iovcnt = 0;
+    for(int j = 0; j < m; j++) {
+      const ::std::string* frame = data[i+j];
+      iov[iovcnt].base = lens[j];
+      iov[iovcnt].len = PutUvarint(lens[j], uint64(frame? frame->size(): 0));
+      iovcnt++;
+      if(frame != NULL && !frame->empty()) {
+        iov[iovcnt].base = frame->data();
+        iov[iovcnt].len = frame->size();
+        iovcnt++;
+      }
+    }
+    if(!Writev(iov, iovcnt)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Env* Conn::env() const {
+  return env_? env_: Env::Default();
+}
+
 void Conn::logf(const char* fmt, ...) {
   if(env_ != NULL) {
     va_list ap;
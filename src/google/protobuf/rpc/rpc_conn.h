@@ -7,33 +7,147 @@
 
 #include <stdarg.h>
 #include <google/protobuf/message.h>
+#include <vector>
 
 namespace google {
 namespace protobuf {
 namespace rpc {
 
 class Env;
+class ShmChannel;
 
 // Initialize socket services
 bool InitSocket();
 
+// PutUvarint encodes a uint64 into buf and returns the number of bytes written.
+// The buffer must hold at least 10 bytes.
+int PutUvarint(uint8 buf[], uint64 x);
+
+// GetUvarint decodes a uint64 from buf and returns the number of bytes read (> 0).
+// If the buffer is too small, GetUvarint returns 0; if the value overflows a
+// 64-bit integer, it returns a negative value.
+int GetUvarint(const uint8 buf[], size_t n, uint64* x);
+
+// Buffer descriptor of a vectored write.
+struct IoVec {
+  const void* base;
+  size_t len;
+};
+
 // Stream-oriented network connection.
 class Conn {
  public:
 
-  Conn(int fd=0, Env* env=NULL): sock_(fd), env_(env) { InitSocket(); }
+  // Default size of the user-space receive buffer.
+  static const int kReadBufferSize = 16*1024;
+
+  Conn(int fd=0, Env* env=NULL): sock_(fd), env_(env), shm_(NULL),
+    rpos_(0), rend_(0), deadline_(0), write_deadline_(0), timed_out_(false),
+    max_body_len_(0) { InitSocket(); }
   ~Conn() {}
 
   bool IsValid() const;
-  bool DialTCP(const char* host, int port);
-  bool ListenTCP(int port, int backlog=5);
+  // Give up connecting after timeout_ms if it is positive.
+  bool DialTCP(const char* host, int port, int timeout_ms=0);
+  // With reuse_port, several sockets may listen on the same port and the
+  // kernel spreads the incoming connections over them (SO_REUSEPORT,
+  // not supported on Windows).
+  bool ListenTCP(int port, int backlog=5, bool reuse_port=false);
+
+  // Unix domain sockets, a path starting with '@' names a socket in the
+  // (Linux) abstract namespace. ListenUnix replaces a stale socket file.
+  // Not supported on Windows.
+  bool DialUnix(const char* path);
+  bool ListenUnix(const char* path, int backlog=5);
+
+  // Shared memory transport (Linux): DialShm connects to the unix socket
+  // of a Server::ListenShm listener and hands it a ring buffer segment,
+  // the frames go through shared memory from then on. AcceptShm is the
+  // server side of the handshake on an accepted connection.
+  // spin_us: time to spin before sleeping, < 0 for the default.
+  bool DialShm(const char* path, int spin_us=-1);
+  bool AcceptShm(int timeout_ms);
+
+  // Pass open file descriptors with a short message (not empty, at most
+  // kMaxFdMessage bytes) over a unix socket, RecvFds waits up to
+  // timeout_ms. The receiver owns copies of the descriptors, the sender
+  // keeps its own. Not supported on Windows.
+  static const int kMaxFds = 64;
+  static const int kMaxFdMessage = 256;
+  bool SendFds(const std::vector<int>& fds, const std::string& msg);
+  bool RecvFds(std::vector<int>* fds, std::string* msg, int timeout_ms);
+
+  // Connect a and b to each other (socketpair), a byte written to one
+  // wakes up the WaitReadable of the other. Not supported on Windows.
+  static bool Pair(Conn* a, Conn* b);
+
+  // Dial "unix:PATH" with DialUnix, "shm:PATH" with DialShm,
+  // other hosts with DialTCP.
+  bool Dial(const char* host, int port, int timeout_ms=0);
   void Close();
 
+  // Shut down both directions without releasing the socket,
+  // this wakes up a thread blocked in Read().
+  void Shutdown();
+
+  // Shut down the receive direction only: a thread blocked in Read()
+  // wakes up with EOF, the writes still go through. Shared memory
+  // connections shut down both directions.
+  void ShutdownRead();
+  // Shut down the send direction only: the peer reads EOF once it has
+  // the data sent, the reads still go through. Shared memory connections
+  // shut down both directions.
+  void ShutdownWrite();
+
   Conn* Accept();
 
+  // Return the underlying socket handle.
+  int Fd() const { return sock_; }
+
+  // Switch the socket to (non-)blocking mode.
+  bool SetNonBlocking(bool nonblocking);
+
+  // Make the blocking reads and vectored writes fail once timeout_ms has
+  // passed from now, 0 removes the deadline. TimedOut() reports whether an
+  // operation failed for that reason since the last SetTimeout().
+  void SetTimeout(int timeout_ms);
+  // The same for the writes only, the reads keep their deadline. A reader
+  // and a writer thread may each set their own.
+  void SetWriteTimeout(int timeout_ms);
+  bool TimedOut() const { return timed_out_; }
+
+  // Longest raw body the wire::Recv*Body functions accept, 0 (the
+  // default) for wire::kDefaultMaxBodyLen.
+  void SetMaxBodyLen(uint32 n) { max_body_len_ = n; }
+  uint32 MaxBodyLen() const { return max_body_len_; }
+
+  // Wait up to timeout_ms for data to read (negative: no limit).
+  // Return false on timeout, true if data, EOF or an error is pending.
+  bool WaitReadable(int timeout_ms);
+  // The same, returning early once wakeup (NULL: none) is readable:
+  // 1 if this connection is readable, 2 if only wakeup is, 0 on timeout.
+  int WaitReadable(int timeout_ms, Conn* wakeup);
+
   bool Read(void* buf, int len);
   bool Write(void* buf, int len);
 
+  // Write all the buffers with as few (writev/WSASend) calls as possible.
+  bool Writev(const IoVec* iov, int iovcnt);
+
+  // [non-blocking]
+  // Read/Write at most len bytes and return the number of bytes transferred.
+  // Return 0 if the operation would block, -1 on EOF or error.
+  int TryRead(void* buf, int len);
+  int TryWrite(const void* buf, int len);
+
+  // Buffered reader.
+  // Peek returns the next n bytes without consuming them (NULL on EOF or
+  // error), the data is valid until the next read operation.
+  // Consume drops n bytes that Buffered() reports as available.
+  const char* Peek(int n);
+  void Consume(int n);
+  int Buffered() const { return rend_ - rpos_; }
+
   bool ReadUvarint(uint64* x);
   bool WriteUvarint(uint64 x);
 
@@ -43,11 +157,41 @@ class Conn {
   bool RecvFrame(::std::string* data);
   bool SendFrame(const ::std::string* data);
 
+  // Receive a frame into the read buffer and return it without a copy
+  // (NULL on EOF, error or a frame longer than max_len). The data is valid
+  // until the next read operation, Consume(*len) drops it. The buffer grows
+  // to the frame and shrinks back once it is read. max_len 0 stands for
+  // the max body len (see SetMaxBodyLen).
+  const char* PeekFrame(int* len, uint64 max_len=0);
+
+  // Send n frames with one vectored write.
+  bool SendFrames(const ::std::string* const data[], int n);
+
  private:
   void logf(const char* fmt, ...);
+  // env_, or Env::Default() without one.
+  Env* env() const;
+
+  // fill reads from the socket until at least n bytes are buffered.
+  bool fill(int n);
+  // recvSome blocks until some data is received, return -1 on EOF or error.
+  int recvSome(void* buf, int len);
+  // waitIO blocks until the socket is ready or the deadline of the
+  // direction passes.
+  bool waitIO(bool write);
 
   int sock_;
   Env* env_;
+  ShmChannel* shm_;  // NULL for socket I/O
+
+  std::vector<char> rbuf_;
+  int rpos_;
+  int rend_;
+
+  uint64 deadline_;  // Env::NowMicros(), 0 for none
+  uint64 write_deadline_;
+  bool timed_out_;
+  uint32 max_body_len_;
 };
 
 }  // namespace rpc
@@ -4,18 +4,23 @@
 
 #include "google/protobuf/rpc/rpc_conn.h"
 #include "google/protobuf/rpc/rpc_env.h"
+#include "google/protobuf/rpc/rpc_shm.h"
 
+#include <stddef.h>
 #include <string.h>
 #include <errno.h>
 #include <sys/time.h>
 #include <arpa/inet.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 
 #ifndef NI_MAXSERV
@@ -36,7 +41,7 @@ bool Conn::IsValid() const {
   return sock_ != 0;
 }
 
-bool Conn::DialTCP(const char* host, int port) {
+bool Conn::DialTCP(const char* host, int port, int timeout_ms) {
   struct sockaddr_in sa;
   int status, len;
 
@@ -53,10 +58,37 @@ bool Conn::DialTCP(const char* host, int port) {
   sa.sin_addr.s_addr = inet_addr(host);
   size_t addressSize = sizeof(sa);
 
+  // connect in non-blocking mode to bound the wait
+  if(timeout_ms > 0) {
+    SetNonBlocking(true);
+  }
   if(connect(sock_, (struct sockaddr*)&sa, addressSize) == -1) {
-    logf("protorpc.Conn.DialTCP: connect failed.\n");
-    Close();
-    return false;
+    bool ok = false;
+    if(timeout_ms > 0 && errno == EINPROGRESS) {
+      struct pollfd pfd;
+      pfd.fd = sock_;
+      pfd.events = POLLOUT;
+      pfd.revents = 0;
+      int r;
+      do {
+        r = poll(&pfd, 1, timeout_ms);
+      } while(r == -1 && errno == EINTR);
+
+      int soerr = 0;
+      socklen_t soerrlen = sizeof(soerr);
+      ok = (r > 0 &&
+        getsockopt(sock_, SOL_SOCKET, SO_ERROR, &soerr, &soerrlen) == 0 &&
+        soerr == 0
+      );
+    }
+    if(!ok) {
+      logf("protorpc.Conn.DialTCP: connect failed.\n");
+      Close();
+      return false;
+    }
+  }
+  if(timeout_ms > 0) {
+    SetNonBlocking(false);
   }
 
   int flag = 1;
@@ -64,7 +96,7 @@ bool Conn::DialTCP(const char* host, int port) {
   return true;
 }
 
-bool Conn::ListenTCP(int port, int backlog) {
+bool Conn::ListenTCP(int port, int backlog, bool reuse_port) {
   if(IsValid()) Close();
   if((sock_ = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
     logf("protorpc.Conn.ListenTCP: socket failed.\n");
@@ -78,6 +110,24 @@ bool Conn::ListenTCP(int port, int backlog) {
   saddr.sin_addr.s_addr = htonl(INADDR_ANY);
   saddr.sin_port = htons((u_short) port);
 
+  // allow restarting while old connections are in TIME_WAIT
+  int flag = 1;
+  setsockopt(sock_, SOL_SOCKET, SO_REUSEADDR, (char*)&flag, sizeof(flag));
+
+  if(reuse_port) {
+#ifdef SO_REUSEPORT
+    if(setsockopt(sock_, SOL_SOCKET, SO_REUSEPORT, (char*)&flag, sizeof(flag)) != 0) {
+      logf("protorpc.Conn.ListenTCP: SO_REUSEPORT failed.\n");
+      Close();
+      return false;
+    }
+#else
+    logf("protorpc.Conn.ListenTCP: SO_REUSEPORT not supported.\n");
+    Close();
+    return false;
+#endif
+  }
+
   if(bind(sock_, (struct sockaddr*)&saddr, sizeof(saddr)) == -1) {
     logf("protorpc.Conn.ListenTCP: bind failed.\n");
     Close();
@@ -89,43 +139,364 @@ bool Conn::ListenTCP(int port, int backlog) {
     return false;
   }
 
-  int flag = 1;
   setsockopt(sock_, IPPROTO_TCP, TCP_NODELAY, (char*)&flag, sizeof(flag));
   return true;
 }
 
+// Fill sa with the unix socket path, return the address length (0 on error).
+static socklen_t unixAddr(const char* path, struct sockaddr_un* sa) {
+  size_t n = strlen(path);
+  if(n == 0 || n >= sizeof(sa->sun_path)) {
+    return 0;
+  }
+  memset(sa, 0, sizeof(*sa));
+  sa->sun_family = AF_UNIX;
+  memcpy(sa->sun_path, path, n);
+  if(path[0] == '@') {
+    sa->sun_path[0] = '\0';  // abstract, the name is not NUL-terminated
+    return socklen_t(offsetof(struct sockaddr_un, sun_path) + n);
+  }
+  return socklen_t(offsetof(struct sockaddr_un, sun_path) + n + 1);
+}
+
+bool Conn::DialUnix(const char* path) {
+  struct sockaddr_un sa;
+  socklen_t salen = unixAddr(path, &sa);
+  if(salen == 0) {
+    logf("protorpc.Conn.DialUnix: invalid path.\n");
+    return false;
+  }
+
+  if(IsValid()) Close();
+  if((sock_ = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+    logf("protorpc.Conn.DialUnix: socket failed.\n");
+    sock_ = 0;
+    return false;
+  }
+  if(connect(sock_, (struct sockaddr*)&sa, salen) == -1) {
+    logf("protorpc.Conn.DialUnix: connect failed.\n");
+    Close();
+    return false;
+  }
+  return true;
+}
+
+bool Conn::ListenUnix(const char* path, int backlog) {
+  struct sockaddr_un sa;
+  socklen_t salen = unixAddr(path, &sa);
+  if(salen == 0) {
+    logf("protorpc.Conn.ListenUnix: invalid path.\n");
+    return false;
+  }
+
+  if(IsValid()) Close();
+  if((sock_ = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+    logf("protorpc.Conn.ListenUnix: socket failed.\n");
+    sock_ = 0;
+    return false;
+  }
+
+  // remove the socket file of a previous server
+  struct stat st;
+  if(path[0] != '@' && stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+    unlink(path);
+  }
+
+  if(bind(sock_, (struct sockaddr*)&sa, salen) == -1) {
+    logf("protorpc.Conn.ListenUnix: bind failed.\n");
+    Close();
+    return false;
+  }
+  if(::listen(sock_, backlog) != 0) {
+    logf("protorpc.Conn.ListenUnix: listen failed.\n");
+    Close();
+    return false;
+  }
+  return true;
+}
+
+bool Conn::DialShm(const char* path, int spin_us) {
+  if(!DialUnix(path)) {
+    return false;
+  }
+  shm_ = ShmChannel::Create(sock_, ShmChannel::kDefaultRingSize, spin_us, env());
+  if(shm_ == NULL) {
+    Close();
+    return false;
+  }
+
+  // pass the segment with a one byte message
+  char tag = 'S';
+  struct iovec iov;
+  iov.iov_base = &tag;
+  iov.iov_len = 1;
+  char ctrl[CMSG_SPACE(sizeof(int))];
+  memset(ctrl, 0, sizeof(ctrl));
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl;
+  msg.msg_controllen = sizeof(ctrl);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  int fd = shm_->Fd();
+  memcpy(CMSG_DATA(cmsg), &fd, sizeof(fd));
+
+  ssize_t n;
+  do {
+    n = sendmsg(sock_, &msg, MSG_NOSIGNAL);
+  } while(n == -1 && errno == EINTR);
+  if(n != 1) {
+    logf("protorpc.Conn.DialShm: sendmsg failed, err = %d.\n", errno);
+    Close();
+    return false;
+  }
+  return true;
+}
+
+bool Conn::AcceptShm(int timeout_ms) {
+  struct pollfd pfd;
+  pfd.fd = sock_;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  int r;
+  do {
+    r = poll(&pfd, 1, timeout_ms);
+  } while(r == -1 && errno == EINTR);
+  if(r <= 0) {
+    logf("protorpc.Conn.AcceptShm: no handshake.\n");
+    return false;
+  }
+
+  char tag = 0;
+  struct iovec iov;
+  iov.iov_base = &tag;
+  iov.iov_len = 1;
+  char ctrl[CMSG_SPACE(sizeof(int))];
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl;
+  msg.msg_controllen = sizeof(ctrl);
+
+  ssize_t n;
+  do {
+    n = recvmsg(sock_, &msg, MSG_CMSG_CLOEXEC);
+  } while(n == -1 && errno == EINTR);
+  struct cmsghdr* cmsg = (n == 1)? CMSG_FIRSTHDR(&msg): NULL;
+  if(cmsg == NULL || tag != 'S' ||
+    cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+    logf("protorpc.Conn.AcceptShm: invalid handshake.\n");
+    return false;
+  }
+  int fd;
+  memcpy(&fd, CMSG_DATA(cmsg), sizeof(fd));
+
+  shm_ = ShmChannel::Attach(sock_, fd, -1, env());
+  return shm_ != NULL;
+}
+
+bool Conn::SendFds(const std::vector<int>& fds, const std::string& msg) {
+  if(fds.empty() || int(fds.size()) > kMaxFds || msg.empty() || int(msg.size()) > kMaxFdMessage) {
+    logf("protorpc.Conn.SendFds: invalid arguments.\n");
+    return false;
+  }
+  struct iovec iov;
+  iov.iov_base = (void*)msg.data();
+  iov.iov_len = msg.size();
+  char ctrl[CMSG_SPACE(sizeof(int)*kMaxFds)];
+  memset(ctrl, 0, sizeof(ctrl));
+  struct msghdr hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.msg_iov = &iov;
+  hdr.msg_iovlen = 1;
+  hdr.msg_control = ctrl;
+  hdr.msg_controllen = CMSG_SPACE(sizeof(int)*fds.size());
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int)*fds.size());
+  memcpy(CMSG_DATA(cmsg), &fds[0], sizeof(int)*fds.size());
+
+  ssize_t n;
+  do {
+    n = sendmsg(sock_, &hdr, MSG_NOSIGNAL);
+  } while(n == -1 && errno == EINTR);
+  if(n != ssize_t(msg.size())) {
+    logf("protorpc.Conn.SendFds: sendmsg failed, err = %d.\n", errno);
+    return false;
+  }
+  return true;
+}
+
+bool Conn::RecvFds(std::vector<int>* fds, std::string* msg, int timeout_ms) {
+  fds->clear();
+  if(!WaitReadable(timeout_ms)) {
+    logf("protorpc.Conn.RecvFds: timeout.\n");
+    return false;
+  }
+
+  char buf[kMaxFdMessage];
+  struct iovec iov;
+  iov.iov_base = buf;
+  iov.iov_len = sizeof(buf);
+  char ctrl[CMSG_SPACE(sizeof(int)*kMaxFds)];
+  struct msghdr hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.msg_iov = &iov;
+  hdr.msg_iovlen = 1;
+  hdr.msg_control = ctrl;
+  hdr.msg_controllen = sizeof(ctrl);
+
+  ssize_t n;
+  do {
+    n = recvmsg(sock_, &hdr, MSG_CMSG_CLOEXEC);
+  } while(n == -1 && errno == EINTR);
+  if(n <= 0) {
+    logf("protorpc.Conn.RecvFds: recvmsg failed, err = %d.\n", errno);
+    return false;
+  }
+  for(struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+    if(cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+      continue;
+    }
+    size_t k = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    for(size_t i = 0; i < k; i++) {
+      int fd;
+      memcpy(&fd, CMSG_DATA(cmsg) + i*sizeof(int), sizeof(fd));
+      fds->push_back(fd);
+    }
+  }
+  if(fds->empty() || (hdr.msg_flags & MSG_CTRUNC) != 0) {
+    logf("protorpc.Conn.RecvFds: no descriptors.\n");
+    for(size_t i = 0; i < fds->size(); i++) {
+      ::close((*fds)[i]);
+    }
+    fds->clear();
+    return false;
+  }
+  msg->assign(buf, size_t(n));
+  return true;
+}
+
 void Conn::Close() {
+  if(shm_ != NULL) {
+    delete shm_;
+    shm_ = NULL;
+  }
   if(IsValid()) {
     ::close(sock_);
     sock_ = 0;
   }
+  rpos_ = rend_ = 0;
+}
+
+void Conn::Shutdown() {
+  if(shm_ != NULL) {
+    shm_->Shutdown();
+  }
+  if(IsValid()) {
+    ::shutdown(sock_, SHUT_RDWR);
+  }
+}
+
+void Conn::ShutdownRead() {
+  if(shm_ != NULL) {
+    Shutdown();
+    return;
+  }
+  if(IsValid()) {
+    ::shutdown(sock_, SHUT_RD);
+  }
+}
+
+void Conn::ShutdownWrite() {
+  if(shm_ != NULL) {
+    Shutdown();
+    return;
+  }
+  if(IsValid()) {
+    ::shutdown(sock_, SHUT_WR);
+  }
+}
+
+// [static]
+bool Conn::Pair(Conn* a, Conn* b) {
+  int sv[2];
+  if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+    a->logf("protorpc.Conn.Pair: socketpair failed, err = %d.\n", errno);
+    return false;
+  }
+  if(a->IsValid()) a->Close();
+  if(b->IsValid()) b->Close();
+  a->sock_ = sv[0];
+  b->sock_ = sv[1];
+  return true;
 }
 
 Conn* Conn::Accept() {
-  struct sockaddr_in addr;
+  struct sockaddr_storage addr;
   socklen_t addrlen = sizeof(addr);
   int sock = ::accept(sock_, (struct sockaddr*)&addr, &addrlen);
-  if(sock == 0) {
-    logf("protorpc.Conn.Accept: failed.\n");
+  if(sock < 0) {
+    if(errno != EAGAIN && errno != EWOULDBLOCK) {
+      logf("protorpc.Conn.Accept: failed, err = %d.\n", errno);
+    }
     return NULL;
   }
   return new Conn(sock, env_);
 }
 
-bool Conn::Read (void* buf, int len) {
-  char *cbuf = (char*)buf;
-  while(len > 0) {
-    int sent = recv(sock_, cbuf, len, 0);
-    if(sent == 0 || sent == -1) {
-      logf("protorpc.Conn.Read: IO error, err = %d.\n", errno);
-      return false;
-    }
-    cbuf += sent;
-    len -= sent;
+bool Conn::SetNonBlocking(bool nonblocking) {
+  int flags = fcntl(sock_, F_GETFL, 0);
+  if(flags == -1) {
+    logf("protorpc.Conn.SetNonBlocking: fcntl failed, err = %d.\n", errno);
+    return false;
+  }
+  flags = nonblocking? (flags | O_NONBLOCK): (flags & ~O_NONBLOCK);
+  if(fcntl(sock_, F_SETFL, flags) == -1) {
+    logf("protorpc.Conn.SetNonBlocking: fcntl failed, err = %d.\n", errno);
+    return false;
   }
   return true;
 }
+
+int Conn::recvSome(void* buf, int len) {
+  if(shm_ != NULL) {
+    int n = shm_->Recv(buf, len, deadline_);
+    if(n == 0) {
+      timed_out_ = true;
+      return -1;
+    }
+    return n;
+  }
+  for(;;) {
+    if(!waitIO(false)) {
+      return -1;
+    }
+    int n = recv(sock_, (char*)buf, len, 0);
+    if(n > 0) {
+      return n;
+    }
+    if(n == 0) {
+      return -1;  // EOF, the peer closed
+    }
+    if(errno == EINTR) {
+      continue;
+    }
+    logf("protorpc.Conn.Read: IO error, err = %d.\n", errno);
+    return -1;
+  }
+}
 bool Conn::Write(void* buf, int len) {
+  if(shm_ != NULL) {
+    IoVec iov = { buf, size_t(len) };
+    return Writev(&iov, 1);
+  }
   const char *cbuf = (char*)buf;
   int flags = MSG_NOSIGNAL;
 
@@ -141,6 +512,177 @@ bool Conn::Write(void* buf, int len) {
   return true;
 }
 
+bool Conn::Writev(const IoVec* vec, int iovcnt) {
+  if(shm_ != NULL) {
+    int r = shm_->Send(vec, iovcnt, write_deadline_);
+    if(r == 0) {
+      timed_out_ = true;
+    }
+    return r > 0;
+  }
+  const int kMaxIov = 64;
+  struct iovec iov[kMaxIov];
+
+  while(iovcnt > 0) {
+    int n = (iovcnt < kMaxIov)? iovcnt: kMaxIov;
+    size_t total = 0;
+    for(int i = 0; i < n; i++) {
+      iov[i].iov_base = (void*)vec[i].base;
+      iov[i].iov_len = vec[i].len;
+      total += vec[i].len;
+    }
+    vec += n;
+    iovcnt -= n;
+
+    // sendmsg for MSG_NOSIGNAL, resume after partial writes
+    struct iovec* cur = iov;
+    int curcnt = n;
+    while(total > 0) {
+      struct msghdr msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_iov = cur;
+      msg.msg_iovlen = curcnt;
+
+      // with a deadline, send what fits and wait for the rest
+      int flags = MSG_NOSIGNAL | (write_deadline_ != 0? MSG_DONTWAIT: 0);
+      ssize_t sent = sendmsg(sock_, &msg, flags);
+      if(sent == -1) {
+        if(errno == EINTR) continue;
+        if(errno == EAGAIN || errno == EWOULDBLOCK) {
+          if(!waitIO(true)) {
+            return false;
+          }
+          continue;
+        }
+        logf("protorpc.Conn.Writev: IO error, err = %d.\n", errno);
+        return false;
+      }
+      total -= size_t(sent);
+      while(curcnt > 0 && size_t(sent) >= cur->iov_len) {
+        sent -= cur->iov_len;
+        cur++;
+        curcnt--;
+      }
+      if(curcnt > 0) {
+        cur->iov_base = (char*)cur->iov_base + sent;
+        cur->iov_len -= size_t(sent);
+      }
+    }
+  }
+  return true;
+}
+
+bool Conn::waitIO(bool write) {
+  const uint64 deadline = write? write_deadline_: deadline_;
+  if(deadline == 0) {
+    return true;
+  }
+  for(;;) {
+    uint64 now = env()->NowMicros();
+    if(now >= deadline) {
+      timed_out_ = true;
+      return false;
+    }
+    struct pollfd pfd;
+    pfd.fd = sock_;
+    pfd.events = write? POLLOUT: POLLIN;
+    pfd.revents = 0;
+    int r = poll(&pfd, 1, int((deadline - now + 999) / 1000));
+    if(r > 0 || (r == -1 && errno != EINTR)) {
+      return true;  // the I/O call reports errors
+    }
+  }
+}
+
+bool Conn::WaitReadable(int timeout_ms) {
+  if(rpos_ < rend_) {
+    return true;
+  }
+  if(shm_ != NULL) {
+    return shm_->WaitReadable(timeout_ms);
+  }
+  struct pollfd pfd;
+  pfd.fd = sock_;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  for(;;) {
+    int r = poll(&pfd, 1, timeout_ms);
+    if(r == -1 && errno == EINTR) {
+      continue;
+    }
+    return r != 0;
+  }
+}
+
+int Conn::WaitReadable(int timeout_ms, Conn* wakeup) {
+  if(wakeup == NULL || !wakeup->IsValid() || shm_ != NULL || rpos_ < rend_) {
+    return WaitReadable(timeout_ms)? 1: 0;
+  }
+  struct pollfd pfd[2];
+  pfd[0].fd = sock_;
+  pfd[1].fd = wakeup->sock_;
+  pfd[0].events = pfd[1].events = POLLIN;
+  pfd[0].revents = pfd[1].revents = 0;
+  for(;;) {
+    int r = poll(pfd, 2, timeout_ms);
+    if(r == -1 && errno == EINTR) {
+      continue;
+    }
+    if(r == 0) {
+      return 0;
+    }
+    return (r < 0 || pfd[0].revents != 0)? 1: 2;
+  }
+}
+
+int Conn::TryRead(void* buf, int len) {
+  if(rpos_ < rend_) {
+    int n = (len < rend_ - rpos_)? len: (rend_ - rpos_);
+    memcpy(buf, &rbuf_[rpos_], n);
+    Consume(n);
+    return n;
+  }
+  if(shm_ != NULL) {
+    return shm_->TryRecv(buf, len);
+  }
+  for(;;) {
+    int n = recv(sock_, (char*)buf, len, 0);
+    if(n > 0) {
+      return n;
+    }
+    if(n == 0) {
+      return -1;
+    }
+    if(errno == EINTR) {
+      continue;
+    }
+    if(errno == EAGAIN || errno == EWOULDBLOCK) {
+      return 0;
+    }
+    logf("protorpc.Conn.TryRead: IO error, err = %d.\n", errno);
+    return -1;
+  }
+}
+int Conn::TryWrite(const void* buf, int len) {
+  if(shm_ != NULL) {
+    return shm_->TrySend(buf, len);
+  }
+  for(;;) {
+    int n = send(sock_, (const char*)buf, len, MSG_NOSIGNAL);
+    if(n >= 0) {
+      return n;
+    }
+    if(errno == EINTR) {
+      continue;
+    }
+    if(errno == EAGAIN || errno == EWOULDBLOCK) {
+      return 0;
+    }
+    logf("protorpc.Conn.TryWrite: IO error, err = %d.\n", errno);
+    return -1;
+  }
+}
+
 }  // namespace rpc
 }  // namespace protobuf
 }  // namespace google
@@ -46,7 +46,7 @@ bool Conn::IsValid() const {
   return sock_ != 0;
 }
 
-bool Conn::DialTCP(const char* host, int port) {
+bool Conn::DialTCP(const char* host, int port, int timeout_ms) {
   if(IsValid()) Close();
   if((sock_ = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
     logf("protorpc.Conn.DialTCP: socket failed.\n");
@@ -62,10 +62,31 @@ bool Conn::DialTCP(const char* host, int port) {
   sa.sin_addr.s_addr = inet_addr(host);
   addressSize = sizeof(sa);
 
+  // connect in non-blocking mode to bound the wait
+  if(timeout_ms > 0) {
+    SetNonBlocking(true);
+  }
   if(connect(sock_, ( struct sockaddr*)&sa, addressSize) == -1 ) {
-    logf("protorpc.Conn.DialTCP: connect failed.\n");
-    Close();
-    return false;
+    bool ok = false;
+    if(timeout_ms > 0 && WSAGetLastError() == WSAEWOULDBLOCK) {
+      fd_set wfds, efds;
+      FD_ZERO(&wfds);
+      FD_ZERO(&efds);
+      FD_SET(sock_, &wfds);
+      FD_SET(sock_, &efds);
+      struct timeval tv;
+      tv.tv_sec = timeout_ms / 1000;
+      tv.tv_usec = (timeout_ms % 1000) * 1000;
+      ok = (select(0, NULL, &wfds, &efds, &tv) > 0 && FD_ISSET(sock_, &wfds));
+    }
+    if(!ok) {
+      logf("protorpc.Conn.DialTCP: connect failed.\n");
+      Close();
+      return false;
+    }
+  }
+  if(timeout_ms > 0) {
+    SetNonBlocking(false);
   }
 
   int flag = 1;
@@ -73,7 +94,11 @@ bool Conn::DialTCP(const char* host, int port) {
   return true;
 }
 
-bool Conn::ListenTCP(int port, int backlog) {
+bool Conn::ListenTCP(int port, int backlog, bool reuse_port) {
+  if(reuse_port) {
+    logf("protorpc.Conn.ListenTCP: SO_REUSEPORT not supported.\n");
+    return false;
+  }
   if(IsValid()) Close();
   if((sock_ = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
     logf("protorpc.Conn.ListenTCP: socket failed.\n");
@@ -103,37 +128,103 @@ bool Conn::ListenTCP(int port, int backlog) {
   return true;
 }
 
+bool Conn::DialUnix(const char* path) {
+  logf("protorpc.Conn.DialUnix: not supported.\n");
+  return false;
+}
+
+bool Conn::ListenUnix(const char* path, int backlog) {
+  logf("protorpc.Conn.ListenUnix: not supported.\n");
+  return false;
+}
+
+bool Conn::DialShm(const char* path, int spin_us) {
+  logf("protorpc.Conn.DialShm: not supported.\n");
+  return false;
+}
+
+bool Conn::AcceptShm(int timeout_ms) {
+  logf("protorpc.Conn.AcceptShm: not supported.\n");
+  return false;
+}
+
+bool Conn::SendFds(const std::vector<int>& fds, const std::string& msg) {
+  logf("protorpc.Conn.SendFds: not supported.\n");
+  return false;
+}
+
+bool Conn::RecvFds(std::vector<int>* fds, std::string* msg, int timeout_ms) {
+  logf("protorpc.Conn.RecvFds: not supported.\n");
+  return false;
+}
+
+// [static]
+bool Conn::Pair(Conn* a, Conn* b) {
+  return false;  // the callers poll instead
+}
+
 void Conn::Close() {
   if(IsValid()) {
     ::closesocket(sock_);
     sock_ = 0;
   }
+  rpos_ = rend_ = 0;
+}
+
+void Conn::Shutdown() {
+  if(IsValid()) {
+    ::shutdown(sock_, SD_BOTH);
+  }
+}
+
+void Conn::ShutdownRead() {
+  if(IsValid()) {
+    ::shutdown(sock_, SD_RECEIVE);
+  }
+}
+
+void Conn::ShutdownWrite() {
+  if(IsValid()) {
+    ::shutdown(sock_, SD_SEND);
+  }
 }
 
 Conn* Conn::Accept() {
   struct sockaddr_in addr;
   int addrlen = sizeof(addr);
   int sock = ::accept(sock_, (struct sockaddr*)&addr, &addrlen);
-  if(sock == 0) {
-    logf("protorpc.Conn.Accept: failed.\n");
+  if(sock == INVALID_SOCKET) {
+    if(WSAGetLastError() != WSAEWOULDBLOCK) {
+      logf("protorpc.Conn.Accept: failed, err = %d.\n", WSAGetLastError());
+    }
     return NULL;
   }
   return new Conn(sock, env_);
 }
 
-bool Conn::Read (void* buf, int len) {
-  char *cbuf = (char*)buf;
-  while(len > 0) {
-    int sent = recv(sock_, cbuf, len, 0);
-    if(sent == 0 || sent == -1) {
-      logf("protorpc.Conn.Read: IO error, err = %d.\n", WSAGetLastError());
-      return false;
-    }
-    cbuf += sent;
-    len -= sent;
+bool Conn::SetNonBlocking(bool nonblocking) {
+  u_long mode = nonblocking? 1: 0;
+  if(ioctlsocket(sock_, FIONBIO, &mode) != 0) {
+    logf("protorpc.Conn.SetNonBlocking: ioctlsocket failed, err = %d.\n", WSAGetLastError());
+    return false;
   }
   return true;
 }
+
+int Conn::recvSome(void* buf, int len) {
+  if(!waitIO(false)) {
+    return -1;
+  }
+  int n = recv(sock_, (char*)buf, len, 0);
+  if(n > 0) {
+    return n;
+  }
+  if(n == 0) {
+    return -1;  // EOF, the peer closed
+  }
+  logf("protorpc.Conn.Read: IO error, err = %d.\n", WSAGetLastError());
+  return -1;
+}
 bool Conn::Write(void* buf, int len) {
   const char *cbuf = (char*)buf;
   int flags = 0;
@@ -150,6 +241,105 @@ bool Conn::Write(void* buf, int len) {
   return true;
 }
 
+bool Conn::Writev(const IoVec* vec, int iovcnt) {
+  const int kMaxIov = 64;
+  WSABUF bufs[kMaxIov];
+
+  while(iovcnt > 0) {
+    int n = (iovcnt < kMaxIov)? iovcnt: kMaxIov;
+    for(int i = 0; i < n; i++) {
+      bufs[i].buf = (char*)vec[i].base;
+      bufs[i].len = (ULONG)vec[i].len;
+    }
+    vec += n;
+    iovcnt -= n;
+
+    // a blocking WSASend sends all the buffers unless it fails,
+    // the deadline only bounds the wait for buffer space
+    if(!waitIO(true)) {
+      return false;
+    }
+    DWORD sent = 0;
+    if(WSASend(sock_, bufs, n, &sent, 0, NULL, NULL) != 0) {
+      logf("protorpc.Conn.Writev: IO error, err = %d.\n", WSAGetLastError());
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Conn::waitIO(bool write) {
+  const uint64 deadline = write? write_deadline_: deadline_;
+  if(deadline == 0) {
+    return true;
+  }
+  uint64 now = env()->NowMicros();
+  if(now >= deadline) {
+    timed_out_ = true;
+    return false;
+  }
+  uint64 wait = deadline - now;
+  fd_set fds;
+  FD_ZERO(&fds);
+  FD_SET(sock_, &fds);
+  struct timeval tv;
+  tv.tv_sec = long(wait / 1000000);
+  tv.tv_usec = long(wait % 1000000);
+  if(select(0, write? NULL: &fds, write? &fds: NULL, NULL, &tv) == 0) {
+    timed_out_ = true;
+    return false;
+  }
+  return true;  // the I/O call reports errors
+}
+
+bool Conn::WaitReadable(int timeout_ms) {
+  if(rpos_ < rend_) {
+    return true;
+  }
+  fd_set fds;
+  FD_ZERO(&fds);
+  FD_SET(sock_, &fds);
+  struct timeval tv;
+  tv.tv_sec = timeout_ms / 1000;
+  tv.tv_usec = (timeout_ms % 1000) * 1000;
+  return select(0, &fds, NULL, NULL, timeout_ms < 0? NULL: &tv) != 0;
+}
+
+int Conn::WaitReadable(int timeout_ms, Conn* wakeup) {
+  return WaitReadable(timeout_ms)? 1: 0;  // no Pair
+}
+
+int Conn::TryRead(void* buf, int len) {
+  if(rpos_ < rend_) {
+    int n = (len < rend_ - rpos_)? len: (rend_ - rpos_);
+    memcpy(buf, &rbuf_[rpos_], n);
+    Consume(n);
+    return n;
+  }
+  int n = recv(sock_, (char*)buf, len, 0);
+  if(n > 0) {
+    return n;
+  }
+  if(n == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK) {
+    return 0;
+  }
+  if(n == SOCKET_ERROR) {
+    logf("protorpc.Conn.TryRead: IO error, err = %d.\n", WSAGetLastError());
+  }
+  return -1;
+}
+int Conn::TryWrite(const void* buf, int len) {
+  int n = send(sock_, (const char*)buf, len, 0);
+  if(n >= 0) {
+    return n;
+  }
+  if(WSAGetLastError() == WSAEWOULDBLOCK) {
+    return 0;
+  }
+  logf("protorpc.Conn.TryWrite: IO error, err = %d.\n", WSAGetLastError());
+  return -1;
+}
+
 }  // namespace rpc
 }  // namespace protobuf
 }  // namespace google
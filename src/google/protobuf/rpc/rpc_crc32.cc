@@ -4,6 +4,24 @@
 
 #include "google/protobuf/rpc/rpc_crc32.h"
 
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#  define PROTORPC_CRC32_X86 1
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#    define PROTORPC_TARGET(x)
+#  else
+#    define PROTORPC_TARGET(x) __attribute__((target(x)))
+#  endif
+#  include <nmmintrin.h>
+#  include <wmmintrin.h>
+#endif
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#  define PROTORPC_CRC32_BIG_ENDIAN 1
+#endif
+
 namespace google {
 namespace protobuf {
 namespace rpc {
@@ -81,16 +99,296 @@ static const uint32_t crc32tab[256] = {
   0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d,
 };
 
-// Return the crc32c of data[0,n-1]
+
+// The functions below update crc, the one's complement of the checksum.
+
+static uint32_t crc32Table(uint32_t crc, const char* data, size_t n) {
+  const uint8_t* p = (const uint8_t*)data;
+  for(size_t i = 0; i < n; i++) {
+    crc = (crc >> 8) ^ crc32tab[(crc ^ p[i]) & 0xff];
+  }
+  return crc;
+}
+
+// Slicing tables: t[k][i] is the crc of byte i followed by k zero bytes.
+struct SlicingTables {
+  uint32_t ieee[16][256];
+  uint32_t castagnoli[8][256];
+
+  SlicingTables() {
+    for(int i = 0; i < 256; i++) {
+      ieee[0][i] = crc32tab[i];
+      uint32_t c = uint32_t(i);
+      for(int j = 0; j < 8; j++) {
+        c = (c >> 1) ^ ((c & 1)? 0x82f63b78: 0);
+      }
+      castagnoli[0][i] = c;
+    }
+    for(int k = 1; k < 16; k++) {
+      for(int i = 0; i < 256; i++) {
+        uint32_t c = ieee[k-1][i];
+        ieee[k][i] = (c >> 8) ^ ieee[0][c & 0xff];
+      }
+    }
+    for(int k = 1; k < 8; k++) {
+      for(int i = 0; i < 256; i++) {
+        uint32_t c = castagnoli[k-1][i];
+        castagnoli[k][i] = (c >> 8) ^ castagnoli[0][c & 0xff];
+      }
+    }
+  }
+};
+
+static const SlicingTables& slicingTables() {
+  static const SlicingTables tables;
+  return tables;
+}
+
+static inline uint32_t load32(const uint8_t* p) {
+  uint32_t x;
+  memcpy(&x, p, 4);
+  return x;
+}
+
+// Little endian only, 8 bytes per step.
+static uint32_t crc32Slicing8(const uint32_t t[][256], uint32_t crc, const char* data, size_t n) {
+  const uint8_t* p = (const uint8_t*)data;
+  for(; n >= 8; p += 8, n -= 8) {
+    uint32_t a = load32(p) ^ crc;
+    uint32_t b = load32(p + 4);
+    crc = t[7][a & 0xff] ^ t[6][(a >> 8) & 0xff] ^ t[5][(a >> 16) & 0xff] ^ t[4][a >> 24] ^
+      t[3][b & 0xff] ^ t[2][(b >> 8) & 0xff] ^ t[1][(b >> 16) & 0xff] ^ t[0][b >> 24];
+  }
+  for(; n > 0; p++, n--) {
+    crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xff];
+  }
+  return crc;
+}
+
+// Little endian only, 16 bytes per step.
+static uint32_t crc32Slicing16(uint32_t crc, const char* data, size_t n) {
+  const uint32_t (*t)[256] = slicingTables().ieee;
+  const uint8_t* p = (const uint8_t*)data;
+  for(; n >= 16; p += 16, n -= 16) {
+    uint32_t a = load32(p) ^ crc;
+    uint32_t b = load32(p + 4);
+    uint32_t c = load32(p + 8);
+    uint32_t d = load32(p + 12);
+    crc = t[15][a & 0xff] ^ t[14][(a >> 8) & 0xff] ^ t[13][(a >> 16) & 0xff] ^ t[12][a >> 24] ^
+      t[11][b & 0xff] ^ t[10][(b >> 8) & 0xff] ^ t[9][(b >> 16) & 0xff] ^ t[8][b >> 24] ^
+      t[7][c & 0xff] ^ t[6][(c >> 8) & 0xff] ^ t[5][(c >> 16) & 0xff] ^ t[4][c >> 24] ^
+      t[3][d & 0xff] ^ t[2][(d >> 8) & 0xff] ^ t[1][(d >> 16) & 0xff] ^ t[0][d >> 24];
+  }
+  return crc32Slicing8(t, crc, (const char*)p, n);
+}
+
+#if defined(PROTORPC_CRC32_X86)
+
+static bool cpuHas(int ecx_bit) {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << ecx_bit)) != 0;
+#else
+  unsigned int eax, ebx, ecx, edx;
+  __asm__("cpuid": "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx): "a"(1), "c"(0));
+  return (ecx & (1u << ecx_bit)) != 0;
+#endif
+}
+static bool hasPclmul() { return cpuHas(1) && cpuHas(19); }  // and SSE4.1
+static bool hasSSE42() { return cpuHas(20); }
+
+// Fold 64 bytes at a time with carry-less multiplications, then reduce
+// (Gopal et al., "Fast CRC Computation for Generic Polynomials Using
+// PCLMULQDQ Instruction", Intel 2009). n >= 64 and a multiple of 16.
+PROTORPC_TARGET("pclmul,sse4.1")
+static uint32_t crc32PclmulBlocks(uint32_t crc, const uint8_t* p, size_t n) {
+  const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+  const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+  const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124LL);
+  const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+  const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+  __m128i x1, x2, x3, x4, x5, x6, x7, x8;
+
+  x1 = _mm_loadu_si128((const __m128i*)(p + 0x00));
+  x2 = _mm_loadu_si128((const __m128i*)(p + 0x10));
+  x3 = _mm_loadu_si128((const __m128i*)(p + 0x20));
+  x4 = _mm_loadu_si128((const __m128i*)(p + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(int(crc)));
+  p += 64;
+  n -= 64;
+
+  // four lanes of 16 bytes
+  for(; n >= 64; p += 64, n -= 64) {
+    x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(p + 0x00)));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(p + 0x10)));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(p + 0x20)));
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(p + 0x30)));
+  }
+
+  // fold the lanes into one
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+  for(; n >= 16; p += 16, n -= 16) {
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)p)), x5);
+  }
+
+  // 128 to 64 bits
+  x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, mask32);
+  x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  // Barrett reduction to 32 bits
+  x2 = _mm_and_si128(x1, mask32);
+  x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+  x2 = _mm_and_si128(x2, mask32);
+  x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+  return uint32_t(_mm_extract_epi32(x1, 1));
+}
+
+static uint32_t crc32Pclmul(uint32_t crc, const char* data, size_t n) {
+  if(n >= 64) {
+    size_t blocks = n & ~size_t(15);
+    crc = crc32PclmulBlocks(crc, (const uint8_t*)data, blocks);
+    data += blocks;
+    n -= blocks;
+  }
+  return crc32Slicing16(crc, data, n);
+}
+
+PROTORPC_TARGET("sse4.2")
+static uint32_t crc32cHardware(uint32_t crc, const char* data, size_t n) {
+  const uint8_t* p = (const uint8_t*)data;
+#if defined(__x86_64__) || defined(_M_X64)
+  uint64_t c = crc;
+  for(; n >= 8; p += 8, n -= 8) {
+    uint64_t x;
+    memcpy(&x, p, 8);
+    c = _mm_crc32_u64(c, x);
+  }
+  crc = uint32_t(c);
+#endif
+  for(; n > 0; p++, n--) {
+    crc = _mm_crc32_u8(crc, *p);
+  }
+  return crc;
+}
+
+#endif  // PROTORPC_CRC32_X86
+
+static uint32_t crc32cSoftware(uint32_t crc, const char* data, size_t n) {
+  const uint32_t (*t)[256] = slicingTables().castagnoli;
+#if defined(PROTORPC_CRC32_BIG_ENDIAN)
+  const uint8_t* p = (const uint8_t*)data;
+  for(size_t i = 0; i < n; i++) {
+    crc = (crc >> 8) ^ t[0][(crc ^ p[i]) & 0xff];
+  }
+  return crc;
+#else
+  return crc32Slicing8(t, crc, data, n);
+#endif
+}
+
+static uint32_t hashTable(const char* data, size_t n) {
+  return ~crc32Table(~0u, data, n);
+}
+static uint32_t hashSlicing8(const char* data, size_t n) {
+  return ~crc32Slicing8(slicingTables().ieee, ~0u, data, n);
+}
+static uint32_t hashSlicing16(const char* data, size_t n) {
+  return ~crc32Slicing16(~0u, data, n);
+}
+#if defined(PROTORPC_CRC32_X86)
+static uint32_t hashPclmul(const char* data, size_t n) {
+  return ~crc32Pclmul(~0u, data, n);
+}
+#endif
+
+// Supported implementations, fastest first.
+typedef uint32_t (*CRC32Func)(uint32_t crc, const char* data, size_t n);
+static CRC32Func fastestCRC32() {
+#if defined(PROTORPC_CRC32_X86)
+  if(hasPclmul()) {
+    return crc32Pclmul;
+  }
+#endif
+#if !defined(PROTORPC_CRC32_BIG_ENDIAN)
+  return crc32Slicing16;
+#else
+  return crc32Table;
+#endif
+}
+static std::vector<CRC32Impl> crc32Impls() {
+  std::vector<CRC32Impl> impls;
+#if defined(PROTORPC_CRC32_X86)
+  if(hasPclmul()) {
+    impls.push_back(CRC32Impl("pclmul", hashPclmul));
+  }
+#endif
+#if !defined(PROTORPC_CRC32_BIG_ENDIAN)
+  impls.push_back(CRC32Impl("slicing-16", hashSlicing16));
+  impls.push_back(CRC32Impl("slicing-8", hashSlicing8));
+#endif
+  impls.push_back(CRC32Impl("table", hashTable));
+  return impls;
+}
+
+void GetCRC32Impls(std::vector<CRC32Impl>* impls) {
+  *impls = crc32Impls();
+}
+
+// Return the crc32 (IEEE) of data[0,n-1]
 uint32_t HashCRC32(const char* data, size_t data_len) {
-  uint32_t i;
-  uint32_t crc;
+  return ExtendCRC32(0, data, data_len);
+}
+
+uint32_t ExtendCRC32(uint32_t crc, const char* data, size_t data_len) {
+  static const CRC32Func fn = fastestCRC32();
+  return ~fn(~crc, data, data_len);
+}
+
+bool HasHardwareCRC32C() {
+#if defined(PROTORPC_CRC32_X86)
+  static const bool has = hasSSE42();
+  return has;
+#else
+  return false;
+#endif
+}
+
+uint32_t HashCRC32C(const char* data, size_t data_len) {
+  return ExtendCRC32C(0, data, data_len);
+}
 
-  crc = ~0;
-  for (i = 0; i < data_len; i++) {
-      crc = (crc >> 8) ^ crc32tab[(crc ^ (data[i])) & 0xff];
+uint32_t ExtendCRC32C(uint32_t crc, const char* data, size_t data_len) {
+#if defined(PROTORPC_CRC32_X86)
+  if(HasHardwareCRC32C()) {
+    return ~crc32cHardware(~crc, data, data_len);
   }
-  return ~crc;
+#endif
+  return ~crc32cSoftware(~crc, data, data_len);
 }
 
 }  // namespace rpc
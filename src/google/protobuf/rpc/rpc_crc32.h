@@ -7,14 +7,38 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <vector>
 
 namespace google {
 namespace protobuf {
 namespace rpc {
 
-// Return the crc32c of data[0,n-1]
+// Return the crc32 (IEEE) of data[0,n-1], the checksum of the wire.
+// It runs on the fastest implementation the CPU supports, picked at
+// the first call.
 uint32_t HashCRC32(const char* data, size_t n);
 
+// Return the crc32c (Castagnoli) of data[0,n-1], with the SSE4.2 crc32
+// instruction if the CPU has it.
+uint32_t HashCRC32C(const char* data, size_t n);
+bool HasHardwareCRC32C();
+
+// Extend crc, the checksum of the data before, with data[0,n-1]:
+// ExtendCRC32(HashCRC32(a), b) == HashCRC32(a+b), HashCRC32(a) ==
+// ExtendCRC32(0, a).
+uint32_t ExtendCRC32(uint32_t crc, const char* data, size_t n);
+uint32_t ExtendCRC32C(uint32_t crc, const char* data, size_t n);
+
+// A HashCRC32 implementation, for tests and benchmarks.
+struct CRC32Impl {
+  const char* name;
+  uint32_t (*hash)(const char* data, size_t n);
+
+  CRC32Impl(const char* name, uint32_t (*hash)(const char*, size_t)): name(name), hash(hash) {}
+};
+// Return the implementations the CPU supports, the one of HashCRC32 first.
+void GetCRC32Impls(std::vector<CRC32Impl>* impls);
+
 }  // namespace rpc
 }  // namespace protobuf
 }  // namespace google
@@ -0,0 +1,210 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "google/protobuf/rpc/rpc_dispatcher.h"
+
+#include <thread>
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+class Dispatcher::Slots {
+ public:
+  explicit Slots(int max): max_(max), running_(0) {}
+
+  bool full() const { return running_ >= max_; }
+
+  int max_;
+  int running_;
+  std::deque<Task> parked_;  // waiting for a slot
+};
+
+Dispatcher::Dispatcher(Env* env, int max_workers):
+  env_(env), max_workers_(max_workers), workers_(0), parked_(0) {
+  if(max_workers_ <= 0) {
+    max_workers_ = int(std::thread::hardware_concurrency());
+    if(max_workers_ <= 0) {
+      max_workers_ = 1;
+    }
+  }
+  for(int i = 0; i < Priority_ARRAYSIZE; i++) {
+    lanes_[i].weight = 1;
+    lanes_[i].current = 0;
+  }
+  lanes_[PRIORITY_HIGH].weight = 16;
+  lanes_[PRIORITY_NORMAL].weight = 4;
+  lanes_[PRIORITY_LOW].weight = 1;
+}
+Dispatcher::~Dispatcher() {
+  for(size_t i = 0; i < slots_.size(); i++) {
+    delete slots_[i];
+  }
+}
+
+void Dispatcher::SetLaneWeight(Priority priority, int weight) {
+  CondVarLock locker(&cv_);
+  lanes_[priority].weight = (weight > 0)? weight: 1;
+}
+
+Dispatcher::Slots* Dispatcher::NewSlots(int max) {
+  CondVarLock locker(&cv_);
+  slots_.push_back(new Slots(max));
+  return slots_.back();
+}
+
+bool Dispatcher::TryAcquire(const Class* cls) {
+  if(cls == NULL || (cls->method == NULL && cls->service == NULL)) {
+    return true;
+  }
+  CondVarLock locker(&cv_);
+  // first come first served: don't pass the parked calls
+  if(cls->method != NULL && !cls->method->parked_.empty()) {
+    return false;
+  }
+  if(cls->service != NULL && !cls->service->parked_.empty()) {
+    return false;
+  }
+  return acquire(cls);
+}
+
+void Dispatcher::Release(const Class* cls) {
+  if(cls == NULL || (cls->method == NULL && cls->service == NULL)) {
+    return;
+  }
+  CondVarLock locker(&cv_);
+  release(cls);
+  schedule();
+}
+
+void Dispatcher::Submit(const Class* cls, void (*function)(void* arg), void* arg) {
+  Task task;
+  task.cls = cls;
+  task.function = function;
+  task.arg = arg;
+
+  CondVarLock locker(&cv_);
+  lanes_[laneOf(cls)].tasks.push_back(task);
+  schedule();
+}
+
+uint64 Dispatcher::Parked() {
+  CondVarLock locker(&cv_);
+  return parked_;
+}
+
+// [static]
+void Dispatcher::WorkerProc(void* p) {
+  auto self = (Dispatcher*)p;
+  for(;;) {
+    Task task;
+    {
+      CondVarLock locker(&self->cv_);
+      if(!self->pick(&task)) {
+        self->workers_--;
+        return;
+      }
+    }
+    (*task.function)(task.arg);
+
+    CondVarLock locker(&self->cv_);
+    self->release(task.cls);
+  }
+}
+
+bool Dispatcher::pick(Task* task) {
+  for(;;) {
+    Lane* best = NULL;
+    int total = 0;
+    for(int i = 0; i < Priority_ARRAYSIZE; i++) {
+      auto lane = &lanes_[i];
+      if(lane->tasks.empty()) {
+        continue;
+      }
+      lane->current += lane->weight;
+      total += lane->weight;
+      if(best == NULL || lane->current > best->current) {
+        best = lane;
+      }
+    }
+    if(best == NULL) {
+      return false;
+    }
+    best->current -= total;
+
+    *task = best->tasks.front();
+    best->tasks.pop_front();
+    if(best->tasks.empty()) {
+      best->current = 0;
+    }
+    if(acquire(task->cls)) {
+      return true;
+    }
+
+    // wait on the full cap, out of the lane
+    auto cls = task->cls;
+    auto full = (cls->method != NULL && cls->method->full())? cls->method: cls->service;
+    full->parked_.push_back(*task);
+    parked_++;
+  }
+}
+
+bool Dispatcher::acquire(const Class* cls) {
+  if(cls == NULL) {
+    return true;
+  }
+  if(cls->method != NULL && cls->method->full()) {
+    return false;
+  }
+  if(cls->service != NULL && cls->service->full()) {
+    return false;
+  }
+  if(cls->method != NULL) {
+    cls->method->running_++;
+  }
+  if(cls->service != NULL) {
+    cls->service->running_++;
+  }
+  return true;
+}
+
+void Dispatcher::release(const Class* cls) {
+  if(cls == NULL) {
+    return;
+  }
+  Slots* slots[2] = { cls->method, cls->service };
+  for(int i = 0; i < 2; i++) {
+    if(slots[i] == NULL) {
+      continue;
+    }
+    slots[i]->running_--;
+    // the longest parked call goes first in its lane
+    if(!slots[i]->parked_.empty()) {
+      auto task = slots[i]->parked_.front();
+      slots[i]->parked_.pop_front();
+      lanes_[laneOf(task.cls)].tasks.push_front(task);
+    }
+  }
+}
+
+void Dispatcher::schedule() {
+  if(workers_ >= max_workers_) {
+    return;
+  }
+  for(int i = 0; i < Priority_ARRAYSIZE; i++) {
+    if(!lanes_[i].tasks.empty()) {
+      workers_++;
+      env_->Schedule(&Dispatcher::WorkerProc, this);
+      return;
+    }
+  }
+}
+
+int Dispatcher::laneOf(const Class* cls) {
+  return (cls != NULL)? int(cls->priority): int(PRIORITY_NORMAL);
+}
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
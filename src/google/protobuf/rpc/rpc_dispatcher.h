@@ -0,0 +1,108 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef GOOGLE_PROTOBUF_RPC_DISPATCHER_H__
+#define GOOGLE_PROTOBUF_RPC_DISPATCHER_H__
+
+#include <google/protobuf/rpc/rpc_env.h>
+#include <google/protobuf/rpc/options.pb.h>
+
+#include <deque>
+#include <vector>
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+// Scheduling of the calls of a service or of a method (see options.proto).
+struct CallLimits {
+  int max_concurrency;  // calls running at once, 0 for no limit
+  Priority priority;
+
+  CallLimits(): max_concurrency(0), priority(PRIORITY_NORMAL) {}
+  CallLimits(int n, Priority p): max_concurrency(n), priority(p) {}
+};
+
+// Server wide run queue of the calls, with weighted priority lanes and
+// concurrency caps.
+//
+// A call holds a slot of its method and one of its service (if they are
+// capped) while it runs. The calls submitted wait in the lane of their
+// priority, the workers (Env::Schedule functions) take them by smooth
+// weighted round robin over the lanes with calls waiting. A call whose
+// caps are full is parked on the cap until a slot is released, so it
+// doesn't hold up its lane. Thread safe.
+class Dispatcher {
+ public:
+  // Concurrency cap shared by calls.
+  class Slots;
+  // Priority and caps of the calls of a method.
+  struct Class {
+    Priority priority;
+    Slots* method;   // NULL for no cap
+    Slots* service;  // NULL for no cap
+  };
+
+  // At most max_workers functions are scheduled at once, 0 for one per CPU.
+  Dispatcher(Env* env, int max_workers=0);
+  ~Dispatcher();
+
+  // Share of the workers a lane gets while all the lanes have calls
+  // waiting. Defaults: HIGH 16, NORMAL 4, LOW 1.
+  void SetLaneWeight(Priority priority, int weight);
+
+  // A cap of max calls, owned by the dispatcher.
+  Slots* NewSlots(int max);
+
+  // Take the slots of cls (NULL for none) to run a call right away,
+  // false if they are full or calls are waiting for them.
+  bool TryAcquire(const Class* cls);
+  void Release(const Class* cls);
+
+  // Run (*function)(arg) on a worker holding the slots of cls, the
+  // slots are released when it returns.
+  void Submit(const Class* cls, void (*function)(void* arg), void* arg);
+
+  // Calls which waited for a full cap.
+  uint64 Parked();
+
+ private:
+  struct Task {
+    const Class* cls;
+    void (*function)(void* arg);
+    void* arg;
+  };
+  struct Lane {
+    int weight;
+    int current;  // smooth weighted round robin
+    std::deque<Task> tasks;
+  };
+
+  static void WorkerProc(void* p);
+  // Requires cv_ held.
+  bool pick(Task* task);
+  bool acquire(const Class* cls);
+  void release(const Class* cls);
+  void schedule();
+  static int laneOf(const Class* cls);
+
+  Env* env_;
+  int max_workers_;
+
+  // guard the fields below
+  CondVar cv_;
+  Lane lanes_[Priority_ARRAYSIZE];
+  std::vector<Slots*> slots_;
+  int workers_;
+  uint64 parked_;
+
+ private:
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(Dispatcher);
+};
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // GOOGLE_PROTOBUF_RPC_DISPATCHER_H__
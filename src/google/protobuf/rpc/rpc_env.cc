@@ -3,6 +3,9 @@
 // license that can be found in the LICENSE file.
 
 #include "google/protobuf/rpc/rpc_env.h"
+#include <google/protobuf/rpc/rpc_timer_wheel.h>
+
+#include <string.h>
 
 #if (defined(_WIN32) || defined(_WIN64))
 #  include "google/protobuf/rpc/rpc_env_windows.cc"
@@ -14,6 +17,27 @@ namespace google {
 namespace protobuf {
 namespace rpc {
 
+struct Env::Timers {
+  CondVar cv;  // guards the fields below
+  TimerWheel wheel;
+  uint64 origin;  // NowMicros() of tick 0
+  uint64 wakeup;  // tick the thread sleeps until
+  bool started;
+  bool running;
+  bool stopping;
+
+  Timers(): origin(0), wakeup(TimerWheel::kNever),
+    started(false), running(false), stopping(false) {}
+};
+
+Env::Env(): timers_(new Timers) {
+  //
+}
+Env::~Env() {
+  StopTimers();
+  delete timers_;
+}
+
 void Env::Logf(const char* fmt, ...) {
   va_list ap;
   va_start(ap, fmt);
@@ -21,6 +45,77 @@ void Env::Logf(const char* fmt, ...) {
   va_end(ap);
 }
 
+void Env::GetScheduleStats(ScheduleStats* stats) {
+  memset(stats, 0, sizeof(*stats));
+}
+
+uint64 Env::ScheduleAfter(int delay_ms, void (*function)(void* arg), void* arg) {
+  auto t = timers_;
+  CondVarLock locker(&t->cv);
+  if(!t->started) {
+    t->started = true;
+    t->running = true;
+    t->origin = NowMicros();
+    StartThread(&Env::TimerProc, this);
+  }
+  // the current tick has partly passed, expire at the end of the next
+  // one at the earliest
+  uint64 now = (NowMicros() - t->origin) / 1000;
+  uint64 expires = now + uint64(delay_ms > 0? delay_ms: 0) + 1;
+  auto id = t->wheel.Add(expires, function, arg);
+  if(expires < t->wakeup) {
+    t->cv.SignalAll();
+  }
+  return id;
+}
+
+bool Env::CancelTimer(uint64 handle) {
+  CondVarLock locker(&timers_->cv);
+  return timers_->wheel.Cancel(handle);
+}
+
+void Env::StopTimers() {
+  auto t = timers_;
+  CondVarLock locker(&t->cv);
+  t->stopping = true;
+  t->cv.SignalAll();
+  while(t->running) {
+    t->cv.Wait();
+  }
+}
+
+// [static]
+void Env::TimerProc(void* p) {
+  auto self = (Env*)p;
+  auto t = self->timers_;
+  std::vector<TimerWheel::Timer> expired;
+
+  CondVarLock locker(&t->cv);
+  while(!t->stopping) {
+    uint64 now = self->NowMicros() - t->origin;
+    t->wheel.Advance(now / 1000, &expired);
+    if(!expired.empty()) {
+      // a timer expired is no longer cancelable, its function runs
+      t->cv.Unlock();
+      for(size_t i = 0; i < expired.size(); i++) {
+        self->Schedule(expired[i].function, expired[i].arg);
+      }
+      expired.clear();
+      t->cv.Lock();
+      continue;
+    }
+    t->wakeup = t->wheel.NextExpiry();
+    if(t->wakeup == TimerWheel::kNever) {
+      t->cv.Wait();
+    } else if(t->wakeup*1000 > now) {
+      t->cv.TimedWait(t->wakeup*1000 - now);
+    }
+    t->wakeup = TimerWheel::kNever;
+  }
+  t->running = false;
+  t->cv.SignalAll();
+}
+
 }  // namespace rpc
 }  // namespace protobuf
 }  // namespace google
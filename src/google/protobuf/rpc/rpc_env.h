@@ -12,10 +12,48 @@ namespace google {
 namespace protobuf {
 namespace rpc {
 
+// A mutex and a condition variable bound to it.
+class LIBPROTOBUF_EXPORT CondVar {
+ public:
+  CondVar();
+  ~CondVar();
+
+  void Lock();
+  void Unlock();
+
+  // Atomically release the lock and wait for a signal, the lock must be held.
+  void Wait();
+  // Like Wait(), but give up after timeout_micros.
+  // Return false if the wait timed out.
+  bool TimedWait(uint64 timeout_micros);
+  void Signal();
+  void SignalAll();
+
+ private:
+  struct Rep;
+  Rep* rep_;
+
+ private:
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(CondVar);
+};
+
+// Hold the CondVar lock in the scope.
+class LIBPROTOBUF_EXPORT CondVarLock {
+ public:
+  explicit CondVarLock(CondVar* cv): cv_(cv) { cv_->Lock(); }
+  ~CondVarLock() { cv_->Unlock(); }
+
+ private:
+  CondVar* cv_;
+
+ private:
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(CondVarLock);
+};
+
 class LIBPROTOBUF_EXPORT Env {
  public:
-  Env() {}
-  virtual ~Env() {}
+  Env();
+  virtual ~Env();
 
   // Return a default environment suitable for the current operating
   // system.  Sophisticated users may wish to provide their own Env
@@ -24,10 +62,18 @@ class LIBPROTOBUF_EXPORT Env {
   // The result of Default() belongs to protobuf and must never be deleted.
   static Env* Default();
 
+  // Return a new environment of the same kind as Default(), with workers
+  // of its own. Deleting it runs the functions already scheduled first.
+  static Env* New();
+
   // Write an entry to the log file with the specified format.
   virtual void Logv(const char* fmt, va_list ap) = 0;
   virtual void Logf(const char* fmt, ...);
 
+  // Returns the number of micro-seconds since some fixed point in time.
+  // Only useful for computing deltas of time.
+  virtual uint64 NowMicros() = 0;
+
   // Start a new thread, invoking "function(arg)" within the new thread.
   // When "function(arg)" returns, the thread will be destroyed.
   virtual void StartThread(void (*function)(void* arg), void* arg) = 0;
@@ -40,6 +86,45 @@ class LIBPROTOBUF_EXPORT Env {
   // serialized.
   virtual void Schedule(void (*function)(void* arg), void* arg) = 0;
 
+  // Set the number of worker threads used by Schedule().
+  // It must be called before the first Schedule(), the default is the
+  // number of CPUs. Return false if it is not supported or too late.
+  virtual bool SetBackgroundThreads(int num_threads) { return false; }
+
+  // Bind the calling thread to the CPU cpu (from 0).
+  // Return false if it is not supported or the CPU does not exist.
+  virtual bool PinThread(int cpu) { return false; }
+
+  // Counters of the Schedule() workers.
+  struct ScheduleStats {
+    int num_threads;
+    uint64 queue_depth;   // functions waiting to run
+    uint64 scheduled;     // total Schedule() calls
+    uint64 executed;      // total functions returned
+    uint64 steals;        // functions taken from another worker's queue
+  };
+  virtual void GetScheduleStats(ScheduleStats* stats);
+
+  // Arrange to Schedule() "(*function)(arg)" once delay_ms milliseconds
+  // have passed (never earlier), return a handle for CancelTimer (never
+  // 0). The timers are kept in a timing wheel of 1ms ticks, run by a
+  // thread started at the first call.
+  virtual uint64 ScheduleAfter(int delay_ms, void (*function)(void* arg), void* arg);
+  // Cancel a timer of ScheduleAfter. Return false if its function is
+  // already scheduled (or the handle is stale).
+  virtual bool CancelTimer(uint64 handle);
+
+ protected:
+  // Stop the timer thread, the timers left never run. Implementations
+  // call it first in their destructor, the thread uses their methods.
+  void StopTimers();
+
+ private:
+  struct Timers;
+  static void TimerProc(void* p);
+
+  Timers* timers_;
+
  private:
   GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(Env);
 };
@@ -4,8 +4,13 @@
 
 #include "google/protobuf/rpc/rpc_env.h"
 #include "google/protobuf/stubs/once.h"
+#include "google/protobuf/stubs/atomicops.h"
 
+#include <string.h>
 #include <queue>
+#include <vector>
+#include <errno.h>
+#include <time.h>
 #include <unistd.h>
 #include <pthread.h>
 
@@ -13,6 +18,16 @@ namespace google {
 namespace protobuf {
 namespace rpc {
 
+using ::google::protobuf::internal::AtomicWord;
+using ::google::protobuf::internal::NoBarrier_Load;
+using ::google::protobuf::internal::NoBarrier_Store;
+using ::google::protobuf::internal::Acquire_Load;
+using ::google::protobuf::internal::Release_Store;
+using ::google::protobuf::internal::MemoryBarrier;
+using ::google::protobuf::internal::Acquire_CompareAndSwap;
+using ::google::protobuf::internal::NoBarrier_AtomicIncrement;
+using ::google::protobuf::internal::Barrier_AtomicIncrement;
+
 namespace {
 struct StartThreadState {
   void (*user_function)(void*);
@@ -26,14 +41,145 @@ static void* StartThreadWrapper(void* arg) {
   return NULL;
 }
 
+struct CondVar::Rep {
+  pthread_mutex_t mu;
+  pthread_cond_t cv;
+};
+
+CondVar::CondVar(): rep_(new Rep) {
+  pthread_mutex_init(&rep_->mu, NULL);
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&rep_->cv, &attr);
+  pthread_condattr_destroy(&attr);
+}
+CondVar::~CondVar() {
+  pthread_cond_destroy(&rep_->cv);
+  pthread_mutex_destroy(&rep_->mu);
+  delete rep_;
+}
+
+void CondVar::Lock() { pthread_mutex_lock(&rep_->mu); }
+void CondVar::Unlock() { pthread_mutex_unlock(&rep_->mu); }
+void CondVar::Wait() { pthread_cond_wait(&rep_->cv, &rep_->mu); }
+bool CondVar::TimedWait(uint64 timeout_micros) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint64 nsec = uint64(ts.tv_nsec) + (timeout_micros%1000000)*1000;
+  ts.tv_sec += time_t(timeout_micros/1000000 + nsec/1000000000);
+  ts.tv_nsec = long(nsec%1000000000);
+  return pthread_cond_timedwait(&rep_->cv, &rep_->mu, &ts) != ETIMEDOUT;
+}
+void CondVar::Signal() { pthread_cond_signal(&rep_->cv); }
+void CondVar::SignalAll() { pthread_cond_broadcast(&rep_->cv); }
+
+// Entry per Schedule() call
+struct BGItem { void* arg; void (*function)(void*); };
+
+// Work-stealing deque (Chase-Lev) with a fixed capacity, the items are
+// stored by value.
+//
+// Only the owner worker calls Push()/Pop() at the bottom,
+// the other workers call Steal() at the top. A thief may read a slot
+// being overwritten, it then loses the race for top_ and drops it.
+class WorkDeque {
+ public:
+  enum { kCapacity = 4096 };
+
+  WorkDeque(): top_(0), bottom_(0) {
+    memset((void*)slots_, 0, sizeof(slots_));
+  }
+
+  // Return false if the deque is full.
+  bool Push(const BGItem& item) {
+    AtomicWord b = NoBarrier_Load(&bottom_);
+    AtomicWord t = Acquire_Load(&top_);
+    if(b - t >= kCapacity) {
+      return false;
+    }
+    Slot* slot = &slots_[b & (kCapacity-1)];
+    NoBarrier_Store(&slot->function, reinterpret_cast<AtomicWord>(item.function));
+    NoBarrier_Store(&slot->arg, reinterpret_cast<AtomicWord>(item.arg));
+    Release_Store(&bottom_, b + 1);
+    return true;
+  }
+
+  // Return false if the deque is empty.
+  bool Pop(BGItem* item) {
+    AtomicWord b = NoBarrier_Load(&bottom_) - 1;
+    NoBarrier_Store(&bottom_, b);
+    MemoryBarrier();
+    AtomicWord t = NoBarrier_Load(&top_);
+    if(t > b) {
+      NoBarrier_Store(&bottom_, b + 1);
+      return false;
+    }
+    load(&slots_[b & (kCapacity-1)], item);
+    bool ok = true;
+    if(t == b) {
+      // the last item, race with the thieves
+      ok = Acquire_CompareAndSwap(&top_, t, t + 1) == t;
+      NoBarrier_Store(&bottom_, b + 1);
+    }
+    return ok;
+  }
+
+  // Return false if the deque is empty or another thief won.
+  bool Steal(BGItem* item) {
+    AtomicWord t = Acquire_Load(&top_);
+    MemoryBarrier();
+    AtomicWord b = Acquire_Load(&bottom_);
+    if(t >= b) {
+      return false;
+    }
+    load(&slots_[t & (kCapacity-1)], item);
+    return Acquire_CompareAndSwap(&top_, t, t + 1) == t;
+  }
+
+ private:
+  struct Slot {
+    volatile AtomicWord function;
+    volatile AtomicWord arg;
+  };
+
+  static void load(Slot* slot, BGItem* item) {
+    item->function = reinterpret_cast<void (*)(void*)>(Acquire_Load(&slot->function));
+    item->arg = reinterpret_cast<void*>(Acquire_Load(&slot->arg));
+  }
+
+  volatile AtomicWord top_;
+  char pad_[64];
+  volatile AtomicWord bottom_;
+  Slot slots_[kCapacity];
+};
+
 class PosixEnv : public Env {
  public:
-  PosixEnv() : page_size_(getpagesize()), started_bgthread_(false) {
+  PosixEnv() : page_size_(getpagesize()), started_bgthread_(false), started_(0),
+    num_threads_(0), stopping_(0), pending_(0), sleeping_(0), scheduled_(0) {
     PthreadCall("mutex_init", pthread_mutex_init(&mu_, NULL));
     PthreadCall("cvar_init", pthread_cond_init(&bgsignal_, NULL));
+
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    num_threads_ = (ncpu > 0)? int(ncpu): 1;
   }
+  // Run the functions scheduled, the ones they schedule too, then stop
+  // the workers (as the Windows env does).
   virtual ~PosixEnv() {
-    exit(1);
+    StopTimers();
+    PthreadCall("lock", pthread_mutex_lock(&mu_));
+    Release_Store(&stopping_, 1);
+    PthreadCall("broadcast", pthread_cond_broadcast(&bgsignal_));
+    PthreadCall("unlock", pthread_mutex_unlock(&mu_));
+    for(size_t i = 0; i < workers_.size(); i++) {
+      PthreadCall("join", pthread_join(workers_[i]->thread, NULL));
+    }
+    for(size_t i = 0; i < workers_.size(); i++) {
+      delete workers_[i];
+    }
+    PthreadCall("cvar_destroy", pthread_cond_destroy(&bgsignal_));
+    PthreadCall("mutex_destroy", pthread_mutex_destroy(&mu_));
   }
 
   // Write an entry to the log file with the specified format.
@@ -45,6 +191,12 @@ class PosixEnv : public Env {
     fprintf(stderr, "%s\n", buffer);
   }
 
+  uint64 NowMicros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64(ts.tv_sec) * 1000000 + uint64(ts.tv_nsec) / 1000;
+  }
+
   void StartThread(void (*function)(void* arg), void* arg) {
     pthread_t t;
     StartThreadState* state = new StartThreadState;
@@ -53,33 +205,89 @@ class PosixEnv : public Env {
     PthreadCall("start thread", pthread_create(&t, NULL,  &StartThreadWrapper, state));
   }
 
-  void Schedule(void (*function)(void*), void* arg) {
+  bool SetBackgroundThreads(int num_threads) {
+    if(num_threads < 1) {
+      return false;
+    }
     PthreadCall("lock", pthread_mutex_lock(&mu_));
+    bool ok = !started_bgthread_;
+    if(ok) {
+      num_threads_ = num_threads;
+    }
+    PthreadCall("unlock", pthread_mutex_unlock(&mu_));
+    return ok;
+  }
 
-    // Start background thread if necessary
-    if (!started_bgthread_) {
-      started_bgthread_ = true;
-      PthreadCall(
-        "create thread",
-        pthread_create(&bgthread_, NULL,  &PosixEnv::BGThreadWrapper, this)
-      );
+  bool PinThread(int cpu) {
+#if defined(__linux__)
+    if(cpu < 0 || cpu >= CPU_SETSIZE) {
+      return false;
     }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+  }
 
-    // If the queue is currently empty, the background thread may currently be
-    // waiting.
-    if(queue_.empty()) {
-      PthreadCall("signal", pthread_cond_signal(&bgsignal_));
+  void Schedule(void (*function)(void*), void* arg) {
+    BGItem item;
+    item.function = function;
+    item.arg = arg;
+
+    // Start background threads if necessary
+    if(Acquire_Load(&started_) == 0) {
+      startWorkers();
     }
 
-    // Add to priority queue
-    queue_.push_back(BGItem());
-    queue_.back().function = function;
-    queue_.back().arg = arg;
+    // Calls from a worker go to its own deque, others to the shared queue
+    Worker* self = tls_worker_;
+    if(self == NULL || self->env != this || !self->deque.Push(item)) {
+      PthreadCall("lock", pthread_mutex_lock(&mu_));
+      queue_.push_back(item);
+      PthreadCall("unlock", pthread_mutex_unlock(&mu_));
+    }
+    if(self != NULL && self->env == this) {
+      NoBarrier_AtomicIncrement(&self->scheduled, 1);
+    } else {
+      NoBarrier_AtomicIncrement(&scheduled_, 1);
+    }
 
-    PthreadCall("unlock", pthread_mutex_unlock(&mu_));
+    // Wake up a sleeping worker (pending_ and sleeping_ form a Dekker pair)
+    Barrier_AtomicIncrement(&pending_, 1);
+    if(Acquire_Load(&sleeping_) > 0) {
+      PthreadCall("lock", pthread_mutex_lock(&mu_));
+      PthreadCall("signal", pthread_cond_signal(&bgsignal_));
+      PthreadCall("unlock", pthread_mutex_unlock(&mu_));
+    }
+  }
+
+  void GetScheduleStats(ScheduleStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->scheduled = uint64(NoBarrier_Load(&scheduled_));
+    for(size_t i = 0; i < workers_.size(); i++) {
+      stats->scheduled += uint64(NoBarrier_Load(&workers_[i]->scheduled));
+      stats->executed += uint64(NoBarrier_Load(&workers_[i]->executed));
+      stats->steals += uint64(NoBarrier_Load(&workers_[i]->steals));
+    }
+    AtomicWord pending = NoBarrier_Load(&pending_);
+    stats->queue_depth = (pending > 0)? uint64(pending): 0;
+    stats->num_threads = int(workers_.size());
   }
 
  private:
+  struct Worker {
+    PosixEnv* env;
+    int index;
+    pthread_t thread;
+    WorkDeque deque;
+    volatile AtomicWord scheduled;
+    volatile AtomicWord executed;
+    volatile AtomicWord steals;
+  };
+
   void PthreadCall(const char* label, int result) {
     if(result != 0) {
       fprintf(stderr, "pthread %s: %s\n", label, strerror(result));
@@ -87,43 +295,114 @@ class PosixEnv : public Env {
     }
   }
 
-  // BGThread() is the body of the background thread
-  void BGThread() {
-    while (true) {
-      // Wait until there is an item that is ready to run
-      PthreadCall("lock", pthread_mutex_lock(&mu_));
-      while (queue_.empty()) {
-        PthreadCall("wait", pthread_cond_wait(&bgsignal_, &mu_));
+  void startWorkers() {
+    PthreadCall("lock", pthread_mutex_lock(&mu_));
+    if(!started_bgthread_) {
+      started_bgthread_ = true;
+      for(int i = 0; i < num_threads_; i++) {
+        Worker* w = new Worker;
+        w->env = this;
+        w->index = i;
+        w->scheduled = 0;
+        w->executed = 0;
+        w->steals = 0;
+        workers_.push_back(w);
       }
+      Release_Store(&started_, 1);
+      for(int i = 0; i < num_threads_; i++) {
+        PthreadCall(
+          "create thread",
+          pthread_create(&workers_[i]->thread, NULL,  &PosixEnv::BGThreadWrapper, workers_[i])
+        );
+      }
+    }
+    PthreadCall("unlock", pthread_mutex_unlock(&mu_));
+  }
+
+  // Find an item: own deque, then the shared queue, then steal.
+  bool nextItem(Worker* self, BGItem* item) {
+    if(self->deque.Pop(item)) {
+      return true;
+    }
 
-      void (*function)(void*) = queue_.front().function;
-      void* arg = queue_.front().arg;
+    bool ok = false;
+    PthreadCall("lock", pthread_mutex_lock(&mu_));
+    if(!queue_.empty()) {
+      *item = queue_.front();
       queue_.pop_front();
+      ok = true;
+    }
+    PthreadCall("unlock", pthread_mutex_unlock(&mu_));
+    if(ok) {
+      return true;
+    }
 
-      PthreadCall("unlock", pthread_mutex_unlock(&mu_));
-      (*function)(arg);
+    int n = int(workers_.size());
+    for(int i = 1; i < n; i++) {
+      Worker* victim = workers_[(self->index + i) % n];
+      if(victim->deque.Steal(item)) {
+        NoBarrier_AtomicIncrement(&self->steals, 1);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // BGThread() is the body of the background thread
+  void BGThread(Worker* self) {
+    tls_worker_ = self;
+    while (true) {
+      BGItem item;
+      if(!nextItem(self, &item)) {
+        // stopping: done once nothing is left to run
+        if(Acquire_Load(&pending_) <= 0 && Acquire_Load(&stopping_) != 0) {
+          return;
+        }
+        // Wait until there is an item that is ready to run
+        PthreadCall("lock", pthread_mutex_lock(&mu_));
+        Barrier_AtomicIncrement(&sleeping_, 1);
+        while(Acquire_Load(&pending_) <= 0 && Acquire_Load(&stopping_) == 0) {
+          PthreadCall("wait", pthread_cond_wait(&bgsignal_, &mu_));
+        }
+        Barrier_AtomicIncrement(&sleeping_, -1);
+        PthreadCall("unlock", pthread_mutex_unlock(&mu_));
+        continue;
+      }
+
+      Barrier_AtomicIncrement(&pending_, -1);
+      (*item.function)(item.arg);
+      NoBarrier_AtomicIncrement(&self->executed, 1);
     }
   }
 
   static void* BGThreadWrapper(void* arg) {
-    reinterpret_cast<PosixEnv*>(arg)->BGThread();
+    Worker* w = reinterpret_cast<Worker*>(arg);
+    w->env->BGThread(w);
     return NULL;
   }
 
   size_t page_size_;
   pthread_mutex_t mu_;
   pthread_cond_t bgsignal_;
-  pthread_t bgthread_;
   bool started_bgthread_;
+  volatile AtomicWord started_;
+  int num_threads_;
+  std::vector<Worker*> workers_;
+  volatile AtomicWord stopping_;  // set under mu_
 
-  // Entry per Schedule() call
-  struct BGItem { void* arg; void (*function)(void*); };
+  // Items scheduled from non-worker threads (or a full deque)
   typedef std::deque<BGItem> BGQueue;
   BGQueue queue_;
 
-  void* zmq_ctx_;
+  volatile AtomicWord pending_;    // queued but not yet started
+  volatile AtomicWord sleeping_;   // workers waiting on bgsignal_
+  volatile AtomicWord scheduled_;  // Schedule() calls from non-worker threads
+
+  static __thread Worker* tls_worker_;
 };
 
+__thread PosixEnv::Worker* PosixEnv::tls_worker_ = NULL;
+
 static ::google::protobuf::ProtobufOnceType g_env_default_init_once;
 static Env* g_env_default;
 static void InitDefaultEnv() {
@@ -135,6 +414,10 @@ Env* Env::Default() {
   return static_cast<Env *>(g_env_default);
 }
 
+Env* Env::New() {
+  return new PosixEnv;
+}
+
 }  // namespace rpc
 }  // namespace protobuf
 }  // namespace google
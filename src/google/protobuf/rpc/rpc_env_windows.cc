@@ -20,29 +20,65 @@ namespace rpc {
 namespace {
 struct ThreadParam {
   ThreadParam(void (*function)(void* arg), void* arg)
-    : function(function), arg(arg) {
+    : function(function), arg(arg), pending(NULL), executed(NULL) {
   }
 
   void (*function)(void* arg);
   void* arg;
+
+  // Schedule() counters, NULL for StartThread()
+  volatile LONG* pending;
+  volatile LONG* executed;
 };
 
 DWORD WINAPI ThreadProc(LPVOID lpParameter) {
   ThreadParam * param = static_cast<ThreadParam *>(lpParameter);
   void (*function)(void* arg) = param->function;
   void* arg = param->arg;
+  volatile LONG* pending = param->pending;
+  volatile LONG* executed = param->executed;
   delete param;
+  if(pending != NULL) InterlockedDecrement(pending);
   function(arg);
+  if(executed != NULL) InterlockedIncrement(executed);
   return 0;
 }
 }  // namespace
 
+struct CondVar::Rep {
+  CRITICAL_SECTION mu;
+  CONDITION_VARIABLE cv;
+};
+
+CondVar::CondVar(): rep_(new Rep) {
+  InitializeCriticalSection(&rep_->mu);
+  InitializeConditionVariable(&rep_->cv);
+}
+CondVar::~CondVar() {
+  DeleteCriticalSection(&rep_->mu);
+  delete rep_;
+}
+
+void CondVar::Lock() { EnterCriticalSection(&rep_->mu); }
+void CondVar::Unlock() { LeaveCriticalSection(&rep_->mu); }
+void CondVar::Wait() { SleepConditionVariableCS(&rep_->cv, &rep_->mu, INFINITE); }
+bool CondVar::TimedWait(uint64 timeout_micros) {
+  DWORD ms = DWORD((timeout_micros + 999) / 1000);
+  return SleepConditionVariableCS(&rep_->cv, &rep_->mu, ms) != 0;
+}
+void CondVar::Signal() { WakeConditionVariable(&rep_->cv); }
+void CondVar::SignalAll() { WakeAllConditionVariable(&rep_->cv); }
+
 class WindowsEnv : public Env {
  public:
-  WindowsEnv() {
+  WindowsEnv(): pending_(0), scheduled_(0), executed_(0) {
   }
+  // The system pool can't drop the functions queued, wait for them.
   virtual ~WindowsEnv() {
-    exit(1);
+    StopTimers();
+    while(executed_ < scheduled_) {
+      Sleep(1);
+    }
   }
 
   // Write an entry to the log file with the specified format.
@@ -54,6 +90,14 @@ class WindowsEnv : public Env {
     fprintf(stderr, "%s\n", buffer);
   }
 
+  virtual uint64 NowMicros() {
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return uint64(now.QuadPart / freq.QuadPart) * 1000000 +
+      uint64(now.QuadPart % freq.QuadPart) * 1000000 / uint64(freq.QuadPart);
+  }
+
   // Start a new thread, invoking "function(arg)" within the new thread.
   // When "function(arg)" returns, the thread will be destroyed.
   virtual void StartThread(void (*function)(void* arg), void* arg) {
@@ -61,6 +105,13 @@ class WindowsEnv : public Env {
     CreateThread(NULL, 0, ThreadProc, param, 0, NULL);
   }
 
+  virtual bool PinThread(int cpu) {
+    if(cpu < 0 || cpu >= int(sizeof(DWORD_PTR)*8)) {
+      return false;
+    }
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+  }
+
   // Arrange to run "(*function)(arg)" once in a background thread.
   //
   // "function" may run in an unspecified thread.  Multiple functions
@@ -69,8 +120,25 @@ class WindowsEnv : public Env {
   // serialized.
   virtual void Schedule(void (*function)(void* arg), void* arg) {
     ThreadParam * param = new ThreadParam(function, arg);
+    param->pending = &pending_;
+    param->executed = &executed_;
+    InterlockedIncrement(&pending_);
+    InterlockedIncrement(&scheduled_);
     QueueUserWorkItem(ThreadProc, param, WT_EXECUTEDEFAULT);
   }
+
+  // The system thread pool sizes itself and has no work stealing counters.
+  virtual void GetScheduleStats(ScheduleStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->queue_depth = uint64(pending_ > 0? pending_: 0);
+    stats->scheduled = uint64(scheduled_);
+    stats->executed = uint64(executed_);
+  }
+
+ private:
+  volatile LONG pending_;
+  volatile LONG scheduled_;
+  volatile LONG executed_;
 };
 
 static GOOGLE_PROTOBUF_DECLARE_ONCE(g_env_default_init_once);
@@ -84,6 +152,10 @@ Env* Env::Default() {
   return static_cast<Env *>(g_env_default);
 }
 
+Env* Env::New() {
+  return new WindowsEnv;
+}
+
 }  // namespace rpc
 }  // namespace protobuf
 }  // namespace google
@@ -0,0 +1,11 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "google/protobuf/rpc/rpc_event_loop.h"
+
+#if (defined(_WIN32) || defined(_WIN64))
+#  include "./rpc_event_loop_windows.cc"
+#else
+#  include "./rpc_event_loop_posix.cc"
+#endif
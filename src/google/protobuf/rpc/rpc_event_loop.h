@@ -0,0 +1,80 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef GOOGLE_PROTOBUF_RPC_EVENT_LOOP_H__
+#define GOOGLE_PROTOBUF_RPC_EVENT_LOOP_H__
+
+#include <google/protobuf/stubs/common.h>
+
+#include <vector>
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+class Env;
+
+// Readiness notification loop (epoll on Linux).
+//
+// File descriptors are registered edge-triggered for both read and write
+// readiness, so a handler must drain the socket (until it would block)
+// every time it is notified.
+class EventLoop {
+ public:
+  enum {
+    kReadable = 1 << 0,
+    kWritable = 1 << 1,
+    kHangup   = 1 << 2,
+  };
+
+  class Handler {
+   public:
+    virtual ~Handler() {}
+    // Called on the loop thread with the kReadable/kWritable/kHangup bits.
+    virtual void OnEvents(int events) = 0;
+  };
+
+  EventLoop(Env* env=NULL);
+  ~EventLoop();
+
+  // Return false if the event loop is not supported on this platform.
+  bool Init();
+
+  // Register/unregister a non-blocking file descriptor.
+  bool Add(int fd, Handler* handler);
+  void Remove(int fd);
+
+  // [blocking]
+  // Dispatch events until Stop() is called.
+  void Run();
+  // Wake up the loop and make Run() return. Thread safe.
+  void Stop();
+
+  // Run function(arg) on the loop thread. Thread safe.
+  void Post(void (*function)(void* arg), void* arg);
+
+ private:
+  struct Task {
+    void (*function)(void* arg);
+    void* arg;
+  };
+  void runPosted();
+
+  int poll_fd_;
+  int wakeup_fd_;
+  volatile bool stopped_;
+  Env* env_;
+
+  Mutex mutex_;
+  std::vector<Task> posted_;
+
+ private:
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(EventLoop);
+};
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
+
+#endif // GOOGLE_PROTOBUF_RPC_EVENT_LOOP_H__
@@ -0,0 +1,153 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "google/protobuf/rpc/rpc_event_loop.h"
+#include "google/protobuf/rpc/rpc_env.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#  include <sys/epoll.h>
+#  include <sys/eventfd.h>
+#endif
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+EventLoop::EventLoop(Env* env):
+  poll_fd_(-1), wakeup_fd_(-1), stopped_(false), env_(env) {
+  //
+}
+EventLoop::~EventLoop() {
+  if(wakeup_fd_ >= 0) ::close(wakeup_fd_);
+  if(poll_fd_ >= 0) ::close(poll_fd_);
+}
+
+#if defined(__linux__)
+
+bool EventLoop::Init() {
+  if((poll_fd_ = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+    if(env_ != NULL) env_->Logf("protorpc.EventLoop.Init: epoll_create1 failed, err = %d.\n", errno);
+    return false;
+  }
+  if((wakeup_fd_ = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC)) < 0) {
+    if(env_ != NULL) env_->Logf("protorpc.EventLoop.Init: eventfd failed, err = %d.\n", errno);
+    return false;
+  }
+
+  // the wakeup fd carries a NULL handler
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;
+  if(epoll_ctl(poll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &ev) != 0) {
+    if(env_ != NULL) env_->Logf("protorpc.EventLoop.Init: epoll_ctl failed, err = %d.\n", errno);
+    return false;
+  }
+  return true;
+}
+
+bool EventLoop::Add(int fd, Handler* handler) {
+  struct epoll_event ev;
+  ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  ev.data.ptr = handler;
+  if(epoll_ctl(poll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+    if(env_ != NULL) env_->Logf("protorpc.EventLoop.Add: epoll_ctl failed, err = %d.\n", errno);
+    return false;
+  }
+  return true;
+}
+
+void EventLoop::Remove(int fd) {
+  struct epoll_event ev;
+  epoll_ctl(poll_fd_, EPOLL_CTL_DEL, fd, &ev);
+}
+
+void EventLoop::Run() {
+  const int kMaxEvents = 256;
+  struct epoll_event events[kMaxEvents];
+
+  while(!stopped_) {
+    int n = epoll_wait(poll_fd_, events, kMaxEvents, -1);
+    if(n < 0) {
+      if(errno == EINTR) continue;
+      if(env_ != NULL) env_->Logf("protorpc.EventLoop.Run: epoll_wait failed, err = %d.\n", errno);
+      return;
+    }
+    for(int i = 0; i < n; i++) {
+      Handler* handler = (Handler*)events[i].data.ptr;
+      if(handler == NULL) {
+        uint64_t v;
+        while(::read(wakeup_fd_, &v, sizeof(v)) > 0) {}
+        runPosted();
+        continue;
+      }
+
+      int mask = 0;
+      if(events[i].events & (EPOLLIN|EPOLLPRI)) mask |= kReadable;
+      if(events[i].events & EPOLLOUT) mask |= kWritable;
+      if(events[i].events & (EPOLLERR|EPOLLHUP|EPOLLRDHUP)) mask |= kHangup;
+      handler->OnEvents(mask);
+    }
+  }
+}
+
+void EventLoop::Stop() {
+  stopped_ = true;
+  if(wakeup_fd_ >= 0) {
+    uint64_t v = 1;
+    ssize_t n = ::write(wakeup_fd_, &v, sizeof(v));
+    (void)n;
+  }
+}
+
+void EventLoop::Post(void (*function)(void* arg), void* arg) {
+  {
+    MutexLock locker(&mutex_);
+    Task task = { function, arg };
+    posted_.push_back(task);
+  }
+  uint64_t v = 1;
+  ssize_t n = ::write(wakeup_fd_, &v, sizeof(v));
+  (void)n;
+}
+
+#else  // !defined(__linux__)
+
+bool EventLoop::Init() {
+  return false;
+}
+bool EventLoop::Add(int fd, Handler* handler) {
+  return false;
+}
+void EventLoop::Remove(int fd) {
+  //
+}
+void EventLoop::Run() {
+  //
+}
+void EventLoop::Stop() {
+  stopped_ = true;
+}
+void EventLoop::Post(void (*function)(void* arg), void* arg) {
+  //
+}
+
+#endif  // defined(__linux__)
+
+void EventLoop::runPosted() {
+  std::vector<Task> tasks;
+  {
+    MutexLock locker(&mutex_);
+    tasks.swap(posted_);
+  }
+  for(size_t i = 0; i < tasks.size(); i++) {
+    tasks[i].function(tasks[i].arg);
+  }
+}
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,49 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "google/protobuf/rpc/rpc_event_loop.h"
+#include "google/protobuf/rpc/rpc_env.h"
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+// The event loop is not supported on windows,
+// Init() returns false and callers fall back to the blocking mode.
+
+EventLoop::EventLoop(Env* env):
+  poll_fd_(-1), wakeup_fd_(-1), stopped_(false), env_(env) {
+  //
+}
+EventLoop::~EventLoop() {
+  //
+}
+
+bool EventLoop::Init() {
+  return false;
+}
+
+bool EventLoop::Add(int fd, Handler* handler) {
+  return false;
+}
+void EventLoop::Remove(int fd) {
+  //
+}
+
+void EventLoop::Run() {
+  //
+}
+void EventLoop::Stop() {
+  stopped_ = true;
+}
+void EventLoop::Post(void (*function)(void* arg), void* arg) {
+  //
+}
+void EventLoop::runPosted() {
+  //
+}
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
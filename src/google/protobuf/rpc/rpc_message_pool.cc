@@ -0,0 +1,56 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "google/protobuf/rpc/rpc_message_pool.h"
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+MessagePool::MessagePool(int max_per_type, int max_message_bytes):
+  max_per_type_(max_per_type > 0? max_per_type: 0),
+  max_message_bytes_(max_message_bytes) {
+  //
+}
+MessagePool::~MessagePool() {
+  for(auto it = free_.begin(); it != free_.end(); ++it) {
+    for(size_t i = 0; i < it->second.size(); i++) {
+      delete it->second[i];
+    }
+  }
+}
+
+::google::protobuf::Message* MessagePool::New(const ::google::protobuf::Message& prototype) {
+  if(max_per_type_ > 0) {
+    MutexLock locker(&mutex_);
+    auto it = free_.find(prototype.GetDescriptor());
+    if(it != free_.end() && !it->second.empty()) {
+      auto msg = it->second.back();
+      it->second.pop_back();
+      return msg;
+    }
+  }
+  return prototype.New();
+}
+
+void MessagePool::Delete(::google::protobuf::Message* msg) {
+  if(msg == NULL) {
+    return;
+  }
+  if(max_per_type_ > 0 && msg->SpaceUsed() <= max_message_bytes_) {
+    // clear out of the lock, the next New gets it ready to use
+    msg->Clear();
+    MutexLock locker(&mutex_);
+    auto& list = free_[msg->GetDescriptor()];
+    if(int(list.size()) < max_per_type_) {
+      list.push_back(msg);
+      return;
+    }
+  }
+  delete msg;
+}
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,52 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef GOOGLE_PROTOBUF_RPC_MESSAGE_POOL_H__
+#define GOOGLE_PROTOBUF_RPC_MESSAGE_POOL_H__
+
+#include <google/protobuf/message.h>
+#include <google/protobuf/descriptor.h>
+
+#include <map>
+#include <vector>
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+// Cleared messages kept for reuse, by message type.
+//
+// Clear() keeps the memory of the strings, sub-messages and repeated
+// fields, so a reused message allocates again only when it grows past
+// the largest value it held. Thread safe.
+class MessagePool {
+ public:
+  // Keep at most max_per_type messages of each type, 0 disables the pool.
+  // A message grown over max_message_bytes (SpaceUsed) is deleted, not
+  // kept with the memory of one oversized call.
+  explicit MessagePool(int max_per_type=4, int max_message_bytes=64*1024);
+  ~MessagePool();
+
+  // Return an empty message of the type of prototype.
+  ::google::protobuf::Message* New(const ::google::protobuf::Message& prototype);
+  // Give back a message of New, NULL is ignored.
+  void Delete(::google::protobuf::Message* msg);
+
+ private:
+  typedef std::vector< ::google::protobuf::Message*> FreeList;
+
+  int max_per_type_;
+  int max_message_bytes_;
+  Mutex mutex_;
+  std::map<const ::google::protobuf::Descriptor*, FreeList> free_;
+
+ private:
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(MessagePool);
+};
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // GOOGLE_PROTOBUF_RPC_MESSAGE_POOL_H__
@@ -4,89 +4,716 @@
 
 #include "google/protobuf/rpc/rpc_server.h"
 #include "google/protobuf/rpc/rpc_env.h"
+#include "google/protobuf/rpc/rpc_server_loop.h"
+#include "google/protobuf/rpc/rpc_wire.h"
+#include "google/protobuf/rpc/rpc_crc32.h"
+#include <google/protobuf/stubs/defer.h>
+
+#include <string.h>
+#include <thread>
 
 namespace google {
 namespace protobuf {
 namespace rpc {
 
-Server::Server(Env* env): env_(env) {
+namespace {
+struct AcceptArg {
+  Server* server;
+  Conn* listener;
+};
+}  // namespace
+
+// A listening socket of ServeSharded and the loop serving it.
+struct Server::Shard {
+  Server* server;
+  Conn* listener;
+  ServerLoop* loop;
+  int cpu;
+
+  Shard(Server* s, int c): server(s), listener(new Conn(0, s->env_)),
+    loop(new ServerLoop(s, s->env_, 1)), cpu(c) {}
+  ~Shard() {
+    delete loop;
+    listener->Close();
+    delete listener;
+  }
+};
+
+Server::Server(Env* env): env_(env), max_inflight_per_conn_(16), message_pool_size_(4),
+  io_uring_(true), protocol_v2_(true), idle_timeout_ms_(0), max_body_len_(0),
+  accepting_(0), stopping_(false), stopped_(false) {
   MutexLock locker(&mutex_);
   if(env_ == NULL) {
     env_ = Env::Default();
   }
+  dispatcher_ = new Dispatcher(env_);
+  Conn::Pair(&wakeup_[0], &wakeup_[1]);
 }
 Server::~Server() {
+  {
+    // the calls of the connections shut down by Shutdown
+    CondVarLock locker(&cv_);
+    while(stopping_ && !conns_.empty()) {
+      cv_.Wait();
+    }
+  }
+  for(size_t i = 0; i < shards_.size(); i++) {
+    delete shards_[i];
+  }
+  for(size_t i = 0; i < listeners_.size(); i++) {
+    listeners_[i]->Close();
+    delete listeners_[i];
+  }
+  wakeup_[0].Close();
+  wakeup_[1].Close();
   const auto& map = service_ownership_map_;
   for(auto it = map.begin(); it != map.end(); ++it) {
     if(it->second) {
       delete service_map_[it->first];
     }
   }
+  delete dispatcher_;
 }
 
 // Add a command to the RPC server
 void Server::AddService(Service* service, bool ownership) {
-    auto name = Service::GetServiceName(service->GetDescriptor());
+  addService(service, ownership, NULL);
+}
+void Server::AddService(Service* service, bool ownership, const CallLimits& limits) {
+  addService(service, ownership, &limits);
+}
+
+void Server::addService(Service* service, bool ownership, const CallLimits* limits) {
+  auto name = Service::GetServiceName(service->GetDescriptor());
   auto it = service_map_.find(name);
   if(it != service_map_.end()) {
     GOOGLE_LOG(FATAL) << "protorpc.Server.AddService: Service already exist, " << name;
   }
   service_map_[name] = service;
   service_ownership_map_[name] = ownership;
+  service_desc_map_[service->GetDescriptor()] = service;
   for(int i = 0; i < service->GetDescriptor()->method_count(); i++) {
     auto method = service->GetDescriptor()->method(i);
-    auto method_name = Service::GetServiceMethodName(method);
-    service_method_map_[method_name] = const_cast<::google::protobuf::MethodDescriptor*>(method);
+    MethodEntry entry;
+    entry.name = Service::GetServiceMethodName(method);
+    entry.hash = 0;
+    entry.service = service;
+    entry.method = const_cast<::google::protobuf::MethodDescriptor*>(method);
+    methods_.push_back(entry);
   }
+  buildMethodTable();
+  setServiceLimits(service->GetDescriptor(), limits);
 }
 
-// Find service by method name
-Service* Server::FindService(const std::string& method) {
-  auto method_desc = findMethodDescriptor(method);
-  if(method_desc == NULL) {
-    return NULL;
+void Server::setServiceLimits(const ::google::protobuf::ServiceDescriptor* desc, const CallLimits* limits) {
+  CallLimits service;
+  if(limits != NULL) {
+    service = *limits;
+  } else {
+    service.max_concurrency = int(desc->options().GetExtension(service_max_concurrency));
+    service.priority = desc->options().GetExtension(service_priority);
   }
-  auto service = findService(method_desc);
-  if(service == NULL) {
+  Dispatcher::Slots* slots = NULL;
+  if(service.max_concurrency > 0) {
+    slots = dispatcher_->NewSlots(service.max_concurrency);
+  }
+  for(int i = 0; i < desc->method_count(); i++) {
+    const auto& options = desc->method(i)->options();
+    CallLimits method(int(options.GetExtension(max_concurrency)),
+      options.HasExtension(priority)? options.GetExtension(priority): service.priority
+    );
+    setMethodLimits(desc->method(i), method, slots);
+  }
+}
+
+bool Server::SetMethodLimits(const std::string& method, const CallLimits& limits) {
+  auto entry = findMethod(method);
+  if(entry == NULL) {
+    return false;
+  }
+  auto it = call_classes_.find(entry->method);
+  setMethodLimits(entry->method, limits, (it != call_classes_.end())? it->second.service: NULL);
+  return true;
+}
+
+void Server::setMethodLimits(const ::google::protobuf::MethodDescriptor* method, const CallLimits& limits,
+  Dispatcher::Slots* service_slots
+) {
+  if(limits.max_concurrency <= 0 && limits.priority == PRIORITY_NORMAL && service_slots == NULL) {
+    call_classes_.erase(method);
+    return;
+  }
+  Dispatcher::Class cls;
+  cls.priority = limits.priority;
+  cls.method = (limits.max_concurrency > 0)? dispatcher_->NewSlots(limits.max_concurrency): NULL;
+  cls.service = service_slots;
+  call_classes_[method] = cls;
+}
+
+const Dispatcher::Class* Server::GetCallClass(const ::google::protobuf::MethodDescriptor* method) const {
+  if(!call_classes_.empty()) {
+    auto it = call_classes_.find(method);
+    if(it != call_classes_.end()) {
+      return &it->second;
+    }
+  }
+  return NULL;
+}
+
+// FNV-1a
+static uint64 hashMethodName(const char* name, size_t len) {
+  uint64 h = 14695981039346656037ULL;
+  for(size_t i = 0; i < len; i++) {
+    h ^= uint8(name[i]);
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+void Server::buildMethodTable() {
+  // at most half full
+  size_t n = 16;
+  while(n < methods_.size()*2) {
+    n *= 2;
+  }
+  method_slots_.assign(n, 0);
+  for(size_t i = 0; i < methods_.size(); i++) {
+    auto& entry = methods_[i];
+    entry.hash = hashMethodName(entry.name.data(), entry.name.size());
+    size_t slot = size_t(entry.hash) & (n - 1);
+    while(method_slots_[slot] != 0) {
+      slot = (slot + 1) & (n - 1);
+    }
+    method_slots_[slot] = int(i + 1);
+  }
+}
+
+const Server::MethodEntry* Server::lookupMethod(const char* name, size_t len) const {
+  if(method_slots_.empty()) {
     return NULL;
   }
-  return service;
+  const size_t mask = method_slots_.size() - 1;
+  const uint64 h = hashMethodName(name, len);
+  for(size_t slot = size_t(h) & mask; method_slots_[slot] != 0; slot = (slot + 1) & mask) {
+    const auto& entry = methods_[method_slots_[slot] - 1];
+    if(entry.hash == h && entry.name.size() == len && memcmp(entry.name.data(), name, len) == 0) {
+      return &entry;
+    }
+  }
+  return NULL;
+}
+
+const Server::MethodEntry* Server::findMethod(const std::string& method) const {
+  auto entry = lookupMethod(method.data(), method.size());
+  if(entry == NULL) {
+    auto name = Service::CamelCase(method);
+    if(name != method) {
+      entry = lookupMethod(name.data(), name.size());
+    }
+  }
+  return entry;
+}
+
+// Find service by method name
+Service* Server::FindService(const std::string& method) {
+  auto entry = findMethod(method);
+  return (entry != NULL)? entry->service: NULL;
 }
 
 // Find method descriptor by method name
 MethodDescriptor* Server::FindMethodDescriptor(const std::string& method) {
-  auto method_desc = findMethodDescriptor(method);
-  if(method_desc == NULL) {
-    return NULL;
+  auto entry = findMethod(method);
+  return (entry != NULL)? entry->method: NULL;
+}
+
+bool Server::FindMethod(const std::string& method, Service** service, MethodDescriptor** method_desc) {
+  auto entry = findMethod(method);
+  if(entry == NULL) {
+    return false;
   }
-  return method_desc;
+  *service = entry->service;
+  *method_desc = entry->method;
+  return true;
 }
 
-void Server::BindAndServe(int port, int backlog) {
-  if(!conn_.ListenTCP(port, backlog)) {
-    env_->Logf("protorpc.Server.ListenTCP: fail.\n");
-    exit(-1);
+int Server::Handshake(const wire::HandshakeRequest& request, wire::HandshakeResponse* response,
+  bool chunked
+) {
+  response->Clear();
+  if(request.version() < uint32(wire::kProtocolV2)) {
+    response->set_version(wire::kProtocolV1);
+    return wire::kProtocolV1;
+  }
+  response->set_version(wire::kProtocolV2);
+  response->set_crc32c(request.crc32c() && HasHardwareCRC32C());
+  response->set_chunked(request.chunked() && chunked);
+  for(size_t i = 0; i < methods_.size(); i++) {
+    response->add_methods(methods_[i].name);
+  }
+  return wire::kProtocolV2;
+}
+
+bool Server::FindMethodById(uint32 id, Service** service, MethodDescriptor** method_desc) {
+  if(id >= methods_.size()) {
+    return false;
+  }
+  *service = methods_[id].service;
+  *method_desc = methods_[id].method;
+  return true;
+}
+
+bool Server::SetMethodCompression(const std::string& method, const wire::Compression& compression) {
+  auto entry = findMethod(method);
+  if(entry == NULL) {
+    return false;
+  }
+  method_compression_[entry->method] = compression;
+  return true;
+}
+
+const wire::Compression* Server::GetCompression(const ::google::protobuf::MethodDescriptor* method) const {
+  if(!method_compression_.empty()) {
+    auto it = method_compression_.find(method);
+    if(it != method_compression_.end()) {
+      return &it->second;
+    }
+  }
+  return &compression_;
+}
+
+void Server::SetMaxInflightPerConn(int n) {
+  max_inflight_per_conn_ = (n > 0)? n: 1;
+}
+
+bool Server::ListenTCP(int port, int backlog) {
+  auto conn = new Conn(0, env_);
+  if(!conn->ListenTCP(port, backlog)) {
+    delete conn;
+    return false;
+  }
+  listeners_.push_back(conn);
+  return true;
+}
+
+bool Server::ListenUnix(const char* path, int backlog) {
+  auto conn = new Conn(0, env_);
+  if(!conn->ListenUnix(path, backlog)) {
+    delete conn;
+    return false;
+  }
+  listeners_.push_back(conn);
+  return true;
+}
+
+bool Server::ListenShm(const char* path, int backlog) {
+  if(!ListenUnix(path, backlog)) {
+    return false;
   }
+  shm_listeners_.push_back(listeners_.back());
+  return true;
+}
+
+bool Server::InheritListeners(const char* path, int timeout_ms) {
+  Conn listener(0, env_);
+  if(!listener.ListenUnix(path, 1)) {
+    return false;
+  }
+  if(!listener.WaitReadable(timeout_ms)) {
+    env_->Logf("protorpc.Server.InheritListeners: timeout.\n");
+    listener.Close();
+    return false;
+  }
+  auto conn = listener.Accept();
+  listener.Close();
+  if(conn == NULL) {
+    return false;
+  }
+
+  // one kind byte per socket: 'S' for ListenShm, 'L' for the others
+  std::vector<int> fds;
+  std::string kinds;
+  bool ok = conn->RecvFds(&fds, &kinds, timeout_ms) && kinds.size() == fds.size();
+  conn->Close();
+  delete conn;
+  for(size_t i = 0; i < fds.size(); i++) {
+    auto c = new Conn(fds[i], env_);
+    if(!ok) {
+      c->Close();
+      delete c;
+      continue;
+    }
+    listeners_.push_back(c);
+    if(kinds[i] == 'S') {
+      shm_listeners_.push_back(c);
+    }
+  }
+  if(!ok) {
+    env_->Logf("protorpc.Server.InheritListeners: invalid handoff.\n");
+  }
+  return ok;
+}
+
+void Server::Serve() {
+  if(listeners_.empty()) {
+    env_->Logf("protorpc.Server.Serve: no listener.\n");
+    return;
+  }
+  for(size_t i = 1; i < listeners_.size(); i++) {
+    startAcceptThread(listeners_[i]);
+  }
+  acceptLoop(listeners_[0]);
+  waitStopped();
+}
+
+void Server::startAcceptThread(Conn* listener) {
+  auto arg = new AcceptArg;
+  arg->server = this;
+  arg->listener = listener;
+  env_->StartThread(&Server::AcceptProc, arg);
+}
+
+bool Server::isShmListener(Conn* listener) const {
+  for(size_t i = 0; i < shm_listeners_.size(); i++) {
+    if(shm_listeners_[i] == listener) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// [static]
+void Server::AcceptProc(void* p) {
+  auto arg = (AcceptArg*)p;
+  arg->server->acceptLoop(arg->listener);
+  delete arg;
+}
+
+void Server::acceptLoop(Conn* listener) {
+  // the client sends the shared memory segment right after connecting
+  static const int kShmHandshakeTimeoutMs = 1000;
+  // Shutdown wakes the accept loops up, they look at it this often
+  // without the wakeup pair
+  static const int kAcceptPollMs = 100;
+
+  {
+    CondVarLock locker(&cv_);
+    if(stopping_) {
+      return;
+    }
+    accepting_++;
+  }
+  defer([&](){
+    CondVarLock locker(&cv_);
+    accepting_--;
+    cv_.SignalAll();
+  });
+
+  // non-blocking: once handed off, the successor may take a connection
+  // this loop was woken up for
+  listener->SetNonBlocking(true);
+  bool shm = isShmListener(listener);
   for(;;) {
-    auto conn = conn_.Accept();
-    if(conn == NULL) {
-      env_->Logf("protorpc.Server.Accept: fail.\n");
+    bool wakeup = wakeup_[0].IsValid();
+    int ready = listener->WaitReadable(wakeup? -1: kAcceptPollMs, &wakeup_[0]);
+    if(Draining()) {
+      break;
+    }
+    if(ready != 1) {
       continue;
     }
-    ServerConn::Serve(this, conn, env_);
+    auto conn = listener->Accept();
+    if(conn == NULL) {
+      continue;  // logged by Accept, or taken by another process
+    }
+    conn->SetNonBlocking(false);
+    ServerConn::Serve(this, conn, env_, shm? kShmHandshakeTimeoutMs: 0);
   }
 }
 
-MethodDescriptor* Server::findMethodDescriptor(const std::string& method) {
-  auto it = service_method_map_.find(Service::CamelCase(method));
-  if(it == service_method_map_.end()) {
-    return NULL;
+void Server::ServeEventLoop(int num_loops) {
+  if(shm_listeners_.size() == listeners_.size()) {
+    Serve();
+    return;
   }
-  return it->second;
+
+  // the event loop drives the sockets only
+  std::vector<Conn*> sockets;
+  for(size_t i = 0; i < listeners_.size(); i++) {
+    if(isShmListener(listeners_[i])) {
+      startAcceptThread(listeners_[i]);
+    } else {
+      sockets.push_back(listeners_[i]);
+    }
+  }
+
+  ServerLoop loop(this, env_, num_loops);
+  for(size_t i = 0; i < sockets.size(); i++) {
+    if(!loop.AddListener(sockets[i])) {
+      env_->Logf("protorpc.Server.ServeEventLoop: event loop unavailable, use blocking mode.\n");
+      for(size_t j = 1; j < sockets.size(); j++) {
+        startAcceptThread(sockets[j]);
+      }
+      acceptLoop(sockets[0]);
+      waitStopped();
+      return;
+    }
+  }
+  if(addLoop(&loop)) {
+    loop.Run();
+    removeLoop(&loop);
+  }
+  waitStopped();
+}
+
+void Server::ServeSharded(int port, int num_shards, bool pin_threads, int backlog) {
+  int num_cpus = int(std::thread::hardware_concurrency());
+  if(num_cpus < 1) {
+    num_cpus = 1;
+  }
+  if(num_shards <= 0) {
+    num_shards = num_cpus;
+  }
+
+  bool ok = true;
+  {
+    MutexLock locker(&mutex_);
+    for(int i = 0; i < num_shards && ok; i++) {
+      auto shard = new Shard(this, pin_threads? (i % num_cpus): -1);
+      shards_.push_back(shard);
+      ok = shard->listener->ListenTCP(port, backlog, true) &&
+        shard->loop->AddListener(shard->listener);
+    }
+    if(!ok) {
+      for(size_t i = 0; i < shards_.size(); i++) {
+        delete shards_[i];
+      }
+      shards_.clear();
+    }
+  }
+  if(!ok) {
+    env_->Logf("protorpc.Server.ServeSharded: sharding unavailable, use ServeEventLoop.\n");
+    if(!ListenTCP(port, backlog)) {
+      env_->Logf("protorpc.Server.ListenTCP: fail.\n");
+      return;
+    }
+    ServeEventLoop(num_shards);
+    return;
+  }
+
+  for(size_t i = 0; i < listeners_.size(); i++) {
+    startAcceptThread(listeners_[i]);
+  }
+  for(size_t i = 1; i < shards_.size(); i++) {
+    env_->StartThread(&Server::ShardProc, shards_[i]);
+  }
+  ShardProc(shards_[0]);
+  waitStopped();
+}
+
+// [static]
+void Server::ShardProc(void* p) {
+  auto shard = (Shard*)p;
+  if(shard->cpu >= 0 && !shard->server->env_->PinThread(shard->cpu)) {
+    shard->server->env_->Logf("protorpc.Server.ServeSharded: pin to CPU %d failed.\n", shard->cpu);
+  }
+  shard->loop->Run();
+}
+
+void Server::GetShardStats(std::vector<ShardStats>* stats) {
+  MutexLock locker(&mutex_);
+  stats->resize(shards_.size());
+  for(size_t i = 0; i < shards_.size(); i++) {
+    ServerLoop::Stats s;
+    shards_[i]->loop->GetStats(&s);
+    (*stats)[i].cpu = shards_[i]->cpu;
+    (*stats)[i].accepted = s.accepted;
+    (*stats)[i].calls = s.calls;
+  }
+}
+
+bool Server::BindAndServe(int port, int backlog) {
+  if(!ListenTCP(port, backlog)) {
+    env_->Logf("protorpc.Server.ListenTCP: fail.\n");
+    return false;
+  }
+  Serve();
+  return true;
+}
+
+bool Server::BindAndServeEventLoop(int port, int backlog, int num_loops) {
+  if(!ListenTCP(port, backlog)) {
+    env_->Logf("protorpc.Server.ListenTCP: fail.\n");
+    return false;
+  }
+  ServeEventLoop(num_loops);
+  return true;
+}
+
+bool Server::Shutdown(int timeout_ms, const char* successor) {
+  const uint64 deadline = env_->NowMicros() + uint64((timeout_ms > 0)? timeout_ms: 0)*1000;
+  std::vector<ServerLoop*> loops;
+  {
+    CondVarLock locker(&cv_);
+    if(stopping_) {
+      env_->Logf("protorpc.Server.Shutdown: already called.\n");
+      return false;
+    }
+    stopping_ = true;
+    if(wakeup_[1].IsValid()) {
+      // never read: it wakes up every accept loop from now on
+      char c = 0;
+      wakeup_[1].Write(&c, 1);
+    }
+    while(accepting_ > 0) {
+      cv_.Wait();
+    }
+    loops = loops_;
+  }
+  {
+    MutexLock locker(&mutex_);
+    for(size_t i = 0; i < shards_.size(); i++) {
+      loops.push_back(shards_[i]->loop);
+    }
+  }
+
+  // 1. stop accepting, the pending connections stay on the sockets
+  for(size_t i = 0; i < loops.size(); i++) {
+    loops[i]->Drain(deadline);
+  }
+  bool ok = true;
+  if(successor != NULL) {
+    ok = handoff(successor);
+  }
+  for(size_t i = 0; i < listeners_.size(); i++) {
+    listeners_[i]->Close();
+  }
+  {
+    MutexLock locker(&mutex_);
+    for(size_t i = 0; i < shards_.size(); i++) {
+      shards_[i]->listener->Close();
+    }
+  }
+
+  // 2. close the connections once their calls have answered
+  {
+    CondVarLock locker(&cv_);
+    for(auto it = conns_.begin(); it != conns_.end(); ++it) {
+      (*it)->Drain();
+    }
+  }
+  bool drained = false;
+  for(;;) {
+    int open = 0;
+    for(size_t i = 0; i < loops.size(); i++) {
+      open += loops[i]->Open();
+    }
+    CondVarLock locker(&cv_);
+    open += int(conns_.size());
+    if(open == 0) {
+      drained = true;
+      break;
+    }
+    auto now = env_->NowMicros();
+    if(now >= deadline) {
+      env_->Logf("protorpc.Server.Shutdown: %d connections left, shut them down.\n", open);
+      for(auto it = conns_.begin(); it != conns_.end(); ++it) {
+        (*it)->Abort();
+      }
+      break;
+    }
+    // the loops don't signal, look again in a while
+    cv_.TimedWait((deadline - now < 10000)? (deadline - now): 10000);
+  }
+
+  // 3. the Serve methods return
+  for(size_t i = 0; i < loops.size(); i++) {
+    loops[i]->Stop();
+  }
+  CondVarLock locker(&cv_);
+  stopped_ = true;
+  cv_.SignalAll();
+  return ok && drained;
+}
+
+bool Server::Draining() {
+  CondVarLock locker(&cv_);
+  return stopping_;
+}
+
+bool Server::handoff(const char* successor) {
+  std::vector<int> fds;
+  std::string kinds;
+  for(size_t i = 0; i < listeners_.size(); i++) {
+    fds.push_back(listeners_[i]->Fd());
+    kinds.push_back(isShmListener(listeners_[i])? 'S': 'L');
+  }
+  {
+    MutexLock locker(&mutex_);
+    for(size_t i = 0; i < shards_.size(); i++) {
+      fds.push_back(shards_[i]->listener->Fd());
+      kinds.push_back('L');
+    }
+  }
+  if(fds.empty()) {
+    env_->Logf("protorpc.Server.Shutdown: no listener to hand off.\n");
+    return false;
+  }
+
+  // the sockets in flight stay open once this side is closed
+  Conn conn(0, env_);
+  bool ok = conn.DialUnix(successor) && conn.SendFds(fds, kinds);
+  conn.Close();
+  if(!ok) {
+    env_->Logf("protorpc.Server.Shutdown: handoff to %s failed.\n", successor);
+  }
+  return ok;
+}
+
+bool Server::addConn(ServerConn* conn) {
+  CondVarLock locker(&cv_);
+  if(stopping_) {
+    return false;
+  }
+  conns_.insert(conn);
+  return true;
+}
+
+void Server::removeConn(ServerConn* conn) {
+  CondVarLock locker(&cv_);
+  if(conns_.erase(conn) != 0) {
+    cv_.SignalAll();
+  }
+}
+
+bool Server::addLoop(ServerLoop* loop) {
+  CondVarLock locker(&cv_);
+  if(stopping_) {
+    return false;
+  }
+  loops_.push_back(loop);
+  return true;
 }
+
+void Server::removeLoop(ServerLoop* loop) {
+  CondVarLock locker(&cv_);
+  for(size_t i = 0; i < loops_.size(); i++) {
+    if(loops_[i] == loop) {
+      loops_.erase(loops_.begin() + i);
+      break;
+    }
+  }
+}
+
+void Server::waitStopped() {
+  CondVarLock locker(&cv_);
+  while(!stopped_) {
+    cv_.Wait();
+  }
+}
+
 Service* Server::findService(const ::google::protobuf::MethodDescriptor* method) {
-  auto it = service_map_.find(Service::CamelCase(method->service()->name()));
-  if(it == service_map_.end()) {
+  auto it = service_desc_map_.find(method->service());
+  if(it == service_desc_map_.end()) {
     return NULL;
   }
   return it->second;
@@ -98,15 +725,11 @@ const ::google::protobuf::rpc::Error Server::CallMethod(
   const ::google::protobuf::Message* request,
   ::google::protobuf::Message* response
 ) {
-  auto method = findMethodDescriptor(method_name);
-  if(method == NULL) {
+  auto entry = findMethod(method_name);
+  if(entry == NULL) {
     return Error::New("protorpc.Server.CallMethod: can't find method " + method_name);
   }
-  auto service = findService(method);
-  if(service == NULL) {
-    return Error::New("protorpc.Server.CallMethod: can't find service " + method_name);
-  }
-  return service->CallMethod(method, request, response);
+  return entry->service->CallMethod(entry->method, request, response);
 }
 
 const ::google::protobuf::rpc::Error Server::CallMethod(
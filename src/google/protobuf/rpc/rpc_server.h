@@ -6,13 +6,20 @@
 #define GOOGLE_PROTOBUF_RPC_SERVER_H__
 
 #include <google/protobuf/rpc/rpc_service.h>
+#include <google/protobuf/rpc/rpc_admission.h>
+#include <google/protobuf/rpc/rpc_dispatcher.h>
 #include <google/protobuf/rpc/rpc_server_conn.h>
+#include <google/protobuf/rpc/rpc_wire.h>
 #include <map>
+#include <set>
+#include <vector>
 
 namespace google {
 namespace protobuf {
 namespace rpc {
 
+class ServerLoop;
+
 class Server: public Caller {
  public:
   Server(Env* env=NULL);
@@ -20,15 +27,156 @@ class Server: public Caller {
 
   // Add a command to the RPC server
   void AddService(Service* service, bool ownership);
+  // With the scheduling of its calls, in place of the proto options of
+  // the service (see options.proto).
+  void AddService(Service* service, bool ownership, const CallLimits& limits);
 
   // Find service by method name
   Service* FindService(const std::string& method);
   // Find method descriptor by method name
   MethodDescriptor* FindMethodDescriptor(const std::string& method);
+  // Find both, return false if the method is unknown. Names spelled as
+  // on the wire ("Service.Method") are found without allocating, others
+  // are CamelCased first.
+  bool FindMethod(const std::string& method, Service** service, MethodDescriptor** method_desc);
+
+  // Accept the protocol v2 handshake of the clients (see wire.proto),
+  // true by default. Without it the handshake fails as an unknown method
+  // and the clients stay on v1.
+  void SetProtocolV2(bool enabled) { protocol_v2_ = enabled; }
+  bool ProtocolV2Enabled() const { return protocol_v2_; }
+  // Answer a handshake, return the protocol version of the connection.
+  // The v2 method ids are the indexes of the methods in the order they
+  // were added. CRC32C is accepted if this CPU computes it in hardware,
+  // chunked bodies if the connection reads them (chunked).
+  int Handshake(const wire::HandshakeRequest& request, wire::HandshakeResponse* response,
+    bool chunked=false);
+  // Find a method by its v2 id, return false if the id is unknown.
+  bool FindMethodById(uint32 id, Service** service, MethodDescriptor** method_desc);
+
+  // Compression of the response bodies on v2 connections, for all the
+  // methods or for one (false if the method is unknown). Set them before
+  // serving.
+  void SetCompression(const wire::Compression& compression) { compression_ = compression; }
+  bool SetMethodCompression(const std::string& method, const wire::Compression& compression);
+  const wire::Compression* GetCompression(const ::google::protobuf::MethodDescriptor* method) const;
+
+  // Scheduling of the calls of one method, in place of its proto options
+  // (false if the method is unknown). Set it before serving.
+  bool SetMethodLimits(const std::string& method, const CallLimits& limits);
+  // Share of the dispatcher workers of a priority lane, see Dispatcher.
+  void SetLaneWeight(Priority priority, int weight) { dispatcher_->SetLaneWeight(priority, weight); }
+  // The dispatcher runs the calls of the methods with limits or a
+  // priority, and all the queued calls once there are some. The event
+  // loops hand it the calls of those methods too. NULL if no method has
+  // limits.
+  Dispatcher* GetDispatcher() { return call_classes_.empty()? NULL: dispatcher_; }
+  // NULL if the method has no limits.
+  const Dispatcher::Class* GetCallClass(const ::google::protobuf::MethodDescriptor* method) const;
+
+  // Max number of requests of one connection running at the same time,
+  // 1 processes the requests strictly one by one.
+  void SetMaxInflightPerConn(int n);
+  int MaxInflightPerConn() const { return max_inflight_per_conn_; }
+
+  // Admission control of the calls of all the connections, off by
+  // default: the calls over the caps or shed by their queue delay are
+  // answered with kOverloadedError at once. With it the calls of a
+  // connection over MaxInflightPerConn wait in the admission queue
+  // instead of blocking the reader. Set it before serving.
+  void SetAdmission(const Admission::Limits& limits) { admission_.SetLimits(limits); }
+  Admission* GetAdmission() { return &admission_; }
+
+  // Number of cleared request and response messages of each type a
+  // connection keeps for the next calls (see MessagePool), 0 disables
+  // the reuse. Default 4.
+  void SetMessagePoolSize(int n) { message_pool_size_ = (n > 0)? n: 0; }
+  int MessagePoolSize() const { return message_pool_size_; }
+
+  // Let ServeEventLoop run on io_uring when the kernel supports it
+  // (Linux 6.0), true by default. epoll is used otherwise.
+  void SetIoUring(bool enabled) { io_uring_ = enabled; }
+  bool IoUringEnabled() const { return io_uring_; }
+
+  // Close the connections with no call, stream or response pending for
+  // timeout_ms, 0 (the default) keeps them open. The clients dial again
+  // at their next call. Keepalive pings (see Client::SetKeepalive) don't
+  // count as activity. Set it before serving.
+  void SetIdleTimeout(int timeout_ms) { idle_timeout_ms_ = (timeout_ms > 0)? timeout_ms: 0; }
+  int IdleTimeout() const { return idle_timeout_ms_; }
+
+  // Longest raw request body accepted, see Conn::SetMaxBodyLen. Set it
+  // before serving.
+  void SetMaxBodyLen(uint32 n) { max_body_len_ = n; }
+  uint32 MaxBodyLen() const { return max_body_len_; }
+
+  // Add a listening socket to serve by Serve() or ServeEventLoop(),
+  // a server may listen on several ports and unix sockets at once.
+  bool ListenTCP(int port, int backlog=128);
+  bool ListenUnix(const char* path, int backlog=128);
+
+  // Listen on a unix socket for clients of the shared memory transport
+  // ("shm:PATH" hosts, Linux only). These connections are always served
+  // by blocking threads, also under ServeEventLoop.
+  bool ListenShm(const char* path, int backlog=128);
+
+  // Take the listening sockets of a server shutting down with
+  // Shutdown(timeout, path): listen on the unix socket path and wait up to
+  // timeout_ms for them. The connections pending on them are not lost.
+  // Not supported on Windows.
+  bool InheritListeners(const char* path, int timeout_ms);
 
   // [blocking]
-  // Process client requests for the specified time
-  void BindAndServe(int port, int backlog=5);
+  // Accept on all the listening sockets (one thread each) and process
+  // the connections on Env workers. The Serve methods return once
+  // Shutdown is done.
+  void Serve();
+
+  // [blocking]
+  // Process client requests of all the listening sockets with
+  // non-blocking connections driven by num_loops event loop threads
+  // (epoll, edge-triggered). Fall back to Serve if the event loop is not
+  // supported.
+  void ServeEventLoop(int num_loops=1);
+
+  // [blocking]
+  // Sharded mode: num_shards sockets listen on port with SO_REUSEPORT
+  // and the kernel spreads the connections over them. Each shard accepts
+  // and serves its connections on its own single event loop thread, so
+  // buffers and counters stay on one core. num_shards <= 0 means one per
+  // CPU; with pin_threads shard i runs on CPU i. The listeners added
+  // before are served by blocking threads as in Serve().
+  // Fall back to ListenTCP and ServeEventLoop(num_shards) if SO_REUSEPORT
+  // or the event loop is not supported.
+  void ServeSharded(int port, int num_shards=0, bool pin_threads=false, int backlog=128);
+
+  // Counters of the ServeSharded shards, one entry per shard.
+  struct ShardStats {
+    int cpu;          // -1 if not pinned
+    uint64 accepted;  // connections
+    uint64 calls;     // requests processed
+  };
+  void GetShardStats(std::vector<ShardStats>* stats);
+
+  // [blocking]
+  // ListenTCP and Serve, false if listening fails.
+  bool BindAndServe(int port, int backlog=5);
+
+  // [blocking]
+  // ListenTCP and ServeEventLoop, false if listening fails.
+  bool BindAndServeEventLoop(int port, int backlog=128, int num_loops=1);
+
+  // Stop serving for a restart: stop accepting, hand the listening
+  // sockets to the successor waiting in InheritListeners(successor) unless
+  // it is NULL, let the calls in flight answer and close the connections
+  // once they wait for a new request. The connections left after
+  // timeout_ms are shut down. Return false if the handoff failed or the
+  // connections were not drained in time. Call it from a thread of its
+  // own (not from a method of this server); the server may be deleted
+  // once it returns.
+  bool Shutdown(int timeout_ms, const char* successor=NULL);
+  // Shutdown was called.
+  bool Draining();
 
   // Call Service Method
   const ::google::protobuf::rpc::Error CallMethod(
@@ -43,16 +191,75 @@ class Server: public Caller {
   );
 
  private:
-  MethodDescriptor* findMethodDescriptor(const std::string& method);
+  // Dispatch table: open addressing (linear probing) over the CamelCase
+  // method names, rebuilt by AddService and read only afterwards.
+  struct MethodEntry {
+    std::string name;
+    uint64 hash;
+    Service* service;
+    MethodDescriptor* method;
+  };
+  const MethodEntry* findMethod(const std::string& method) const;
+  const MethodEntry* lookupMethod(const char* name, size_t len) const;
+  void buildMethodTable();
+  void addService(Service* service, bool ownership, const CallLimits* limits);
+  // Limits of the service and its methods, from their options if limits
+  // is NULL.
+  void setServiceLimits(const ::google::protobuf::ServiceDescriptor* desc, const CallLimits* limits);
+  void setMethodLimits(const ::google::protobuf::MethodDescriptor* method, const CallLimits& limits,
+    Dispatcher::Slots* service_slots);
   Service* findService(const ::google::protobuf::MethodDescriptor* method);
 
   std::map<std::string, Service*> service_map_;
   std::map<std::string, bool> service_ownership_map_;
-  std::map<std::string, ::google::protobuf::MethodDescriptor*> service_method_map_;
+  std::map<const ::google::protobuf::ServiceDescriptor*, Service*> service_desc_map_;
+  std::vector<MethodEntry> methods_;
+  std::vector<int> method_slots_;  // index in methods_ + 1, 0 if empty
+  wire::Compression compression_;
+  std::map<const ::google::protobuf::MethodDescriptor*, wire::Compression> method_compression_;
+  Dispatcher* dispatcher_;
+  std::map<const ::google::protobuf::MethodDescriptor*, Dispatcher::Class> call_classes_;
+
+  static void AcceptProc(void* p);
+  void acceptLoop(Conn* listener);
+  bool isShmListener(Conn* listener) const;
+  void startAcceptThread(Conn* listener);
+
+  // The connections and loops served, false once shutting down.
+  friend class ServerConn;
+  bool addConn(ServerConn* conn);
+  void removeConn(ServerConn* conn);
+  bool addLoop(ServerLoop* loop);
+  void removeLoop(ServerLoop* loop);
+  // Send the listening sockets to the successor.
+  bool handoff(const char* successor);
+  // Wait for the end of Shutdown.
+  void waitStopped();
+
+  struct Shard;
+  static void ShardProc(void* p);
 
   Mutex mutex_;
-  Conn conn_;
+  std::vector<Conn*> listeners_;
+  std::vector<Conn*> shm_listeners_;  // also in listeners_
+  std::vector<Shard*> shards_;
   Env* env_;
+  int max_inflight_per_conn_;
+  Admission admission_;
+  int message_pool_size_;
+  bool io_uring_;
+  bool protocol_v2_;
+  int idle_timeout_ms_;
+  uint32 max_body_len_;
+
+  // guard the fields below
+  CondVar cv_;
+  std::set<ServerConn*> conns_;
+  std::vector<ServerLoop*> loops_;  // of ServeEventLoop
+  int accepting_;  // accept loops
+  Conn wakeup_[2];  // Shutdown writes to 1, the accept loops wait on 0
+  bool stopping_;
+  bool stopped_;
 
  private:
   GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(Server);
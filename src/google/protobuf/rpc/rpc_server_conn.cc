@@ -4,6 +4,7 @@
 
 #include "google/protobuf/rpc/rpc_server_conn.h"
 #include <google/protobuf/rpc/rpc_server.h>
+#include <google/protobuf/rpc/rpc_stream.h>
 #include <google/protobuf/rpc/rpc_wire.h>
 #include <google/protobuf/stubs/defer.h>
 
@@ -11,30 +12,547 @@ namespace google {
 namespace protobuf {
 namespace rpc {
 
+struct ServerConn::Call {
+  uint64 id;
+  uint64 deadline;  // Env::NowMicros(), 0 for none
+  uint64 received;  // Env::NowMicros()
+  int64 bytes;      // raw request length, for the admission control
+  bool queued;      // in ready_ or the dispatcher, counted by inflight_
+  ServerConn* owner;
+  const Dispatcher::Class* cls;  // NULL for no limits
+  Service* service;
+  const ::google::protobuf::MethodDescriptor* method;
+  ::google::protobuf::Message* request;
+  ::google::protobuf::Message* response;
+};
+
+class ServerConn::StreamCall: public Stream {
+ public:
+  StreamCall(ServerConn* owner, uint64 id, Service* service,
+    const ::google::protobuf::MethodDescriptor* method):
+    owner_(owner), id_(id), service_(service), method_(method),
+    in_end_(false), canceled_(false), overrun_(false),
+    credit_(wire::kStreamWindow), window_(wire::kStreamWindow), unacked_(0) {}
+
+  // implements Stream
+  const Error Write(const ::google::protobuf::Message* msg);
+  bool Read(::google::protobuf::Message* msg);
+
+  ServerConn* owner_;
+  uint64 id_;
+  Service* service_;
+  const ::google::protobuf::MethodDescriptor* method_;
+
+  // guarded by owner_->cv_
+  struct Frame {
+    wire::RequestHeader header;
+    std::string body;
+  };
+  std::deque<Frame> in_;
+  bool in_end_;    // the client sent its last message
+  bool canceled_;
+  bool overrun_;   // the client sent past its window, canceled_ too
+  int64 credit_;   // body bytes the client may still buffer
+  int64 window_;   // body bytes the client may still send
+
+  uint32 unacked_;  // body bytes read and not granted back yet
+
+ private:
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(StreamCall);
+};
+
+const Error ServerConn::StreamCall::Write(const ::google::protobuf::Message* msg) {
+  std::string pbHeader, body;
+  auto err = wire::MarshalStreamResponse(id_, wire::STREAM_MESSAGE, 0, msg, &pbHeader, &body,
+    owner_->server_->GetCompression(method_), owner_->checksum_
+  );
+  if(!err.IsNil()) {
+    return err;
+  }
+  {
+    CondVarLock locker(&owner_->cv_);
+    while(credit_ <= 0 && !canceled_ && !owner_->eof_ && !owner_->broken_) {
+      owner_->cv_.Wait();
+    }
+    if(canceled_) {
+      return Error::New("protorpc.ServerConn.Stream: call canceled.");
+    }
+    if(owner_->eof_ || owner_->broken_) {
+      return Error::New("protorpc.ServerConn.Stream: connection closed.");
+    }
+    credit_ -= int64(body.size());
+    owner_->pushFrames(&pbHeader, &body);
+  }
+  if(!owner_->flushResponses()) {
+    return Error::New("protorpc.ServerConn.Stream: connection closed.");
+  }
+  return Error::Nil();
+}
+
+bool ServerConn::StreamCall::Read(::google::protobuf::Message* msg) {
+  Frame frame;
+  {
+    CondVarLock locker(&owner_->cv_);
+    while(in_.empty() && !in_end_ && !canceled_ && !owner_->eof_ && !owner_->broken_) {
+      owner_->cv_.Wait();
+    }
+    if(in_.empty() || canceled_) {
+      return false;
+    }
+    frame.header.Swap(&in_.front().header);
+    frame.body.swap(in_.front().body);
+    in_.pop_front();
+  }
+  auto err = wire::DecodeRequestBody(&frame.header, frame.body.data(), frame.body.size(), msg);
+  if(!err.IsNil()) {
+    owner_->env_->Logf("protorpc.ServerConn.Stream: %s\n", err.String().c_str());
+    return false;
+  }
+
+  // let the client send more once half the window is read
+  unacked_ += uint32(frame.body.size());
+  if(unacked_ >= wire::kStreamWindow/2) {
+    std::string pbHeader, body;
+    wire::MarshalStreamResponse(id_, wire::STREAM_WINDOW, unacked_, NULL, &pbHeader, &body);
+    {
+      CondVarLock locker(&owner_->cv_);
+      window_ += unacked_;
+      owner_->pushFrames(&pbHeader, &body);
+    }
+    unacked_ = 0;
+    owner_->flushResponses();
+  }
+  return true;
+}
+
 ServerConn::ServerConn(Server* server, Conn* conn, Env* env):
-  server_(server), conn_(conn), env_(env) {
-  //
+  server_(server), conn_(conn), env_(env), shm_handshake_ms_(0),
+  last_read_micros_(0), pool_(server->MessagePoolSize()),
+  protocol_(wire::kProtocolV1), checksum_(wire::kCRC32), chunked_(false), first_request_(true),
+  inflight_(0), workers_(0), refs_(1), broken_(false), eof_(false), idle_(true),
+  draining_(false), idle_timer_(0), active_micros_(0),
+  pending_bytes_(0), flushing_(false), chunked_waiters_(0) {
+  max_inflight_ = server->MaxInflightPerConn();
+  conn_->SetMaxBodyLen(server->MaxBodyLen());
 }
 ServerConn::~ServerConn() {
+  server_->removeConn(this);
   conn_->Close();
   delete conn_;
 }
 
-void ServerConn::Serve(Server* server, Conn* conn, Env* env) {
+void ServerConn::Serve(Server* server, Conn* conn, Env* env, int shm_handshake_ms) {
   auto self = new ServerConn(server, conn, env);
-  env->Schedule(ServerConn::ServeProc, self);
+  self->shm_handshake_ms_ = shm_handshake_ms;
+  if(!server->addConn(self)) {
+    // shutting down, the successor accepts the next connections
+    delete self;
+    return;
+  }
+  if(server->IdleTimeout() > 0) {
+    // the timer holds a reference
+    CondVarLock locker(&self->cv_);
+    self->active_micros_ = env->NowMicros();
+    self->refs_++;
+    self->idle_timer_ = env->ScheduleAfter(server->IdleTimeout(), &ServerConn::IdleProc, self);
+  }
+  // the reader blocks for the connection's lifetime: give it its own
+  // thread, a pool worker would starve the other connections
+  env->StartThread(ServerConn::ServeProc, self);
 }
 
 // [static]
 void ServerConn::ServeProc(void* p) {
   auto self = (ServerConn*)p;
-  for(;;) {
+  // a slow client holds up its own thread only, not the accept loop
+  bool ok = self->shm_handshake_ms_ <= 0 || self->conn_->AcceptShm(self->shm_handshake_ms_);
+  while(ok) {
     auto err = self->ProcessOneCall(self->conn_);
     if(!err.IsNil()) {
       break;
     }
+    // help the workers and flush before blocking on the next read, with
+    // admission control keep reading to turn the calls down in time
+    if(self->conn_->Buffered() == 0) {
+      if(!self->server_->GetAdmission()->Enabled()) {
+        self->runReadyCalls();
+      }
+      if(!self->flushResponses()) {
+        break;
+      }
+    } else if(self->pending_bytes_ >= 256*1024) {
+      if(!self->flushResponses()) {
+        break;
+      }
+    }
+    {
+      CondVarLock locker(&self->cv_);
+      if(self->broken_) {
+        break;
+      }
+      if(self->conn_->Buffered() == 0) {
+        if(self->draining_ && self->streams_.empty() && !self->conn_->WaitReadable(0)) {
+          break;
+        }
+        self->idle_ = true;
+      }
+    }
+  }
+  {
+    // no more messages or window for the streams
+    CondVarLock locker(&self->cv_);
+    self->eof_ = true;
+    self->cv_.SignalAll();
+    if(self->idle_timer_ != 0 && self->env_->CancelTimer(self->idle_timer_)) {
+      self->idle_timer_ = 0;
+      self->refs_--;  // the reader still holds one
+    }
   }
-  delete self;
+  self->runReadyCalls();
+  self->flushResponses();
+  self->unref();
+}
+
+// [static]
+void ServerConn::CallProc(void* p) {
+  auto self = (ServerConn*)p;
+  for(;;) {
+    Call* call = NULL;
+    {
+      CondVarLock locker(&self->cv_);
+      if(self->ready_.empty()) {
+        self->workers_--;
+        break;
+      }
+      call = self->ready_.front();
+      self->ready_.pop_front();
+    }
+    self->runCall(call);
+    self->flushResponses();
+  }
+  self->unref();
+}
+
+// [static]
+void ServerConn::DispatchProc(void* p) {
+  auto call = (Call*)p;
+  auto self = call->owner;
+  self->runCall(call);
+  self->flushResponses();
+  self->unref();
+}
+
+// [static]
+void ServerConn::StreamProc(void* p) {
+  auto stream = (StreamCall*)p;
+  auto self = stream->owner_;
+  auto rv = stream->service_->CallStreamMethod(stream->method_, stream);
+  self->server_->GetAdmission()->Done();
+  {
+    CondVarLock locker(&self->cv_);
+    self->streams_.erase(stream->id_);
+    if(stream->overrun_) {
+      rv = Error::New("protorpc.ServerConn.Stream: window exceeded.");
+    }
+  }
+  auto err = self->queueResponse(stream->id_, rv.String(), NULL);
+  if(!err.IsNil()) {
+    self->env_->Logf("protorpc.ServerConn.StreamProc: SendResponse fail: %s.\n", err.String().c_str());
+  }
+  delete stream;
+  self->flushResponses();
+  {
+    CondVarLock locker(&self->cv_);
+    if(self->idle_timer_ != 0) {
+      self->active_micros_ = self->env_->NowMicros();
+    }
+    self->stopIdleReader();
+  }
+  self->unref();
+}
+
+// [static]
+void ServerConn::IdleProc(void* p) {
+  auto self = (ServerConn*)p;
+  bool armed;
+  {
+    CondVarLock locker(&self->cv_);
+    self->idle_timer_ = 0;
+    armed = !self->eof_ && self->checkIdle();
+  }
+  if(!armed) {
+    self->unref();
+  }
+}
+
+bool ServerConn::checkIdle() {
+  const uint64 timeout = uint64(server_->IdleTimeout())*1000;
+  const uint64 now = env_->NowMicros();
+  uint64 wait = timeout;
+  if(idle_ && inflight_ == 0 && streams_.empty() && pending_.empty() && !flushing_) {
+    const uint64 idle_for = (now > active_micros_)? now - active_micros_: 0;
+    if(idle_for >= timeout) {
+      if(!conn_->WaitReadable(0)) {
+        // wake up the reader with EOF as Drain does
+        conn_->ShutdownRead();
+        return false;
+      }
+    } else {
+      wait = timeout - idle_for;
+    }
+  }
+  idle_timer_ = env_->ScheduleAfter(int((wait + 999) / 1000), &ServerConn::IdleProc, this);
+  return true;
+}
+
+void ServerConn::Drain() {
+  CondVarLock locker(&cv_);
+  draining_ = true;
+  stopIdleReader();
+}
+
+void ServerConn::stopIdleReader() {
+  if(draining_ && idle_ && streams_.empty() && !conn_->WaitReadable(0)) {
+    // wake up the reader with EOF, the answers still go out
+    conn_->ShutdownRead();
+  }
+}
+
+void ServerConn::Abort() {
+  conn_->Shutdown();
+}
+
+void ServerConn::unref() {
+  bool last;
+  {
+    CondVarLock locker(&cv_);
+    last = (--refs_ == 0);
+  }
+  if(last) {
+    delete this;
+  }
+}
+
+void ServerConn::dispatch(Call* call) {
+  // nothing pipelined behind this call: run it on the reader, unless
+  // the admission control sees calls waiting before it or its caps are
+  // full
+  const bool admission = server_->GetAdmission()->Enabled();
+  auto dispatcher = server_->GetDispatcher();
+  if(max_inflight_ <= 1 || conn_->Buffered() == 0) {
+    bool idle = true;
+    if(admission && max_inflight_ > 1) {
+      CondVarLock locker(&cv_);
+      idle = ready_.empty();
+    }
+    if(idle && (dispatcher == NULL || dispatcher->TryAcquire(call->cls))) {
+      auto cls = call->cls;
+      runCall(call);
+      if(dispatcher != NULL) {
+        dispatcher->Release(cls);
+      }
+      return;
+    }
+  }
+
+  // with admission control the calls over max_inflight_ wait in ready_,
+  // where their queue delay counts, and the reader goes on
+  cv_.Lock();
+  while(inflight_ >= max_inflight_ && !admission) {
+    if(!ready_.empty()) {
+      auto c = ready_.front();
+      ready_.pop_front();
+      cv_.Unlock();
+      runCall(c);
+      cv_.Lock();
+      continue;
+    }
+    cv_.Wait();
+  }
+  call->queued = true;
+  inflight_++;
+  if(dispatcher != NULL) {
+    refs_++;
+    cv_.Unlock();
+    dispatcher->Submit(call->cls, &ServerConn::DispatchProc, call);
+    if(max_inflight_ <= 1) {
+      // strictly one by one
+      CondVarLock locker(&cv_);
+      while(inflight_ > 0) {
+        cv_.Wait();
+      }
+    }
+    return;
+  }
+  ready_.push_back(call);
+  // a worker runs the calls of ready_ until it is empty
+  bool schedule = workers_ < max_inflight_;
+  if(schedule) {
+    workers_++;
+    refs_++;
+  }
+  cv_.Unlock();
+
+  if(schedule) {
+    env_->Schedule(&ServerConn::CallProc, this);
+  }
+}
+
+void ServerConn::runReadyCalls() {
+  for(;;) {
+    Call* call = NULL;
+    {
+      CondVarLock locker(&cv_);
+      if(ready_.empty()) {
+        return;
+      }
+      call = ready_.front();
+      ready_.pop_front();
+    }
+    runCall(call);
+  }
+}
+
+void ServerConn::runCall(Call* call) {
+  Error rv;
+  auto admission = server_->GetAdmission();
+  const uint64 now = env_->NowMicros();
+  if(!admission->Start(call->bytes, call->received, now)) {
+    // queued too long, the client had better try elsewhere
+    rv = Error::New(kOverloadedError);
+  } else if(call->deadline != 0 && now > call->deadline) {
+    // the client has given up, don't run the handler
+    rv = Error::New("protorpc.ServerConn.runCall: deadline exceeded.");
+  } else {
+    rv = call->service->CallMethod(call->method, call->request, call->response);
+  }
+  Error err;
+  if(chunked_ && wire::IsChunkedBody(call->response)) {
+    err = sendChunkedResponse(call->id, rv.String(), call->response,
+      server_->GetCompression(call->method)
+    );
+  } else {
+    err = queueResponse(call->id, rv.String(), call->response,
+      server_->GetCompression(call->method)
+    );
+  }
+  if(!err.IsNil()) {
+    env_->Logf("protorpc.ServerConn.runCall: SendResponse fail: %s.\n", err.String().c_str());
+  }
+  const bool queued = call->queued;
+  pool_.Delete(call->request);
+  pool_.Delete(call->response);
+  delete call;
+  admission->Done();
+
+  CondVarLock locker(&cv_);
+  if(!err.IsNil()) {
+    broken_ = true;
+  }
+  if(idle_timer_ != 0) {
+    active_micros_ = env_->NowMicros();
+  }
+  if(queued) {
+    inflight_--;
+    cv_.SignalAll();
+  }
+}
+
+Error ServerConn::queueResponse(uint64 id, const std::string& error,
+  const ::google::protobuf::Message* response,
+  const wire::Compression* compression
+) {
+  std::string pbHeader, compressedPbResponse;
+  auto err = wire::MarshalResponse(id, error, response, &pbHeader, &compressedPbResponse, protocol_,
+    compression, checksum_
+  );
+  if(!err.IsNil()) {
+    return err;
+  }
+
+  CondVarLock locker(&cv_);
+  pushFrames(&pbHeader, &compressedPbResponse);
+  return Error::Nil();
+}
+
+void ServerConn::pushFrames(std::string* header, std::string* body) {
+  pending_bytes_ += header->size() + body->size();
+  pending_.push_back(std::string());
+  pending_.back().swap(*header);
+  pending_.push_back(std::string());
+  pending_.back().swap(*body);
+}
+
+bool ServerConn::flushResponses() {
+  cv_.Lock();
+  // the current flusher will send what we queued
+  if(flushing_) {
+    cv_.Unlock();
+    return true;
+  }
+  flushing_ = true;
+  bool ok = sendPending();
+  flushing_ = false;
+  if(chunked_waiters_ > 0) {
+    cv_.SignalAll();
+  }
+  cv_.Unlock();
+  return ok;
+}
+
+bool ServerConn::sendPending() {
+  auto& frames = flush_frames_;
+  auto& ptrs = flush_ptrs_;
+
+  while(!pending_.empty() && !broken_) {
+    frames.swap(pending_);
+    pending_bytes_ = 0;
+    cv_.Unlock();
+
+    ptrs.resize(frames.size());
+    for(size_t i = 0; i < frames.size(); i++) {
+      ptrs[i] = &frames[i];
+    }
+    bool ok = conn_->SendFrames(&ptrs[0], int(ptrs.size()));
+    frames.clear();
+
+    cv_.Lock();
+    if(!ok) {
+      env_->Logf("protorpc.ServerConn.flushResponses: SendFrames fail.\n");
+      broken_ = true;
+    }
+  }
+  return !broken_;
+}
+
+Error ServerConn::sendChunkedResponse(uint64 id, const std::string& error,
+  const ::google::protobuf::Message* response,
+  const wire::Compression* compression
+) {
+  Error err;
+  cv_.Lock();
+  chunked_waiters_++;
+  while(flushing_) {
+    cv_.Wait();
+  }
+  chunked_waiters_--;
+  flushing_ = true;
+  if(!sendPending()) {
+    err = Error::New("protorpc.ServerConn.sendChunkedResponse: SendFrames fail.");
+  } else {
+    cv_.Unlock();
+    err = wire::SendResponse(conn_, id, error, response, protocol_, compression, checksum_, true);
+    cv_.Lock();
+    if(!err.IsNil()) {
+      broken_ = true;  // the body may be cut
+    }
+  }
+  flushing_ = false;
+  if(chunked_waiters_ > 0) {
+    cv_.SignalAll();
+  }
+  cv_.Unlock();
+  return err;
 }
 
 Error ServerConn::ProcessOneCall(Conn* receiver) {
@@ -42,58 +560,214 @@ Error ServerConn::ProcessOneCall(Conn* receiver) {
   Error err;
 
   // 1. recv request header
-  err = RecvRequestHeader(receiver, &reqHeader);
+  // (buffered requests were received at the last socket read)
+  bool buffered = receiver->Buffered() > 0;
+  err = RecvRequestHeader(receiver, &reqHeader, protocol_);
   if(!err.IsNil()) {
     return err;
   }
+  const bool ping = wire::IsPing(reqHeader, protocol_);
+  if(!buffered) {
+    last_read_micros_ = env_->NowMicros();
+    CondVarLock locker(&cv_);
+    idle_ = false;
+    if(!ping) {
+      active_micros_ = last_read_micros_;
+    }
+  }
+  const uint64 received = last_read_micros_;
+  const bool first = first_request_;
+  first_request_ = false;
 
   // 2. find service/method
-  auto method = server_->FindMethodDescriptor(reqHeader.method());
-  if(method == NULL) {
-    wire::SendResponse(receiver, reqHeader.id(),
-      "protorpc.ServerConn.ProcessOneCall: Can't find ServiceMethod: " + reqHeader.method(),
-       NULL
-    );
+  if(first && server_->ProtocolV2Enabled() && reqHeader.method() == wire::kHandshakeMethod) {
+    return handshake(receiver, reqHeader);
+  }
+  if(ping) {
+    err = wire::SkipRequestBody(receiver, &reqHeader);
+    if(!err.IsNil()) {
+      return err;
+    }
+    queueResponse(reqHeader.id(), "", NULL);
     return Error::Nil();
   }
-  auto service = server_->FindService(reqHeader.method());
-  if(service == NULL) {
-    wire::SendResponse(receiver, reqHeader.id(),
-      "protorpc.ServerConn.ProcessOneCall: Can't find ServiceMethod: " + reqHeader.method(),
+  if(reqHeader.stream() != wire::STREAM_NONE) {
+    return processStreamFrame(receiver, reqHeader);
+  }
+  Service* service;
+  MethodDescriptor* method;
+  bool found = (protocol_ == wire::kProtocolV2)?
+    server_->FindMethodById(reqHeader.method_id(), &service, &method):
+    server_->FindMethod(reqHeader.method(), &service, &method);
+  if(!found) {
+    // skip the body
+    err = wire::SkipRequestBody(receiver, &reqHeader);
+    if(!err.IsNil()) {
+      return err;
+    }
+    auto name = (protocol_ == wire::kProtocolV2)?
+      "#" + std::to_string(static_cast<long long>(reqHeader.method_id())):
+      reqHeader.method();
+    queueResponse(reqHeader.id(),
+      "protorpc.ServerConn.ProcessOneCall: Can't find ServiceMethod: " + name,
        NULL
     );
     return Error::Nil();
   }
 
-  // 3. make request/response message
-  auto request = service->GetRequestPrototype(method).New();
-  auto response = service->GetResponsePrototype(method).New();
-  defer([&](){ delete request; delete response; });
+  // 3. admission control: turn the call down before reading its body
+  const int64 bytes = reqHeader.raw_request_len();
+  if(!server_->GetAdmission()->Admit(bytes, received)) {
+    err = wire::SkipRequestBody(receiver, &reqHeader);
+    if(!err.IsNil()) {
+      return err;
+    }
+    queueResponse(reqHeader.id(), kOverloadedError, NULL);
+    return Error::Nil();
+  }
+
+  // 4. make request/response message
+  auto request = pool_.New(service->GetRequestPrototype(method));
+  auto response = pool_.New(service->GetResponsePrototype(method));
 
-  // 4. recv request body
+  // 5. recv request body
   err = wire::RecvRequestBody(receiver, &reqHeader, request);
   if(!err.IsNil()) {
     env_->Logf(
       "protorpc.ServerConn.ProcessOneCall: : RecvRequestBody fail: %s.\n",
       err.String().c_str()
     );
+    pool_.Delete(request);
+    pool_.Delete(response);
+    // leave the queue
+    server_->GetAdmission()->Start(bytes, received, received);
+    server_->GetAdmission()->Done();
     return err;
   }
 
-  // 5. call method
-  auto rv = service->CallMethod(method, request, response);
+  // 6. call method, 7. send response (flushed by ServeProc or CallProc)
+  auto call = new Call;
+  call->id = reqHeader.id();
+  call->deadline = 0;
+  if(reqHeader.timeout_ms() != 0) {
+    call->deadline = received + uint64(reqHeader.timeout_ms())*1000;
+  }
+  call->received = received;
+  call->bytes = bytes;
+  call->queued = false;
+  call->owner = this;
+  call->cls = server_->GetCallClass(method);
+  call->service = service;
+  call->method = method;
+  call->request = request;
+  call->response = response;
+  dispatch(call);
 
-  // 6. send response
-  err = wire::SendResponse(receiver, reqHeader.id(), rv.String(), response);
+  return Error::Nil();
+}
+
+Error ServerConn::processStreamFrame(Conn* receiver, const wire::RequestHeader& reqHeader) {
+  // the message body, empty for the control frames
+  int len;
+  auto body = receiver->PeekFrame(&len);
+  if(body == NULL) {
+    return Error::New("protorpc.ServerConn.ProcessOneCall: RecvFrame failed.");
+  }
+  defer([&](){ receiver->Consume(len); });
+
+  if(reqHeader.stream() == wire::STREAM_OPEN) {
+    openStream(reqHeader);
+    return Error::Nil();
+  }
+
+  CondVarLock locker(&cv_);
+  auto it = streams_.find(reqHeader.id());
+  if(it == streams_.end()) {
+    return Error::Nil();  // the call is done
+  }
+  auto stream = it->second;
+  switch(reqHeader.stream()) {
+  case wire::STREAM_MESSAGE:
+    if(stream->canceled_) {
+      break;
+    }
+    // like Write, a message may start while some window is left
+    if(stream->window_ <= 0) {
+      stream->canceled_ = true;
+      stream->overrun_ = true;
+      stream->in_.clear();
+      break;
+    }
+    stream->window_ -= len;
+    stream->in_.push_back(StreamCall::Frame());
+    stream->in_.back().header.CopyFrom(reqHeader);
+    stream->in_.back().body.assign(body, len);
+    break;
+  case wire::STREAM_END:
+    stream->in_end_ = true;
+    break;
+  case wire::STREAM_WINDOW:
+    stream->credit_ += reqHeader.window();
+    break;
+  case wire::STREAM_CANCEL:
+    stream->canceled_ = true;
+    break;
+  default:
+    break;
+  }
+  cv_.SignalAll();
+  return Error::Nil();
+}
+
+void ServerConn::openStream(const wire::RequestHeader& reqHeader) {
+  Service* service;
+  MethodDescriptor* method;
+  bool found = (protocol_ == wire::kProtocolV2) &&
+    server_->FindMethodById(reqHeader.method_id(), &service, &method);
+  if(!found || !(method->client_streaming() || method->server_streaming())) {
+    queueResponse(reqHeader.id(),
+      "protorpc.ServerConn.ProcessOneCall: Can't find streaming ServiceMethod: #" +
+      std::to_string(static_cast<long long>(reqHeader.method_id())),
+      NULL
+    );
+    return;
+  }
+  // a stream counts as a call in flight until its handler returns
+  const uint64 now = env_->NowMicros();
+  if(!server_->GetAdmission()->Admit(0, now)) {
+    queueResponse(reqHeader.id(), kOverloadedError, NULL);
+    return;
+  }
+  server_->GetAdmission()->Start(0, now, now);
+
+  auto stream = new StreamCall(this, reqHeader.id(), service, method);
+  {
+    CondVarLock locker(&cv_);
+    streams_[stream->id_] = stream;
+    refs_++;
+  }
+  env_->StartThread(&ServerConn::StreamProc, stream);
+}
+
+Error ServerConn::handshake(Conn* receiver, const wire::RequestHeader& reqHeader) {
+  wire::HandshakeRequest request;
+  wire::HandshakeResponse response;
+  auto err = wire::RecvRequestBody(receiver, &reqHeader, &request);
   if(!err.IsNil()) {
-    env_->Logf("protorpc.ServerConn.ProcessOneCall: : SendResponse fail: %s.\n", err.String().c_str());
     return err;
   }
-
+  int version = server_->Handshake(request, &response, true);
+  err = queueResponse(reqHeader.id(), "", &response);
+  if(!err.IsNil()) {
+    return err;
+  }
+  // no call runs yet, the next frames use the new version
+  protocol_ = version;
+  checksum_ = response.crc32c()? wire::kCRC32C: wire::kCRC32;
+  chunked_ = response.chunked();
   return Error::Nil();
 }
 
 }  // namespace rpc
 }  // namespace protobuf
 }  // namespace google
-
@@ -8,6 +8,14 @@
 #include <google/protobuf/rpc/rpc_env.h>
 #include <google/protobuf/rpc/rpc_conn.h>
 #include <google/protobuf/rpc/rpc_service.h>
+#include <google/protobuf/rpc/rpc_message_pool.h>
+#include <google/protobuf/rpc/rpc_dispatcher.h>
+#include <google/protobuf/rpc/rpc_wire.h>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
 
 namespace google {
 namespace protobuf {
@@ -15,16 +23,88 @@ namespace rpc {
 
 class Server;
 
+// Blocking server side connection.
+//
+// The reader runs on its own thread. Requests that are already pipelined
+// behind the current one are dispatched to other workers (at most
+// Server::MaxInflightPerConn() at a time), and the responses are sent as
+// they complete, tagged by the request id. With the admission control
+// of the server the reader doesn't wait for the workers, the calls queue
+// up to the limits of Server::SetAdmission.
+//
+// Once the server has call limits (see Server::GetDispatcher) the queued
+// calls go to its dispatcher instead of the workers of the connection.
+//
+// Each streaming call runs on a thread of its own, the reader queues the
+// messages of the client for it (see wire.proto).
+//
+// The connections register with their server, Server::Shutdown drains
+// them: the reader stops once it waits for a new request with no stream
+// open, the calls in flight still answer. With Server::SetIdleTimeout an
+// Env timer closes the connection the same way once nothing is pending
+// for the timeout.
 class ServerConn {
  public:
-  static void Serve(Server* server, Conn* conn, Env* env);
+  // With shm_handshake_ms > 0 the connection thread first waits that
+  // long for the shared memory segment of the client (Conn::AcceptShm).
+  static void Serve(Server* server, Conn* conn, Env* env, int shm_handshake_ms=0);
+
+  // Stop reading requests once no stream is open and the next request
+  // is not there. Thread safe, the server holds its lock.
+  void Drain();
+  // Shut the connection down, the calls in flight fail to answer.
+  void Abort();
 
  private:
+  struct Call;
+  class StreamCall;
+
   ServerConn(Server* server, Conn* conn, Env* env);
   ~ServerConn();
 
   static void ServeProc(void* p);
+  static void CallProc(void* p);
+  static void DispatchProc(void* p);
+  static void StreamProc(void* p);
+  static void IdleProc(void* p);
   Error ProcessOneCall(Conn* receiver);
+  // Answer the protocol v2 handshake and switch protocol_.
+  Error handshake(Conn* receiver, const wire::RequestHeader& reqHeader);
+  // Handle a frame of a streaming call.
+  Error processStreamFrame(Conn* receiver, const wire::RequestHeader& reqHeader);
+  void openStream(const wire::RequestHeader& reqHeader);
+
+  // Run the call now or hand it to a worker.
+  void dispatch(Call* call);
+  void runCall(Call* call);
+  // Run the dispatched calls no worker has picked up yet.
+  void runReadyCalls();
+  // Drop a reference, the last one deletes the connection.
+  void unref();
+  // Wake up the reader waiting for a request of a draining connection,
+  // requires cv_ held.
+  void stopIdleReader();
+  // Close the connection if it has been idle for the timeout, or arm
+  // the idle timer again. Requires cv_ held, return false once the timer
+  // is done with its reference.
+  bool checkIdle();
+
+  // Responses are queued while more pipelined requests are buffered,
+  // and flushed with one vectored write.
+  Error queueResponse(uint64 id, const std::string& error,
+    const ::google::protobuf::Message* response,
+    const wire::Compression* compression=NULL);
+  // Requires cv_ held.
+  void pushFrames(std::string* header, std::string* body);
+  bool flushResponses();
+  // Send the queued frames as the flusher, requires cv_ held (released
+  // while sending).
+  bool sendPending();
+  // Send a response whose body is chunked (see wire::IsChunkedBody)
+  // right away as the flusher, the other responses wait.
+  Error sendChunkedResponse(uint64 id, const std::string& error,
+    const ::google::protobuf::Message* response,
+    const wire::Compression* compression);
 
   const ::google::protobuf::rpc::Error callMethod(
     const std::string& method,
@@ -34,6 +114,37 @@ class ServerConn {
   Server* server_;
   Conn* conn_;
   Env* env_;
+  int shm_handshake_ms_;
+  int max_inflight_;
+  uint64 last_read_micros_;  // Env::NowMicros() of the last socket read
+  MessagePool pool_;         // requests and responses
+  int protocol_;             // wire::kProtocolV1 until the handshake
+  wire::Checksum checksum_;
+  bool chunked_;             // large bodies are sent in chunks
+  bool first_request_;
+
+  // guard the fields below
+  CondVar cv_;
+  std::deque<Call*> ready_;
+  int inflight_;  // calls of ready_ and running from it
+  int workers_;   // CallProc scheduled, at most max_inflight_
+  int refs_;
+  bool broken_;
+  bool eof_;  // the reader is done
+  bool idle_;  // the reader waits for a new request
+  bool draining_;
+  std::map<uint64, StreamCall*> streams_;
+  uint64 idle_timer_;     // Env::ScheduleAfter handle, 0 for none
+  uint64 active_micros_;  // Env::NowMicros() of the last call, pings aside
+
+  std::vector<std::string> pending_;  // header/body frames
+  size_t pending_bytes_;
+  bool flushing_;
+  int chunked_waiters_;  // sendChunkedResponse waiting for the flusher
+
+  // used by the flusher only, kept for their capacity
+  std::vector<std::string> flush_frames_;
+  std::vector<const std::string*> flush_ptrs_;
 
  private:
   GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(ServerConn);
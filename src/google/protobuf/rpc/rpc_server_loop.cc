@@ -0,0 +1,955 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "google/protobuf/rpc/rpc_server_loop.h"
+#include <google/protobuf/rpc/rpc_server.h>
+#include <google/protobuf/rpc/rpc_wire.h>
+#include <google/protobuf/stubs/defer.h>
+#include <google/protobuf/stubs/atomicops.h>
+
+#include <snappy.h>
+
+#include <errno.h>
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+using ::google::protobuf::internal::AtomicWord;
+using ::google::protobuf::internal::NoBarrier_Load;
+using ::google::protobuf::internal::NoBarrier_AtomicIncrement;
+
+// Per loop state. The counters are written by one loop thread, on a
+// cache line of their own.
+struct ServerLoop::Counters {
+  volatile AtomicWord accepted;
+  volatile AtomicWord calls;
+  char pad_[64];
+
+  ServerLoop* owner;
+  int index;
+  std::set<ServerLoopConn*> conns;  // guarded by owner->cv_
+  std::vector<Call*> done;          // offloaded calls, guarded by owner->cv_
+
+  Counters(ServerLoop* o, int i): accepted(0), calls(0), owner(o), index(i) {}
+};
+
+// A call offloaded to the dispatcher, its messages are from the pool of
+// its connection.
+struct ServerLoop::Call {
+  ServerLoopConn* conn;
+  Service* service;
+  const MethodDescriptor* method;
+  Message* request;
+  Message* response;
+  uint64 id;
+  int protocol;
+  wire::Checksum checksum;
+  std::string out;  // the encoded response
+};
+
+class ServerLoop::Listener: public EventLoop::Handler, public UringLoop::Handler {
+ public:
+  Listener(ServerLoop* owner, Conn* conn): owner_(owner), conn_(conn) {}
+
+  // implements EventLoop::Handler (accept new connections)
+  void OnEvents(int events) {
+    owner_->accept(conn_);
+  }
+
+  // implements UringLoop::Handler (multishot accept)
+  void OnComplete(int op, int res, const char* data, bool more) {
+    if(res >= 0) {
+      owner_->acceptFd(res);
+    } else if(res != -ECANCELED) {
+      owner_->env_->Logf("protorpc.ServerLoop.accept: failed, err = %d.\n", -res);
+    }
+    if(!more) {
+      bool draining;
+      {
+        CondVarLock locker(&owner_->cv_);
+        draining = owner_->draining_;
+      }
+      if(draining) {
+        owner_->listenerDone();
+      } else {
+        owner_->urings_[0]->Accept(conn_->Fd(), this);
+      }
+    }
+  }
+
+  Conn* conn() { return conn_; }
+
+ private:
+  ServerLoop* owner_;
+  Conn* conn_;
+};
+
+ServerLoop::ServerLoop(Server* server, Env* env, int num_loops):
+  server_(server), env_(env), num_loops_(num_loops), initialized_(false), next_loop_(0),
+  running_(0), listening_(0), draining_(false), idle_timer_(0), offloaded_(0) {
+  if(num_loops_ < 1) {
+    num_loops_ = 1;
+  }
+}
+ServerLoop::~ServerLoop() {
+  // the offloaded calls left return to connections about to be deleted
+  {
+    CondVarLock locker(&cv_);
+    while(offloaded_ > 0) {
+      cv_.Wait();
+    }
+  }
+  for(size_t i = 0; i < counters_.size(); i++) {
+    auto& done = counters_[i]->done;
+    for(size_t j = 0; j < done.size(); j++) {
+      done[j]->conn->discard(done[j]);
+    }
+    done.clear();
+  }
+  for(size_t i = 0; i < loops_.size(); i++) {
+    delete loops_[i];
+  }
+  for(size_t i = 0; i < urings_.size(); i++) {
+    delete urings_[i];
+  }
+  for(size_t i = 0; i < listeners_.size(); i++) {
+    delete listeners_[i];
+  }
+  // the connections left by Stop()
+  for(size_t i = 0; i < counters_.size(); i++) {
+    while(!counters_[i]->conns.empty()) {
+      delete *counters_[i]->conns.begin();
+    }
+    delete counters_[i];
+  }
+}
+
+bool ServerLoop::init() {
+  for(int i = 0; i < num_loops_; i++) {
+    counters_.push_back(new Counters(this, i));
+  }
+  if(server_->IoUringEnabled()) {
+    for(int i = 0; i < num_loops_; i++) {
+      urings_.push_back(new UringLoop(env_));
+      if(!urings_.back()->Init()) {
+        env_->Logf("protorpc.ServerLoop: io_uring unavailable, use epoll.\n");
+        for(size_t j = 0; j < urings_.size(); j++) {
+          delete urings_[j];
+        }
+        urings_.clear();
+        break;
+      }
+    }
+    if(!urings_.empty()) {
+      return true;
+    }
+  }
+  for(int i = 0; i < num_loops_; i++) {
+    loops_.push_back(new EventLoop(env_));
+    if(!loops_.back()->Init()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ServerLoop::AddListener(Conn* listener) {
+  if(!initialized_) {
+    if(!init()) {
+      return false;
+    }
+    initialized_ = true;
+  }
+  if(!listener->SetNonBlocking(true)) {
+    return false;
+  }
+  auto l = new Listener(this, listener);
+  bool ok = urings_.empty()?
+    loops_[0]->Add(listener->Fd(), l):
+    urings_[0]->Accept(listener->Fd(), l);
+  if(!ok) {
+    delete l;
+    return false;
+  }
+  listeners_.push_back(l);
+  CondVarLock locker(&cv_);
+  listening_++;
+  return true;
+}
+
+void ServerLoop::Run() {
+  {
+    CondVarLock locker(&cv_);
+    running_ = int(counters_.size());
+    if(server_->IdleTimeout() > 0) {
+      idle_timer_ = env_->ScheduleAfter(server_->IdleTimeout()/4, &ServerLoop::IdleProc, this);
+    }
+  }
+  if(!urings_.empty()) {
+    for(size_t i = 1; i < urings_.size(); i++) {
+      env_->StartThread(&ServerLoop::UringLoopProc, counters_[i]);
+    }
+    urings_[0]->Run();
+  } else {
+    for(size_t i = 1; i < loops_.size(); i++) {
+      env_->StartThread(&ServerLoop::LoopProc, counters_[i]);
+    }
+    loops_[0]->Run();
+  }
+  loopDone();
+
+  CondVarLock locker(&cv_);
+  while(running_ > 0) {
+    cv_.Wait();
+  }
+  // the loops are about to be deleted, no sweep after this
+  if(idle_timer_ != 0 && env_->CancelTimer(idle_timer_)) {
+    idle_timer_ = 0;
+  }
+  while(idle_timer_ != 0) {
+    cv_.Wait();
+  }
+}
+
+void ServerLoop::Drain(uint64 deadline) {
+  {
+    CondVarLock locker(&cv_);
+    if(!initialized_ || draining_) {
+      return;
+    }
+    draining_ = true;
+  }
+  for(size_t i = 0; i < counters_.size(); i++) {
+    if(!urings_.empty()) {
+      urings_[i]->Post(&ServerLoop::DrainProc, counters_[i]);
+    } else {
+      loops_[i]->Post(&ServerLoop::DrainProc, counters_[i]);
+    }
+  }
+
+  CondVarLock locker(&cv_);
+  while(listening_ > 0) {
+    auto now = env_->NowMicros();
+    if(now >= deadline) {
+      break;
+    }
+    cv_.TimedWait(deadline - now);
+  }
+}
+
+int ServerLoop::Open() {
+  CondVarLock locker(&cv_);
+  size_t n = 0;
+  for(size_t i = 0; i < counters_.size(); i++) {
+    n += counters_[i]->conns.size();
+  }
+  return int(n);
+}
+
+void ServerLoop::Stop() {
+  for(size_t i = 0; i < urings_.size(); i++) {
+    urings_[i]->Stop();
+  }
+  for(size_t i = 0; i < loops_.size(); i++) {
+    loops_[i]->Stop();
+  }
+  CondVarLock locker(&cv_);
+  while(running_ > 0) {
+    cv_.Wait();
+  }
+}
+
+// [static]
+void ServerLoop::DrainProc(void* p) {
+  auto counters = (Counters*)p;
+  auto self = counters->owner;
+  if(counters->index == 0) {
+    // io_uring listeners are done once their accept is canceled
+    for(size_t i = 0; i < self->listeners_.size(); i++) {
+      if(!self->urings_.empty()) {
+        self->urings_[0]->Cancel(self->listeners_[i], UringLoop::kAccept);
+      } else {
+        self->loops_[0]->Remove(self->listeners_[i]->conn()->Fd());
+        self->listenerDone();
+      }
+    }
+  }
+
+  std::vector<ServerLoopConn*> conns;
+  {
+    CondVarLock locker(&self->cv_);
+    conns.assign(counters->conns.begin(), counters->conns.end());
+  }
+  for(size_t i = 0; i < conns.size(); i++) {
+    conns[i]->Drain();
+  }
+}
+
+// [static]
+void ServerLoop::IdleProc(void* p) {
+  auto self = (ServerLoop*)p;
+  CondVarLock locker(&self->cv_);
+  self->idle_timer_ = 0;
+  if(self->running_ == 0) {
+    self->cv_.SignalAll();
+    return;
+  }
+  for(size_t i = 0; i < self->counters_.size(); i++) {
+    if(!self->urings_.empty()) {
+      self->urings_[i]->Post(&ServerLoop::SweepProc, self->counters_[i]);
+    } else {
+      self->loops_[i]->Post(&ServerLoop::SweepProc, self->counters_[i]);
+    }
+  }
+  self->idle_timer_ = self->env_->ScheduleAfter(self->server_->IdleTimeout()/4,
+    &ServerLoop::IdleProc, self
+  );
+}
+
+// [static]
+void ServerLoop::SweepProc(void* p) {
+  auto counters = (Counters*)p;
+  auto self = counters->owner;
+  std::vector<ServerLoopConn*> conns;
+  {
+    CondVarLock locker(&self->cv_);
+    conns.assign(counters->conns.begin(), counters->conns.end());
+  }
+  const uint64 timeout = uint64(self->server_->IdleTimeout())*1000;
+  const uint64 now = self->env_->NowMicros();
+  for(size_t i = 0; i < conns.size(); i++) {
+    conns[i]->Sweep((now > timeout)? now - timeout: 0);
+  }
+}
+
+void ServerLoop::loopDone() {
+  CondVarLock locker(&cv_);
+  running_--;
+  cv_.SignalAll();
+}
+
+void ServerLoop::listenerDone() {
+  CondVarLock locker(&cv_);
+  listening_--;
+  cv_.SignalAll();
+}
+
+void ServerLoop::GetStats(Stats* stats) {
+  stats->accepted = 0;
+  stats->calls = 0;
+  for(size_t i = 0; i < counters_.size(); i++) {
+    stats->accepted += uint64(NoBarrier_Load(&counters_[i]->accepted));
+    stats->calls += uint64(NoBarrier_Load(&counters_[i]->calls));
+  }
+}
+
+// [static]
+void ServerLoop::LoopProc(void* p) {
+  auto counters = (Counters*)p;
+  counters->owner->loops_[counters->index]->Run();
+  counters->owner->loopDone();
+}
+
+// [static]
+void ServerLoop::UringLoopProc(void* p) {
+  auto counters = (Counters*)p;
+  counters->owner->urings_[counters->index]->Run();
+  counters->owner->loopDone();
+}
+
+void ServerLoop::accept(Conn* listener) {
+  // edge-triggered: accept until it would block
+  for(;;) {
+    auto conn = listener->Accept();
+    if(conn == NULL) {
+      break;
+    }
+    if(!conn->SetNonBlocking(true)) {
+      conn->Close();
+      delete conn;
+      continue;
+    }
+
+    int i = next_loop_;
+    next_loop_ = (next_loop_ + 1) % int(loops_.size());
+    NoBarrier_AtomicIncrement(&counters_[i]->accepted, 1);
+
+    auto loop = loops_[i];
+    auto self = new ServerLoopConn(server_, conn, loop, env_, counters_[i]);
+    if(!loop->Add(conn->Fd(), self)) {
+      delete self;
+    }
+  }
+}
+
+// Called on the first loop, the other loops start their connections
+// on their own threads.
+void ServerLoop::acceptFd(int fd) {
+  int i = next_loop_;
+  next_loop_ = (next_loop_ + 1) % int(urings_.size());
+  NoBarrier_AtomicIncrement(&counters_[i]->accepted, 1);
+
+  auto self = new ServerLoopConn(server_, new Conn(fd, env_), urings_[i], env_, counters_[i]);
+  if(i == 0) {
+    ServerLoopConn::StartProc(self);
+  } else {
+    urings_[i]->Post(&ServerLoopConn::StartProc, self);
+  }
+}
+
+// --------------------------------------------------------
+
+ServerLoopConn::ServerLoopConn(Server* server, Conn* conn, EventLoop* loop, Env* env,
+  ServerLoop::Counters* counters
+):
+  server_(server), conn_(conn), loop_(loop), uring_(NULL), env_(env), counters_(counters),
+  pool_(server->MessagePoolSize()), protocol_(wire::kProtocolV1), checksum_(wire::kCRC32),
+  first_request_(true), draining_(false), closing_(false), offloaded_(0),
+  active_micros_(env->NowMicros()), in_pos_(0), out_pos_(0), unread_(false), read_closed_(false),
+  recv_armed_(false), recv_canceled_(false), send_inflight_(false) {
+  CondVarLock locker(&counters_->owner->cv_);
+  counters_->conns.insert(this);
+  draining_ = counters_->owner->draining_;
+}
+ServerLoopConn::ServerLoopConn(Server* server, Conn* conn, UringLoop* uring, Env* env,
+  ServerLoop::Counters* counters
+):
+  server_(server), conn_(conn), loop_(NULL), uring_(uring), env_(env), counters_(counters),
+  pool_(server->MessagePoolSize()), protocol_(wire::kProtocolV1), checksum_(wire::kCRC32),
+  first_request_(true), draining_(false), closing_(false), offloaded_(0),
+  active_micros_(env->NowMicros()), in_pos_(0), out_pos_(0), unread_(false), read_closed_(false),
+  recv_armed_(false), recv_canceled_(false), send_inflight_(false) {
+  CondVarLock locker(&counters_->owner->cv_);
+  counters_->conns.insert(this);
+  draining_ = counters_->owner->draining_;
+}
+ServerLoopConn::~ServerLoopConn() {
+  {
+    CondVarLock locker(&counters_->owner->cv_);
+    counters_->conns.erase(this);
+  }
+  conn_->Close();
+  delete conn_;
+}
+
+// [static]
+void ServerLoopConn::StartProc(void* p) {
+  auto self = (ServerLoopConn*)p;
+  if(!self->uring_->Recv(self->conn_->Fd(), self)) {
+    delete self;
+    return;
+  }
+  self->recv_armed_ = true;
+  if(self->draining_ && self->idle()) {
+    self->close();
+  }
+}
+
+void ServerLoopConn::Drain() {
+  draining_ = true;
+  if(!closing_ && idle()) {
+    close();
+  }
+}
+
+void ServerLoopConn::Sweep(uint64 deadline) {
+  // buffers larger than this are dropped once idle
+  static const size_t kMaxIdleBuffer = 64*1024;
+
+  if(closing_ || !idle()) {
+    return;
+  }
+  if(active_micros_ <= deadline) {
+    close();
+    return;
+  }
+  if(in_.capacity() > kMaxIdleBuffer) {
+    std::string().swap(in_);
+    in_pos_ = 0;
+  }
+  if(out_.capacity() > kMaxIdleBuffer) {
+    std::string().swap(out_);
+    out_pos_ = 0;
+  }
+  if(sending_.capacity() > kMaxIdleBuffer) {
+    std::string().swap(sending_);
+  }
+}
+
+bool ServerLoopConn::idle() const {
+  return in_pos_ == in_.size() && out_.empty() && !send_inflight_ && offloaded_ == 0;
+}
+
+bool ServerLoopConn::finished() const {
+  return read_closed_ && out_.empty() && !send_inflight_ && offloaded_ == 0;
+}
+
+bool ServerLoopConn::backlogged() const {
+  // responses unsent past this, the reads wait
+  static const size_t kMaxUnsent = 1024*1024;
+
+  size_t unsent = out_.size() - ((uring_ != NULL)? 0: out_pos_);
+  if(uring_ != NULL) {
+    unsent += sending_.size() - out_pos_;
+  }
+  return unsent >= kMaxUnsent || offloaded_ >= server_->MaxInflightPerConn();
+}
+
+void ServerLoopConn::OnComplete(int op, int res, const char* data, bool more) {
+  if(op == UringLoop::kRecv) {
+    if(!more) {
+      recv_armed_ = false;
+      recv_canceled_ = false;
+    }
+    if(closing_) {
+      close();
+      return;
+    }
+    if(res > 0) {
+      in_.append(data, res);  // processed by readRequests
+    }
+    // multishot receive ends on EOF, errors, when the buffers run out
+    // and when canceled while backlogged
+    if(res == 0) {
+      // the requests read are still answered
+      read_closed_ = true;
+    } else if(res < 0 && res != -ENOBUFS && res != -ECANCELED) {
+      close();
+      return;
+    }
+  } else if(op == UringLoop::kSend) {
+    send_inflight_ = false;
+    if(res < 0) {
+      close();
+      return;
+    }
+    out_pos_ += size_t(res);
+    if(out_pos_ < sending_.size()) {
+      if(!uring_->Send(conn_->Fd(), sending_.data() + out_pos_, sending_.size() - out_pos_, this)) {
+        close();
+        return;
+      }
+      send_inflight_ = true;
+    } else {
+      sending_.clear();
+      out_pos_ = 0;
+    }
+    if(closing_) {
+      close();
+      return;
+    }
+  }
+  if(!flush()) {
+    close();
+    return;
+  }
+  if(!readRequests()) {
+    // reply what we have, then drop the connection
+    flush();
+    close();
+    return;
+  }
+  if((draining_ && idle()) || finished()) {
+    close();
+  }
+}
+
+void ServerLoopConn::OnEvents(int events) {
+  if(events & EventLoop::kReadable) {
+    unread_ = true;  // edge triggered, read now or once not backlogged
+  }
+  if(!flush()) {
+    close();
+    return;
+  }
+  if(!readRequests()) {
+    // reply what we have, then drop the connection
+    flush();
+    close();
+    return;
+  }
+  if((events & EventLoop::kHangup) && !(events & EventLoop::kReadable)) {
+    close();
+    return;
+  }
+  if((draining_ && idle()) || finished()) {
+    close();
+  }
+}
+
+void ServerLoopConn::readAll() {
+  char buf[16*1024];
+  for(;;) {
+    int n = conn_->TryRead(buf, sizeof(buf));
+    if(n < 0) {
+      read_closed_ = true;
+      return;
+    }
+    if(n == 0) {
+      return;
+    }
+    in_.append(buf, n);
+  }
+}
+
+bool ServerLoopConn::readRequests() {
+  if(!backlogged()) {
+    if(uring_ == NULL && unread_ && !read_closed_) {
+      unread_ = false;
+      readAll();
+    }
+    // the frames left while backlogged too, for as long as the socket
+    // takes the responses
+    bool more;
+    do {
+      if(!processFrames()) {
+        return false;
+      }
+      more = backlogged();
+      if(!flush()) {
+        return false;
+      }
+    } while(more && !backlogged());
+  }
+  if(uring_ != NULL && !read_closed_) {
+    if(backlogged()) {
+      if(recv_armed_ && !recv_canceled_) {
+        recv_canceled_ = uring_->Cancel(this, UringLoop::kRecv);
+      }
+    } else if(!recv_armed_) {
+      if(!uring_->Recv(conn_->Fd(), this)) {
+        return false;
+      }
+      recv_armed_ = true;
+    }
+  }
+  return true;
+}
+
+bool ServerLoopConn::processFrames() {
+  const size_t max_header_len = wire::Const::default_instance().max_header_len();
+  const uint32 max_body_len = server_->MaxBodyLen() != 0?
+    server_->MaxBodyLen(): wire::kDefaultMaxBodyLen;
+  const uint64 received = env_->NowMicros();
+
+  while(!backlogged()) {
+    const uint8* p = (const uint8*)in_.data() + in_pos_;
+    size_t n = in_.size() - in_pos_;
+
+    // header frame
+    uint64 hdr_len;
+    int k1 = GetUvarint(p, n, &hdr_len);
+    if(k1 == 0) break;
+    if(k1 < 0 || hdr_len > max_header_len) {
+      env_->Logf("protorpc.ServerLoopConn.processFrames: invalid header frame.\n");
+      return false;
+    }
+    if(n - k1 < hdr_len) break;
+
+    // body frame
+    uint64 body_len;
+    int k2 = GetUvarint(p + k1 + hdr_len, n - k1 - hdr_len, &body_len);
+    if(k2 == 0) break;
+    if(k2 < 0) {
+      env_->Logf("protorpc.ServerLoopConn.processFrames: invalid body frame.\n");
+      return false;
+    }
+    if(body_len > snappy::MaxCompressedLength(max_body_len)) {
+      env_->Logf("protorpc.ServerLoopConn.processFrames: body too long.\n");
+      return false;
+    }
+    if(n - k1 - hdr_len - k2 < body_len) break;
+
+    processCall(
+      (const char*)p + k1, size_t(hdr_len),
+      (const char*)p + k1 + hdr_len + k2, size_t(body_len),
+      received
+    );
+    NoBarrier_AtomicIncrement(&counters_->calls, 1);
+    in_pos_ += k1 + size_t(hdr_len) + k2 + size_t(body_len);
+  }
+
+  // compact the input buffer
+  if(in_pos_ == in_.size()) {
+    in_.clear();
+    in_pos_ = 0;
+  } else if(in_pos_ > in_.size()/2) {
+    in_.erase(0, in_pos_);
+    in_pos_ = 0;
+  }
+  return true;
+}
+
+void ServerLoopConn::processCall(
+  const char* hdr, size_t hdr_len,
+  const char* body, size_t body_len,
+  uint64 received
+) {
+  wire::RequestHeader reqHeader;
+  Error err;
+
+  // 1. parse request header
+  err = wire::DecodeRequestHeader(hdr, hdr_len, protocol_, &reqHeader);
+  if(!err.IsNil()) {
+    env_->Logf("protorpc.ServerLoopConn.processCall: %s\n", err.String().c_str());
+    return;
+  }
+  const bool first = first_request_;
+  first_request_ = false;
+
+  // 2. find service/method
+  if(first && server_->ProtocolV2Enabled() && reqHeader.method() == wire::kHandshakeMethod) {
+    wire::HandshakeRequest request;
+    wire::HandshakeResponse response;
+    err = wire::DecodeRequestBody(&reqHeader, body, body_len, &request);
+    if(!err.IsNil()) {
+      wire::EncodeResponse(&out_, reqHeader.id(), err.String(), NULL);
+      return;
+    }
+    // the bodies are received whole here, no chunked ones
+    int version = server_->Handshake(request, &response);
+    wire::EncodeResponse(&out_, reqHeader.id(), "", &response);
+    protocol_ = version;
+    checksum_ = response.crc32c()? wire::kCRC32C: wire::kCRC32;
+    return;
+  }
+  if(wire::IsPing(reqHeader, protocol_)) {
+    wire::EncodeResponse(&out_, reqHeader.id(), "", NULL, protocol_, NULL, checksum_);
+    return;
+  }
+  active_micros_ = received;
+  if(reqHeader.stream() != wire::STREAM_NONE) {
+    // the stream methods block, they need the threads of ServerConn
+    if(reqHeader.stream() == wire::STREAM_OPEN) {
+      wire::EncodeResponse(&out_, reqHeader.id(),
+        "protorpc.ServerLoopConn.processCall: streaming calls need Server::Serve.",
+        NULL, protocol_, NULL, checksum_
+      );
+    }
+    return;
+  }
+  Service* service;
+  MethodDescriptor* method;
+  bool found = (protocol_ == wire::kProtocolV2)?
+    server_->FindMethodById(reqHeader.method_id(), &service, &method):
+    server_->FindMethod(reqHeader.method(), &service, &method);
+  if(!found) {
+    auto name = (protocol_ == wire::kProtocolV2)?
+      "#" + std::to_string(static_cast<long long>(reqHeader.method_id())):
+      reqHeader.method();
+    wire::EncodeResponse(&out_, reqHeader.id(),
+      "protorpc.ServerLoopConn.processCall: Can't find ServiceMethod: " + name,
+      NULL, protocol_, NULL, checksum_
+    );
+    return;
+  }
+
+  // the body frame is bounded, not what it uncompresses to
+  const uint32 max_body_len = server_->MaxBodyLen() != 0?
+    server_->MaxBodyLen(): wire::kDefaultMaxBodyLen;
+  if(reqHeader.raw_request_len() > max_body_len) {
+    wire::EncodeResponse(&out_, reqHeader.id(),
+      "protorpc.ServerLoopConn.processCall: body too long.", NULL, protocol_, NULL, checksum_
+    );
+    return;
+  }
+
+  // skip calls the client has given up on
+  if(reqHeader.timeout_ms() != 0 &&
+    env_->NowMicros() > received + uint64(reqHeader.timeout_ms())*1000
+  ) {
+    wire::EncodeResponse(&out_, reqHeader.id(),
+      "protorpc.ServerLoopConn.processCall: deadline exceeded.", NULL, protocol_, NULL, checksum_
+    );
+    return;
+  }
+
+  // 3. admission control, the call runs right away: its queue delay is
+  // the time the loop spent on the frames read before it
+  auto admission = server_->GetAdmission();
+  const int64 bytes = reqHeader.raw_request_len();
+  if(!admission->Admit(bytes, received)) {
+    wire::EncodeResponse(&out_, reqHeader.id(), kOverloadedError, NULL, protocol_, NULL, checksum_);
+    return;
+  }
+  bool offloaded = false;
+  defer([&](){ if(!offloaded) admission->Done(); });
+  if(!admission->Start(bytes, received, env_->NowMicros())) {
+    wire::EncodeResponse(&out_, reqHeader.id(), kOverloadedError, NULL, protocol_, NULL, checksum_);
+    return;
+  }
+
+  // 4. make request/response message
+  auto request = pool_.New(service->GetRequestPrototype(method));
+  auto response = pool_.New(service->GetResponsePrototype(method));
+  defer([&](){ if(!offloaded) { pool_.Delete(request); pool_.Delete(response); } });
+
+  // 5. decode request body
+  err = wire::DecodeRequestBody(&reqHeader, body, body_len, request, max_body_len);
+  if(!err.IsNil()) {
+    wire::EncodeResponse(&out_, reqHeader.id(), err.String(), NULL, protocol_, NULL, checksum_);
+    return;
+  }
+
+  // 6. call method, the ones with limits or a priority on the dispatcher
+  auto dispatcher = server_->GetDispatcher();
+  auto cls = (dispatcher != NULL)? server_->GetCallClass(method): NULL;
+  if(cls != NULL) {
+    auto call = new ServerLoop::Call;
+    call->conn = this;
+    call->service = service;
+    call->method = method;
+    call->request = request;
+    call->response = response;
+    call->id = reqHeader.id();
+    call->protocol = protocol_;
+    call->checksum = checksum_;
+    offloaded = true;
+    offloaded_++;
+    {
+      CondVarLock locker(&counters_->owner->cv_);
+      counters_->owner->offloaded_++;
+    }
+    dispatcher->Submit(cls, &ServerLoopConn::CallProc, call);
+    return;
+  }
+  auto rv = service->CallMethod(method, request, response);
+
+  // 7. queue response
+  err = wire::EncodeResponse(&out_, reqHeader.id(), rv.String(), response, protocol_,
+    server_->GetCompression(method), checksum_
+  );
+  if(!err.IsNil()) {
+    env_->Logf("protorpc.ServerLoopConn.processCall: EncodeResponse fail: %s.\n", err.String().c_str());
+    wire::EncodeResponse(&out_, reqHeader.id(), err.String(), NULL, protocol_, NULL, checksum_);
+  }
+}
+
+bool ServerLoopConn::flush() {
+  if(uring_ != NULL) {
+    if(send_inflight_ || out_.empty()) {
+      return true;
+    }
+    sending_.swap(out_);
+    out_.clear();
+    out_pos_ = 0;
+    if(!uring_->Send(conn_->Fd(), sending_.data(), sending_.size(), this)) {
+      return false;
+    }
+    send_inflight_ = true;
+    return true;
+  }
+  while(out_pos_ < out_.size()) {
+    int n = conn_->TryWrite(out_.data() + out_pos_, int(out_.size() - out_pos_));
+    if(n < 0) {
+      return false;
+    }
+    if(n == 0) {
+      return true; // wait for kWritable
+    }
+    out_pos_ += n;
+  }
+  out_.clear();
+  out_pos_ = 0;
+  return true;
+}
+
+// [static]
+void ServerLoopConn::CallProc(void* p) {
+  auto call = (ServerLoop::Call*)p;
+  auto self = call->conn;
+  auto rv = call->service->CallMethod(call->method, call->request, call->response);
+  auto err = wire::EncodeResponse(&call->out, call->id, rv.String(), call->response, call->protocol,
+    self->server_->GetCompression(call->method), call->checksum
+  );
+  if(!err.IsNil()) {
+    self->env_->Logf("protorpc.ServerLoopConn.processCall: EncodeResponse fail: %s.\n", err.String().c_str());
+    call->out.clear();
+    wire::EncodeResponse(&call->out, call->id, err.String(), NULL, call->protocol, NULL, call->checksum);
+  }
+
+  // the loop takes the calls done in a batch, it is deleted only once
+  // offloaded_ is 0
+  auto counters = self->counters_;
+  auto owner = counters->owner;
+  CondVarLock locker(&owner->cv_);
+  counters->done.push_back(call);
+  if(counters->done.size() == 1) {
+    if(self->uring_ != NULL) {
+      self->uring_->Post(&ServerLoopConn::DoneProc, counters);
+    } else {
+      self->loop_->Post(&ServerLoopConn::DoneProc, counters);
+    }
+  }
+  owner->offloaded_--;
+  owner->cv_.SignalAll();
+}
+
+// [static]
+void ServerLoopConn::DoneProc(void* p) {
+  auto counters = (ServerLoop::Counters*)p;
+  std::vector<ServerLoop::Call*> done;
+  {
+    CondVarLock locker(&counters->owner->cv_);
+    done.swap(counters->done);
+  }
+  for(size_t i = 0; i < done.size(); i++) {
+    done[i]->conn->done(done[i]);
+  }
+}
+
+void ServerLoopConn::done(ServerLoop::Call* call) {
+  if(!closing_) {
+    out_.append(call->out);
+  }
+  discard(call);
+  if(closing_) {
+    close();
+    return;
+  }
+  // the requests left while too many calls were offloaded
+  if(!flush() || !readRequests()) {
+    flush();
+    close();
+    return;
+  }
+  if((draining_ && idle()) || finished()) {
+    close();
+  }
+}
+
+void ServerLoopConn::discard(ServerLoop::Call* call) {
+  pool_.Delete(call->request);
+  pool_.Delete(call->response);
+  server_->GetAdmission()->Done();
+  delete call;
+  offloaded_--;
+}
+
+void ServerLoopConn::close() {
+  if(uring_ != NULL) {
+    if(!closing_) {
+      closing_ = true;
+      if(recv_armed_) {
+        uring_->Cancel(this, UringLoop::kRecv);
+      }
+    }
+    if(!recv_armed_ && !send_inflight_ && offloaded_ == 0) {
+      delete this;
+    }
+    return;
+  }
+  if(!closing_) {
+    closing_ = true;
+    loop_->Remove(conn_->Fd());
+  }
+  if(offloaded_ == 0) {
+    delete this;
+  }
+}
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,210 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef GOOGLE_PROTOBUF_RPC_SERVER_LOOP_H__
+#define GOOGLE_PROTOBUF_RPC_SERVER_LOOP_H__
+
+#include <google/protobuf/rpc/rpc_env.h>
+#include <google/protobuf/rpc/rpc_conn.h>
+#include <google/protobuf/rpc/rpc_event_loop.h>
+#include <google/protobuf/rpc/rpc_uring_loop.h>
+#include <google/protobuf/rpc/rpc_service.h>
+#include <google/protobuf/rpc/rpc_message_pool.h>
+#include <google/protobuf/rpc/rpc_wire.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+class Server;
+
+// Reactor mode of the server.
+//
+// The listening sockets and all the accepted connections are non-blocking,
+// connections are spread over num_loops event loops (one thread each).
+// The loops run on io_uring when the server allows it and the kernel
+// supports it, on epoll otherwise. With Server::SetIdleTimeout an Env
+// timer has each loop sweep its connections a few times per timeout:
+// the idle ones are closed, and their buffers released.
+//
+// The calls of the methods with limits or a priority (see
+// Server::GetDispatcher) run on the dispatcher workers, their responses
+// are posted back to the loop. The other methods run on the loop thread
+// and must not block: a handler waiting holds up all the connections of
+// its loop.
+class ServerLoop {
+ public:
+  ServerLoop(Server* server, Env* env, int num_loops);
+  ~ServerLoop();
+
+  // Accept on a listening socket (not owned) in the first loop.
+  // Return false if the event loop is not supported.
+  bool AddListener(Conn* listener);
+
+  // [blocking]
+  // Run the first loop in the calling thread, the others in new threads.
+  // Return once Stop() is called and all the loops are done.
+  void Run();
+
+  // Stop accepting and close the connections once no request or response
+  // is pending on them. Return once the listeners are out of the loops
+  // (or at Env::NowMicros() deadline), Open() tells when the connections
+  // are gone. Thread safe.
+  void Drain(uint64 deadline);
+  // Connections not closed yet.
+  int Open();
+  // Stop the loops and wait for their threads, the connections left are
+  // closed by the destructor. Thread safe, but not on a loop thread.
+  void Stop();
+
+  // Counters summed over the loops, each loop updates its own.
+  struct Stats {
+    uint64 accepted;  // connections
+    uint64 calls;     // requests processed
+  };
+  void GetStats(Stats* stats);
+
+ private:
+  friend class ServerLoopConn;
+  class Listener;
+  struct Counters;
+  struct Call;
+
+  bool init();
+  static void LoopProc(void* p);
+  static void UringLoopProc(void* p);
+  static void DrainProc(void* p);
+  static void IdleProc(void* p);
+  static void SweepProc(void* p);
+  void loopDone();
+  void listenerDone();
+  // Spread the connections of a listener over the loops.
+  void accept(Conn* listener);
+  void acceptFd(int fd);
+
+  Server* server_;
+  Env* env_;
+  int num_loops_;
+  bool initialized_;
+  std::vector<Listener*> listeners_;
+  std::vector<EventLoop*> loops_;
+  std::vector<UringLoop*> urings_;  // empty on epoll
+  std::vector<Counters*> counters_; // one per loop
+  int next_loop_;
+
+  // guard the fields below
+  CondVar cv_;
+  int running_;    // loop threads
+  int listening_;  // listeners still in the loops
+  bool draining_;
+  uint64 idle_timer_;  // Env::ScheduleAfter handle, 0 for none
+  int offloaded_;      // calls on the dispatcher workers
+
+ private:
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(ServerLoop);
+};
+
+// Non-blocking server side connection, owned by its event loop.
+class ServerLoopConn: public EventLoop::Handler, public UringLoop::Handler {
+ public:
+  ServerLoopConn(Server* server, Conn* conn, EventLoop* loop, Env* env,
+    ServerLoop::Counters* counters);
+  ServerLoopConn(Server* server, Conn* conn, UringLoop* uring, Env* env,
+    ServerLoop::Counters* counters);
+  ~ServerLoopConn();
+
+  // Arm the receive of an io_uring connection, on its loop thread.
+  static void StartProc(void* p);
+  // Run an offloaded call on a dispatcher worker.
+  static void CallProc(void* p);
+  // Queue the responses of the offloaded calls done, on the loop thread.
+  static void DoneProc(void* p);
+
+  // Close the connection once no request or response is pending, on
+  // its loop thread. It may delete the connection.
+  void Drain();
+  // Close the connection if it has been idle since Env::NowMicros()
+  // deadline, release the buffers of a burst if it is idle. On its loop
+  // thread, it may delete the connection.
+  void Sweep(uint64 deadline);
+
+  // implements EventLoop::Handler
+  void OnEvents(int events);
+  // implements UringLoop::Handler
+  void OnComplete(int op, int res, const char* data, bool more);
+
+ private:
+  friend class ServerLoop;
+
+  // Read until the socket would block, set read_closed_ on EOF or error
+  // (an error fails the next write).
+  void readAll();
+  // Process the complete header/body frame pairs in in_, until the
+  // connection is backlogged. False on a frame over the max body len.
+  bool processFrames();
+  // Read and process the requests unless backlogged, with io_uring arm
+  // or cancel the receive. Return false on error.
+  bool readRequests();
+  // Too much of the responses is unsent, or Server::MaxInflightPerConn
+  // calls are offloaded: stop reading the requests until they are done.
+  bool backlogged() const;
+  // received is the Env::NowMicros() the frames were read at.
+  void processCall(const char* hdr, size_t hdr_len, const char* body, size_t body_len,
+    uint64 received);
+  // Write out_ until the socket would block, return false on error.
+  // With io_uring, send out_ unless a send is in flight.
+  bool flush();
+  // With io_uring, the connection is deleted once its operations are done.
+  void close();
+  // No partial request, no call running and no response to send.
+  bool idle() const;
+  // The client is done sending and all its responses are sent.
+  bool finished() const;
+  // Queue the response of an offloaded call (drop it if closing), on the
+  // loop thread. It may delete the connection.
+  void done(ServerLoop::Call* call);
+  // Release an offloaded call without its response.
+  void discard(ServerLoop::Call* call);
+
+  Server* server_;
+  Conn* conn_;
+  EventLoop* loop_;
+  UringLoop* uring_;
+  Env* env_;
+  ServerLoop::Counters* counters_;
+  MessagePool pool_;  // requests and responses
+  int protocol_;      // wire::kProtocolV1 until the handshake
+  wire::Checksum checksum_;
+  bool first_request_;
+  bool draining_;
+  bool closing_;
+  int offloaded_;  // calls on the dispatcher workers, it outlives them
+  uint64 active_micros_;  // Env::NowMicros() of the last call, pings aside
+
+  std::string in_;
+  size_t in_pos_;
+  std::string out_;
+  size_t out_pos_;  // of sending_ with io_uring
+  bool unread_;     // epoll: readable while backlogged
+  bool read_closed_;  // EOF, it closes once finished()
+
+  // io_uring
+  std::string sending_;
+  bool recv_armed_;
+  bool recv_canceled_;  // while backlogged
+  bool send_inflight_;
+
+ private:
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(ServerLoopConn);
+};
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // GOOGLE_PROTOBUF_RPC_SERVER_LOOP_H__
@@ -3,6 +3,7 @@
 // license that can be found in the LICENSE file.
 
 #include "google/protobuf/rpc/rpc_service.h"
+#include <google/protobuf/rpc/rpc_stream.h>
 
 #include <google/protobuf/descriptor.h>
 
@@ -10,6 +11,55 @@ namespace google {
 namespace protobuf {
 namespace rpc {
 
+const Error& Future::Wait() {
+  CondVarLock locker(&cv_);
+  while(!done_) {
+    cv_.Wait();
+  }
+  return err_;
+}
+
+bool Future::IsDone() {
+  CondVarLock locker(&cv_);
+  return done_;
+}
+
+void Future::Done(const Error& err, const Callback& done) {
+  if(done) {
+    done(err);
+  }
+  CondVarLock locker(&cv_);
+  err_ = err;
+  done_ = true;
+  cv_.SignalAll();
+}
+
+std::shared_ptr<Future> Caller::CallMethodAsync(
+  const ::google::protobuf::MethodDescriptor* method,
+  const ::google::protobuf::Message* request,
+  ::google::protobuf::Message* response,
+  const Callback& done
+) {
+  std::shared_ptr<Future> future(new Future);
+  future->Done(CallMethod(method, request, response), done);
+  return future;
+}
+
+std::unique_ptr<ClientStream> Caller::NewStream(
+  const ::google::protobuf::MethodDescriptor* method
+) {
+  return ClientStream::NewError(Error::New(
+    "protorpc.Caller.NewStream: streaming calls not supported."
+  ));
+}
+
+const Error Service::CallStreamMethod(
+  const ::google::protobuf::MethodDescriptor* method,
+  Stream* stream
+) {
+  return Error::New("protorpc.Service.CallStreamMethod: not a streaming method.");
+}
+
 // [static]
 // See: goprotobuf/protoc-gen-go/generator/generator.go#CamelCase
 std::string Service::CamelCase(const std::string& s) {
@@ -7,8 +7,12 @@
 
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/stubs/common.h>
+#include <google/protobuf/rpc/rpc_env.h>
 #include <google/protobuf/rpc/wire.pb/wire.pb.h>
 
+#include <functional>
+#include <memory>
+
 namespace google {
 namespace protobuf {
 namespace rpc {
@@ -31,6 +35,35 @@ class LIBPROTOBUF_EXPORT Error {
   std::string err_text_;
 };
 
+class Stream;
+class ClientStream;
+
+// Completion callback of an asynchronous call.
+typedef std::function<void(const Error& err)> Callback;
+
+// Result of an asynchronous call.
+class LIBPROTOBUF_EXPORT Future {
+ public:
+  Future(): done_(false) {}
+  ~Future() {}
+
+  // Block until the call is done and return its error.
+  const Error& Wait();
+  bool IsDone();
+
+  // Run done (if not empty), then mark the call as done and wake up
+  // the waiters. Called once per call.
+  void Done(const Error& err, const Callback& done);
+
+ private:
+  CondVar cv_;
+  bool done_;
+  Error err_;
+
+ private:
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(Future);
+};
+
 // Abstract base interface for protocol-buffer-based RPC services caller.
 class LIBPROTOBUF_EXPORT Caller {
  public:
@@ -58,6 +91,26 @@ class LIBPROTOBUF_EXPORT Caller {
     const ::google::protobuf::Message* request,
     ::google::protobuf::Message* response) = 0;
 
+  // Start a call and return without waiting for the response.
+  //
+  // The request may be reused once CallMethodAsync() returns, the response
+  // must stay alive until the call is done. "done" (if not empty) runs when
+  // the call is done, in an unspecified thread.
+  //
+  // The default implementation calls CallMethod() and is done on return.
+  virtual std::shared_ptr<Future> CallMethodAsync(
+    const ::google::protobuf::MethodDescriptor* method,
+    const ::google::protobuf::Message* request,
+    ::google::protobuf::Message* response,
+    const Callback& done = Callback());
+
+  // Start a streaming call of method (see rpc_stream.h), its messages
+  // are the request and response types of method.
+  //
+  // The default implementation returns a stream failing every call.
+  virtual std::unique_ptr<ClientStream> NewStream(
+    const ::google::protobuf::MethodDescriptor* method);
+
  private:
   GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(Caller);
 };
@@ -109,6 +162,16 @@ class LIBPROTOBUF_EXPORT Service: public Caller {
   virtual const ::google::protobuf::Message& GetResponsePrototype(
     const ::google::protobuf::MethodDescriptor* method) const = 0;
 
+  // Run a streaming method over stream and return its status, called by
+  // the server on a thread of its own. The request of a server streaming
+  // method is the first message of stream, the response of a client
+  // streaming method is written to it.
+  //
+  // The default implementation fails.
+  virtual const ::google::protobuf::rpc::Error CallStreamMethod(
+    const ::google::protobuf::MethodDescriptor* method,
+    Stream* stream);
+
  private:
   GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(Service);
 };
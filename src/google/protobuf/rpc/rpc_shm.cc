@@ -0,0 +1,298 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "google/protobuf/rpc/rpc_shm.h"
+#include "google/protobuf/rpc/rpc_env.h"
+
+#include <string.h>
+
+#include <atomic>
+#include <thread>
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+// The indices run freely and wrap around, tail - head is the number of
+// bytes in the ring. The producer owns tail, the consumer owns head.
+// All of it is writable by the peer: the indexes are checked against
+// ShmChannel::ring_size_ before use.
+struct ShmChannel::Ring {
+  std::atomic<uint32> tail;
+  char pad0[60];
+  std::atomic<uint32> head;
+  char pad1[60];
+
+  // futex words, bumped after each write (data) and read (space)
+  std::atomic<uint32> data_seq;
+  std::atomic<uint32> space_seq;
+  std::atomic<uint32> reader_waiting;
+  std::atomic<uint32> writer_waiting;
+  std::atomic<uint32> closed;
+  uint32 size;  // informative
+  char pad2[40];
+
+  char* data() { return (char*)(this + 1); }
+};
+
+// Segment layout: header, ring of the creator, ring of the attacher.
+struct ShmHeader {
+  uint32 magic;
+  uint32 ring_size;
+  char pad[56];
+};
+static const uint32 kShmMagic = 0x70727368;  // "prsh"
+
+// Futex waits are cut into slices to notice a peer that died
+// without closing the channel.
+static const int kPeerCheckMs = 100;
+
+size_t ShmChannel::segmentSize(uint32 ring_size) {
+  return sizeof(ShmHeader) + 2*(sizeof(Ring) + ring_size);
+}
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
+
+#if (defined(_WIN32) || defined(_WIN64))
+#  include "./rpc_shm_windows.cc"
+#else
+#  include "./rpc_shm_posix.cc"
+#endif
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+ShmChannel::ShmChannel(int sock, int fd, void* base, size_t size, uint32 ring_size,
+  bool creator, int spin_us, Env* env):
+  sock_(sock), fd_(fd), base_(base), size_(size), ring_size_(ring_size),
+  spin_us_(spin_us), env_(env) {
+  auto header = (ShmHeader*)base;
+  auto first = (Ring*)(header + 1);
+  auto second = (Ring*)(first->data() + ring_size_);
+  tx_ = creator? first: second;
+  rx_ = creator? second: first;
+
+  // spinning only helps when the peer runs on another core
+  if(spin_us_ < 0) {
+    spin_us_ = (std::thread::hardware_concurrency() > 1)? 50: 0;
+  }
+}
+
+int ShmChannel::TryRecv(void* buf, int len) {
+  Ring* r = rx_;
+  uint32 head = r->head.load(std::memory_order_relaxed);
+  for(;;) {
+    uint32 n = r->tail.load(std::memory_order_acquire) - head;
+    if(n > ring_size_) {
+      return corrupt("TryRecv");
+    }
+    if(n == 0) {
+      if(!closed(r)) {
+        return 0;
+      }
+      // data written just before closing
+      if(r->tail.load(std::memory_order_acquire) != head) {
+        continue;
+      }
+      return -1;
+    }
+    if(n > uint32(len)) {
+      n = uint32(len);
+    }
+    uint32 off = head & (ring_size_ - 1);
+    uint32 first = (n < ring_size_ - off)? n: (ring_size_ - off);
+    memcpy(buf, r->data() + off, first);
+    memcpy((char*)buf + first, r->data(), n - first);
+    r->head.store(head + n, std::memory_order_release);
+    wake(r, false);
+    return int(n);
+  }
+}
+
+int ShmChannel::TrySend(const void* buf, int len) {
+  Ring* r = tx_;
+  if(closed(r)) {
+    return -1;
+  }
+  uint32 tail = r->tail.load(std::memory_order_relaxed);
+  uint32 used = tail - r->head.load(std::memory_order_acquire);
+  if(used > ring_size_) {
+    return corrupt("TrySend");
+  }
+  uint32 room = ring_size_ - used;
+  uint32 n = (uint32(len) < room)? uint32(len): room;
+  if(n == 0) {
+    return 0;
+  }
+  uint32 off = tail & (ring_size_ - 1);
+  uint32 first = (n < ring_size_ - off)? n: (ring_size_ - off);
+  memcpy(r->data() + off, buf, first);
+  memcpy(r->data(), (const char*)buf + first, n - first);
+  r->tail.store(tail + n, std::memory_order_release);
+  wake(r, true);
+  return int(n);
+}
+
+int ShmChannel::Recv(void* buf, int len, uint64 deadline) {
+  for(;;) {
+    int n = TryRecv(buf, len);
+    if(n != 0) {
+      return n;
+    }
+    if(!wait(rx_, true, deadline)) {
+      return 0;
+    }
+  }
+}
+
+int ShmChannel::Send(const IoVec* iov, int iovcnt, uint64 deadline) {
+  Ring* r = tx_;
+  uint32 tail = r->tail.load(std::memory_order_relaxed);
+
+  // publish the whole message at once unless the ring fills up,
+  // the reader wakes up one time
+  for(int i = 0; i < iovcnt; i++) {
+    const char* p = (const char*)iov[i].base;
+    size_t left = iov[i].len;
+    while(left > 0) {
+      if(closed(r)) {
+        return -1;
+      }
+      uint32 used = tail - r->head.load(std::memory_order_acquire);
+      if(used > ring_size_) {
+        return corrupt("Send");
+      }
+      uint32 room = ring_size_ - used;
+      if(room == 0) {
+        r->tail.store(tail, std::memory_order_release);
+        wake(r, true);
+        if(!wait(r, false, deadline)) {
+          return 0;
+        }
+        continue;
+      }
+      uint32 n = (left < size_t(room))? uint32(left): room;
+      uint32 off = tail & (ring_size_ - 1);
+      uint32 first = (n < ring_size_ - off)? n: (ring_size_ - off);
+      memcpy(r->data() + off, p, first);
+      memcpy(r->data(), p + first, n - first);
+      tail += n;
+      p += n;
+      left -= n;
+    }
+  }
+  r->tail.store(tail, std::memory_order_release);
+  wake(r, true);
+  return 1;
+}
+
+bool ShmChannel::WaitReadable(int timeout_ms) {
+  uint64 deadline = 0;
+  if(timeout_ms == 0) {
+    return rx_->tail.load() != rx_->head.load() || closed(rx_);
+  }
+  if(timeout_ms > 0) {
+    deadline = env_->NowMicros() + uint64(timeout_ms)*1000;
+  }
+  return wait(rx_, true, deadline);
+}
+
+void ShmChannel::Shutdown() {
+  Ring* rings[2] = { tx_, rx_ };
+  for(int i = 0; i < 2; i++) {
+    rings[i]->closed.store(1);
+    rings[i]->data_seq.fetch_add(1);
+    rings[i]->space_seq.fetch_add(1);
+    futexWake(&rings[i]->data_seq);
+    futexWake(&rings[i]->space_seq);
+  }
+}
+
+bool ShmChannel::closed(Ring* r) {
+  return r->closed.load(std::memory_order_acquire) != 0;
+}
+
+int ShmChannel::corrupt(const char* where) {
+  env_->Logf("protorpc.ShmChannel.%s: corrupt ring.\n", where);
+  Shutdown();
+  return -1;
+}
+
+void ShmChannel::wake(Ring* r, bool reader) {
+  // pairs with the waiting flag/sequence check in wait()
+  if(reader) {
+    r->data_seq.fetch_add(1);
+    if(r->reader_waiting.load() != 0) {
+      futexWake(&r->data_seq);
+    }
+  } else {
+    r->space_seq.fetch_add(1);
+    if(r->writer_waiting.load() != 0) {
+      futexWake(&r->space_seq);
+    }
+  }
+}
+
+bool ShmChannel::wait(Ring* r, bool reader, uint64 deadline) {
+  auto ready = [r, reader, this]() {
+    if(closed(r)) {
+      return true;
+    }
+    // a corrupt ring is ready, the caller fails on it
+    uint32 used = r->tail.load(std::memory_order_acquire) - r->head.load(std::memory_order_acquire);
+    return reader? (used != 0): (used != ring_size_);
+  };
+
+  if(spin_us_ > 0) {
+    uint64 until = env_->NowMicros() + uint64(spin_us_);
+    for(int i = 1; ; i++) {
+      if(ready()) {
+        return true;
+      }
+      if((i & 63) == 0 && env_->NowMicros() >= until) {
+        break;
+      }
+    }
+  }
+
+  std::atomic<uint32>* seq = reader? &r->data_seq: &r->space_seq;
+  std::atomic<uint32>* waiting = reader? &r->reader_waiting: &r->writer_waiting;
+  for(;;) {
+    int timeout_ms = kPeerCheckMs;
+    if(deadline != 0) {
+      uint64 now = env_->NowMicros();
+      if(now >= deadline) {
+        return false;
+      }
+      uint64 left = (deadline - now + 999) / 1000;
+      if(left < uint64(timeout_ms)) {
+        timeout_ms = int(left);
+      }
+    }
+
+    waiting->store(1);
+    uint32 v = seq->load();
+    if(ready()) {
+      waiting->store(0);
+      return true;
+    }
+    bool woken = futexWait(seq, v, timeout_ms);
+    waiting->store(0);
+    if(ready()) {
+      return true;
+    }
+    if(!woken && peerGone()) {
+      tx_->closed.store(1);
+      rx_->closed.store(1);
+      return true;
+    }
+  }
+}
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,101 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef GOOGLE_PROTOBUF_RPC_SHM_H__
+#define GOOGLE_PROTOBUF_RPC_SHM_H__
+
+#include <google/protobuf/rpc/rpc_conn.h>
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+class Env;
+
+// Byte stream between two processes of the same host: a shared memory
+// segment holding one single-producer/single-consumer ring for each
+// direction. A blocked side sleeps on a futex after an optional spin.
+//
+// The channel carries the same frames as the socket (Conn routes its
+// reads and writes here), the unix socket used to set it up only
+// detects that the peer has gone away.
+//
+// Linux only, Create and Attach fail on the other platforms.
+class ShmChannel {
+ public:
+  // Default capacity of each ring, a power of two.
+  static const int kDefaultRingSize = 256*1024;
+
+  // Create a segment with two rings of ring_size bytes. The caller
+  // passes Fd() to the peer, which attaches to it.
+  // spin_us < 0 spins a little only on multi-core machines.
+  static ShmChannel* Create(int sock, int ring_size, int spin_us, Env* env);
+  static ShmChannel* Attach(int sock, int segment_fd, int spin_us, Env* env);
+  ~ShmChannel();
+
+  // Descriptor of the segment.
+  int Fd() const { return fd_; }
+
+  // Block until some data is received or deadline (Env::NowMicros(),
+  // 0 for none) passes. Return the number of bytes read, 0 on timeout,
+  // -1 once the peer has closed and all the data is consumed.
+  int Recv(void* buf, int len, uint64 deadline);
+
+  // Copy all the buffers into the ring, waiting for space as needed.
+  // Return 1 on success, 0 on timeout, -1 if the channel is closed.
+  int Send(const IoVec* iov, int iovcnt, uint64 deadline);
+
+  // [non-blocking]
+  // Return the number of bytes transferred, 0 if it would block,
+  // -1 if the channel is closed.
+  int TryRecv(void* buf, int len);
+  int TrySend(const void* buf, int len);
+
+  // Wait up to timeout_ms for data (negative: no limit). Return false on
+  // timeout, true if data is ready or the channel is closed.
+  bool WaitReadable(int timeout_ms);
+
+  // Close both directions, the local and remote waiters wake up.
+  void Shutdown();
+
+ private:
+  struct Ring;
+
+  ShmChannel(int sock, int fd, void* base, size_t size, uint32 ring_size,
+    bool creator, int spin_us, Env* env);
+
+  static size_t segmentSize(uint32 ring_size);
+
+  // wait until the ring has data (reader) or space (writer),
+  // return false on timeout.
+  bool wait(Ring* ring, bool reader, uint64 deadline);
+  void wake(Ring* ring, bool reader);
+  bool closed(Ring* ring);
+  // The peer wrote indexes out of the ring: close the channel, return -1.
+  int corrupt(const char* where);
+
+  // platform
+  static bool futexWait(volatile void* addr, uint32 val, int timeout_ms);
+  static void futexWake(volatile void* addr);
+  bool peerGone();
+
+  int sock_;
+  int fd_;
+  void* base_;
+  size_t size_;
+  uint32 ring_size_;  // checked at attach, the segment copy is the peer's
+  Ring* tx_;
+  Ring* rx_;
+  int spin_us_;
+  Env* env_;
+
+ private:
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(ShmChannel);
+};
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // GOOGLE_PROTOBUF_RPC_SHM_H__
@@ -0,0 +1,161 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "google/protobuf/rpc/rpc_shm.h"
+#include "google/protobuf/rpc/rpc_env.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__linux__)
+#  include <linux/futex.h>
+#  include <sys/syscall.h>
+#  include <time.h>
+#  ifndef F_ADD_SEALS
+#    define F_ADD_SEALS (1024 + 9)
+#    define F_GET_SEALS (1024 + 10)
+#    define F_SEAL_SHRINK 0x0002
+#    define F_SEAL_GROW 0x0004
+#  endif
+#endif
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+#if defined(__linux__)
+
+ShmChannel* ShmChannel::Create(int sock, int ring_size, int spin_us, Env* env) {
+  uint32 size = 4096;
+  while(size < uint32(ring_size) && size < (1u << 30)) {
+    size <<= 1;
+  }
+  size_t total = segmentSize(size);
+
+  int fd = int(syscall(SYS_memfd_create, "protorpc-shm", 3 /* MFD_CLOEXEC|MFD_ALLOW_SEALING */));
+  if(fd < 0) {
+    env->Logf("protorpc.ShmChannel.Create: memfd_create failed, err = %d.\n", errno);
+    return NULL;
+  }
+  if(ftruncate(fd, off_t(total)) != 0) {
+    env->Logf("protorpc.ShmChannel.Create: ftruncate failed, err = %d.\n", errno);
+    close(fd);
+    return NULL;
+  }
+  // the peer maps it whole, a resize would fault its accesses
+  if(fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK|F_SEAL_GROW) != 0) {
+    env->Logf("protorpc.ShmChannel.Create: F_ADD_SEALS failed, err = %d.\n", errno);
+    close(fd);
+    return NULL;
+  }
+  void* base = mmap(NULL, total, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  if(base == MAP_FAILED) {
+    env->Logf("protorpc.ShmChannel.Create: mmap failed, err = %d.\n", errno);
+    close(fd);
+    return NULL;
+  }
+
+  // the new segment is zero filled
+  auto header = (ShmHeader*)base;
+  header->magic = kShmMagic;
+  header->ring_size = size;
+  auto first = (Ring*)(header + 1);
+  auto second = (Ring*)(first->data() + size);
+  first->size = second->size = size;
+
+  return new ShmChannel(sock, fd, base, total, size, true, spin_us, env);
+}
+
+ShmChannel* ShmChannel::Attach(int sock, int fd, int spin_us, Env* env) {
+  // sealed against resizing, or the peer could truncate it under us
+  const int seals = F_SEAL_SHRINK|F_SEAL_GROW;
+  int sealed = fcntl(fd, F_GET_SEALS);
+  struct stat st;
+  if(sealed < 0 || (sealed & seals) != seals ||
+    fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(ShmHeader)) {
+    env->Logf("protorpc.ShmChannel.Attach: invalid segment.\n");
+    close(fd);
+    return NULL;
+  }
+  size_t total = size_t(st.st_size);
+  void* base = mmap(NULL, total, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  if(base == MAP_FAILED) {
+    env->Logf("protorpc.ShmChannel.Attach: mmap failed, err = %d.\n", errno);
+    close(fd);
+    return NULL;
+  }
+
+  auto header = (ShmHeader*)base;
+  uint32 size = header->ring_size;
+  if(header->magic != kShmMagic || size == 0 || (size & (size - 1)) != 0 ||
+    segmentSize(size) != total) {
+    env->Logf("protorpc.ShmChannel.Attach: invalid segment.\n");
+    munmap(base, total);
+    close(fd);
+    return NULL;
+  }
+  return new ShmChannel(sock, fd, base, total, size, false, spin_us, env);
+}
+
+ShmChannel::~ShmChannel() {
+  Shutdown();
+  munmap(base_, size_);
+  close(fd_);
+}
+
+bool ShmChannel::futexWait(volatile void* addr, uint32 val, int timeout_ms) {
+  struct timespec ts;
+  ts.tv_sec = timeout_ms / 1000;
+  ts.tv_nsec = long(timeout_ms % 1000) * 1000000;
+  // shared futex: the peer maps the segment at another address
+  long r = syscall(SYS_futex, addr, FUTEX_WAIT, val, &ts, NULL, 0);
+  return r == 0 || errno != ETIMEDOUT;
+}
+
+void ShmChannel::futexWake(volatile void* addr) {
+  syscall(SYS_futex, addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+#else
+
+ShmChannel* ShmChannel::Create(int sock, int ring_size, int spin_us, Env* env) {
+  env->Logf("protorpc.ShmChannel.Create: not supported.\n");
+  return NULL;
+}
+
+ShmChannel* ShmChannel::Attach(int sock, int fd, int spin_us, Env* env) {
+  env->Logf("protorpc.ShmChannel.Attach: not supported.\n");
+  close(fd);
+  return NULL;
+}
+
+ShmChannel::~ShmChannel() {
+}
+
+bool ShmChannel::futexWait(volatile void* addr, uint32 val, int timeout_ms) {
+  return false;
+}
+
+void ShmChannel::futexWake(volatile void* addr) {
+}
+
+#endif
+
+// The peer never writes to the socket after the handshake,
+// any readable state is EOF or an error.
+bool ShmChannel::peerGone() {
+  struct pollfd pfd;
+  pfd.fd = sock_;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  return poll(&pfd, 1, 0) > 0;
+}
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
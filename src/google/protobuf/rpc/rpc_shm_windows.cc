@@ -0,0 +1,38 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "google/protobuf/rpc/rpc_shm.h"
+#include "google/protobuf/rpc/rpc_env.h"
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+ShmChannel* ShmChannel::Create(int sock, int ring_size, int spin_us, Env* env) {
+  env->Logf("protorpc.ShmChannel.Create: not supported.\n");
+  return NULL;
+}
+
+ShmChannel* ShmChannel::Attach(int sock, int fd, int spin_us, Env* env) {
+  env->Logf("protorpc.ShmChannel.Attach: not supported.\n");
+  return NULL;
+}
+
+ShmChannel::~ShmChannel() {
+}
+
+bool ShmChannel::futexWait(volatile void* addr, uint32 val, int timeout_ms) {
+  return false;
+}
+
+void ShmChannel::futexWake(volatile void* addr) {
+}
+
+bool ShmChannel::peerGone() {
+  return true;
+}
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
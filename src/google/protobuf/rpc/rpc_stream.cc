@@ -0,0 +1,35 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "google/protobuf/rpc/rpc_stream.h"
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+namespace {
+
+class ErrorStream: public ClientStream {
+ public:
+  explicit ErrorStream(const Error& err): err_(err) {}
+
+  const Error Write(const ::google::protobuf::Message* msg) { return err_; }
+  bool Read(::google::protobuf::Message* msg) { return false; }
+  const Error CloseWrite() { return err_; }
+  const Error Finish() { return err_; }
+
+ private:
+  Error err_;
+};
+
+}  // namespace
+
+// [static]
+std::unique_ptr<ClientStream> ClientStream::NewError(const Error& err) {
+  return std::unique_ptr<ClientStream>(new ErrorStream(err));
+}
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
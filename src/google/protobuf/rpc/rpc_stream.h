@@ -0,0 +1,131 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef GOOGLE_PROTOBUF_RPC_STREAM_H__
+#define GOOGLE_PROTOBUF_RPC_STREAM_H__
+
+#include <google/protobuf/rpc/rpc_service.h>
+
+#include <memory>
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+// The messages of a streaming call (see MethodDescriptor::client_streaming()
+// and server_streaming()), as seen by one side. Writes block while the
+// peer has too many unread messages.
+class LIBPROTOBUF_EXPORT Stream {
+ public:
+  Stream() {}
+  virtual ~Stream() {}
+
+  // Send a message, fail once the call is done or broken.
+  virtual const Error Write(const ::google::protobuf::Message* msg) = 0;
+  // Receive the next message, return false when the peer sent its last
+  // one or the call is done.
+  virtual bool Read(::google::protobuf::Message* msg) = 0;
+
+ private:
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(Stream);
+};
+
+// Client side of a streaming call, started by Caller::NewStream. The
+// call is canceled if it is deleted before Finish().
+class LIBPROTOBUF_EXPORT ClientStream: public Stream {
+ public:
+  ClientStream() {}
+  virtual ~ClientStream() {}
+
+  // No more messages from the client.
+  virtual const Error CloseWrite() = 0;
+  // CloseWrite, skip the unread messages and wait for the status of the
+  // call returned by the server method.
+  virtual const Error Finish() = 0;
+
+  // A stream whose calls fail with err.
+  static std::unique_ptr<ClientStream> NewError(const Error& err);
+
+ private:
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(ClientStream);
+};
+
+// Typed views of a Stream, used by the generated services.
+
+template<class R>
+class StreamReader {
+ public:
+  explicit StreamReader(Stream* stream): stream_(stream) {}
+  bool Read(R* msg) { return stream_->Read(msg); }
+ private:
+  Stream* stream_;
+};
+
+template<class W>
+class StreamWriter {
+ public:
+  explicit StreamWriter(Stream* stream): stream_(stream) {}
+  const Error Write(const W& msg) { return stream_->Write(&msg); }
+ private:
+  Stream* stream_;
+};
+
+template<class W, class R>
+class StreamReaderWriter {
+ public:
+  explicit StreamReaderWriter(Stream* stream): stream_(stream) {}
+  const Error Write(const W& msg) { return stream_->Write(&msg); }
+  bool Read(R* msg) { return stream_->Read(msg); }
+ private:
+  Stream* stream_;
+};
+
+// Typed client streams, used by the generated stubs.
+
+// Server streaming call: read the responses, then Finish.
+template<class R>
+class ClientReader {
+ public:
+  explicit ClientReader(std::unique_ptr<ClientStream> stream): stream_(std::move(stream)) {}
+  bool Read(R* msg) { return stream_->Read(msg); }
+  const Error Finish() { return stream_->Finish(); }
+ private:
+  std::unique_ptr<ClientStream> stream_;
+};
+
+// Client streaming call: write the requests, then Finish fills response.
+template<class W, class R>
+class ClientWriter {
+ public:
+  ClientWriter(std::unique_ptr<ClientStream> stream, R* response):
+    stream_(std::move(stream)), response_(response) {}
+  const Error Write(const W& msg) { return stream_->Write(&msg); }
+  const Error Finish() {
+    stream_->CloseWrite();
+    stream_->Read(response_);
+    return stream_->Finish();
+  }
+ private:
+  std::unique_ptr<ClientStream> stream_;
+  R* response_;
+};
+
+// Bidirectional streaming call.
+template<class W, class R>
+class ClientReaderWriter {
+ public:
+  explicit ClientReaderWriter(std::unique_ptr<ClientStream> stream): stream_(std::move(stream)) {}
+  const Error Write(const W& msg) { return stream_->Write(&msg); }
+  bool Read(R* msg) { return stream_->Read(msg); }
+  const Error CloseWrite() { return stream_->CloseWrite(); }
+  const Error Finish() { return stream_->Finish(); }
+ private:
+  std::unique_ptr<ClientStream> stream_;
+};
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // GOOGLE_PROTOBUF_RPC_STREAM_H__
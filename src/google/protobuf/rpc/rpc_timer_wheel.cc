@@ -0,0 +1,203 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "google/protobuf/rpc/rpc_timer_wheel.h"
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+const uint64 TimerWheel::kNever;
+const uint32 TimerWheel::kNil;
+
+TimerWheel::TimerWheel(uint64 now):
+  now_(now), heads_(kLevels*kSlots, kNil), free_(kNil), size_(0), near_(0) {
+  //
+}
+TimerWheel::~TimerWheel() {
+  //
+}
+
+TimerWheel::Id TimerWheel::Add(uint64 expires, void (*function)(void* arg), void* arg) {
+  uint32 i = free_;
+  if(i != kNil) {
+    free_ = nodes_[i].next;
+  } else {
+    i = uint32(nodes_.size());
+    nodes_.push_back(Node());
+    nodes_[i].gen = 0;
+  }
+  auto& node = nodes_[i];
+  node.expires = expires;
+  node.timer.function = function;
+  node.timer.arg = arg;
+  place(i, now_ + 1);
+  size_++;
+  return (uint64(node.gen) << 32) | uint64(i + 1);
+}
+
+bool TimerWheel::Cancel(Id id) {
+  uint64 low = id & 0xffffffffu;
+  if(low == 0 || low > nodes_.size()) {
+    return false;
+  }
+  uint32 i = uint32(low - 1);
+  auto& node = nodes_[i];
+  if(node.slot < 0 || node.gen != uint32(id >> 32)) {
+    return false;
+  }
+  unlink(i);
+  node.gen++;
+  node.next = free_;
+  free_ = i;
+  size_--;
+  return true;
+}
+
+void TimerWheel::Advance(uint64 now, std::vector<Timer>* expired) {
+  while(now_ < now) {
+    if(size_ == 0) {
+      now_ = now;
+      break;
+    }
+    if(near_ == 0) {
+      // nothing to expire before the next cascade
+      uint64 next = nextCascade();
+      if(next > now) {
+        now_ = now;
+        break;
+      }
+      now_ = next - 1;
+    }
+    now_++;
+    int index = int(now_ & (kSlots - 1));
+    if(index == 0) {
+      for(int level = 1; level < kLevels; level++) {
+        int i = int((now_ >> (level*kLevelBits)) & (kSlots - 1));
+        cascade(level, i);
+        if(i != 0) {
+          break;
+        }
+      }
+    }
+    expire(index, expired);
+  }
+}
+
+uint64 TimerWheel::NextExpiry() const {
+  if(size_ == 0) {
+    return kNever;
+  }
+  uint64 next = (size_ > near_)? nextCascade(): kNever;
+  if(near_ > 0) {
+    for(uint64 t = now_ + 1; t < now_ + kSlots && t < next; t++) {
+      if(heads_[t & (kSlots - 1)] != kNil) {
+        return t;
+      }
+    }
+  }
+  return next;
+}
+
+uint64 TimerWheel::nextCascade() const {
+  // a slot of level n cascades when the wheel turns to it, at a multiple
+  // of its span
+  uint64 next = kNever;
+  for(int level = 1; level < kLevels; level++) {
+    const int shift = level*kLevelBits;
+    const uint64 base = now_ >> shift;
+    for(uint64 d = 1; d <= kSlots; d++) {
+      if(heads_[level*kSlots + int((base + d) & (kSlots - 1))] != kNil) {
+        uint64 t = (base + d) << shift;
+        if(t < next) {
+          next = t;
+        }
+        break;
+      }
+    }
+  }
+  return next;
+}
+
+void TimerWheel::place(uint32 i, uint64 first) {
+  uint64 expires = nodes_[i].expires;
+  if(expires < first) {
+    expires = first;
+  }
+  uint64 delta = expires - now_;
+  int level = 0;
+  uint64 span = kSlots;
+  while(level < kLevels - 1 && delta >= span) {
+    level++;
+    span <<= kLevelBits;
+  }
+  if(delta >= span) {
+    // out of the wheel span, placed again when its slot cascades
+    expires = now_ + span - 1;
+  }
+  int index = int((expires >> (level*kLevelBits)) & (kSlots - 1));
+  link(i, level*kSlots + index);
+}
+
+void TimerWheel::link(uint32 i, int slot) {
+  auto& node = nodes_[i];
+  node.slot = slot;
+  node.prev = kNil;
+  node.next = heads_[slot];
+  if(node.next != kNil) {
+    nodes_[node.next].prev = i;
+  }
+  heads_[slot] = i;
+  if(slot < kSlots) {
+    near_++;
+  }
+}
+
+void TimerWheel::unlink(uint32 i) {
+  auto& node = nodes_[i];
+  if(node.prev != kNil) {
+    nodes_[node.prev].next = node.next;
+  } else {
+    heads_[node.slot] = node.next;
+  }
+  if(node.next != kNil) {
+    nodes_[node.next].prev = node.prev;
+  }
+  if(node.slot < kSlots) {
+    near_--;
+  }
+  node.slot = -1;
+}
+
+void TimerWheel::cascade(int level, int index) {
+  int slot = level*kSlots + index;
+  uint32 i = heads_[slot];
+  heads_[slot] = kNil;
+  while(i != kNil) {
+    uint32 next = nodes_[i].next;
+    place(i, now_);
+    i = next;
+  }
+}
+
+void TimerWheel::expire(int index, std::vector<Timer>* expired) {
+  uint32 i = heads_[index];
+  heads_[index] = kNil;
+  while(i != kNil) {
+    auto& node = nodes_[i];
+    uint32 next = node.next;
+    expired->push_back(node.timer);
+    node.slot = -1;
+    node.gen++;
+    node.next = free_;
+    free_ = i;
+    size_--;
+    near_--;
+    i = next;
+  }
+}
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,100 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef GOOGLE_PROTOBUF_RPC_TIMER_WHEEL_H__
+#define GOOGLE_PROTOBUF_RPC_TIMER_WHEEL_H__
+
+#include <google/protobuf/stubs/common.h>
+
+#include <vector>
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+// Hierarchical timing wheel, the time is counted in ticks.
+//
+// Level 0 has a slot per tick for the timers of the next kSlots ticks,
+// each level above covers kSlots times the span of the one below, and
+// its timers cascade down a level as the wheel turns past them. Add and
+// Cancel are O(1), Advance costs a slot per tick (skipping to the next
+// cascade while level 0 is empty) plus the timers expired or cascaded.
+// Timers further out than the wheel span are parked on the top level and
+// placed again.
+//
+// Not thread safe, see Env::ScheduleAfter.
+class TimerWheel {
+ public:
+  typedef uint64 Id;  // 0 is never an id
+  static const uint64 kNever = ~uint64(0);
+
+  struct Timer {
+    void (*function)(void* arg);
+    void* arg;
+  };
+
+  explicit TimerWheel(uint64 now=0);
+  ~TimerWheel();
+
+  // Expire function(arg) at tick expires, at the next tick if it is due.
+  Id Add(uint64 expires, void (*function)(void* arg), void* arg);
+  // Remove a timer, false if it has expired or was canceled.
+  bool Cancel(Id id);
+
+  // Turn the wheel to tick now, the timers expired are appended to
+  // expired by tick.
+  void Advance(uint64 now, std::vector<Timer>* expired);
+  // Tick to advance to for the next timer to expire (or cascade), kNever
+  // with no timer.
+  uint64 NextExpiry() const;
+
+  size_t Size() const { return size_; }
+  uint64 Now() const { return now_; }
+
+ private:
+  enum {
+    kLevelBits = 8,
+    kSlots = 1 << kLevelBits,
+    kLevels = 4,
+  };
+  static const uint32 kNil = ~uint32(0);
+
+  struct Node {
+    uint64 expires;
+    uint32 prev;
+    uint32 next;
+    uint32 gen;   // bumped when the node is freed, stale ids miss
+    int slot;     // index in heads_, -1 when free
+    Timer timer;
+  };
+
+  // Put a node in the slot of its expiry, tick first at the earliest
+  // (the current one while cascading, its slot is expired next).
+  void place(uint32 i, uint64 first);
+  void link(uint32 i, int slot);
+  void unlink(uint32 i);
+  // Place again the timers of a slot of an upper level.
+  void cascade(int level, int index);
+  // Take out the timers of level 0 slot index.
+  void expire(int index, std::vector<Timer>* expired);
+  // Tick of the next cascade of an upper level slot with timers, kNever
+  // if there is none.
+  uint64 nextCascade() const;
+
+  uint64 now_;
+  std::vector<Node> nodes_;
+  std::vector<uint32> heads_;  // kLevels * kSlots lists
+  uint32 free_;                // free nodes, linked by next
+  size_t size_;
+  size_t near_;                // timers on level 0
+
+ private:
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(TimerWheel);
+};
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // GOOGLE_PROTOBUF_RPC_TIMER_WHEEL_H__
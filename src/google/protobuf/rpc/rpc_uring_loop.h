@@ -0,0 +1,98 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef GOOGLE_PROTOBUF_RPC_URING_LOOP_H__
+#define GOOGLE_PROTOBUF_RPC_URING_LOOP_H__
+
+#include <google/protobuf/rpc/rpc_env.h>
+
+#include <vector>
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+// Completion loop on io_uring (Linux).
+//
+// Accept and receive are multishot: armed once, they complete for every
+// new connection or chunk of data. Received data lands in a ring of
+// buffers shared with the kernel. Operations are queued and submitted in
+// one batch with the wait for the next completions, so a busy loop makes
+// about one system call per round of events.
+//
+// All the methods but Post and Stop must be called on the loop thread
+// (or before Run).
+class UringLoop {
+ public:
+  enum {
+    kAccept = 1,
+    kRecv   = 2,
+    kSend   = 3,
+  };
+
+  class Handler {
+   public:
+    virtual ~Handler() {}
+    // Called on the loop thread when an operation completes.
+    // res is the accepted fd, the number of bytes or -errno; data holds
+    // the received bytes (kRecv) until the call returns. more is true if
+    // a multishot operation stays armed.
+    virtual void OnComplete(int op, int res, const char* data, bool more) = 0;
+  };
+
+  UringLoop(Env* env=NULL);
+  ~UringLoop();
+
+  // Return false if io_uring or the features used (multishot receive with
+  // buffer rings, Linux 6.0) are not available.
+  bool Init();
+
+  bool Accept(int fd, Handler* handler);
+  bool Recv(int fd, Handler* handler);
+  // buf must stay valid until the kSend completion.
+  bool Send(int fd, const void* buf, size_t len, Handler* handler);
+  // Cancel the operations op of handler, they complete with -ECANCELED.
+  bool Cancel(Handler* handler, int op);
+
+  // Run function(arg) on the loop thread. Thread safe.
+  void Post(void (*function)(void* arg), void* arg);
+
+  // [blocking]
+  // Dispatch completions until Stop() is called.
+  void Run();
+  // Wake up the loop and make Run() return. Thread safe.
+  void Stop();
+
+ private:
+  struct Rep;
+  struct Task {
+    void (*function)(void* arg);
+    void* arg;
+  };
+
+  // Flush the queued operations and wait for min_complete completions.
+  bool enter(unsigned min_complete);
+  void reap();
+  // Queue the read of wakeup_fd_, false if the queue is full.
+  bool armWakeup();
+  void runPosted();
+
+  Rep* rep_;
+  int wakeup_fd_;
+  bool wakeup_armed_;
+  volatile bool stopped_;
+  Env* env_;
+
+  Mutex mutex_;
+  std::vector<Task> posted_;
+
+ private:
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(UringLoop);
+};
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
+
+#endif // GOOGLE_PROTOBUF_RPC_URING_LOOP_H__
@@ -0,0 +1,453 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "google/protobuf/rpc/rpc_uring_loop.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#  include <linux/io_uring.h>
+#  include <sys/eventfd.h>
+#  include <sys/mman.h>
+#  include <sys/socket.h>
+#  include <sys/syscall.h>
+#endif
+
+// multishot receive and buffer rings need the Linux 6.0 headers
+#if defined(__linux__) && defined(__NR_io_uring_setup) && defined(IORING_RECV_MULTISHOT)
+#  define PROTORPC_HAVE_URING 1
+#endif
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+#if defined(PROTORPC_HAVE_URING)
+
+// operations of the loop itself, with a NULL handler
+static const int kWakeupOp = 4;
+static const int kCancelOp = 5;
+
+static const unsigned kRingEntries = 256;
+static const unsigned kBufCount = 64;  // power of two
+static const unsigned kBufSize = 16*1024;
+static const int kBufGroup = 0;
+
+struct UringLoop::Rep {
+  int ring_fd;
+
+  // submission queue
+  unsigned* sq_head;
+  unsigned* sq_tail;
+  unsigned* sq_array;
+  unsigned sq_mask;
+  unsigned sq_entries;
+  struct io_uring_sqe* sqes;
+  unsigned sqe_tail;   // queued, published to sq_tail by enter()
+  unsigned submitted;  // accepted by the kernel
+
+  // completion queue
+  unsigned* cq_head;
+  unsigned* cq_tail;
+  unsigned cq_mask;
+  struct io_uring_cqe* cqes;
+
+  void* sq_ring;
+  size_t sq_ring_size;
+  void* cq_ring;
+  size_t cq_ring_size;
+  size_t sqes_size;
+
+  // provided buffers of the multishot receives. The entries are addressed
+  // as a plain array: in C++ the flexible array of io_uring_buf_ring is
+  // preceded by a one byte empty struct, which shifts it by 8 bytes.
+  struct io_uring_buf* br;
+  size_t br_size;
+  unsigned short br_tail;
+  char* bufs;
+
+  uint64_t wakeup_value;
+
+  Rep(): ring_fd(-1), sq_head(NULL), sq_tail(NULL), sq_array(NULL),
+    sq_mask(0), sq_entries(0), sqes(NULL), sqe_tail(0), submitted(0),
+    cq_head(NULL), cq_tail(NULL), cq_mask(0), cqes(NULL),
+    sq_ring(NULL), sq_ring_size(0), cq_ring(NULL), cq_ring_size(0), sqes_size(0),
+    br(NULL), br_size(0), br_tail(0), bufs(NULL), wakeup_value(0) {
+  }
+
+  // Return the next free entry, NULL if the queue is full.
+  struct io_uring_sqe* getSqe() {
+    if(sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+      return NULL;
+    }
+    unsigned idx = sqe_tail & sq_mask;
+    struct io_uring_sqe* sqe = &sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array[idx] = idx;
+    sqe_tail++;
+    return sqe;
+  }
+
+  // Hand buffer bid back to the kernel.
+  void recycle(unsigned bid) {
+    struct io_uring_buf* b = &br[br_tail & (kBufCount - 1)];
+    b->addr = (uint64_t)(uintptr_t)(bufs + size_t(bid)*kBufSize);
+    b->len = kBufSize;
+    b->bid = (unsigned short)bid;
+    br_tail++;
+    // the ring tail overlays the resv field of the first entry
+    __atomic_store_n(&br[0].resv, br_tail, __ATOMIC_RELEASE);
+  }
+};
+
+static uint64_t userData(UringLoop::Handler* handler, int op) {
+  return (uint64_t)(uintptr_t)handler | uint64_t(op);
+}
+
+UringLoop::UringLoop(Env* env):
+  rep_(new Rep), wakeup_fd_(-1), wakeup_armed_(false), stopped_(false), env_(env) {
+  //
+}
+UringLoop::~UringLoop() {
+  // closing the ring cancels the operations still using the buffers
+  if(rep_->ring_fd >= 0) ::close(rep_->ring_fd);
+  if(rep_->bufs != NULL) delete[] rep_->bufs;
+  if(rep_->br != NULL) munmap(rep_->br, rep_->br_size);
+  if(rep_->sqes != NULL) munmap(rep_->sqes, rep_->sqes_size);
+  if(rep_->cq_ring != NULL && rep_->cq_ring != rep_->sq_ring) munmap(rep_->cq_ring, rep_->cq_ring_size);
+  if(rep_->sq_ring != NULL) munmap(rep_->sq_ring, rep_->sq_ring_size);
+  if(wakeup_fd_ >= 0) ::close(wakeup_fd_);
+  delete rep_;
+}
+
+bool UringLoop::Init() {
+  Rep* r = rep_;
+
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL;
+  p.cq_entries = kRingEntries*4;
+  r->ring_fd = int(syscall(__NR_io_uring_setup, kRingEntries, &p));
+  if(r->ring_fd < 0) {
+    if(env_ != NULL) env_->Logf("protorpc.UringLoop.Init: io_uring_setup failed, err = %d.\n", errno);
+    return false;
+  }
+
+  // IORING_OP_SEND_ZC came with multishot receive (Linux 6.0)
+  size_t probe_size = sizeof(struct io_uring_probe) + 256*sizeof(struct io_uring_probe_op);
+  struct io_uring_probe* probe = (struct io_uring_probe*)calloc(1, probe_size);
+  bool supported = (
+    syscall(__NR_io_uring_register, r->ring_fd, IORING_REGISTER_PROBE, probe, 256) == 0 &&
+    probe->last_op >= IORING_OP_SEND_ZC &&
+    (probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED) != 0
+  );
+  free(probe);
+  if(!supported) {
+    if(env_ != NULL) env_->Logf("protorpc.UringLoop.Init: kernel too old.\n");
+    return false;
+  }
+
+  // map the rings
+  r->sq_ring_size = p.sq_off.array + p.sq_entries*sizeof(unsigned);
+  r->cq_ring_size = p.cq_off.cqes + p.cq_entries*sizeof(struct io_uring_cqe);
+  if(p.features & IORING_FEAT_SINGLE_MMAP) {
+    if(r->cq_ring_size > r->sq_ring_size) r->sq_ring_size = r->cq_ring_size;
+    r->cq_ring_size = r->sq_ring_size;
+  }
+  r->sq_ring = mmap(NULL, r->sq_ring_size, PROT_READ|PROT_WRITE,
+    MAP_SHARED|MAP_POPULATE, r->ring_fd, IORING_OFF_SQ_RING
+  );
+  if(r->sq_ring == MAP_FAILED) {
+    r->sq_ring = NULL;
+    if(env_ != NULL) env_->Logf("protorpc.UringLoop.Init: mmap failed, err = %d.\n", errno);
+    return false;
+  }
+  if(p.features & IORING_FEAT_SINGLE_MMAP) {
+    r->cq_ring = r->sq_ring;
+  } else {
+    r->cq_ring = mmap(NULL, r->cq_ring_size, PROT_READ|PROT_WRITE,
+      MAP_SHARED|MAP_POPULATE, r->ring_fd, IORING_OFF_CQ_RING
+    );
+    if(r->cq_ring == MAP_FAILED) {
+      r->cq_ring = NULL;
+      if(env_ != NULL) env_->Logf("protorpc.UringLoop.Init: mmap failed, err = %d.\n", errno);
+      return false;
+    }
+  }
+  r->sqes_size = p.sq_entries*sizeof(struct io_uring_sqe);
+  r->sqes = (struct io_uring_sqe*)mmap(NULL, r->sqes_size, PROT_READ|PROT_WRITE,
+    MAP_SHARED|MAP_POPULATE, r->ring_fd, IORING_OFF_SQES
+  );
+  if(r->sqes == MAP_FAILED) {
+    r->sqes = NULL;
+    if(env_ != NULL) env_->Logf("protorpc.UringLoop.Init: mmap failed, err = %d.\n", errno);
+    return false;
+  }
+
+  char* sq = (char*)r->sq_ring;
+  r->sq_head = (unsigned*)(sq + p.sq_off.head);
+  r->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+  r->sq_array = (unsigned*)(sq + p.sq_off.array);
+  r->sq_mask = *(unsigned*)(sq + p.sq_off.ring_mask);
+  r->sq_entries = p.sq_entries;
+  r->sqe_tail = r->submitted = *r->sq_tail;
+
+  char* cq = (char*)r->cq_ring;
+  r->cq_head = (unsigned*)(cq + p.cq_off.head);
+  r->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+  r->cq_mask = *(unsigned*)(cq + p.cq_off.ring_mask);
+  r->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+
+  // register the receive buffers
+  r->br_size = kBufCount*sizeof(struct io_uring_buf);
+  r->br = (struct io_uring_buf*)mmap(NULL, r->br_size, PROT_READ|PROT_WRITE,
+    MAP_PRIVATE|MAP_ANONYMOUS, -1, 0
+  );
+  if(r->br == MAP_FAILED) {
+    r->br = NULL;
+    if(env_ != NULL) env_->Logf("protorpc.UringLoop.Init: mmap failed, err = %d.\n", errno);
+    return false;
+  }
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (uint64_t)(uintptr_t)r->br;
+  reg.ring_entries = kBufCount;
+  reg.bgid = kBufGroup;
+  if(syscall(__NR_io_uring_register, r->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+    if(env_ != NULL) env_->Logf("protorpc.UringLoop.Init: buffer ring failed, err = %d.\n", errno);
+    return false;
+  }
+  r->bufs = new char[size_t(kBufCount)*kBufSize];
+  for(unsigned i = 0; i < kBufCount; i++) {
+    r->recycle(i);
+  }
+
+  if((wakeup_fd_ = eventfd(0, EFD_CLOEXEC)) < 0) {
+    if(env_ != NULL) env_->Logf("protorpc.UringLoop.Init: eventfd failed, err = %d.\n", errno);
+    return false;
+  }
+  if(!armWakeup()) {
+    if(env_ != NULL) env_->Logf("protorpc.UringLoop.Init: arm wakeup failed.\n");
+    return false;
+  }
+  return true;
+}
+
+// Queue an entry, flushing the queue to the kernel when it is full.
+#define URING_GET_SQE(sqe) \
+  struct io_uring_sqe* sqe = rep_->getSqe(); \
+  if(sqe == NULL) { \
+    if(!enter(0) || (sqe = rep_->getSqe()) == NULL) return false; \
+  }
+
+bool UringLoop::Accept(int fd, Handler* handler) {
+  URING_GET_SQE(sqe);
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = fd;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_CLOEXEC;
+  sqe->user_data = userData(handler, kAccept);
+  return true;
+}
+
+bool UringLoop::Recv(int fd, Handler* handler) {
+  URING_GET_SQE(sqe);
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fd;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = kBufGroup;
+  sqe->user_data = userData(handler, kRecv);
+  return true;
+}
+
+bool UringLoop::Send(int fd, const void* buf, size_t len, Handler* handler) {
+  URING_GET_SQE(sqe);
+  sqe->opcode = IORING_OP_SEND;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t)(uintptr_t)buf;
+  sqe->len = unsigned(len);
+  sqe->msg_flags = MSG_NOSIGNAL;
+  sqe->user_data = userData(handler, kSend);
+  return true;
+}
+
+bool UringLoop::Cancel(Handler* handler, int op) {
+  URING_GET_SQE(sqe);
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = userData(handler, op);
+  sqe->user_data = userData(NULL, kCancelOp);
+  return true;
+}
+
+bool UringLoop::armWakeup() {
+  URING_GET_SQE(sqe);
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = wakeup_fd_;
+  sqe->addr = (uint64_t)(uintptr_t)&rep_->wakeup_value;
+  sqe->len = sizeof(rep_->wakeup_value);
+  sqe->user_data = userData(NULL, kWakeupOp);
+  wakeup_armed_ = true;
+  return true;
+}
+
+#undef URING_GET_SQE
+
+void UringLoop::Post(void (*function)(void* arg), void* arg) {
+  {
+    MutexLock locker(&mutex_);
+    Task task = { function, arg };
+    posted_.push_back(task);
+  }
+  uint64_t v = 1;
+  ssize_t n = ::write(wakeup_fd_, &v, sizeof(v));
+  (void)n;
+}
+
+void UringLoop::runPosted() {
+  std::vector<Task> tasks;
+  {
+    MutexLock locker(&mutex_);
+    tasks.swap(posted_);
+  }
+  for(size_t i = 0; i < tasks.size(); i++) {
+    tasks[i].function(tasks[i].arg);
+  }
+}
+
+bool UringLoop::enter(unsigned min_complete) {
+  Rep* r = rep_;
+  __atomic_store_n(r->sq_tail, r->sqe_tail, __ATOMIC_RELEASE);
+  unsigned to_submit = r->sqe_tail - r->submitted;
+  unsigned flags = (min_complete > 0)? IORING_ENTER_GETEVENTS: 0;
+  if(to_submit == 0 && min_complete == 0) {
+    return true;
+  }
+  long n = syscall(__NR_io_uring_enter, r->ring_fd, to_submit, min_complete, flags, NULL, 0);
+  if(n < 0) {
+    // EBUSY: the completion queue is full, reap first
+    if(errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+      return true;
+    }
+    if(env_ != NULL) env_->Logf("protorpc.UringLoop.enter: io_uring_enter failed, err = %d.\n", errno);
+    return false;
+  }
+  r->submitted += unsigned(n);
+  return true;
+}
+
+void UringLoop::reap() {
+  Rep* r = rep_;
+  unsigned head = *r->cq_head;
+  for(;;) {
+    if(head == __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+      break;
+    }
+    struct io_uring_cqe cqe = r->cqes[head & r->cq_mask];
+    head++;
+    __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+
+    int op = int(cqe.user_data & 7);
+    Handler* handler = (Handler*)(uintptr_t)(cqe.user_data & ~uint64_t(7));
+    if(handler == NULL) {
+      if(op == kWakeupOp) {
+        wakeup_armed_ = false;
+        runPosted();
+        if(!stopped_) {
+          armWakeup();  // else rearmed by Run
+        }
+      }
+      continue;
+    }
+
+    const char* data = NULL;
+    int bid = -1;
+    if(cqe.flags & IORING_CQE_F_BUFFER) {
+      bid = int(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+      data = r->bufs + size_t(bid)*kBufSize;
+    }
+    handler->OnComplete(op, cqe.res, data, (cqe.flags & IORING_CQE_F_MORE) != 0);
+    if(bid >= 0) {
+      r->recycle(unsigned(bid));
+    }
+  }
+}
+
+void UringLoop::Run() {
+  while(!stopped_) {
+    if(!wakeup_armed_ && !armWakeup()) {
+      // the queue is still full, flush it and reap before waiting
+      if(!enter(0)) {
+        return;
+      }
+      reap();
+      continue;
+    }
+    if(!enter(1)) {
+      return;
+    }
+    reap();
+  }
+}
+
+void UringLoop::Stop() {
+  stopped_ = true;
+  if(wakeup_fd_ >= 0) {
+    uint64_t v = 1;
+    ssize_t n = ::write(wakeup_fd_, &v, sizeof(v));
+    (void)n;
+  }
+}
+
+#else  // !defined(PROTORPC_HAVE_URING)
+
+struct UringLoop::Rep {
+};
+
+UringLoop::UringLoop(Env* env):
+  rep_(NULL), wakeup_fd_(-1), wakeup_armed_(false), stopped_(false), env_(env) {
+  //
+}
+UringLoop::~UringLoop() {
+  //
+}
+
+bool UringLoop::Init() {
+  return false;
+}
+
+bool UringLoop::Accept(int fd, Handler* handler) {
+  return false;
+}
+bool UringLoop::Recv(int fd, Handler* handler) {
+  return false;
+}
+bool UringLoop::Send(int fd, const void* buf, size_t len, Handler* handler) {
+  return false;
+}
+bool UringLoop::Cancel(Handler* handler, int op) {
+  return false;
+}
+
+void UringLoop::Post(void (*function)(void* arg), void* arg) {
+  //
+}
+
+void UringLoop::Run() {
+  //
+}
+void UringLoop::Stop() {
+  stopped_ = true;
+}
+
+#endif  // defined(PROTORPC_HAVE_URING)
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,55 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "google/protobuf/rpc/rpc_uring_loop.h"
+
+namespace google {
+namespace protobuf {
+namespace rpc {
+
+// io_uring is Linux only, Init() returns false and callers fall back to
+// the other modes.
+
+struct UringLoop::Rep {
+};
+
+UringLoop::UringLoop(Env* env):
+  rep_(NULL), wakeup_fd_(-1), wakeup_armed_(false), stopped_(false), env_(env) {
+  //
+}
+UringLoop::~UringLoop() {
+  //
+}
+
+bool UringLoop::Init() {
+  return false;
+}
+
+bool UringLoop::Accept(int fd, Handler* handler) {
+  return false;
+}
+bool UringLoop::Recv(int fd, Handler* handler) {
+  return false;
+}
+bool UringLoop::Send(int fd, const void* buf, size_t len, Handler* handler) {
+  return false;
+}
+bool UringLoop::Cancel(Handler* handler, int op) {
+  return false;
+}
+
+void UringLoop::Post(void (*function)(void* arg), void* arg) {
+  //
+}
+
+void UringLoop::Run() {
+  //
+}
+void UringLoop::Stop() {
+  stopped_ = true;
+}
+
+}  // namespace rpc
+}  // namespace protobuf
+}  // namespace google
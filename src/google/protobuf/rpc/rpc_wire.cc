@@ -4,131 +4,768 @@
 
 #include <google/protobuf/rpc/rpc_wire.h>
 #include <google/protobuf/rpc/rpc_crc32.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream.h>
+#include <google/protobuf/stubs/defer.h>
 
 #include <snappy.h>
+#include <snappy-sinksource.h>
+
+#include <limits.h>
+#include <string.h>
+#include <algorithm>
 
 namespace google {
 namespace protobuf {
 namespace rpc {
 namespace wire {
 
-Error SendRequest(Conn* conn,
-  uint64_t id, const std::string& serviceMethod,
-  const ::google::protobuf::Message* request
-) {
-  // marshal request
-  std::string pbRequest;
-  if(request != NULL) {
-    if(!request->SerializeToString(&pbRequest)) {
-      return Error::New("protorpc.SendRequest: SerializeToString failed.");
+// Bodies are serialized and uncompressed in buffers per thread which stay
+// allocated (up to kMaxScratchLen) for the next ones.
+static const size_t kMaxScratchLen = 16*1024*1024;
+static thread_local std::string serializeBuf;
+static thread_local std::string uncompressBuf;
+
+// The body is checksummed in chunks while snappy (or a copy) goes over
+// it, each chunk is still in the cache.
+static const size_t kChunkLen = 64*1024;
+
+static inline uint32 extendChecksum(bool crc32c, uint32 crc, const char* data, size_t n) {
+  return crc32c? ExtendCRC32C(crc, data, n): ExtendCRC32(crc, data, n);
+}
+
+// Snappy sink appending to a string and checksumming the compressed
+// blocks as they are emitted. The string is reserved, not resized, for
+// the longest output: snappy compresses each block into its scratch
+// buffer and only the bytes emitted are copied, none zero-filled.
+class ChecksumSink: public snappy::Sink {
+ public:
+  ChecksumSink(std::string* out, size_t max_len, bool crc32c):
+    out_(out), crc32c_(crc32c), crc_(0) {
+    out_->clear();
+    out_->reserve(max_len);
+  }
+
+  virtual void Append(const char* bytes, size_t n) {
+    size_t len = out_->size();
+    out_->append(bytes, n);
+    crc_ = extendChecksum(crc32c_, crc_, out_->data() + len, n);
+  }
+
+  // Return the checksum of the output.
+  uint32 Finish() {
+    return crc_;
+  }
+
+ private:
+  std::string* out_;
+  bool crc32c_;
+  uint32 crc_;
+};
+
+// Snappy source over a compressed body, checksumming each chunk once
+// snappy has consumed it.
+class ChecksumSource: public snappy::Source {
+ public:
+  ChecksumSource(const char* data, size_t len, bool check, bool crc32c):
+    data_(data), left_(len), check_(check), crc32c_(crc32c), crc_(0) {}
+
+  virtual size_t Available() const { return left_; }
+  virtual const char* Peek(size_t* len) {
+    *len = std::min(left_, kChunkLen);
+    return data_;
+  }
+  virtual void Skip(size_t n) {
+    if(check_) {
+      crc_ = extendChecksum(crc32c_, crc_, data_, n);
     }
+    data_ += n;
+    left_ -= n;
   }
 
-  // compress serialized proto data
-  std::string compressedPbRequest;
-  snappy::Compress(pbRequest.data(), pbRequest.size(), &compressedPbRequest);
+  // Checksum all the data, also what snappy did not consume.
+  uint32 Finish() {
+    Skip(left_);
+    return crc_;
+  }
 
-  // generate header
-  RequestHeader header;
+ private:
+  const char* data_;
+  size_t left_;
+  bool check_;
+  bool crc32c_;
+  uint32 crc_;
+};
 
-  header.set_id(id);
-  header.set_method(serviceMethod);
+static void releaseScratch(std::string* buf) {
+  if(buf->capacity() > kMaxScratchLen) {
+    std::string().swap(*buf);
+  }
+}
+
+const char kHandshakeMethod[] = "protorpc.Handshake";
+const char kPingMethod[] = "protorpc.Ping";
+
+bool IsPing(const RequestHeader& header, int version) {
+  if(header.stream() != STREAM_NONE) {
+    return false;
+  }
+  return (version == kProtocolV2)?
+    header.method_id() == kPingMethodId:
+    header.method() == kPingMethod;
+}
 
-  header.set_raw_request_len(pbRequest.size());
-  header.set_snappy_compressed_request_len(compressedPbRequest.size());
-  header.set_checksum(HashCRC32(compressedPbRequest.data(), compressedPbRequest.size()));
+// Fixed part of the v2 header frames (see wire.proto).
+static const size_t kHeaderV2Len = 28;
 
-  // check header size
-  std::string pbHeader;
-  if(!header.SerializeToString(&pbHeader)) {
-    return Error::New("protorpc.SendRequest: SerializeToString failed.");
+static void put32(char* p, uint32 v) {
+  for(int i = 0; i < 4; i++) {
+    p[i] = char(v >> (8*i));
   }
-  if(pbHeader.size() > Const::default_instance().max_header_len()) {
-    return Error::New("protorpc.SendRequest: header larger than max_header_len.");
+}
+static void put64(char* p, uint64 v) {
+  put32(p, uint32(v));
+  put32(p + 4, uint32(v >> 32));
+}
+static uint32 get32(const char* p) {
+  const uint8* b = (const uint8*)p;
+  return uint32(b[0]) | (uint32(b[1]) << 8) | (uint32(b[2]) << 16) | (uint32(b[3]) << 24);
+}
+static uint64 get64(const char* p) {
+  return uint64(get32(p)) | (uint64(get32(p + 4)) << 32);
+}
+
+// v1 bodies are always checksummed and compressed.
+static const uint32 kFlagsV1 = FLAG_CHECKSUM | FLAG_COMPRESSED;
+
+Error EncodeRequestHeader(const RequestHeader& header, int version, std::string* out) {
+  if(version != kProtocolV2) {
+    if(!header.SerializeToString(out)) {
+      return Error::New("protorpc.SendRequest: SerializeToString failed.");
+    }
+    if(out->size() > Const::default_instance().max_header_len()) {
+      return Error::New("protorpc.SendRequest: header larger than max_header_len.");
+    }
+    return Error::Nil();
   }
+  out->resize(kHeaderV2Len);
+  char* p = &(*out)[0];
+  p[0] = char(kProtocolV2);
+  p[1] = char(header.flags());
+  p[2] = char(header.stream());
+  p[3] = 0;
+  put32(p + 4, header.method_id());
+  put64(p + 8, header.id());
+  put32(p + 16, header.raw_request_len());
+  put32(p + 20, (header.stream() == STREAM_WINDOW)? header.window(): header.timeout_ms());
+  put32(p + 24, header.checksum());
+  return Error::Nil();
+}
 
-  // send header
-  if(!conn->SendFrame(&pbHeader)) {
-    return Error::New("protorpc.SendRequest: SendFrame header failed.");
+Error DecodeRequestHeader(const char* data, size_t len, int version, RequestHeader* header) {
+  if(version != kProtocolV2) {
+    if(!header->ParseFromArray(data, int(len))) {
+      return Error::New("protorpc.RecvRequestHeader: ParseFromString failed.");
+    }
+    return Error::Nil();
   }
+  if(len != kHeaderV2Len || data[0] != char(kProtocolV2) || !StreamFrame_IsValid(uint8(data[2]))) {
+    return Error::New("protorpc.RecvRequestHeader: bad v2 header.");
+  }
+  header->Clear();
+  header->set_flags(uint8(data[1]));
+  header->set_method_id(get32(data + 4));
+  header->set_id(get64(data + 8));
+  header->set_raw_request_len(get32(data + 16));
+  if(data[2] != 0) {
+    header->set_stream(StreamFrame(uint8(data[2])));
+  }
+  if(header->stream() == STREAM_WINDOW) {
+    header->set_window(get32(data + 20));
+  } else if(uint32 timeoutMs = get32(data + 20)) {
+    header->set_timeout_ms(timeoutMs);
+  }
+  header->set_checksum(get32(data + 24));
+  return Error::Nil();
+}
 
-  // send body
-  if(!conn->SendFrame(&compressedPbRequest)) {
-    return Error::New("protorpc.SendRequest: SendFrame body failed.");
+Error EncodeResponseHeader(const ResponseHeader& header, int version, std::string* out) {
+  if(version != kProtocolV2) {
+    if(!header.SerializeToString(out)) {
+      return Error::New("protorpc.SendResponse: SerializeToString failed.");
+    }
+    if(out->size() > Const::default_instance().max_header_len()) {
+      return Error::New("protorpc.SendResponse: header larger than max_header_len.");
+    }
+    return Error::Nil();
   }
+  const std::string& error = header.error();
+  if(kHeaderV2Len + error.size() > Const::default_instance().max_header_len()) {
+    return Error::New("protorpc.SendResponse: header larger than max_header_len.");
+  }
+  out->resize(kHeaderV2Len);
+  char* p = &(*out)[0];
+  p[0] = char(kProtocolV2);
+  p[1] = char(header.flags());
+  p[2] = char(header.stream());
+  p[3] = 0;
+  put32(p + 4, uint32(error.size()));
+  put64(p + 8, header.id());
+  put32(p + 16, header.raw_response_len());
+  put32(p + 20, header.window());
+  put32(p + 24, header.checksum());
+  out->append(error);
+  return Error::Nil();
+}
 
+Error DecodeResponseHeader(const char* data, size_t len, int version, ResponseHeader* header) {
+  if(version != kProtocolV2) {
+    if(!header->ParseFromArray(data, int(len))) {
+      return Error::New("protorpc.RecvResponseHeader: ParseFromString failed.");
+    }
+    return Error::Nil();
+  }
+  if(len < kHeaderV2Len || data[0] != char(kProtocolV2) ||
+    !StreamFrame_IsValid(uint8(data[2])) || get32(data + 4) != len - kHeaderV2Len) {
+    return Error::New("protorpc.RecvResponseHeader: bad v2 header.");
+  }
+  header->Clear();
+  header->set_flags(uint8(data[1]));
+  header->set_id(get64(data + 8));
+  header->set_raw_response_len(get32(data + 16));
+  if(data[2] != 0) {
+    header->set_stream(StreamFrame(uint8(data[2])));
+  }
+  if(uint32 window = get32(data + 20)) {
+    header->set_window(window);
+  }
+  header->set_checksum(get32(data + 24));
+  if(len > kHeaderV2Len) {
+    header->set_error(data + kHeaderV2Len, len - kHeaderV2Len);
+  }
   return Error::Nil();
 }
 
-Error RecvRequestHeader(Conn* conn,
-  RequestHeader* header
+// Longest a snappy body of len bytes uncompresses to: its densest
+// element is a 3 bytes copy of 64 bytes.
+static inline uint64 maxUncompressedLen(size_t len) {
+  return uint64(len)*22;
+}
+
+// Decode a body frame with the checksum and compression of flags, up to
+// maxLen raw bytes (0: kDefaultMaxBodyLen).
+static Error decodeBody(const char* errPrefix, uint32 flags, uint32 checksum, uint32 rawLen,
+  uint32 maxLen,
+  const char* data, size_t len,
+  ::google::protobuf::Message* msg
 ) {
-  // recv header
-  std::string pbHeader;
-  if(!conn->RecvFrame(&pbHeader)) {
-    return Error::New("protorpc.RecvRequestHeader: RecvFrame failed.");
+  if(maxLen == 0) {
+    maxLen = kDefaultMaxBodyLen;
   }
-  if(pbHeader.size() > Const::default_instance().max_header_len()) {
-    return Error::New("protorpc.RecvRequestHeader: RecvFrame larger than max_header_len.");
+  const bool check = (flags & FLAG_CHECKSUM) != 0;
+  const bool crc32c = (flags & FLAG_CRC32C) != 0;
+  if((flags & FLAG_CHUNKED) != 0) {
+    return Error::New(std::string(errPrefix) + ": chunked body not supported.");
+  }
+  if((flags & FLAG_COMPRESSED) == 0) {
+    if(len > maxLen) {
+      return Error::New(std::string(errPrefix) + ": body too long.");
+    }
+    if(check && extendChecksum(crc32c, 0, data, len) != checksum) {
+      return Error::New(std::string(errPrefix) + ": Unexpected checksum.");
+    }
+    if(len != rawLen) {
+      return Error::New(std::string(errPrefix) + ": Unexcpeted raw msg len.");
+    }
+    if(!msg->ParseFromArray(data, int(len))) {
+      return Error::New(std::string(errPrefix) + ": ParseFromString failed.");
+    }
+    return Error::Nil();
   }
 
-  // Marshal Header
-  if(!header->ParseFromString(pbHeader)) {
-    return Error::New("protorpc.RecvRequestHeader: ParseFromString failed.");
+  // decode the compressed data, checksummed on the way
+  size_t n;
+  if(!snappy::GetUncompressedLength(data, len, &n)) {
+    return Error::New(std::string(errPrefix) + ": snappy::Uncompress failed.");
+  }
+  // n is the peer's word, bound it before sizing the buffer
+  if(n > maxLen || n > maxUncompressedLen(len)) {
+    return Error::New(std::string(errPrefix) + ": body too long.");
+  }
+  // check wire header: rawMsgLen
+  if(n != rawLen) {
+    return Error::New(std::string(errPrefix) + ": Unexcpeted raw msg len.");
+  }
+  if(uncompressBuf.size() < n) {
+    uncompressBuf.resize(n);
+  }
+  defer([&](){ releaseScratch(&uncompressBuf); });
+  bool ok;
+  if(len <= kChunkLen) {
+    if(check && extendChecksum(crc32c, 0, data, len) != checksum) {
+      return Error::New(std::string(errPrefix) + ": Unexpected checksum.");
+    }
+    ok = snappy::RawUncompress(data, len, &uncompressBuf[0]);
+  } else {
+    ChecksumSource source(data, len, check, crc32c);
+    ok = snappy::RawUncompress(&source, &uncompressBuf[0]);
+    if(check && source.Finish() != checksum) {
+      return Error::New(std::string(errPrefix) + ": Unexpected checksum.");
+    }
+  }
+  if(!ok) {
+    return Error::New(std::string(errPrefix) + ": snappy::Uncompress failed.");
   }
 
+  // marshal message
+  if(!msg->ParseFromArray(uncompressBuf.data(), int(n))) {
+    return Error::New(std::string(errPrefix) + ": ParseFromString failed.");
+  }
   return Error::Nil();
 }
 
-Error RecvRequestBody(Conn* conn,
-  const RequestHeader* header,
-  ::google::protobuf::Message* request
+// Bodies of at least kProbeMinLen are probed by compressing kProbeLen
+// bytes of their middle, they are sent raw unless it saves 1/8.
+static const size_t kProbeLen = 2048;
+static const size_t kProbeMinLen = 16*1024;
+
+bool ShouldCompress(const Compression* compression, const char* data, size_t len) {
+  if(compression == NULL) {
+    return true;
+  }
+  if(!compression->enabled || len < compression->min_len) {
+    return false;
+  }
+  if(!compression->probe || len < kProbeMinLen) {
+    return true;
+  }
+  char buf[32 + kProbeLen + kProbeLen/6];
+  GOOGLE_DCHECK_LE(snappy::MaxCompressedLength(kProbeLen), sizeof(buf));
+  size_t n;
+  snappy::RawCompress(data + (len - kProbeLen)/2, kProbeLen, buf, &n);
+  return n <= kProbeLen - kProbeLen/8;
+}
+
+// Compress raw into body under the policy (always on v1) or copy it, and
+// checksum it in the same pass. Return the header flags.
+static uint32 encodeBody(int version, const Compression* compression, bool crc32c,
+  const std::string& raw, std::string* body, uint32* checksum
 ) {
-  // recv body
-  std::string compressedPbRequest;
-  if(!conn->RecvFrame(&compressedPbRequest)) {
-    return Error::New("protorpc.RecvRequestBody: RecvFrame failed.");
+  const uint32 flags = FLAG_CHECKSUM | (crc32c? FLAG_CRC32C: 0);
+  if(version == kProtocolV2 && !ShouldCompress(compression, raw.data(), raw.size())) {
+    uint32 crc = 0;
+    body->clear();
+    body->reserve(raw.size());
+    for(size_t i = 0; i < raw.size(); i += kChunkLen) {
+      size_t n = std::min(kChunkLen, raw.size() - i);
+      body->append(raw.data() + i, n);
+      crc = extendChecksum(crc32c, crc, body->data() + i, n);
+    }
+    *checksum = crc;
+    return flags;
+  }
+  if(raw.size() <= kChunkLen) {
+    snappy::Compress(raw.data(), raw.size(), body);
+    *checksum = extendChecksum(crc32c, 0, body->data(), body->size());
+    return flags | FLAG_COMPRESSED;
   }
+  snappy::ByteArraySource source(raw.data(), raw.size());
+  ChecksumSink sink(body, snappy::MaxCompressedLength(raw.size()), crc32c);
+  snappy::Compress(&source, &sink);
+  *checksum = sink.Finish();
+  return flags | FLAG_COMPRESSED;
+}
+
+// Append a frame (uvarint length + data) to out.
+static void appendFrame(std::string* out, const std::string& data) {
+  uint8 buf[10];
+  int n = PutUvarint(buf, uint64(data.size()));
+  out->append((const char*)buf, n);
+  out->append(data);
+}
+
+// Chunk frames: flags:1 0:3 checksum:4 data, see wire.proto.
+static const size_t kChunkHeaderLen = 8;
+
+bool IsChunkedBody(const ::google::protobuf::Message* msg) {
+  return msg != NULL && uint32(msg->ByteSize()) >= kChunkedBodyMinLen;
+}
 
-  // checksum
-  uint32_t checksum = HashCRC32(compressedPbRequest.data(), compressedPbRequest.size());
-  if(checksum != header->checksum()) {
-    return Error::New("protorpc.RecvRequestBody: Unexpected checksum.");
+// Output stream of a chunked body: the serialized message is cut in
+// chunks of kBodyChunkLen, each one compressed under the policy (or
+// not), checksummed and written to the connection. The header frame is
+// written with the first chunk.
+class ChunkedOutputStream: public io::ZeroCopyOutputStream {
+ public:
+  ChunkedOutputStream(Conn* conn, const std::string* header,
+    const Compression* compression, bool crc32c):
+    conn_(conn), header_(header), compression_(compression), crc32c_(crc32c),
+    ok_(true), len_(0), count_(0) {
+    raw_.resize(kBodyChunkLen);
   }
 
-  // decode the compressed data
-  std::string pbRequest;
-  if(!snappy::Uncompress(compressedPbRequest.data(), compressedPbRequest.size(), &pbRequest)) {
-    return Error::New("protorpc.RecvRequestBody: snappy::Uncompress failed.");
+  // implements ZeroCopyOutputStream
+  virtual bool Next(void** data, int* size) {
+    if(len_ == raw_.size() && !flush(false)) {
+      return false;
+    }
+    *data = &raw_[len_];
+    *size = int(raw_.size() - len_);
+    count_ += raw_.size() - len_;
+    len_ = raw_.size();
+    return true;
   }
-  // check wire header: rawMsgLen
-  if(pbRequest.size() != header->raw_request_len()) {
-    return Error::New("protorpc.RecvRequestBody: Unexcpeted raw msg len.");
+  virtual void BackUp(int count) {
+    len_ -= size_t(count);
+    count_ -= count;
+  }
+  virtual int64 ByteCount() const {
+    return count_;
   }
 
-  // marshal request
-  if(!request->ParseFromString(pbRequest)) {
-    return Error::New("protorpc.RecvRequestBody: ParseFromString failed.");
+  // Write the last chunk and the end frame.
+  bool Finish() {
+    return flush(true);
+  }
+
+ private:
+  bool flush(bool last) {
+    if(!ok_) {
+      return false;
+    }
+    uint8 lens[3][10];
+    IoVec iov[6];
+    int n = 0;
+    if(header_ != NULL) {
+      iov[n].base = lens[0];
+      iov[n++].len = PutUvarint(lens[0], uint64(header_->size()));
+      iov[n].base = header_->data();
+      iov[n++].len = header_->size();
+      header_ = NULL;
+    }
+    if(len_ != 0) {
+      const char* data = raw_.data();
+      size_t dataLen = len_;
+      chunk_[0] = 0;
+      if(ShouldCompress(compression_, raw_.data(), len_)) {
+        if(compressed_.empty()) {
+          compressed_.resize(snappy::MaxCompressedLength(kBodyChunkLen));
+        }
+        snappy::RawCompress(raw_.data(), len_, &compressed_[0], &dataLen);
+        data = compressed_.data();
+        chunk_[0] = char(FLAG_COMPRESSED);
+      }
+      chunk_[1] = chunk_[2] = chunk_[3] = 0;
+      put32(chunk_ + 4, extendChecksum(crc32c_, 0, data, dataLen));
+      iov[n].base = lens[1];
+      iov[n++].len = PutUvarint(lens[1], uint64(kChunkHeaderLen + dataLen));
+      iov[n].base = chunk_;
+      iov[n++].len = kChunkHeaderLen;
+      iov[n].base = data;
+      iov[n++].len = dataLen;
+      len_ = 0;
+    }
+    if(last) {
+      iov[n].base = lens[2];
+      iov[n++].len = PutUvarint(lens[2], 0);
+    }
+    ok_ = conn_->Writev(iov, n);
+    return ok_;
+  }
+
+  Conn* conn_;
+  const std::string* header_;  // not written yet
+  const Compression* compression_;
+  bool crc32c_;
+  bool ok_;
+
+  std::string raw_;
+  size_t len_;
+  std::string compressed_;
+  char chunk_[kChunkHeaderLen];
+  int64 count_;
+};
+
+// Input stream of a chunked body, reading the chunk frames from the
+// connection as the parser goes: raw chunks are returned from the
+// connection buffer, compressed ones are uncompressed in uncompressBuf.
+class ChunkedInputStream: public io::ZeroCopyInputStream {
+ public:
+  ChunkedInputStream(const char* errPrefix, Conn* conn, bool crc32c):
+    errPrefix_(errPrefix), conn_(conn), crc32c_(crc32c),
+    peeked_(-1), data_(NULL), len_(0), backup_(0), count_(0), done_(false) {}
+  ~ChunkedInputStream() {
+    release();
+  }
+
+  // implements ZeroCopyInputStream
+  virtual bool Next(const void** data, int* size) {
+    if(backup_ > 0) {
+      *data = data_ + len_ - backup_;
+      *size = backup_;
+      count_ += backup_;
+      backup_ = 0;
+      return true;
+    }
+    while(nextChunk()) {
+      if(len_ > 0) {
+        *data = data_;
+        *size = len_;
+        count_ += len_;
+        return true;
+      }
+    }
+    return false;
+  }
+  virtual void BackUp(int count) {
+    backup_ = count;
+    count_ -= count;
+  }
+  virtual bool Skip(int count) {
+    const void* data;
+    int size;
+    while(count > 0 && Next(&data, &size)) {
+      if(size > count) {
+        BackUp(size - count);
+        size = count;
+      }
+      count -= size;
+    }
+    return count == 0;
+  }
+  virtual int64 ByteCount() const {
+    return count_;
+  }
+
+  // Read up to the end frame, return the first error.
+  Error Finish() {
+    backup_ = 0;
+    while(nextChunk()) {
+    }
+    return err_;
+  }
+
+ private:
+  // Consume the last chunk frame, receive the next one.
+  bool nextChunk() {
+    release();
+    backup_ = 0;
+    len_ = 0;
+    if(done_ || !err_.IsNil()) {
+      return false;
+    }
+    const char* p = conn_->PeekFrame(&peeked_, kChunkHeaderLen + snappy::MaxCompressedLength(kBodyChunkLen));
+    if(p == NULL) {
+      peeked_ = -1;
+      return fail("RecvFrame failed.");
+    }
+    if(peeked_ == 0) {
+      done_ = true;
+      return false;
+    }
+    if(size_t(peeked_) < kChunkHeaderLen) {
+      return fail("bad chunk.");
+    }
+    const char* data = p + kChunkHeaderLen;
+    size_t dataLen = size_t(peeked_) - kChunkHeaderLen;
+    if(extendChecksum(crc32c_, 0, data, dataLen) != get32(p + 4)) {
+      return fail("Unexpected checksum.");
+    }
+    if((p[0] & FLAG_COMPRESSED) == 0) {
+      if(dataLen > kBodyChunkLen) {
+        return fail("bad chunk.");
+      }
+      data_ = data;
+      len_ = int(dataLen);
+      return true;
+    }
+    size_t n;
+    if(!snappy::GetUncompressedLength(data, dataLen, &n) || n > kBodyChunkLen) {
+      return fail("snappy::Uncompress failed.");
+    }
+    if(uncompressBuf.size() < kBodyChunkLen) {
+      uncompressBuf.resize(kBodyChunkLen);
+    }
+    if(!snappy::RawUncompress(data, dataLen, &uncompressBuf[0])) {
+      return fail("snappy::Uncompress failed.");
+    }
+    release();
+    data_ = uncompressBuf.data();
+    len_ = int(n);
+    return true;
+  }
+  void release() {
+    if(peeked_ >= 0) {
+      conn_->Consume(peeked_);
+      peeked_ = -1;
+    }
+  }
+  bool fail(const char* msg) {
+    err_ = Error::New(std::string(errPrefix_) + ": " + msg);
+    return false;
   }
 
+  const char* errPrefix_;
+  Conn* conn_;
+  bool crc32c_;
+
+  int peeked_;  // length of the frame in the connection buffer, -1: none
+  const char* data_;
+  int len_;
+  int backup_;
+  int64 count_;
+  bool done_;
+  Error err_;
+};
+
+// Send the header frame and msg as a chunked body.
+static Error sendChunkedBody(const char* errPrefix, Conn* conn, const std::string* pbHeader,
+  const ::google::protobuf::Message* msg,
+  const Compression* compression, bool crc32c
+) {
+  ChunkedOutputStream out(conn, pbHeader, compression, crc32c);
+  {
+    // the sizes were cached by IsChunkedBody
+    io::CodedOutputStream coded(&out);
+    msg->SerializeWithCachedSizes(&coded);
+    if(coded.HadError()) {
+      return Error::New(std::string(errPrefix) + ": SendFrames failed.");
+    }
+  }
+  if(!out.Finish()) {
+    return Error::New(std::string(errPrefix) + ": SendFrames failed.");
+  }
   return Error::Nil();
 }
 
-Error SendResponse(Conn* conn,
-  uint64_t id, const std::string& error,
-  const ::google::protobuf::Message* response
+// Receive a body frame, or the chunk frames of FLAG_CHUNKED, into msg
+// (NULL: skip it).
+static Error recvBody(const char* errPrefix, Conn* conn,
+  uint32 flags, uint32 checksum, uint32 rawLen,
+  ::google::protobuf::Message* msg
 ) {
-  // marshal response
-  std::string pbResponse;
-  if(response != NULL) {
-    if(!response->SerializeToString(&pbResponse)) {
-      return Error::New("protorpc.SendResponse: SerializeToString failed.");
+  const uint32 maxLen = conn->MaxBodyLen();
+  if(msg != NULL && rawLen > (maxLen != 0? maxLen: kDefaultMaxBodyLen)) {
+    return Error::New(std::string(errPrefix) + ": body too long.");
+  }
+  if((flags & FLAG_CHUNKED) == 0) {
+    // recv body, decoded from the connection buffer
+    int len;
+    auto data = (msg != NULL && maxLen != 0)?
+      conn->PeekFrame(&len, snappy::MaxCompressedLength(maxLen)): conn->PeekFrame(&len);
+    if(data == NULL) {
+      return Error::New(std::string(errPrefix) + ": RecvFrame failed.");
+    }
+    Error err;
+    if(msg != NULL) {
+      err = decodeBody(errPrefix, flags, checksum, rawLen, maxLen, data, size_t(len), msg);
+    }
+    conn->Consume(len);
+    return err;
+  }
+
+  ChunkedInputStream in(errPrefix, conn, (flags & FLAG_CRC32C) != 0);
+  bool ok = true;
+  if(msg != NULL) {
+    // rawLen is the peer's word, only the local limit bounds the body
+    io::CodedInputStream coded(&in);
+    if(maxLen != 0) {
+      coded.SetTotalBytesLimit(int(std::min(maxLen, uint32(INT_MAX))), -1);
+    }
+    coded.PushLimit(int(std::min(rawLen, uint32(INT_MAX))));
+    ok = msg->ParseFromCodedStream(&coded) && coded.ConsumedEntireMessage();
+  }
+  Error err = in.Finish();
+  if(!err.IsNil()) {
+    return err;
+  }
+  if(!ok) {
+    return Error::New(std::string(errPrefix) + ": ParseFromString failed.");
+  }
+  if(msg != NULL && uint64(in.ByteCount()) != rawLen) {
+    return Error::New(std::string(errPrefix) + ": Unexcpeted raw msg len.");
+  }
+  return Error::Nil();
+}
+
+// Serialize msg (NULL: empty) and encode it into body.
+static Error marshalBody(const char* errPrefix, int version,
+  const ::google::protobuf::Message* msg,
+  const Compression* compression, Checksum checksum,
+  std::string* body, uint32* rawLen, uint32* flags, uint32* crc
+) {
+  std::string& raw = serializeBuf;
+  raw.clear();
+  defer([&](){ releaseScratch(&serializeBuf); });
+  if(msg != NULL) {
+    if(!msg->SerializeToString(&raw)) {
+      return Error::New(std::string(errPrefix) + ": SerializeToString failed.");
     }
   }
 
   // compress serialized proto data
-  std::string compressedPbResponse;
-  snappy::Compress(pbResponse.data(), pbResponse.size(), &compressedPbResponse);
+  *flags = encodeBody(version, compression, version == kProtocolV2 && checksum == kCRC32C,
+    raw, body, crc
+  );
+  *rawLen = uint32(raw.size());
+  return Error::Nil();
+}
+
+Error MarshalRequest(
+  uint64_t id, const std::string& serviceMethod,
+  const ::google::protobuf::Message* request,
+  std::string* pbHeader, std::string* compressedPbRequest,
+  uint32_t timeoutMs,
+  int version, uint32_t methodId,
+  const Compression* compression,
+  Checksum checksum
+) {
+  // marshal request
+  uint32 rawLen, flags, crc;
+  Error err = marshalBody("protorpc.SendRequest", version, request, compression, checksum,
+    compressedPbRequest, &rawLen, &flags, &crc
+  );
+  if(!err.IsNil()) {
+    return err;
+  }
+
+  // generate header
+  RequestHeader header;
+
+  header.set_id(id);
+  if(version == kProtocolV2) {
+    header.set_method_id(methodId);
+    header.set_flags(flags);
+  } else {
+    header.set_method(serviceMethod);
+  }
+
+  header.set_raw_request_len(rawLen);
+  header.set_snappy_compressed_request_len(compressedPbRequest->size());
+  header.set_checksum(crc);
+  if(timeoutMs != 0) {
+    header.set_timeout_ms(timeoutMs);
+  }
+
+  return EncodeRequestHeader(header, version, pbHeader);
+}
+
+Error MarshalResponse(
+  uint64_t id, const std::string& error,
+  const ::google::protobuf::Message* response,
+  std::string* pbHeader, std::string* compressedPbResponse,
+  int version,
+  const Compression* compression,
+  Checksum checksum
+) {
+  // marshal response
+  uint32 rawLen, flags, crc;
+  Error err = marshalBody("protorpc.SendResponse", version, response, compression, checksum,
+    compressedPbResponse, &rawLen, &flags, &crc
+  );
+  if(!err.IsNil()) {
+    return err;
+  }
 
   // generate header
   ResponseHeader header;
@@ -136,81 +773,329 @@ Error SendResponse(Conn* conn,
   header.set_id(id);
   header.set_error(error);
 
-  header.set_raw_response_len(pbResponse.size());
-  header.set_snappy_compressed_response_len(compressedPbResponse.size());
-  header.set_checksum(HashCRC32(compressedPbResponse.data(), compressedPbResponse.size()));
+  header.set_raw_response_len(rawLen);
+  header.set_snappy_compressed_response_len(compressedPbResponse->size());
+  header.set_checksum(crc);
+  if(version == kProtocolV2) {
+    header.set_flags(flags);
+  }
 
-  // check header size
-  std::string pbHeader;
-  if(!header.SerializeToString(&pbHeader)) {
-    return Error::New("protorpc.SendResponse: SerializeToString failed.");
+  return EncodeResponseHeader(header, version, pbHeader);
+}
+
+Error MarshalStreamRequest(
+  uint64_t id, uint32_t methodId, StreamFrame frame, uint32_t window,
+  const ::google::protobuf::Message* request,
+  std::string* pbHeader, std::string* body,
+  const Compression* compression,
+  Checksum checksum
+) {
+  RequestHeader header;
+  header.set_id(id);
+  header.set_method_id(methodId);
+  header.set_stream(frame);
+  if(frame == STREAM_MESSAGE) {
+    uint32 rawLen, flags, crc;
+    Error err = marshalBody("protorpc.SendRequest", kProtocolV2, request, compression, checksum,
+      body, &rawLen, &flags, &crc
+    );
+    if(!err.IsNil()) {
+      return err;
+    }
+    header.set_flags(flags);
+    header.set_raw_request_len(rawLen);
+    header.set_snappy_compressed_request_len(body->size());
+    header.set_checksum(crc);
+  } else {
+    body->clear();
+    if(frame == STREAM_WINDOW) {
+      header.set_window(window);
+    }
   }
-  if(pbHeader.size() > Const::default_instance().max_header_len()) {
-    return Error::New("protorpc.SendResponse: header larger than max_header_len.");
+  return EncodeRequestHeader(header, kProtocolV2, pbHeader);
+}
+
+Error MarshalStreamResponse(
+  uint64_t id, StreamFrame frame, uint32_t window,
+  const ::google::protobuf::Message* response,
+  std::string* pbHeader, std::string* body,
+  const Compression* compression,
+  Checksum checksum
+) {
+  ResponseHeader header;
+  header.set_id(id);
+  header.set_stream(frame);
+  if(frame == STREAM_MESSAGE) {
+    uint32 rawLen, flags, crc;
+    Error err = marshalBody("protorpc.SendResponse", kProtocolV2, response, compression, checksum,
+      body, &rawLen, &flags, &crc
+    );
+    if(!err.IsNil()) {
+      return err;
+    }
+    header.set_flags(flags);
+    header.set_raw_response_len(rawLen);
+    header.set_snappy_compressed_response_len(body->size());
+    header.set_checksum(crc);
+  } else {
+    body->clear();
+    if(frame == STREAM_WINDOW) {
+      header.set_window(window);
+    }
+  }
+  return EncodeResponseHeader(header, kProtocolV2, pbHeader);
+}
+
+Error SendRequest(Conn* conn,
+  uint64_t id, const std::string& serviceMethod,
+  const ::google::protobuf::Message* request,
+  uint32_t timeoutMs,
+  int version, uint32_t methodId,
+  const Compression* compression,
+  Checksum checksum,
+  bool chunked
+) {
+  if(chunked && version == kProtocolV2 && IsChunkedBody(request)) {
+    RequestHeader header;
+    header.set_id(id);
+    header.set_method_id(methodId);
+    header.set_flags(FLAG_CHUNKED | FLAG_CHECKSUM | (checksum == kCRC32C? FLAG_CRC32C: 0));
+    header.set_raw_request_len(uint32(request->GetCachedSize()));
+    if(timeoutMs != 0) {
+      header.set_timeout_ms(timeoutMs);
+    }
+    std::string pbHeader;
+    Error err = EncodeRequestHeader(header, version, &pbHeader);
+    if(!err.IsNil()) {
+      return err;
+    }
+    return sendChunkedBody("protorpc.SendRequest", conn, &pbHeader, request, compression,
+      checksum == kCRC32C
+    );
   }
 
-  // send header
-  if(!conn->SendFrame(&pbHeader)) {
-    return Error::New("protorpc.SendResponse: SendFrame header failed.");
+  std::string pbHeader, compressedPbRequest;
+  Error err = MarshalRequest(id, serviceMethod, request, &pbHeader, &compressedPbRequest, timeoutMs,
+    version, methodId, compression, checksum);
+  if(!err.IsNil()) {
+    return err;
   }
 
-  // send body
-  if(!conn->SendFrame(&compressedPbResponse)) {
-    return Error::New("protorpc.SendResponse: SendFrame body failed.");
+  // send header and body with one vectored write
+  const std::string* frames[2] = { &pbHeader, &compressedPbRequest };
+  if(!conn->SendFrames(frames, 2)) {
+    return Error::New("protorpc.SendRequest: SendFrames failed.");
   }
 
   return Error::Nil();
 }
 
-Error RecvResponseHeader(Conn* conn,
-  ResponseHeader* header
+Error EncodeRequest(std::string* out,
+  uint64_t id, const std::string& serviceMethod,
+  const ::google::protobuf::Message* request,
+  uint32_t timeoutMs,
+  int version, uint32_t methodId,
+  const Compression* compression,
+  Checksum checksum
 ) {
-  // recv header
-  std::string pbHeader;
-  if(!conn->RecvFrame(&pbHeader)) {
-    return Error::New("protorpc.RecvResponseHeader: RecvFrame failed.");
+  std::string pbHeader, compressedPbRequest;
+  Error err = MarshalRequest(id, serviceMethod, request, &pbHeader, &compressedPbRequest, timeoutMs,
+    version, methodId, compression, checksum);
+  if(!err.IsNil()) {
+    return err;
+  }
+  appendFrame(out, pbHeader);
+  appendFrame(out, compressedPbRequest);
+  return Error::Nil();
+}
+
+Error RecvRequestHeader(Conn* conn,
+  RequestHeader* header,
+  int version
+) {
+  // recv header, parsed in place
+  int len;
+  auto pbHeader = conn->PeekFrame(&len, Const::default_instance().max_header_len());
+  if(pbHeader == NULL) {
+    return Error::New("protorpc.RecvRequestHeader: RecvFrame failed.");
+  }
+  Error err = DecodeRequestHeader(pbHeader, size_t(len), version, header);
+  conn->Consume(len);
+  return err;
+}
+
+Error RecvRequestBody(Conn* conn,
+  const RequestHeader* header,
+  ::google::protobuf::Message* request
+) {
+  uint32 flags = header->has_flags()? header->flags(): kFlagsV1;
+  return recvBody("protorpc.RecvRequestBody", conn, flags, header->checksum(),
+    header->raw_request_len(), request
+  );
+}
+
+Error SkipRequestBody(Conn* conn,
+  const RequestHeader* header
+) {
+  return recvBody("protorpc.RecvRequestBody", conn, header->flags(), 0, 0, NULL);
+}
+
+Error DecodeRequestBody(const RequestHeader* header,
+  const char* data, size_t len,
+  ::google::protobuf::Message* request,
+  uint32_t maxLen
+) {
+  uint32 flags = header->has_flags()? header->flags(): kFlagsV1;
+  return decodeBody("protorpc.RecvRequestBody", flags, header->checksum(), header->raw_request_len(),
+    maxLen, data, len, request
+  );
+}
+
+Error SendResponse(Conn* conn,
+  uint64_t id, const std::string& error,
+  const ::google::protobuf::Message* response,
+  int version,
+  const Compression* compression,
+  Checksum checksum,
+  bool chunked
+) {
+  if(chunked && version == kProtocolV2 && IsChunkedBody(response)) {
+    ResponseHeader header;
+    header.set_id(id);
+    header.set_error(error);
+    header.set_flags(FLAG_CHUNKED | FLAG_CHECKSUM | (checksum == kCRC32C? FLAG_CRC32C: 0));
+    header.set_raw_response_len(uint32(response->GetCachedSize()));
+    std::string pbHeader;
+    Error err = EncodeResponseHeader(header, version, &pbHeader);
+    if(!err.IsNil()) {
+      return err;
+    }
+    return sendChunkedBody("protorpc.SendResponse", conn, &pbHeader, response, compression,
+      checksum == kCRC32C
+    );
   }
-  if(pbHeader.size() > Const::default_instance().max_header_len()) {
-    return Error::New("protorpc.RecvResponseHeader: RecvFrame larger than max_header_len.");
+
+  std::string pbHeader, compressedPbResponse;
+  Error err = MarshalResponse(id, error, response, &pbHeader, &compressedPbResponse, version,
+    compression, checksum);
+  if(!err.IsNil()) {
+    return err;
   }
 
-  // Marshal Header
-  if(!header->ParseFromString(pbHeader)) {
-    return Error::New("protorpc.RecvResponseHeader: ParseFromString failed.");
+  // send header and body with one vectored write
+  const std::string* frames[2] = { &pbHeader, &compressedPbResponse };
+  if(!conn->SendFrames(frames, 2)) {
+    return Error::New("protorpc.SendResponse: SendFrames failed.");
   }
 
   return Error::Nil();
 }
 
+Error EncodeResponse(std::string* out,
+  uint64_t id, const std::string& error,
+  const ::google::protobuf::Message* response,
+  int version,
+  const Compression* compression,
+  Checksum checksum
+) {
+  std::string pbHeader, compressedPbResponse;
+  Error err = MarshalResponse(id, error, response, &pbHeader, &compressedPbResponse, version,
+    compression, checksum);
+  if(!err.IsNil()) {
+    return err;
+  }
+  appendFrame(out, pbHeader);
+  appendFrame(out, compressedPbResponse);
+  return Error::Nil();
+}
+
+Error RecvResponseHeader(Conn* conn,
+  ResponseHeader* header,
+  int version
+) {
+  // recv header, parsed in place
+  int len;
+  auto pbHeader = conn->PeekFrame(&len, Const::default_instance().max_header_len());
+  if(pbHeader == NULL) {
+    return Error::New("protorpc.RecvResponseHeader: RecvFrame failed.");
+  }
+  Error err = DecodeResponseHeader(pbHeader, size_t(len), version, header);
+  conn->Consume(len);
+  return err;
+}
+
 Error RecvResponseBody(Conn* conn,
   const ResponseHeader* header,
   ::google::protobuf::Message* response
 ) {
-  // recv body
-  std::string compressedPbRequest;
-  if(!conn->RecvFrame(&compressedPbRequest)) {
-    return Error::New("protorpc.RecvResponseBody: RecvFrame failed.");
-  }
+  uint32 flags = header->has_flags()? header->flags(): kFlagsV1;
+  return recvBody("protorpc.RecvResponseBody", conn, flags, header->checksum(),
+    header->raw_response_len(), response
+  );
+}
 
-  // checksum
-  uint32_t checksum = HashCRC32(compressedPbRequest.data(), compressedPbRequest.size());
-  if(checksum != header->checksum()) {
-    return Error::New("protorpc.RecvResponseBody: Unexpected checksum.");
+Error SkipResponseBody(Conn* conn,
+  const ResponseHeader* header
+) {
+  return recvBody("protorpc.RecvResponseBody", conn, header->flags(), 0, 0, NULL);
+}
+
+Error DecodeResponseBody(const ResponseHeader* header,
+  const char* data, size_t len,
+  ::google::protobuf::Message* response,
+  uint32_t maxLen
+) {
+  uint32 flags = header->has_flags()? header->flags(): kFlagsV1;
+  return decodeBody("protorpc.RecvResponseBody", flags, header->checksum(), header->raw_response_len(),
+    maxLen, data, len, response
+  );
+}
+
+Error RoundTrip(Conn* conn,
+  uint64_t id, const std::string& serviceMethod,
+  const ::google::protobuf::Message* request,
+  ::google::protobuf::Message* response,
+  uint32_t timeoutMs,
+  int version, uint32_t methodId,
+  const Compression* compression,
+  Checksum checksum,
+  bool chunked
+) {
+  ResponseHeader respHeader;
+  Error err;
+
+  if(timeoutMs != 0) {
+    conn->SetTimeout(int(timeoutMs));
   }
 
-  // decode the compressed data
-  std::string pbResponse;
-  if(!snappy::Uncompress(compressedPbRequest.data(), compressedPbRequest.size(), &pbResponse)) {
-    return Error::New("protorpc.RecvResponseBody: snappy::Uncompress failed.");
+  // send request, recv response hdr and body
+  err = SendRequest(conn, id, serviceMethod, request, timeoutMs, version, methodId, compression,
+    checksum, chunked
+  );
+  if(err.IsNil()) {
+    err = RecvResponseHeader(conn, &respHeader, version);
   }
-  // check wire header: rawMsgLen
-  if(pbResponse.size() != header->raw_response_len()) {
-    return Error::New("protorpc.RecvResponseBody: Unexcpeted raw msg len.");
+  if(err.IsNil()) {
+    err = RecvResponseBody(conn, &respHeader, response);
+  }
+  if(err.IsNil() && respHeader.id() != id) {
+    err = Error::New("protorpc.RoundTrip: unexpected call id.");
   }
 
-  // marshal response
-  if(!response->ParseFromString(pbResponse)) {
-    return Error::New("protorpc.RecvResponseBody: ParseFromString failed.");
+  if(!err.IsNil()) {
+    if(conn->TimedOut()) {
+      err = Error::New("protorpc.RoundTrip: timeout.");
+    }
+    conn->Close();
+  }
+  if(timeoutMs != 0) {
+    conn->SetTimeout(0);
+  }
+  if(!err.IsNil()) {
+    return err;
+  }
+  if(!respHeader.error().empty()) {
+    return Error::New(respHeader.error());
   }
 
   return Error::Nil();
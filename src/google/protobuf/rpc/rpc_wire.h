@@ -15,29 +15,200 @@ namespace protobuf {
 namespace rpc {
 namespace wire {
 
+// Protocol versions of a connection (see wire.proto): v1 is the Go
+// compatible format, v2 is negotiated by a handshake call of
+// kHandshakeMethod. The functions below take the version of the
+// connection; v2 requests are sent by methodId instead of serviceMethod.
+static const int kProtocolV1 = 1;
+static const int kProtocolV2 = 2;
+extern const char kHandshakeMethod[];
+
+// Keepalive pings (see wire.proto), sent as kPingMethod on v1
+// connections and as kPingMethodId on v2 ones.
+extern const char kPingMethod[];
+static const uint32_t kPingMethodId = 0xffffffffu;
+
+// Body compression policy, for v2 connections only: v1 bodies are always
+// snappy compressed. Bodies shorter than min_len are sent raw, and with
+// probe the larger ones are sent raw when a sample of them does not
+// compress.
+struct Compression {
+  bool enabled;
+  uint32_t min_len;
+  bool probe;
+
+  Compression(bool enabled=true, uint32_t min_len=256, bool probe=true):
+    enabled(enabled), min_len(min_len), probe(probe) {}
+};
+
+// Whether a body of len bytes should be compressed under the policy
+// (NULL: always).
+bool ShouldCompress(const Compression* compression, const char* data, size_t len);
+
+// Checksum of the body frames: v1 uses CRC32 (IEEE), v2 peers may agree
+// on CRC32C in the handshake.
+enum Checksum {
+  kCRC32 = 0,
+  kCRC32C = 1,
+};
+
+// Chunked bodies (see wire.proto), for v2 connections which agreed on
+// them in the handshake: the bodies of at least kChunkedBodyMinLen are
+// sent and received kBodyChunkLen at a time instead of being marshalled
+// whole. The Recv*Body functions read both kinds of bodies.
+static const uint32_t kBodyChunkLen = 256*1024;
+static const uint32_t kChunkedBodyMinLen = 1024*1024;
+
+// Longest raw body decoded when no max body len is set, the protobuf
+// default total bytes limit.
+static const uint32_t kDefaultMaxBodyLen = 64*1024*1024;
+
+// Whether msg is large enough to be sent in chunks (computes its size).
+bool IsChunkedBody(const ::google::protobuf::Message* msg);
+
+// Whether a request of a connection of version is a keepalive ping.
+bool IsPing(const RequestHeader& header, int version);
+
+// Header frame codecs of both versions.
+Error EncodeRequestHeader(const RequestHeader& header, int version, std::string* out);
+Error DecodeRequestHeader(const char* data, size_t len, int version, RequestHeader* header);
+Error EncodeResponseHeader(const ResponseHeader& header, int version, std::string* out);
+Error DecodeResponseHeader(const char* data, size_t len, int version, ResponseHeader* header);
+
+// timeoutMs is sent as RequestHeader.timeout_ms (0: no deadline).
+// With chunked, large bodies are sent in chunks (v2 only).
 Error SendRequest(Conn* conn,
   uint64_t id, const std::string& serviceMethod,
-  const ::google::protobuf::Message* request
+  const ::google::protobuf::Message* request,
+  uint32_t timeoutMs=0,
+  int version=kProtocolV1, uint32_t methodId=0,
+  const Compression* compression=NULL,
+  Checksum checksum=kCRC32,
+  bool chunked=false
 );
 Error RecvRequestHeader(Conn* conn,
-  RequestHeader* header
+  RequestHeader* header,
+  int version=kProtocolV1
 );
 Error RecvRequestBody(Conn* conn,
   const RequestHeader* header,
   ::google::protobuf::Message* request
 );
+// Receive and drop the body of a request.
+Error SkipRequestBody(Conn* conn,
+  const RequestHeader* header
+);
+
+// Marshal the request header and the (compressed) body.
+Error MarshalRequest(
+  uint64_t id, const std::string& serviceMethod,
+  const ::google::protobuf::Message* request,
+  std::string* pbHeader, std::string* compressedPbRequest,
+  uint32_t timeoutMs=0,
+  int version=kProtocolV1, uint32_t methodId=0,
+  const Compression* compression=NULL,
+  Checksum checksum=kCRC32
+);
+// Encode the request header frame and body frame, append to out.
+Error EncodeRequest(std::string* out,
+  uint64_t id, const std::string& serviceMethod,
+  const ::google::protobuf::Message* request,
+  uint32_t timeoutMs=0,
+  int version=kProtocolV1, uint32_t methodId=0,
+  const Compression* compression=NULL,
+  Checksum checksum=kCRC32
+);
+// Decode the request body frame data (not chunked), up to maxLen raw
+// bytes (0: kDefaultMaxBodyLen).
+Error DecodeRequestBody(const RequestHeader* header,
+  const char* data, size_t len,
+  ::google::protobuf::Message* request,
+  uint32_t maxLen=0
+);
 
 Error SendResponse(Conn* conn,
   uint64_t id, const std::string& error,
-  const ::google::protobuf::Message* response
+  const ::google::protobuf::Message* response,
+  int version=kProtocolV1,
+  const Compression* compression=NULL,
+  Checksum checksum=kCRC32,
+  bool chunked=false
 );
 Error RecvResponseHeader(Conn* conn,
-  ResponseHeader* header
+  ResponseHeader* header,
+  int version=kProtocolV1
 );
 Error RecvResponseBody(Conn* conn,
   const ResponseHeader* header,
   ::google::protobuf::Message* request
 );
+// Receive and drop the body of a response.
+Error SkipResponseBody(Conn* conn,
+  const ResponseHeader* header
+);
+
+// Marshal the response header and the (compressed) body.
+Error MarshalResponse(
+  uint64_t id, const std::string& error,
+  const ::google::protobuf::Message* response,
+  std::string* pbHeader, std::string* compressedPbResponse,
+  int version=kProtocolV1,
+  const Compression* compression=NULL,
+  Checksum checksum=kCRC32
+);
+// Encode the response header frame and body frame, append to out.
+Error EncodeResponse(std::string* out,
+  uint64_t id, const std::string& error,
+  const ::google::protobuf::Message* response,
+  int version=kProtocolV1,
+  const Compression* compression=NULL,
+  Checksum checksum=kCRC32
+);
+// Decode the response body frame data (not chunked), up to maxLen raw
+// bytes (0: kDefaultMaxBodyLen).
+Error DecodeResponseBody(const ResponseHeader* header,
+  const char* data, size_t len,
+  ::google::protobuf::Message* response,
+  uint32_t maxLen=0
+);
+
+// Streaming calls, protocol v2 only (see wire.proto). Each side may
+// have kStreamWindow body bytes of messages unread by its peer until it
+// is granted more by a STREAM_WINDOW frame. The server ends with an error
+// the call of a client sending past its window.
+static const uint32_t kStreamWindow = 256*1024;
+
+// Marshal a frame of a stream call. STREAM_MESSAGE frames carry the
+// message, the others an empty body (window is the grant of
+// STREAM_WINDOW frames).
+Error MarshalStreamRequest(
+  uint64_t id, uint32_t methodId, StreamFrame frame, uint32_t window,
+  const ::google::protobuf::Message* request,
+  std::string* pbHeader, std::string* body,
+  const Compression* compression=NULL,
+  Checksum checksum=kCRC32
+);
+Error MarshalStreamResponse(
+  uint64_t id, StreamFrame frame, uint32_t window,
+  const ::google::protobuf::Message* response,
+  std::string* pbHeader, std::string* body,
+  const Compression* compression=NULL,
+  Checksum checksum=kCRC32
+);
+
+// Send a request and receive its response on a connection without other
+// calls in flight. The connection is closed on I/O or protocol errors,
+// and when timeoutMs (if not 0) passes.
+Error RoundTrip(Conn* conn,
+  uint64_t id, const std::string& serviceMethod,
+  const ::google::protobuf::Message* request,
+  ::google::protobuf::Message* response,
+  uint32_t timeoutMs=0,
+  int version=kProtocolV1, uint32_t methodId=0,
+  const Compression* compression=NULL,
+  Checksum checksum=kCRC32,
+  bool chunked=false
+);
 
 }  // namespace wire
 }  // namespace rpc
@@ -0,0 +1,2 @@
+@rem gen cxx code
+..\..\..\..\bin\protoc.exe -I..\..\.. --cxx_out=..\..\.. google\protobuf\rpc\options.proto
@@ -32,6 +32,14 @@ const ::google::protobuf::internal::GeneratedMessageReflection*
 const ::google::protobuf::Descriptor* ResponseHeader_descriptor_ = NULL;
 const ::google::protobuf::internal::GeneratedMessageReflection*
   ResponseHeader_reflection_ = NULL;
+const ::google::protobuf::Descriptor* HandshakeRequest_descriptor_ = NULL;
+const ::google::protobuf::internal::GeneratedMessageReflection*
+  HandshakeRequest_reflection_ = NULL;
+const ::google::protobuf::Descriptor* HandshakeResponse_descriptor_ = NULL;
+const ::google::protobuf::internal::GeneratedMessageReflection*
+  HandshakeResponse_reflection_ = NULL;
+const ::google::protobuf::EnumDescriptor* HeaderFlags_descriptor_ = NULL;
+const ::google::protobuf::EnumDescriptor* StreamFrame_descriptor_ = NULL;
 
 }  // namespace
 
@@ -58,12 +66,17 @@ void protobuf_AssignDesc_wire_2eproto() {
       ::google::protobuf::MessageFactory::generated_factory(),
       sizeof(Const));
   RequestHeader_descriptor_ = file->message_type(1);
-  static const int RequestHeader_offsets_[5] = {
+  static const int RequestHeader_offsets_[10] = {
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(RequestHeader, id_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(RequestHeader, method_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(RequestHeader, raw_request_len_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(RequestHeader, snappy_compressed_request_len_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(RequestHeader, checksum_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(RequestHeader, timeout_ms_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(RequestHeader, method_id_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(RequestHeader, flags_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(RequestHeader, stream_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(RequestHeader, window_),
   };
   RequestHeader_reflection_ =
     new ::google::protobuf::internal::GeneratedMessageReflection(
@@ -77,12 +90,15 @@ void protobuf_AssignDesc_wire_2eproto() {
       ::google::protobuf::MessageFactory::generated_factory(),
       sizeof(RequestHeader));
   ResponseHeader_descriptor_ = file->message_type(2);
-  static const int ResponseHeader_offsets_[5] = {
+  static const int ResponseHeader_offsets_[8] = {
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(ResponseHeader, id_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(ResponseHeader, error_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(ResponseHeader, raw_response_len_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(ResponseHeader, snappy_compressed_response_len_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(ResponseHeader, checksum_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(ResponseHeader, flags_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(ResponseHeader, stream_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(ResponseHeader, window_),
   };
   ResponseHeader_reflection_ =
     new ::google::protobuf::internal::GeneratedMessageReflection(
@@ -95,6 +111,43 @@ void protobuf_AssignDesc_wire_2eproto() {
       ::google::protobuf::DescriptorPool::generated_pool(),
       ::google::protobuf::MessageFactory::generated_factory(),
       sizeof(ResponseHeader));
+  HandshakeRequest_descriptor_ = file->message_type(3);
+  static const int HandshakeRequest_offsets_[3] = {
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(HandshakeRequest, version_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(HandshakeRequest, crc32c_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(HandshakeRequest, chunked_),
+  };
+  HandshakeRequest_reflection_ =
+    new ::google::protobuf::internal::GeneratedMessageReflection(
+      HandshakeRequest_descriptor_,
+      HandshakeRequest::default_instance_,
+      HandshakeRequest_offsets_,
+      GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(HandshakeRequest, _has_bits_[0]),
+      GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(HandshakeRequest, _unknown_fields_),
+      -1,
+      ::google::protobuf::DescriptorPool::generated_pool(),
+      ::google::protobuf::MessageFactory::generated_factory(),
+      sizeof(HandshakeRequest));
+  HandshakeResponse_descriptor_ = file->message_type(4);
+  static const int HandshakeResponse_offsets_[4] = {
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(HandshakeResponse, version_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(HandshakeResponse, methods_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(HandshakeResponse, crc32c_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(HandshakeResponse, chunked_),
+  };
+  HandshakeResponse_reflection_ =
+    new ::google::protobuf::internal::GeneratedMessageReflection(
+      HandshakeResponse_descriptor_,
+      HandshakeResponse::default_instance_,
+      HandshakeResponse_offsets_,
+      GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(HandshakeResponse, _has_bits_[0]),
+      GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(HandshakeResponse, _unknown_fields_),
+      -1,
+      ::google::protobuf::DescriptorPool::generated_pool(),
+      ::google::protobuf::MessageFactory::generated_factory(),
+      sizeof(HandshakeResponse));
+  HeaderFlags_descriptor_ = file->enum_type(0);
+  StreamFrame_descriptor_ = file->enum_type(1);
 }
 
 namespace {
@@ -113,6 +166,10 @@ void protobuf_RegisterTypes(const ::std::string&) {
     RequestHeader_descriptor_, &RequestHeader::default_instance());
   ::google::protobuf::MessageFactory::InternalRegisterGeneratedMessage(
     ResponseHeader_descriptor_, &ResponseHeader::default_instance());
+  ::google::protobuf::MessageFactory::InternalRegisterGeneratedMessage(
+    HandshakeRequest_descriptor_, &HandshakeRequest::default_instance());
+  ::google::protobuf::MessageFactory::InternalRegisterGeneratedMessage(
+    HandshakeResponse_descriptor_, &HandshakeResponse::default_instance());
 }
 
 }  // namespace
@@ -124,6 +181,10 @@ void protobuf_ShutdownFile_wire_2eproto() {
   delete RequestHeader_reflection_;
   delete ResponseHeader::default_instance_;
   delete ResponseHeader_reflection_;
+  delete HandshakeRequest::default_instance_;
+  delete HandshakeRequest_reflection_;
+  delete HandshakeResponse::default_instance_;
+  delete HandshakeResponse_reflection_;
 }
 
 void protobuf_AddDesc_wire_2eproto() {
@@ -134,22 +195,40 @@ void protobuf_AddDesc_wire_2eproto() {
 
   ::google::protobuf::DescriptorPool::InternalAddGeneratedFile(
     "\n\nwire.proto\022\030google.protobuf.rpc.wire\"%"
-    "\n\005Const\022\034\n\016max_header_len\030\001 \001(\r:\0041024\"}\n"
-    "\rRequestHeader\022\n\n\002id\030\001 \001(\004\022\016\n\006method\030\002 \001"
-    "(\t\022\027\n\017raw_request_len\030\003 \001(\r\022%\n\035snappy_co"
-    "mpressed_request_len\030\004 \001(\r\022\020\n\010checksum\030\005"
-    " \001(\r\"\177\n\016ResponseHeader\022\n\n\002id\030\001 \001(\004\022\r\n\005er"
-    "ror\030\002 \001(\t\022\030\n\020raw_response_len\030\003 \001(\r\022&\n\036s"
-    "nappy_compressed_response_len\030\004 \001(\r\022\020\n\010c"
-    "hecksum\030\005 \001(\r", 333);
+    "\n\005Const\022\034\n\016max_header_len\030\001 \001(\r:\0041024\"\372\001"
+    "\n\rRequestHeader\022\n\n\002id\030\001 \001(\004\022\016\n\006method\030\002 "
+    "\001(\t\022\027\n\017raw_request_len\030\003 \001(\r\022%\n\035snappy_c"
+    "ompressed_request_len\030\004 \001(\r\022\020\n\010checksum\030"
+    "\005 \001(\r\022\022\n\ntimeout_ms\030\006 \001(\r\022\021\n\tmethod_id\030\020"
+    " \001(\r\022\r\n\005flags\030\021 \001(\r\0225\n\006stream\030\022 \001(\0162%.go"
+    "ogle.protobuf.rpc.wire.StreamFrame\022\016\n\006wi"
+    "ndow\030\023 \001(\r\"\325\001\n\016ResponseHeader\022\n\n\002id\030\001 \001("
+    "\004\022\r\n\005error\030\002 \001(\t\022\030\n\020raw_response_len\030\003 \001"
+    "(\r\022&\n\036snappy_compressed_response_len\030\004 \001"
+    "(\r\022\020\n\010checksum\030\005 \001(\r\022\r\n\005flags\030\021 \001(\r\0225\n\006s"
+    "tream\030\022 \001(\0162%.google.protobuf.rpc.wire.S"
+    "treamFrame\022\016\n\006window\030\023 \001(\r\"D\n\020HandshakeR"
+    "equest\022\017\n\007version\030\001 \001(\r\022\016\n\006crc32c\030\002 \001(\010\022"
+    "\017\n\007chunked\030\003 \001(\010\"V\n\021HandshakeResponse\022\017\n"
+    "\007version\030\001 \001(\r\022\017\n\007methods\030\002 \003(\t\022\016\n\006crc32"
+    "c\030\003 \001(\010\022\017\n\007chunked\030\004 \001(\010*X\n\013HeaderFlags\022"
+    "\021\n\rFLAG_CHECKSUM\020\001\022\023\n\017FLAG_COMPRESSED\020\002\022"
+    "\017\n\013FLAG_CRC32C\020\004\022\020\n\014FLAG_CHUNKED\020\010*y\n\013St"
+    "reamFrame\022\017\n\013STREAM_NONE\020\000\022\017\n\013STREAM_OPE"
+    "N\020\001\022\022\n\016STREAM_MESSAGE\020\002\022\016\n\nSTREAM_END\020\003\022"
+    "\021\n\rSTREAM_WINDOW\020\004\022\021\n\rSTREAM_CANCEL\020\005", 917);
   ::google::protobuf::MessageFactory::InternalRegisterGeneratedFile(
     "wire.proto", &protobuf_RegisterTypes);
   Const::default_instance_ = new Const();
   RequestHeader::default_instance_ = new RequestHeader();
   ResponseHeader::default_instance_ = new ResponseHeader();
+  HandshakeRequest::default_instance_ = new HandshakeRequest();
+  HandshakeResponse::default_instance_ = new HandshakeResponse();
   Const::default_instance_->InitAsDefaultInstance();
   RequestHeader::default_instance_->InitAsDefaultInstance();
   ResponseHeader::default_instance_->InitAsDefaultInstance();
+  HandshakeRequest::default_instance_->InitAsDefaultInstance();
+  HandshakeResponse::default_instance_->InitAsDefaultInstance();
   ::google::protobuf::internal::OnShutdown(&protobuf_ShutdownFile_wire_2eproto);
 }
 
@@ -159,6 +238,40 @@ struct StaticDescriptorInitializer_wire_2eproto {
     protobuf_AddDesc_wire_2eproto();
   }
 } static_descriptor_initializer_wire_2eproto_;
+const ::google::protobuf::EnumDescriptor* HeaderFlags_descriptor() {
+  protobuf_AssignDescriptorsOnce();
+  return HeaderFlags_descriptor_;
+}
+bool HeaderFlags_IsValid(int value) {
+  switch(value) {
+    case 1:
+    case 2:
+    case 4:
+    case 8:
+      return true;
+    default:
+      return false;
+  }
+}
+
+const ::google::protobuf::EnumDescriptor* StreamFrame_descriptor() {
+  protobuf_AssignDescriptorsOnce();
+  return StreamFrame_descriptor_;
+}
+bool StreamFrame_IsValid(int value) {
+  switch(value) {
+    case 0:
+    case 1:
+    case 2:
+    case 3:
+    case 4:
+    case 5:
+      return true;
+    default:
+      return false;
+  }
+}
+
 
 // ===================================================================
 
@@ -422,6 +535,11 @@ const int RequestHeader::kMethodFieldNumber;
 const int RequestHeader::kRawRequestLenFieldNumber;
 const int RequestHeader::kSnappyCompressedRequestLenFieldNumber;
 const int RequestHeader::kChecksumFieldNumber;
+const int RequestHeader::kTimeoutMsFieldNumber;
+const int RequestHeader::kMethodIdFieldNumber;
+const int RequestHeader::kFlagsFieldNumber;
+const int RequestHeader::kStreamFieldNumber;
+const int RequestHeader::kWindowFieldNumber;
 #endif  // !_MSC_VER
 
 RequestHeader::RequestHeader()
@@ -445,6 +563,11 @@ void RequestHeader::SharedCtor() {
   raw_request_len_ = 0u;
   snappy_compressed_request_len_ = 0u;
   checksum_ = 0u;
+  timeout_ms_ = 0u;
+  method_id_ = 0u;
+  flags_ = 0u;
+  stream_ = 0;
+  window_ = 0u;
   ::memset(_has_bits_, 0, sizeof(_has_bits_));
 }
 
@@ -492,6 +615,13 @@ void RequestHeader::Clear() {
     raw_request_len_ = 0u;
     snappy_compressed_request_len_ = 0u;
     checksum_ = 0u;
+    timeout_ms_ = 0u;
+    method_id_ = 0u;
+    flags_ = 0u;
+  }
+  if (_has_bits_[8 / 32] & (0xffu << (8 % 32))) {
+    stream_ = 0;
+    window_ = 0u;
   }
   ::memset(_has_bits_, 0, sizeof(_has_bits_));
   mutable_unknown_fields()->Clear();
@@ -579,6 +709,91 @@ bool RequestHeader::MergePartialFromCodedStream(
         } else {
           goto handle_uninterpreted;
         }
+        if (input->ExpectTag(48)) goto parse_timeout_ms;
+        break;
+      }
+
+      // optional uint32 timeout_ms = 6;
+      case 6: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT) {
+         parse_timeout_ms:
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   ::google::protobuf::uint32, ::google::protobuf::internal::WireFormatLite::TYPE_UINT32>(
+                 input, &timeout_ms_)));
+          set_has_timeout_ms();
+        } else {
+          goto handle_uninterpreted;
+        }
+        if (input->ExpectTag(128)) goto parse_method_id;
+        break;
+      }
+
+      // optional uint32 method_id = 16;
+      case 16: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT) {
+         parse_method_id:
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   ::google::protobuf::uint32, ::google::protobuf::internal::WireFormatLite::TYPE_UINT32>(
+                 input, &method_id_)));
+          set_has_method_id();
+        } else {
+          goto handle_uninterpreted;
+        }
+        if (input->ExpectTag(136)) goto parse_flags;
+        break;
+      }
+
+      // optional uint32 flags = 17;
+      case 17: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT) {
+         parse_flags:
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   ::google::protobuf::uint32, ::google::protobuf::internal::WireFormatLite::TYPE_UINT32>(
+                 input, &flags_)));
+          set_has_flags();
+        } else {
+          goto handle_uninterpreted;
+        }
+        if (input->ExpectTag(144)) goto parse_stream;
+        break;
+      }
+
+      // optional .google.protobuf.rpc.wire.StreamFrame stream = 18;
+      case 18: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT) {
+         parse_stream:
+          int value;
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   int, ::google::protobuf::internal::WireFormatLite::TYPE_ENUM>(
+                 input, &value)));
+          if (::google::protobuf::rpc::wire::StreamFrame_IsValid(value)) {
+            set_stream(static_cast< ::google::protobuf::rpc::wire::StreamFrame >(value));
+          } else {
+            mutable_unknown_fields()->AddVarint(18, value);
+          }
+        } else {
+          goto handle_uninterpreted;
+        }
+        if (input->ExpectTag(152)) goto parse_window;
+        break;
+      }
+
+      // optional uint32 window = 19;
+      case 19: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT) {
+         parse_window:
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   ::google::protobuf::uint32, ::google::protobuf::internal::WireFormatLite::TYPE_UINT32>(
+                 input, &window_)));
+          set_has_window();
+        } else {
+          goto handle_uninterpreted;
+        }
         if (input->ExpectAtEnd()) return true;
         break;
       }
@@ -630,6 +845,32 @@ void RequestHeader::SerializeWithCachedSizes(
     ::google::protobuf::internal::WireFormatLite::WriteUInt32(5, this->checksum(), output);
   }
 
+  // optional uint32 timeout_ms = 6;
+  if (has_timeout_ms()) {
+    ::google::protobuf::internal::WireFormatLite::WriteUInt32(6, this->timeout_ms(), output);
+  }
+
+  // optional uint32 method_id = 16;
+  if (has_method_id()) {
+    ::google::protobuf::internal::WireFormatLite::WriteUInt32(16, this->method_id(), output);
+  }
+
+  // optional uint32 flags = 17;
+  if (has_flags()) {
+    ::google::protobuf::internal::WireFormatLite::WriteUInt32(17, this->flags(), output);
+  }
+
+  // optional .google.protobuf.rpc.wire.StreamFrame stream = 18;
+  if (has_stream()) {
+    ::google::protobuf::internal::WireFormatLite::WriteEnum(
+      18, this->stream(), output);
+  }
+
+  // optional uint32 window = 19;
+  if (has_window()) {
+    ::google::protobuf::internal::WireFormatLite::WriteUInt32(19, this->window(), output);
+  }
+
   if (!unknown_fields().empty()) {
     ::google::protobuf::internal::WireFormat::SerializeUnknownFields(
         unknown_fields(), output);
@@ -668,6 +909,32 @@ void RequestHeader::SerializeWithCachedSizes(
     target = ::google::protobuf::internal::WireFormatLite::WriteUInt32ToArray(5, this->checksum(), target);
   }
 
+  // optional uint32 timeout_ms = 6;
+  if (has_timeout_ms()) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteUInt32ToArray(6, this->timeout_ms(), target);
+  }
+
+  // optional uint32 method_id = 16;
+  if (has_method_id()) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteUInt32ToArray(16, this->method_id(), target);
+  }
+
+  // optional uint32 flags = 17;
+  if (has_flags()) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteUInt32ToArray(17, this->flags(), target);
+  }
+
+  // optional .google.protobuf.rpc.wire.StreamFrame stream = 18;
+  if (has_stream()) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteEnumToArray(
+      18, this->stream(), target);
+  }
+
+  // optional uint32 window = 19;
+  if (has_window()) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteUInt32ToArray(19, this->window(), target);
+  }
+
   if (!unknown_fields().empty()) {
     target = ::google::protobuf::internal::WireFormat::SerializeUnknownFieldsToArray(
         unknown_fields(), target);
@@ -714,6 +981,42 @@ int RequestHeader::ByteSize() const {
           this->checksum());
     }
 
+    // optional uint32 timeout_ms = 6;
+    if (has_timeout_ms()) {
+      total_size += 1 +
+        ::google::protobuf::internal::WireFormatLite::UInt32Size(
+          this->timeout_ms());
+    }
+
+    // optional uint32 method_id = 16;
+    if (has_method_id()) {
+      total_size += 2 +
+        ::google::protobuf::internal::WireFormatLite::UInt32Size(
+          this->method_id());
+    }
+
+    // optional uint32 flags = 17;
+    if (has_flags()) {
+      total_size += 2 +
+        ::google::protobuf::internal::WireFormatLite::UInt32Size(
+          this->flags());
+    }
+
+  }
+  if (_has_bits_[8 / 32] & (0xffu << (8 % 32))) {
+    // optional .google.protobuf.rpc.wire.StreamFrame stream = 18;
+    if (has_stream()) {
+      total_size += 2 +
+        ::google::protobuf::internal::WireFormatLite::EnumSize(this->stream());
+    }
+
+    // optional uint32 window = 19;
+    if (has_window()) {
+      total_size += 2 +
+        ::google::protobuf::internal::WireFormatLite::UInt32Size(
+          this->window());
+    }
+
   }
   if (!unknown_fields().empty()) {
     total_size +=
@@ -756,6 +1059,23 @@ void RequestHeader::MergeFrom(const RequestHeader& from) {
     if (from.has_checksum()) {
       set_checksum(from.checksum());
     }
+    if (from.has_timeout_ms()) {
+      set_timeout_ms(from.timeout_ms());
+    }
+    if (from.has_method_id()) {
+      set_method_id(from.method_id());
+    }
+    if (from.has_flags()) {
+      set_flags(from.flags());
+    }
+  }
+  if (from._has_bits_[8 / 32] & (0xffu << (8 % 32))) {
+    if (from.has_stream()) {
+      set_stream(from.stream());
+    }
+    if (from.has_window()) {
+      set_window(from.window());
+    }
   }
   mutable_unknown_fields()->MergeFrom(from.unknown_fields());
 }
@@ -830,6 +1150,11 @@ void RequestHeader::Swap(RequestHeader* other) {
     std::swap(raw_request_len_, other->raw_request_len_);
     std::swap(snappy_compressed_request_len_, other->snappy_compressed_request_len_);
     std::swap(checksum_, other->checksum_);
+    std::swap(timeout_ms_, other->timeout_ms_);
+    std::swap(method_id_, other->method_id_);
+    std::swap(flags_, other->flags_);
+    std::swap(stream_, other->stream_);
+    std::swap(window_, other->window_);
     std::swap(_has_bits_[0], other->_has_bits_[0]);
     _unknown_fields_.Swap(&other->_unknown_fields_);
     std::swap(_cached_size_, other->_cached_size_);
@@ -853,6 +1178,9 @@ const int ResponseHeader::kErrorFieldNumber;
 const int ResponseHeader::kRawResponseLenFieldNumber;
 const int ResponseHeader::kSnappyCompressedResponseLenFieldNumber;
 const int ResponseHeader::kChecksumFieldNumber;
+const int ResponseHeader::kFlagsFieldNumber;
+const int ResponseHeader::kStreamFieldNumber;
+const int ResponseHeader::kWindowFieldNumber;
 #endif  // !_MSC_VER
 
 ResponseHeader::ResponseHeader()
@@ -876,6 +1204,9 @@ void ResponseHeader::SharedCtor() {
   raw_response_len_ = 0u;
   snappy_compressed_response_len_ = 0u;
   checksum_ = 0u;
+  flags_ = 0u;
+  stream_ = 0;
+  window_ = 0u;
   ::memset(_has_bits_, 0, sizeof(_has_bits_));
 }
 
@@ -923,6 +1254,9 @@ void ResponseHeader::Clear() {
     raw_response_len_ = 0u;
     snappy_compressed_response_len_ = 0u;
     checksum_ = 0u;
+    flags_ = 0u;
+    stream_ = 0;
+    window_ = 0u;
   }
   ::memset(_has_bits_, 0, sizeof(_has_bits_));
   mutable_unknown_fields()->Clear();
@@ -1010,6 +1344,59 @@ bool ResponseHeader::MergePartialFromCodedStream(
         } else {
           goto handle_uninterpreted;
         }
+        if (input->ExpectTag(136)) goto parse_flags;
+        break;
+      }
+
+      // optional uint32 flags = 17;
+      case 17: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT) {
+         parse_flags:
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   ::google::protobuf::uint32, ::google::protobuf::internal::WireFormatLite::TYPE_UINT32>(
+                 input, &flags_)));
+          set_has_flags();
+        } else {
+          goto handle_uninterpreted;
+        }
+        if (input->ExpectTag(144)) goto parse_stream;
+        break;
+      }
+
+      // optional .google.protobuf.rpc.wire.StreamFrame stream = 18;
+      case 18: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT) {
+         parse_stream:
+          int value;
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   int, ::google::protobuf::internal::WireFormatLite::TYPE_ENUM>(
+                 input, &value)));
+          if (::google::protobuf::rpc::wire::StreamFrame_IsValid(value)) {
+            set_stream(static_cast< ::google::protobuf::rpc::wire::StreamFrame >(value));
+          } else {
+            mutable_unknown_fields()->AddVarint(18, value);
+          }
+        } else {
+          goto handle_uninterpreted;
+        }
+        if (input->ExpectTag(152)) goto parse_window;
+        break;
+      }
+
+      // optional uint32 window = 19;
+      case 19: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT) {
+         parse_window:
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   ::google::protobuf::uint32, ::google::protobuf::internal::WireFormatLite::TYPE_UINT32>(
+                 input, &window_)));
+          set_has_window();
+        } else {
+          goto handle_uninterpreted;
+        }
         if (input->ExpectAtEnd()) return true;
         break;
       }
@@ -1061,6 +1448,22 @@ void ResponseHeader::SerializeWithCachedSizes(
     ::google::protobuf::internal::WireFormatLite::WriteUInt32(5, this->checksum(), output);
   }
 
+  // optional uint32 flags = 17;
+  if (has_flags()) {
+    ::google::protobuf::internal::WireFormatLite::WriteUInt32(17, this->flags(), output);
+  }
+
+  // optional .google.protobuf.rpc.wire.StreamFrame stream = 18;
+  if (has_stream()) {
+    ::google::protobuf::internal::WireFormatLite::WriteEnum(
+      18, this->stream(), output);
+  }
+
+  // optional uint32 window = 19;
+  if (has_window()) {
+    ::google::protobuf::internal::WireFormatLite::WriteUInt32(19, this->window(), output);
+  }
+
   if (!unknown_fields().empty()) {
     ::google::protobuf::internal::WireFormat::SerializeUnknownFields(
         unknown_fields(), output);
@@ -1099,6 +1502,22 @@ void ResponseHeader::SerializeWithCachedSizes(
     target = ::google::protobuf::internal::WireFormatLite::WriteUInt32ToArray(5, this->checksum(), target);
   }
 
+  // optional uint32 flags = 17;
+  if (has_flags()) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteUInt32ToArray(17, this->flags(), target);
+  }
+
+  // optional .google.protobuf.rpc.wire.StreamFrame stream = 18;
+  if (has_stream()) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteEnumToArray(
+      18, this->stream(), target);
+  }
+
+  // optional uint32 window = 19;
+  if (has_window()) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteUInt32ToArray(19, this->window(), target);
+  }
+
   if (!unknown_fields().empty()) {
     target = ::google::protobuf::internal::WireFormat::SerializeUnknownFieldsToArray(
         unknown_fields(), target);
@@ -1145,6 +1564,26 @@ int ResponseHeader::ByteSize() const {
           this->checksum());
     }
 
+    // optional uint32 flags = 17;
+    if (has_flags()) {
+      total_size += 2 +
+        ::google::protobuf::internal::WireFormatLite::UInt32Size(
+          this->flags());
+    }
+
+    // optional .google.protobuf.rpc.wire.StreamFrame stream = 18;
+    if (has_stream()) {
+      total_size += 2 +
+        ::google::protobuf::internal::WireFormatLite::EnumSize(this->stream());
+    }
+
+    // optional uint32 window = 19;
+    if (has_window()) {
+      total_size += 2 +
+        ::google::protobuf::internal::WireFormatLite::UInt32Size(
+          this->window());
+    }
+
   }
   if (!unknown_fields().empty()) {
     total_size +=
@@ -1187,6 +1626,15 @@ void ResponseHeader::MergeFrom(const ResponseHeader& from) {
     if (from.has_checksum()) {
       set_checksum(from.checksum());
     }
+    if (from.has_flags()) {
+      set_flags(from.flags());
+    }
+    if (from.has_stream()) {
+      set_stream(from.stream());
+    }
+    if (from.has_window()) {
+      set_window(from.window());
+    }
   }
   mutable_unknown_fields()->MergeFrom(from.unknown_fields());
 }
@@ -1261,6 +1709,9 @@ void ResponseHeader::Swap(ResponseHeader* other) {
     std::swap(raw_response_len_, other->raw_response_len_);
     std::swap(snappy_compressed_response_len_, other->snappy_compressed_response_len_);
     std::swap(checksum_, other->checksum_);
+    std::swap(flags_, other->flags_);
+    std::swap(stream_, other->stream_);
+    std::swap(window_, other->window_);
     std::swap(_has_bits_[0], other->_has_bits_[0]);
     _unknown_fields_.Swap(&other->_unknown_fields_);
     std::swap(_cached_size_, other->_cached_size_);
@@ -1276,6 +1727,714 @@ void ResponseHeader::Swap(ResponseHeader* other) {
 }
 
 
+// ===================================================================
+
+#ifndef _MSC_VER
+const int HandshakeRequest::kVersionFieldNumber;
+const int HandshakeRequest::kCrc32CFieldNumber;
+const int HandshakeRequest::kChunkedFieldNumber;
+#endif  // !_MSC_VER
+
+HandshakeRequest::HandshakeRequest()
+  : ::google::protobuf::Message() {
+  SharedCtor();
+}
+
+void HandshakeRequest::InitAsDefaultInstance() {
+}
+
+HandshakeRequest::HandshakeRequest(const HandshakeRequest& from)
+  : ::google::protobuf::Message() {
+  SharedCtor();
+  MergeFrom(from);
+}
+
+void HandshakeRequest::SharedCtor() {
+  _cached_size_ = 0;
+  version_ = 0u;
+  crc32c_ = false;
+  chunked_ = false;
+  ::memset(_has_bits_, 0, sizeof(_has_bits_));
+}
+
+HandshakeRequest::~HandshakeRequest() {
+  SharedDtor();
+}
+
+void HandshakeRequest::SharedDtor() {
+  if (this != default_instance_) {
+  }
+}
+
+void HandshakeRequest::SetCachedSize(int size) const {
+  GOOGLE_SAFE_CONCURRENT_WRITES_BEGIN();
+  _cached_size_ = size;
+  GOOGLE_SAFE_CONCURRENT_WRITES_END();
+}
+const ::google::protobuf::Descriptor* HandshakeRequest::descriptor() {
+  protobuf_AssignDescriptorsOnce();
+  return HandshakeRequest_descriptor_;
+}
+
+const HandshakeRequest& HandshakeRequest::default_instance() {
+  if (default_instance_ == NULL) protobuf_AddDesc_wire_2eproto();
+  return *default_instance_;
+}
+
+HandshakeRequest* HandshakeRequest::default_instance_ = NULL;
+
+HandshakeRequest* HandshakeRequest::New() const {
+  return new HandshakeRequest;
+}
+
+void HandshakeRequest::Clear() {
+  if (_has_bits_[0 / 32] & (0xffu << (0 % 32))) {
+    version_ = 0u;
+    crc32c_ = false;
+    chunked_ = false;
+  }
+  ::memset(_has_bits_, 0, sizeof(_has_bits_));
+  mutable_unknown_fields()->Clear();
+}
+
+bool HandshakeRequest::MergePartialFromCodedStream(
+    ::google::protobuf::io::CodedInputStream* input) {
+#define DO_(EXPRESSION) if (!(EXPRESSION)) return false
+  ::google::protobuf::uint32 tag;
+  while ((tag = input->ReadTag()) != 0) {
+    switch (::google::protobuf::internal::WireFormatLite::GetTagFieldNumber(tag)) {
+      // optional uint32 version = 1;
+      case 1: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT) {
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   ::google::protobuf::uint32, ::google::protobuf::internal::WireFormatLite::TYPE_UINT32>(
+                 input, &version_)));
+          set_has_version();
+        } else {
+          goto handle_uninterpreted;
+        }
+        if (input->ExpectTag(16)) goto parse_crc32c;
+        break;
+      }
+
+      // optional bool crc32c = 2;
+      case 2: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT) {
+         parse_crc32c:
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   bool, ::google::protobuf::internal::WireFormatLite::TYPE_BOOL>(
+                 input, &crc32c_)));
+          set_has_crc32c();
+        } else {
+          goto handle_uninterpreted;
+        }
+        if (input->ExpectTag(24)) goto parse_chunked;
+        break;
+      }
+
+      // optional bool chunked = 3;
+      case 3: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT) {
+         parse_chunked:
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   bool, ::google::protobuf::internal::WireFormatLite::TYPE_BOOL>(
+                 input, &chunked_)));
+          set_has_chunked();
+        } else {
+          goto handle_uninterpreted;
+        }
+        if (input->ExpectAtEnd()) return true;
+        break;
+      }
+
+      default: {
+      handle_uninterpreted:
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_END_GROUP) {
+          return true;
+        }
+        DO_(::google::protobuf::internal::WireFormat::SkipField(
+              input, tag, mutable_unknown_fields()));
+        break;
+      }
+    }
+  }
+  return true;
+#undef DO_
+}
+
+void HandshakeRequest::SerializeWithCachedSizes(
+    ::google::protobuf::io::CodedOutputStream* output) const {
+  // optional uint32 version = 1;
+  if (has_version()) {
+    ::google::protobuf::internal::WireFormatLite::WriteUInt32(1, this->version(), output);
+  }
+
+  // optional bool crc32c = 2;
+  if (has_crc32c()) {
+    ::google::protobuf::internal::WireFormatLite::WriteBool(2, this->crc32c(), output);
+  }
+
+  // optional bool chunked = 3;
+  if (has_chunked()) {
+    ::google::protobuf::internal::WireFormatLite::WriteBool(3, this->chunked(), output);
+  }
+
+  if (!unknown_fields().empty()) {
+    ::google::protobuf::internal::WireFormat::SerializeUnknownFields(
+        unknown_fields(), output);
+  }
+}
+
+::google::protobuf::uint8* HandshakeRequest::SerializeWithCachedSizesToArray(
+    ::google::protobuf::uint8* target) const {
+  // optional uint32 version = 1;
+  if (has_version()) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteUInt32ToArray(1, this->version(), target);
+  }
+
+  // optional bool crc32c = 2;
+  if (has_crc32c()) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteBoolToArray(2, this->crc32c(), target);
+  }
+
+  // optional bool chunked = 3;
+  if (has_chunked()) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteBoolToArray(3, this->chunked(), target);
+  }
+
+  if (!unknown_fields().empty()) {
+    target = ::google::protobuf::internal::WireFormat::SerializeUnknownFieldsToArray(
+        unknown_fields(), target);
+  }
+  return target;
+}
+
+int HandshakeRequest::ByteSize() const {
+  int total_size = 0;
+
+  if (_has_bits_[0 / 32] & (0xffu << (0 % 32))) {
+    // optional uint32 version = 1;
+    if (has_version()) {
+      total_size += 1 +
+        ::google::protobuf::internal::WireFormatLite::UInt32Size(
+          this->version());
+    }
+
+    // optional bool crc32c = 2;
+    if (has_crc32c()) {
+      total_size += 1 + 1;
+    }
+
+    // optional bool chunked = 3;
+    if (has_chunked()) {
+      total_size += 1 + 1;
+    }
+
+  }
+  if (!unknown_fields().empty()) {
+    total_size +=
+      ::google::protobuf::internal::WireFormat::ComputeUnknownFieldsSize(
+        unknown_fields());
+  }
+  GOOGLE_SAFE_CONCURRENT_WRITES_BEGIN();
+  _cached_size_ = total_size;
+  GOOGLE_SAFE_CONCURRENT_WRITES_END();
+  return total_size;
+}
+
+void HandshakeRequest::MergeFrom(const ::google::protobuf::Message& from) {
+  GOOGLE_CHECK_NE(&from, this);
+  const HandshakeRequest* source =
+    ::google::protobuf::internal::dynamic_cast_if_available<const HandshakeRequest*>(
+      &from);
+  if (source == NULL) {
+    ::google::protobuf::internal::ReflectionOps::Merge(from, this);
+  } else {
+    MergeFrom(*source);
+  }
+}
+
+void HandshakeRequest::MergeFrom(const HandshakeRequest& from) {
+  GOOGLE_CHECK_NE(&from, this);
+  if (from._has_bits_[0 / 32] & (0xffu << (0 % 32))) {
+    if (from.has_version()) {
+      set_version(from.version());
+    }
+    if (from.has_crc32c()) {
+      set_crc32c(from.crc32c());
+    }
+    if (from.has_chunked()) {
+      set_chunked(from.chunked());
+    }
+  }
+  mutable_unknown_fields()->MergeFrom(from.unknown_fields());
+}
+
+void HandshakeRequest::CopyFrom(const ::google::protobuf::Message& from) {
+  if (&from == this) return;
+  Clear();
+  MergeFrom(from);
+}
+
+void HandshakeRequest::CopyFrom(const HandshakeRequest& from) {
+  if (&from == this) return;
+  Clear();
+  MergeFrom(from);
+}
+
+bool HandshakeRequest::IsInitialized() const {
+
+  return true;
+}
+
+bool HandshakeRequest::ParseFromXmlString(const std::string& data) {
+  ::google::protobuf::xml::XmlMessage stub(*const_cast<HandshakeRequest*>(this));
+  if(!stub.ParseFromString(data)) {
+    GOOGLE_LOG(WARNING) << "ParseFromXmlString failed: " << stub.GetErrorText();
+    return false;
+  }
+  if (!this->IsInitialized()) {
+    GOOGLE_LOG(WARNING)
+      << "ParseFromXmlString failed: missing required fields: "
+      << this->InitializationErrorString();
+    return false;
+  }
+  return true;
+}
+
+bool HandshakeRequest::ParsePartialFromXmlString(const std::string& data) {
+  ::google::protobuf::xml::XmlMessage stub(*const_cast<HandshakeRequest*>(this));
+  if(!stub.ParseFromString(data)) {
+    GOOGLE_LOG(WARNING) << "ParsePartialFromXmlString failed: " << stub.GetErrorText();
+    return false;
+  }
+  return true;
+}
+
+bool HandshakeRequest::SerializeToXmlString(std::string* output) const {
+  output->clear();
+  if (!this->IsInitialized()) {
+    GOOGLE_LOG(WARNING)
+      << "SerializeToXmlString failed: missing required fields: "
+      << this->InitializationErrorString();
+    return false;
+  }
+
+  ::google::protobuf::xml::XmlMessage stub(*const_cast<HandshakeRequest*>(this));
+  output->assign(stub.SerializeToString());
+  return true;
+}
+
+bool HandshakeRequest::SerializePartialToXmlString(std::string* output) const {
+  output->clear();
+
+  ::google::protobuf::xml::XmlMessage stub(*const_cast<HandshakeRequest*>(this));
+  output->assign(stub.SerializeToString());
+  return true;
+}
+
+void HandshakeRequest::Swap(HandshakeRequest* other) {
+  if (other != this) {
+    std::swap(version_, other->version_);
+    std::swap(crc32c_, other->crc32c_);
+    std::swap(chunked_, other->chunked_);
+    std::swap(_has_bits_[0], other->_has_bits_[0]);
+    _unknown_fields_.Swap(&other->_unknown_fields_);
+    std::swap(_cached_size_, other->_cached_size_);
+  }
+}
+
+::google::protobuf::Metadata HandshakeRequest::GetMetadata() const {
+  protobuf_AssignDescriptorsOnce();
+  ::google::protobuf::Metadata metadata;
+  metadata.descriptor = HandshakeRequest_descriptor_;
+  metadata.reflection = HandshakeRequest_reflection_;
+  return metadata;
+}
+
+
+// ===================================================================
+
+#ifndef _MSC_VER
+const int HandshakeResponse::kVersionFieldNumber;
+const int HandshakeResponse::kMethodsFieldNumber;
+const int HandshakeResponse::kCrc32CFieldNumber;
+const int HandshakeResponse::kChunkedFieldNumber;
+#endif  // !_MSC_VER
+
+HandshakeResponse::HandshakeResponse()
+  : ::google::protobuf::Message() {
+  SharedCtor();
+}
+
+void HandshakeResponse::InitAsDefaultInstance() {
+}
+
+HandshakeResponse::HandshakeResponse(const HandshakeResponse& from)
+  : ::google::protobuf::Message() {
+  SharedCtor();
+  MergeFrom(from);
+}
+
+void HandshakeResponse::SharedCtor() {
+  _cached_size_ = 0;
+  version_ = 0u;
+  crc32c_ = false;
+  chunked_ = false;
+  ::memset(_has_bits_, 0, sizeof(_has_bits_));
+}
+
+HandshakeResponse::~HandshakeResponse() {
+  SharedDtor();
+}
+
+void HandshakeResponse::SharedDtor() {
+  if (this != default_instance_) {
+  }
+}
+
+void HandshakeResponse::SetCachedSize(int size) const {
+  GOOGLE_SAFE_CONCURRENT_WRITES_BEGIN();
+  _cached_size_ = size;
+  GOOGLE_SAFE_CONCURRENT_WRITES_END();
+}
+const ::google::protobuf::Descriptor* HandshakeResponse::descriptor() {
+  protobuf_AssignDescriptorsOnce();
+  return HandshakeResponse_descriptor_;
+}
+
+const HandshakeResponse& HandshakeResponse::default_instance() {
+  if (default_instance_ == NULL) protobuf_AddDesc_wire_2eproto();
+  return *default_instance_;
+}
+
+HandshakeResponse* HandshakeResponse::default_instance_ = NULL;
+
+HandshakeResponse* HandshakeResponse::New() const {
+  return new HandshakeResponse;
+}
+
+void HandshakeResponse::Clear() {
+  if (_has_bits_[0 / 32] & (0xffu << (0 % 32))) {
+    version_ = 0u;
+    crc32c_ = false;
+    chunked_ = false;
+  }
+  methods_.Clear();
+  ::memset(_has_bits_, 0, sizeof(_has_bits_));
+  mutable_unknown_fields()->Clear();
+}
+
+bool HandshakeResponse::MergePartialFromCodedStream(
+    ::google::protobuf::io::CodedInputStream* input) {
+#define DO_(EXPRESSION) if (!(EXPRESSION)) return false
+  ::google::protobuf::uint32 tag;
+  while ((tag = input->ReadTag()) != 0) {
+    switch (::google::protobuf::internal::WireFormatLite::GetTagFieldNumber(tag)) {
+      // optional uint32 version = 1;
+      case 1: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT) {
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   ::google::protobuf::uint32, ::google::protobuf::internal::WireFormatLite::TYPE_UINT32>(
+                 input, &version_)));
+          set_has_version();
+        } else {
+          goto handle_uninterpreted;
+        }
+        if (input->ExpectTag(18)) goto parse_methods;
+        break;
+      }
+
+      // repeated string methods = 2;
+      case 2: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+         parse_methods:
+          DO_(::google::protobuf::internal::WireFormatLite::ReadString(
+                input, this->add_methods()));
+          ::google::protobuf::internal::WireFormat::VerifyUTF8String(
+            this->methods(this->methods_size() - 1).data(),
+            this->methods(this->methods_size() - 1).length(),
+            ::google::protobuf::internal::WireFormat::PARSE);
+        } else {
+          goto handle_uninterpreted;
+        }
+        if (input->ExpectTag(18)) goto parse_methods;
+        if (input->ExpectTag(24)) goto parse_crc32c;
+        break;
+      }
+
+      // optional bool crc32c = 3;
+      case 3: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT) {
+         parse_crc32c:
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   bool, ::google::protobuf::internal::WireFormatLite::TYPE_BOOL>(
+                 input, &crc32c_)));
+          set_has_crc32c();
+        } else {
+          goto handle_uninterpreted;
+        }
+        if (input->ExpectTag(32)) goto parse_chunked;
+        break;
+      }
+
+      // optional bool chunked = 4;
+      case 4: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT) {
+         parse_chunked:
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   bool, ::google::protobuf::internal::WireFormatLite::TYPE_BOOL>(
+                 input, &chunked_)));
+          set_has_chunked();
+        } else {
+          goto handle_uninterpreted;
+        }
+        if (input->ExpectAtEnd()) return true;
+        break;
+      }
+
+      default: {
+      handle_uninterpreted:
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_END_GROUP) {
+          return true;
+        }
+        DO_(::google::protobuf::internal::WireFormat::SkipField(
+              input, tag, mutable_unknown_fields()));
+        break;
+      }
+    }
+  }
+  return true;
+#undef DO_
+}
+
+void HandshakeResponse::SerializeWithCachedSizes(
+    ::google::protobuf::io::CodedOutputStream* output) const {
+  // optional uint32 version = 1;
+  if (has_version()) {
+    ::google::protobuf::internal::WireFormatLite::WriteUInt32(1, this->version(), output);
+  }
+
+  // repeated string methods = 2;
+  for (int i = 0; i < this->methods_size(); i++) {
+  ::google::protobuf::internal::WireFormat::VerifyUTF8String(
+    this->methods(i).data(), this->methods(i).length(),
+    ::google::protobuf::internal::WireFormat::SERIALIZE);
+    ::google::protobuf::internal::WireFormatLite::WriteString(
+      2, this->methods(i), output);
+  }
+
+  // optional bool crc32c = 3;
+  if (has_crc32c()) {
+    ::google::protobuf::internal::WireFormatLite::WriteBool(3, this->crc32c(), output);
+  }
+
+  // optional bool chunked = 4;
+  if (has_chunked()) {
+    ::google::protobuf::internal::WireFormatLite::WriteBool(4, this->chunked(), output);
+  }
+
+  if (!unknown_fields().empty()) {
+    ::google::protobuf::internal::WireFormat::SerializeUnknownFields(
+        unknown_fields(), output);
+  }
+}
+
+::google::protobuf::uint8* HandshakeResponse::SerializeWithCachedSizesToArray(
+    ::google::protobuf::uint8* target) const {
+  // optional uint32 version = 1;
+  if (has_version()) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteUInt32ToArray(1, this->version(), target);
+  }
+
+  // repeated string methods = 2;
+  for (int i = 0; i < this->methods_size(); i++) {
+    ::google::protobuf::internal::WireFormat::VerifyUTF8String(
+      this->methods(i).data(), this->methods(i).length(),
+      ::google::protobuf::internal::WireFormat::SERIALIZE);
+    target = ::google::protobuf::internal::WireFormatLite::
+      WriteStringToArray(2, this->methods(i), target);
+  }
+
+  // optional bool crc32c = 3;
+  if (has_crc32c()) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteBoolToArray(3, this->crc32c(), target);
+  }
+
+  // optional bool chunked = 4;
+  if (has_chunked()) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteBoolToArray(4, this->chunked(), target);
+  }
+
+  if (!unknown_fields().empty()) {
+    target = ::google::protobuf::internal::WireFormat::SerializeUnknownFieldsToArray(
+        unknown_fields(), target);
+  }
+  return target;
+}
+
+int HandshakeResponse::ByteSize() const {
+  int total_size = 0;
+
+  if (_has_bits_[0 / 32] & (0xffu << (0 % 32))) {
+    // optional uint32 version = 1;
+    if (has_version()) {
+      total_size += 1 +
+        ::google::protobuf::internal::WireFormatLite::UInt32Size(
+          this->version());
+    }
+
+    // optional bool crc32c = 3;
+    if (has_crc32c()) {
+      total_size += 1 + 1;
+    }
+
+    // optional bool chunked = 4;
+    if (has_chunked()) {
+      total_size += 1 + 1;
+    }
+
+  }
+  // repeated string methods = 2;
+  total_size += 1 * this->methods_size();
+  for (int i = 0; i < this->methods_size(); i++) {
+    total_size += ::google::protobuf::internal::WireFormatLite::StringSize(
+      this->methods(i));
+  }
+
+  if (!unknown_fields().empty()) {
+    total_size +=
+      ::google::protobuf::internal::WireFormat::ComputeUnknownFieldsSize(
+        unknown_fields());
+  }
+  GOOGLE_SAFE_CONCURRENT_WRITES_BEGIN();
+  _cached_size_ = total_size;
+  GOOGLE_SAFE_CONCURRENT_WRITES_END();
+  return total_size;
+}
+
+void HandshakeResponse::MergeFrom(const ::google::protobuf::Message& from) {
+  GOOGLE_CHECK_NE(&from, this);
+  const HandshakeResponse* source =
+    ::google::protobuf::internal::dynamic_cast_if_available<const HandshakeResponse*>(
+      &from);
+  if (source == NULL) {
+    ::google::protobuf::internal::ReflectionOps::Merge(from, this);
+  } else {
+    MergeFrom(*source);
+  }
+}
+
+void HandshakeResponse::MergeFrom(const HandshakeResponse& from) {
+  GOOGLE_CHECK_NE(&from, this);
+  methods_.MergeFrom(from.methods_);
+  if (from._has_bits_[0 / 32] & (0xffu << (0 % 32))) {
+    if (from.has_version()) {
+      set_version(from.version());
+    }
+    if (from.has_crc32c()) {
+      set_crc32c(from.crc32c());
+    }
+    if (from.has_chunked()) {
+      set_chunked(from.chunked());
+    }
+  }
+  mutable_unknown_fields()->MergeFrom(from.unknown_fields());
+}
+
+void HandshakeResponse::CopyFrom(const ::google::protobuf::Message& from) {
+  if (&from == this) return;
+  Clear();
+  MergeFrom(from);
+}
+
+void HandshakeResponse::CopyFrom(const HandshakeResponse& from) {
+  if (&from == this) return;
+  Clear();
+  MergeFrom(from);
+}
+
+bool HandshakeResponse::IsInitialized() const {
+
+  return true;
+}
+
+bool HandshakeResponse::ParseFromXmlString(const std::string& data) {
+  ::google::protobuf::xml::XmlMessage stub(*const_cast<HandshakeResponse*>(this));
+  if(!stub.ParseFromString(data)) {
+    GOOGLE_LOG(WARNING) << "ParseFromXmlString failed: " << stub.GetErrorText();
+    return false;
+  }
+  if (!this->IsInitialized()) {
+    GOOGLE_LOG(WARNING)
+      << "ParseFromXmlString failed: missing required fields: "
+      << this->InitializationErrorString();
+    return false;
+  }
+  return true;
+}
+
+bool HandshakeResponse::ParsePartialFromXmlString(const std::string& data) {
+  ::google::protobuf::xml::XmlMessage stub(*const_cast<HandshakeResponse*>(this));
+  if(!stub.ParseFromString(data)) {
+    GOOGLE_LOG(WARNING) << "ParsePartialFromXmlString failed: " << stub.GetErrorText();
+    return false;
+  }
+  return true;
+}
+
+bool HandshakeResponse::SerializeToXmlString(std::string* output) const {
+  output->clear();
+  if (!this->IsInitialized()) {
+    GOOGLE_LOG(WARNING)
+      << "SerializeToXmlString failed: missing required fields: "
+      << this->InitializationErrorString();
+    return false;
+  }
+
+  ::google::protobuf::xml::XmlMessage stub(*const_cast<HandshakeResponse*>(this));
+  output->assign(stub.SerializeToString());
+  return true;
+}
+
+bool HandshakeResponse::SerializePartialToXmlString(std::string* output) const {
+  output->clear();
+
+  ::google::protobuf::xml::XmlMessage stub(*const_cast<HandshakeResponse*>(this));
+  output->assign(stub.SerializeToString());
+  return true;
+}
+
+void HandshakeResponse::Swap(HandshakeResponse* other) {
+  if (other != this) {
+    std::swap(version_, other->version_);
+    methods_.Swap(&other->methods_);
+    std::swap(crc32c_, other->crc32c_);
+    std::swap(chunked_, other->chunked_);
+    std::swap(_has_bits_[0], other->_has_bits_[0]);
+    _unknown_fields_.Swap(&other->_unknown_fields_);
+    std::swap(_cached_size_, other->_cached_size_);
+  }
+}
+
+::google::protobuf::Metadata HandshakeResponse::GetMetadata() const {
+  protobuf_AssignDescriptorsOnce();
+  ::google::protobuf::Metadata metadata;
+  metadata.descriptor = HandshakeResponse_descriptor_;
+  metadata.reflection = HandshakeResponse_reflection_;
+  return metadata;
+}
+
+
 // @@protoc_insertion_point(namespace_scope)
 
 }  // namespace wire
@@ -23,6 +23,7 @@
 #include <google/protobuf/message.h>
 #include <google/protobuf/repeated_field.h>
 #include <google/protobuf/extension_set.h>
+#include <google/protobuf/generated_enum_reflection.h>
 #include <google/protobuf/generated_message_reflection.h>
 #include <google/protobuf/xml/xml_message.h>
 #include <google/protobuf/unknown_field_set.h>
@@ -41,7 +42,53 @@ void protobuf_ShutdownFile_wire_2eproto();
 class Const;
 class RequestHeader;
 class ResponseHeader;
+class HandshakeRequest;
+class HandshakeResponse;
+
+enum HeaderFlags {
+  FLAG_CHECKSUM = 1,
+  FLAG_COMPRESSED = 2,
+  FLAG_CRC32C = 4,
+  FLAG_CHUNKED = 8
+};
+bool HeaderFlags_IsValid(int value);
+const HeaderFlags HeaderFlags_MIN = FLAG_CHECKSUM;
+const HeaderFlags HeaderFlags_MAX = FLAG_CHUNKED;
+const int HeaderFlags_ARRAYSIZE = HeaderFlags_MAX + 1;
+
+const ::google::protobuf::EnumDescriptor* HeaderFlags_descriptor();
+inline const ::std::string& HeaderFlags_Name(HeaderFlags value) {
+  return ::google::protobuf::internal::NameOfEnum(
+    HeaderFlags_descriptor(), value);
+}
+inline bool HeaderFlags_Parse(
+    const ::std::string& name, HeaderFlags* value) {
+  return ::google::protobuf::internal::ParseNamedEnum<HeaderFlags>(
+    HeaderFlags_descriptor(), name, value);
+}
+enum StreamFrame {
+  STREAM_NONE = 0,
+  STREAM_OPEN = 1,
+  STREAM_MESSAGE = 2,
+  STREAM_END = 3,
+  STREAM_WINDOW = 4,
+  STREAM_CANCEL = 5
+};
+bool StreamFrame_IsValid(int value);
+const StreamFrame StreamFrame_MIN = STREAM_NONE;
+const StreamFrame StreamFrame_MAX = STREAM_CANCEL;
+const int StreamFrame_ARRAYSIZE = StreamFrame_MAX + 1;
 
+const ::google::protobuf::EnumDescriptor* StreamFrame_descriptor();
+inline const ::std::string& StreamFrame_Name(StreamFrame value) {
+  return ::google::protobuf::internal::NameOfEnum(
+    StreamFrame_descriptor(), value);
+}
+inline bool StreamFrame_Parse(
+    const ::std::string& name, StreamFrame* value) {
+  return ::google::protobuf::internal::ParseNamedEnum<StreamFrame>(
+    StreamFrame_descriptor(), name, value);
+}
 // ===================================================================
 
 class Const : public ::google::protobuf::Message {
@@ -248,6 +295,41 @@ class RequestHeader : public ::google::protobuf::Message {
   inline ::google::protobuf::uint32 checksum() const;
   inline void set_checksum(::google::protobuf::uint32 value);
 
+  // optional uint32 timeout_ms = 6;
+  inline bool has_timeout_ms() const;
+  inline void clear_timeout_ms();
+  static const int kTimeoutMsFieldNumber = 6;
+  inline ::google::protobuf::uint32 timeout_ms() const;
+  inline void set_timeout_ms(::google::protobuf::uint32 value);
+
+  // optional uint32 method_id = 16;
+  inline bool has_method_id() const;
+  inline void clear_method_id();
+  static const int kMethodIdFieldNumber = 16;
+  inline ::google::protobuf::uint32 method_id() const;
+  inline void set_method_id(::google::protobuf::uint32 value);
+
+  // optional uint32 flags = 17;
+  inline bool has_flags() const;
+  inline void clear_flags();
+  static const int kFlagsFieldNumber = 17;
+  inline ::google::protobuf::uint32 flags() const;
+  inline void set_flags(::google::protobuf::uint32 value);
+
+  // optional .google.protobuf.rpc.wire.StreamFrame stream = 18;
+  inline bool has_stream() const;
+  inline void clear_stream();
+  static const int kStreamFieldNumber = 18;
+  inline ::google::protobuf::rpc::wire::StreamFrame stream() const;
+  inline void set_stream(::google::protobuf::rpc::wire::StreamFrame value);
+
+  // optional uint32 window = 19;
+  inline bool has_window() const;
+  inline void clear_window();
+  static const int kWindowFieldNumber = 19;
+  inline ::google::protobuf::uint32 window() const;
+  inline void set_window(::google::protobuf::uint32 value);
+
   // @@protoc_insertion_point(class_scope:google.protobuf.rpc.wire.RequestHeader)
  private:
   inline void set_has_id();
@@ -260,6 +342,16 @@ class RequestHeader : public ::google::protobuf::Message {
   inline void clear_has_snappy_compressed_request_len();
   inline void set_has_checksum();
   inline void clear_has_checksum();
+  inline void set_has_timeout_ms();
+  inline void clear_has_timeout_ms();
+  inline void set_has_method_id();
+  inline void clear_has_method_id();
+  inline void set_has_flags();
+  inline void clear_has_flags();
+  inline void set_has_stream();
+  inline void clear_has_stream();
+  inline void set_has_window();
+  inline void clear_has_window();
 
   ::google::protobuf::UnknownFieldSet _unknown_fields_;
 
@@ -268,9 +360,14 @@ class RequestHeader : public ::google::protobuf::Message {
   ::google::protobuf::uint32 raw_request_len_;
   ::google::protobuf::uint32 snappy_compressed_request_len_;
   ::google::protobuf::uint32 checksum_;
+  ::google::protobuf::uint32 timeout_ms_;
+  ::google::protobuf::uint32 method_id_;
+  ::google::protobuf::uint32 flags_;
+  int stream_;
+  ::google::protobuf::uint32 window_;
 
   mutable int _cached_size_;
-  ::google::protobuf::uint32 _has_bits_[(5 + 31) / 32];
+  ::google::protobuf::uint32 _has_bits_[(10 + 31) / 32];
 
   friend void  protobuf_AddDesc_wire_2eproto();
   friend void protobuf_AssignDesc_wire_2eproto();
@@ -389,6 +486,27 @@ class ResponseHeader : public ::google::protobuf::Message {
   inline ::google::protobuf::uint32 checksum() const;
   inline void set_checksum(::google::protobuf::uint32 value);
 
+  // optional uint32 flags = 17;
+  inline bool has_flags() const;
+  inline void clear_flags();
+  static const int kFlagsFieldNumber = 17;
+  inline ::google::protobuf::uint32 flags() const;
+  inline void set_flags(::google::protobuf::uint32 value);
+
+  // optional .google.protobuf.rpc.wire.StreamFrame stream = 18;
+  inline bool has_stream() const;
+  inline void clear_stream();
+  static const int kStreamFieldNumber = 18;
+  inline ::google::protobuf::rpc::wire::StreamFrame stream() const;
+  inline void set_stream(::google::protobuf::rpc::wire::StreamFrame value);
+
+  // optional uint32 window = 19;
+  inline bool has_window() const;
+  inline void clear_window();
+  static const int kWindowFieldNumber = 19;
+  inline ::google::protobuf::uint32 window() const;
+  inline void set_window(::google::protobuf::uint32 value);
+
   // @@protoc_insertion_point(class_scope:google.protobuf.rpc.wire.ResponseHeader)
  private:
   inline void set_has_id();
@@ -401,6 +519,12 @@ class ResponseHeader : public ::google::protobuf::Message {
   inline void clear_has_snappy_compressed_response_len();
   inline void set_has_checksum();
   inline void clear_has_checksum();
+  inline void set_has_flags();
+  inline void clear_has_flags();
+  inline void set_has_stream();
+  inline void clear_has_stream();
+  inline void set_has_window();
+  inline void clear_has_window();
 
   ::google::protobuf::UnknownFieldSet _unknown_fields_;
 
@@ -409,9 +533,12 @@ class ResponseHeader : public ::google::protobuf::Message {
   ::google::protobuf::uint32 raw_response_len_;
   ::google::protobuf::uint32 snappy_compressed_response_len_;
   ::google::protobuf::uint32 checksum_;
+  ::google::protobuf::uint32 flags_;
+  int stream_;
+  ::google::protobuf::uint32 window_;
 
   mutable int _cached_size_;
-  ::google::protobuf::uint32 _has_bits_[(5 + 31) / 32];
+  ::google::protobuf::uint32 _has_bits_[(8 + 31) / 32];
 
   friend void  protobuf_AddDesc_wire_2eproto();
   friend void protobuf_AssignDesc_wire_2eproto();
@@ -420,6 +547,255 @@ class ResponseHeader : public ::google::protobuf::Message {
   void InitAsDefaultInstance();
   static ResponseHeader* default_instance_;
 };
+// -------------------------------------------------------------------
+
+class HandshakeRequest : public ::google::protobuf::Message {
+ public:
+  HandshakeRequest();
+  virtual ~HandshakeRequest();
+
+  HandshakeRequest(const HandshakeRequest& from);
+
+  inline HandshakeRequest& operator=(const HandshakeRequest& from) {
+    CopyFrom(from);
+    return *this;
+  }
+
+  inline const ::google::protobuf::UnknownFieldSet& unknown_fields() const {
+    return _unknown_fields_;
+  }
+
+  inline ::google::protobuf::UnknownFieldSet* mutable_unknown_fields() {
+    return &_unknown_fields_;
+  }
+
+  static const ::google::protobuf::Descriptor* descriptor();
+  static const HandshakeRequest& default_instance();
+
+  void Swap(HandshakeRequest* other);
+
+  // implements Message ----------------------------------------------
+
+  HandshakeRequest* New() const;
+  void CopyFrom(const ::google::protobuf::Message& from);
+  void MergeFrom(const ::google::protobuf::Message& from);
+  void CopyFrom(const HandshakeRequest& from);
+  void MergeFrom(const HandshakeRequest& from);
+  void Clear();
+  bool IsInitialized() const;
+
+  int ByteSize() const;
+  bool MergePartialFromCodedStream(
+      ::google::protobuf::io::CodedInputStream* input);
+  void SerializeWithCachedSizes(
+      ::google::protobuf::io::CodedOutputStream* output) const;
+  ::google::protobuf::uint8* SerializeWithCachedSizesToArray(::google::protobuf::uint8* output) const;
+  int GetCachedSize() const { return _cached_size_; }
+  private:
+  void SharedCtor();
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  public:
+
+  ::google::protobuf::Metadata GetMetadata() const;
+
+  // xml support -----------------------------------------------------
+
+  // Parse a protocol buffer contained in a string.
+  bool ParseFromXmlString(const std::string& data);
+  // Like ParseFromXmlString(), but accepts messages that are missing
+  // required fields.
+  bool ParsePartialFromXmlString(const std::string& data);
+
+  // Serialize the message and store it in the given string.  All required
+  // fields must be set.
+  bool SerializeToXmlString(std::string* output) const;
+  // Like SerializeToXmlString(), but allows missing required fields.
+  bool SerializePartialToXmlString(std::string* output) const;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  // optional uint32 version = 1;
+  inline bool has_version() const;
+  inline void clear_version();
+  static const int kVersionFieldNumber = 1;
+  inline ::google::protobuf::uint32 version() const;
+  inline void set_version(::google::protobuf::uint32 value);
+
+  // optional bool crc32c = 2;
+  inline bool has_crc32c() const;
+  inline void clear_crc32c();
+  static const int kCrc32CFieldNumber = 2;
+  inline bool crc32c() const;
+  inline void set_crc32c(bool value);
+
+  // optional bool chunked = 3;
+  inline bool has_chunked() const;
+  inline void clear_chunked();
+  static const int kChunkedFieldNumber = 3;
+  inline bool chunked() const;
+  inline void set_chunked(bool value);
+
+  // @@protoc_insertion_point(class_scope:google.protobuf.rpc.wire.HandshakeRequest)
+ private:
+  inline void set_has_version();
+  inline void clear_has_version();
+  inline void set_has_crc32c();
+  inline void clear_has_crc32c();
+  inline void set_has_chunked();
+  inline void clear_has_chunked();
+
+  ::google::protobuf::UnknownFieldSet _unknown_fields_;
+
+  ::google::protobuf::uint32 version_;
+  bool crc32c_;
+  bool chunked_;
+
+  mutable int _cached_size_;
+  ::google::protobuf::uint32 _has_bits_[(3 + 31) / 32];
+
+  friend void  protobuf_AddDesc_wire_2eproto();
+  friend void protobuf_AssignDesc_wire_2eproto();
+  friend void protobuf_ShutdownFile_wire_2eproto();
+
+  void InitAsDefaultInstance();
+  static HandshakeRequest* default_instance_;
+};
+// -------------------------------------------------------------------
+
+class HandshakeResponse : public ::google::protobuf::Message {
+ public:
+  HandshakeResponse();
+  virtual ~HandshakeResponse();
+
+  HandshakeResponse(const HandshakeResponse& from);
+
+  inline HandshakeResponse& operator=(const HandshakeResponse& from) {
+    CopyFrom(from);
+    return *this;
+  }
+
+  inline const ::google::protobuf::UnknownFieldSet& unknown_fields() const {
+    return _unknown_fields_;
+  }
+
+  inline ::google::protobuf::UnknownFieldSet* mutable_unknown_fields() {
+    return &_unknown_fields_;
+  }
+
+  static const ::google::protobuf::Descriptor* descriptor();
+  static const HandshakeResponse& default_instance();
+
+  void Swap(HandshakeResponse* other);
+
+  // implements Message ----------------------------------------------
+
+  HandshakeResponse* New() const;
+  void CopyFrom(const ::google::protobuf::Message& from);
+  void MergeFrom(const ::google::protobuf::Message& from);
+  void CopyFrom(const HandshakeResponse& from);
+  void MergeFrom(const HandshakeResponse& from);
+  void Clear();
+  bool IsInitialized() const;
+
+  int ByteSize() const;
+  bool MergePartialFromCodedStream(
+      ::google::protobuf::io::CodedInputStream* input);
+  void SerializeWithCachedSizes(
+      ::google::protobuf::io::CodedOutputStream* output) const;
+  ::google::protobuf::uint8* SerializeWithCachedSizesToArray(::google::protobuf::uint8* output) const;
+  int GetCachedSize() const { return _cached_size_; }
+  private:
+  void SharedCtor();
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  public:
+
+  ::google::protobuf::Metadata GetMetadata() const;
+
+  // xml support -----------------------------------------------------
+
+  // Parse a protocol buffer contained in a string.
+  bool ParseFromXmlString(const std::string& data);
+  // Like ParseFromXmlString(), but accepts messages that are missing
+  // required fields.
+  bool ParsePartialFromXmlString(const std::string& data);
+
+  // Serialize the message and store it in the given string.  All required
+  // fields must be set.
+  bool SerializeToXmlString(std::string* output) const;
+  // Like SerializeToXmlString(), but allows missing required fields.
+  bool SerializePartialToXmlString(std::string* output) const;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  // optional uint32 version = 1;
+  inline bool has_version() const;
+  inline void clear_version();
+  static const int kVersionFieldNumber = 1;
+  inline ::google::protobuf::uint32 version() const;
+  inline void set_version(::google::protobuf::uint32 value);
+
+  // repeated string methods = 2;
+  inline int methods_size() const;
+  inline void clear_methods();
+  static const int kMethodsFieldNumber = 2;
+  inline const ::std::string& methods(int index) const;
+  inline ::std::string* mutable_methods(int index);
+  inline void set_methods(int index, const ::std::string& value);
+  inline void set_methods(int index, const char* value);
+  inline void set_methods(int index, const char* value, size_t size);
+  inline ::std::string* add_methods();
+  inline void add_methods(const ::std::string& value);
+  inline void add_methods(const char* value);
+  inline void add_methods(const char* value, size_t size);
+  inline const ::google::protobuf::RepeatedPtrField< ::std::string>& methods() const;
+  inline ::google::protobuf::RepeatedPtrField< ::std::string>* mutable_methods();
+
+  // optional bool crc32c = 3;
+  inline bool has_crc32c() const;
+  inline void clear_crc32c();
+  static const int kCrc32CFieldNumber = 3;
+  inline bool crc32c() const;
+  inline void set_crc32c(bool value);
+
+  // optional bool chunked = 4;
+  inline bool has_chunked() const;
+  inline void clear_chunked();
+  static const int kChunkedFieldNumber = 4;
+  inline bool chunked() const;
+  inline void set_chunked(bool value);
+
+  // @@protoc_insertion_point(class_scope:google.protobuf.rpc.wire.HandshakeResponse)
+ private:
+  inline void set_has_version();
+  inline void clear_has_version();
+  inline void set_has_crc32c();
+  inline void clear_has_crc32c();
+  inline void set_has_chunked();
+  inline void clear_has_chunked();
+
+  ::google::protobuf::UnknownFieldSet _unknown_fields_;
+
+  ::google::protobuf::RepeatedPtrField< ::std::string> methods_;
+  ::google::protobuf::uint32 version_;
+  bool crc32c_;
+  bool chunked_;
+
+  mutable int _cached_size_;
+  ::google::protobuf::uint32 _has_bits_[(4 + 31) / 32];
+
+  friend void  protobuf_AddDesc_wire_2eproto();
+  friend void protobuf_AssignDesc_wire_2eproto();
+  friend void protobuf_ShutdownFile_wire_2eproto();
+
+  void InitAsDefaultInstance();
+  static HandshakeResponse* default_instance_;
+};
 // ===================================================================
 
 
@@ -611,6 +987,117 @@ inline void RequestHeader::set_checksum(::google::protobuf::uint32 value) {
   checksum_ = value;
 }
 
+// optional uint32 timeout_ms = 6;
+inline bool RequestHeader::has_timeout_ms() const {
+  return (_has_bits_[0] & 0x00000020u) != 0;
+}
+inline void RequestHeader::set_has_timeout_ms() {
+  _has_bits_[0] |= 0x00000020u;
+}
+inline void RequestHeader::clear_has_timeout_ms() {
+  _has_bits_[0] &= ~0x00000020u;
+}
+inline void RequestHeader::clear_timeout_ms() {
+  timeout_ms_ = 0u;
+  clear_has_timeout_ms();
+}
+inline ::google::protobuf::uint32 RequestHeader::timeout_ms() const {
+  return timeout_ms_;
+}
+inline void RequestHeader::set_timeout_ms(::google::protobuf::uint32 value) {
+  set_has_timeout_ms();
+  timeout_ms_ = value;
+}
+
+// optional uint32 method_id = 16;
+inline bool RequestHeader::has_method_id() const {
+  return (_has_bits_[0] & 0x00000040u) != 0;
+}
+inline void RequestHeader::set_has_method_id() {
+  _has_bits_[0] |= 0x00000040u;
+}
+inline void RequestHeader::clear_has_method_id() {
+  _has_bits_[0] &= ~0x00000040u;
+}
+inline void RequestHeader::clear_method_id() {
+  method_id_ = 0u;
+  clear_has_method_id();
+}
+inline ::google::protobuf::uint32 RequestHeader::method_id() const {
+  return method_id_;
+}
+inline void RequestHeader::set_method_id(::google::protobuf::uint32 value) {
+  set_has_method_id();
+  method_id_ = value;
+}
+
+// optional uint32 flags = 17;
+inline bool RequestHeader::has_flags() const {
+  return (_has_bits_[0] & 0x00000080u) != 0;
+}
+inline void RequestHeader::set_has_flags() {
+  _has_bits_[0] |= 0x00000080u;
+}
+inline void RequestHeader::clear_has_flags() {
+  _has_bits_[0] &= ~0x00000080u;
+}
+inline void RequestHeader::clear_flags() {
+  flags_ = 0u;
+  clear_has_flags();
+}
+inline ::google::protobuf::uint32 RequestHeader::flags() const {
+  return flags_;
+}
+inline void RequestHeader::set_flags(::google::protobuf::uint32 value) {
+  set_has_flags();
+  flags_ = value;
+}
+
+// optional .google.protobuf.rpc.wire.StreamFrame stream = 18;
+inline bool RequestHeader::has_stream() const {
+  return (_has_bits_[0] & 0x00000100u) != 0;
+}
+inline void RequestHeader::set_has_stream() {
+  _has_bits_[0] |= 0x00000100u;
+}
+inline void RequestHeader::clear_has_stream() {
+  _has_bits_[0] &= ~0x00000100u;
+}
+inline void RequestHeader::clear_stream() {
+  stream_ = 0;
+  clear_has_stream();
+}
+inline ::google::protobuf::rpc::wire::StreamFrame RequestHeader::stream() const {
+  return static_cast< ::google::protobuf::rpc::wire::StreamFrame >(stream_);
+}
+inline void RequestHeader::set_stream(::google::protobuf::rpc::wire::StreamFrame value) {
+  assert(::google::protobuf::rpc::wire::StreamFrame_IsValid(value));
+  set_has_stream();
+  stream_ = value;
+}
+
+// optional uint32 window = 19;
+inline bool RequestHeader::has_window() const {
+  return (_has_bits_[0] & 0x00000200u) != 0;
+}
+inline void RequestHeader::set_has_window() {
+  _has_bits_[0] |= 0x00000200u;
+}
+inline void RequestHeader::clear_has_window() {
+  _has_bits_[0] &= ~0x00000200u;
+}
+inline void RequestHeader::clear_window() {
+  window_ = 0u;
+  clear_has_window();
+}
+inline ::google::protobuf::uint32 RequestHeader::window() const {
+  return window_;
+}
+inline void RequestHeader::set_window(::google::protobuf::uint32 value) {
+  set_has_window();
+  window_ = value;
+}
+
 // -------------------------------------------------------------------
 
 // ResponseHeader
@@ -773,6 +1260,257 @@ inline void ResponseHeader::set_checksum(::google::protobuf::uint32 value) {
   checksum_ = value;
 }
 
+// optional uint32 flags = 17;
+inline bool ResponseHeader::has_flags() const {
+  return (_has_bits_[0] & 0x00000020u) != 0;
+}
+inline void ResponseHeader::set_has_flags() {
+  _has_bits_[0] |= 0x00000020u;
+}
+inline void ResponseHeader::clear_has_flags() {
+  _has_bits_[0] &= ~0x00000020u;
+}
+inline void ResponseHeader::clear_flags() {
+  flags_ = 0u;
+  clear_has_flags();
+}
+inline ::google::protobuf::uint32 ResponseHeader::flags() const {
+  return flags_;
+}
+inline void ResponseHeader::set_flags(::google::protobuf::uint32 value) {
+  set_has_flags();
+  flags_ = value;
+}
+
+// optional .google.protobuf.rpc.wire.StreamFrame stream = 18;
+inline bool ResponseHeader::has_stream() const {
+  return (_has_bits_[0] & 0x00000040u) != 0;
+}
+inline void ResponseHeader::set_has_stream() {
+  _has_bits_[0] |= 0x00000040u;
+}
+inline void ResponseHeader::clear_has_stream() {
+  _has_bits_[0] &= ~0x00000040u;
+}
+inline void ResponseHeader::clear_stream() {
+  stream_ = 0;
+  clear_has_stream();
+}
+inline ::google::protobuf::rpc::wire::StreamFrame ResponseHeader::stream() const {
+  return static_cast< ::google::protobuf::rpc::wire::StreamFrame >(stream_);
+}
+inline void ResponseHeader::set_stream(::google::protobuf::rpc::wire::StreamFrame value) {
+  assert(::google::protobuf::rpc::wire::StreamFrame_IsValid(value));
+  set_has_stream();
+  stream_ = value;
+}
+
+// optional uint32 window = 19;
+inline bool ResponseHeader::has_window() const {
+  return (_has_bits_[0] & 0x00000080u) != 0;
+}
+inline void ResponseHeader::set_has_window() {
+  _has_bits_[0] |= 0x00000080u;
+}
+inline void ResponseHeader::clear_has_window() {
+  _has_bits_[0] &= ~0x00000080u;
+}
+inline void ResponseHeader::clear_window() {
+  window_ = 0u;
+  clear_has_window();
+}
+inline ::google::protobuf::uint32 ResponseHeader::window() const {
+  return window_;
+}
+inline void ResponseHeader::set_window(::google::protobuf::uint32 value) {
+  set_has_window();
+  window_ = value;
+}
+
+// -------------------------------------------------------------------
+
+// HandshakeRequest
+
+// optional uint32 version = 1;
+inline bool HandshakeRequest::has_version() const {
+  return (_has_bits_[0] & 0x00000001u) != 0;
+}
+inline void HandshakeRequest::set_has_version() {
+  _has_bits_[0] |= 0x00000001u;
+}
+inline void HandshakeRequest::clear_has_version() {
+  _has_bits_[0] &= ~0x00000001u;
+}
+inline void HandshakeRequest::clear_version() {
+  version_ = 0u;
+  clear_has_version();
+}
+inline ::google::protobuf::uint32 HandshakeRequest::version() const {
+  return version_;
+}
+inline void HandshakeRequest::set_version(::google::protobuf::uint32 value) {
+  set_has_version();
+  version_ = value;
+}
+
+// optional bool crc32c = 2;
+inline bool HandshakeRequest::has_crc32c() const {
+  return (_has_bits_[0] & 0x00000002u) != 0;
+}
+inline void HandshakeRequest::set_has_crc32c() {
+  _has_bits_[0] |= 0x00000002u;
+}
+inline void HandshakeRequest::clear_has_crc32c() {
+  _has_bits_[0] &= ~0x00000002u;
+}
+inline void HandshakeRequest::clear_crc32c() {
+  crc32c_ = false;
+  clear_has_crc32c();
+}
+inline bool HandshakeRequest::crc32c() const {
+  return crc32c_;
+}
+inline void HandshakeRequest::set_crc32c(bool value) {
+  set_has_crc32c();
+  crc32c_ = value;
+}
+
+// optional bool chunked = 3;
+inline bool HandshakeRequest::has_chunked() const {
+  return (_has_bits_[0] & 0x00000004u) != 0;
+}
+inline void HandshakeRequest::set_has_chunked() {
+  _has_bits_[0] |= 0x00000004u;
+}
+inline void HandshakeRequest::clear_has_chunked() {
+  _has_bits_[0] &= ~0x00000004u;
+}
+inline void HandshakeRequest::clear_chunked() {
+  chunked_ = false;
+  clear_has_chunked();
+}
+inline bool HandshakeRequest::chunked() const {
+  return chunked_;
+}
+inline void HandshakeRequest::set_chunked(bool value) {
+  set_has_chunked();
+  chunked_ = value;
+}
+
+// -------------------------------------------------------------------
+
+// HandshakeResponse
+
+// optional uint32 version = 1;
+inline bool HandshakeResponse::has_version() const {
+  return (_has_bits_[0] & 0x00000001u) != 0;
+}
+inline void HandshakeResponse::set_has_version() {
+  _has_bits_[0] |= 0x00000001u;
+}
+inline void HandshakeResponse::clear_has_version() {
+  _has_bits_[0] &= ~0x00000001u;
+}
+inline void HandshakeResponse::clear_version() {
+  version_ = 0u;
+  clear_has_version();
+}
+inline ::google::protobuf::uint32 HandshakeResponse::version() const {
+  return version_;
+}
+inline void HandshakeResponse::set_version(::google::protobuf::uint32 value) {
+  set_has_version();
+  version_ = value;
+}
+
+// repeated string methods = 2;
+inline int HandshakeResponse::methods_size() const {
+  return methods_.size();
+}
+inline void HandshakeResponse::clear_methods() {
+  methods_.Clear();
+}
+inline const ::std::string& HandshakeResponse::methods(int index) const {
+  return methods_.Get(index);
+}
+inline ::std::string* HandshakeResponse::mutable_methods(int index) {
+  return methods_.Mutable(index);
+}
+inline void HandshakeResponse::set_methods(int index, const ::std::string& value) {
+  methods_.Mutable(index)->assign(value);
+}
+inline void HandshakeResponse::set_methods(int index, const char* value) {
+  methods_.Mutable(index)->assign(value);
+}
+inline void HandshakeResponse::set_methods(int index, const char* value, size_t size) {
+  methods_.Mutable(index)->assign(
+    reinterpret_cast<const char*>(value), size);
+}
+inline ::std::string* HandshakeResponse::add_methods() {
+  return methods_.Add();
+}
+inline void HandshakeResponse::add_methods(const ::std::string& value) {
+  methods_.Add()->assign(value);
+}
+inline void HandshakeResponse::add_methods(const char* value) {
+  methods_.Add()->assign(value);
+}
+inline void HandshakeResponse::add_methods(const char* value, size_t size) {
+  methods_.Add()->assign(reinterpret_cast<const char*>(value), size);
+}
+inline const ::google::protobuf::RepeatedPtrField< ::std::string>&
+HandshakeResponse::methods() const {
+  return methods_;
+}
+inline ::google::protobuf::RepeatedPtrField< ::std::string>*
+HandshakeResponse::mutable_methods() {
+  return &methods_;
+}
+
+// optional bool crc32c = 3;
+inline bool HandshakeResponse::has_crc32c() const {
+  return (_has_bits_[0] & 0x00000004u) != 0;
+}
+inline void HandshakeResponse::set_has_crc32c() {
+  _has_bits_[0] |= 0x00000004u;
+}
+inline void HandshakeResponse::clear_has_crc32c() {
+  _has_bits_[0] &= ~0x00000004u;
+}
+inline void HandshakeResponse::clear_crc32c() {
+  crc32c_ = false;
+  clear_has_crc32c();
+}
+inline bool HandshakeResponse::crc32c() const {
+  return crc32c_;
+}
+inline void HandshakeResponse::set_crc32c(bool value) {
+  set_has_crc32c();
+  crc32c_ = value;
+}
+
+// optional bool chunked = 4;
+inline bool HandshakeResponse::has_chunked() const {
+  return (_has_bits_[0] & 0x00000008u) != 0;
+}
+inline void HandshakeResponse::set_has_chunked() {
+  _has_bits_[0] |= 0x00000008u;
+}
+inline void HandshakeResponse::clear_has_chunked() {
+  _has_bits_[0] &= ~0x00000008u;
+}
+inline void HandshakeResponse::clear_chunked() {
+  chunked_ = false;
+  clear_has_chunked();
+}
+inline bool HandshakeResponse::chunked() const {
+  return chunked_;
+}
+inline void HandshakeResponse::set_chunked(bool value) {
+  set_has_chunked();
+  chunked_ = value;
+}
+
 
 // @@protoc_insertion_point(namespace_scope)
 
@@ -785,6 +1523,14 @@ inline void ResponseHeader::set_checksum(::google::protobuf::uint32 value) {
 namespace google {
 namespace protobuf {
 
+template <>
+inline const EnumDescriptor* GetEnumDescriptor< ::google::protobuf::rpc::wire::HeaderFlags>() {
+  return ::google::protobuf::rpc::wire::HeaderFlags_descriptor();
+}
+template <>
+inline const EnumDescriptor* GetEnumDescriptor< ::google::protobuf::rpc::wire::StreamFrame>() {
+  return ::google::protobuf::rpc::wire::StreamFrame_descriptor();
+}
 
 }  // namespace google
 }  // namespace protobuf
@@ -0,0 +1,1190 @@
+// Copyright 2013 <chaishushan{AT}gmail.com>. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+// Micro benchmarks of the rpc package.
+//
+// Usage: rpcbench [name]   (run all the benchmarks by default)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <vector>
+
+#include "./service.pb/echo.pb.h"
+#include "./service.pb/stream.pb.h"
+
+#include <google/protobuf/rpc/rpc_env.h>
+#include <google/protobuf/rpc/rpc_server.h>
+#include <google/protobuf/rpc/rpc_client.h>
+#include <google/protobuf/rpc/rpc_wire.h>
+#include <google/protobuf/rpc/rpc_crc32.h>
+
+#include <snappy.h>
+
+#if (defined(_WIN32) || defined(_WIN64))
+#  include <windows.h>
+#  define sleepMillis(ms) Sleep(ms)
+#else
+#  include <unistd.h>
+#  define sleepMillis(ms) usleep((ms)*1000)
+#endif
+
+using ::google::protobuf::uint64;
+
+// Heap allocations of the process (all threads), and the bytes they
+// hold: each block starts with its size.
+static std::atomic<uint64> numAllocs(0);
+static std::atomic<uint64> heapBytes(0);
+static std::atomic<uint64> peakHeapBytes(0);
+static const size_t kAllocHeaderLen = 16;
+
+void* operator new(size_t size) {
+  numAllocs++;
+  char* p = (char*)malloc(kAllocHeaderLen + size);
+  if(p == NULL) {
+    throw std::bad_alloc();
+  }
+  *(size_t*)p = size;
+  uint64 bytes = heapBytes += size;
+  uint64 peak = peakHeapBytes.load(std::memory_order_relaxed);
+  while(bytes > peak && !peakHeapBytes.compare_exchange_weak(peak, bytes)) {
+  }
+  return p + kAllocHeaderLen;
+}
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+void operator delete(void* p) noexcept {
+  if(p != NULL) {
+    char* block = (char*)p - kAllocHeaderLen;
+    heapBytes -= *(size_t*)block;
+    free(block);
+  }
+}
+void operator delete[](void* p) noexcept {
+  operator delete(p);
+}
+void operator delete(void* p, size_t) noexcept {
+  operator delete(p);
+}
+void operator delete[](void* p, size_t) noexcept {
+  operator delete(p);
+}
+
+class EchoService: public service::EchoService {
+ public:
+  inline EchoService() {}
+  virtual ~EchoService() {}
+
+  virtual const ::google::protobuf::rpc::Error Echo(
+    const ::service::EchoRequest* request,
+    ::service::EchoResponse* response
+  ) {
+    response->set_msg(request->msg());
+    return ::google::protobuf::rpc::Error::Nil();
+  }
+};
+
+// Exports request->n() rows of request->data(), streamed or as one message.
+class StreamService: public service::StreamService {
+ public:
+  inline StreamService() {}
+  virtual ~StreamService() {}
+
+  virtual const ::google::protobuf::rpc::Error List(
+    const ::service::StreamRequest* request,
+    ::google::protobuf::rpc::StreamWriter< ::service::StreamResponse>* writer
+  ) {
+    ::service::StreamResponse row;
+    row.set_data(request->data());
+    for(int i = 0; i < request->n(); i++) {
+      row.set_n(i);
+      auto err = writer->Write(row);
+      if(!err.IsNil()) return err;
+    }
+    return ::google::protobuf::rpc::Error::Nil();
+  }
+  virtual const ::google::protobuf::rpc::Error Echo(
+    const ::service::StreamRequest* request,
+    ::service::StreamResponse* response
+  ) {
+    auto data = response->mutable_data();
+    data->clear();
+    for(int i = 0; i < request->n(); i++) {
+      data->append(request->data());
+    }
+    response->set_n(request->n());
+    return ::google::protobuf::rpc::Error::Nil();
+  }
+};
+
+static ::google::protobuf::rpc::Env* env() {
+  return ::google::protobuf::rpc::Env::Default();
+}
+
+// Print the latency distribution of samples (in micro-seconds).
+static void report(const char* name, std::vector<uint64>* samples, uint64 elapsed) {
+  std::sort(samples->begin(), samples->end());
+  uint64 sum = 0;
+  for(size_t i = 0; i < samples->size(); i++) {
+    sum += (*samples)[i];
+  }
+  size_t n = samples->size();
+  printf("%-24s %8d calls  avg %7.2f us  p50 %5d us  p99 %5d us  %8.0f calls/s\n",
+    name, int(n), double(sum)/double(n),
+    int((*samples)[n/2]), int((*samples)[n*99/100]),
+    double(n)*1e6/double(elapsed)
+  );
+}
+
+// --------------------------------------------------------
+// TCP loopback vs unix domain socket vs shared memory round trip
+// on EchoService.Echo.
+
+static const int kTransportPort = 12351;
+static const char* kTransportUnixPath = "@protorpc-rpcbench";
+static const char* kTransportShmPath = "@protorpc-rpcbench-shm";
+
+static void serveTransport(void* arg) {
+  auto server = (::google::protobuf::rpc::Server*)arg;
+  server->ServeEventLoop(1);
+}
+
+static bool benchEcho(const char* name, ::google::protobuf::rpc::Client* client, int n) {
+  service::EchoService::Stub stub(client);
+  ::service::EchoRequest args;
+  ::service::EchoResponse reply;
+  args.set_msg(std::string(64, 'x'));
+
+  // warm up, the server may still be starting
+  for(int i = 0; i < 100; i++) {
+    if(!stub.Echo(&args, &reply).IsNil()) {
+      if(i == 99) {
+        fprintf(stderr, "%s: EchoService.Echo failed\n", name);
+        return false;
+      }
+      sleepMillis(20);
+    }
+  }
+
+  std::vector<uint64> samples(n);
+  uint64 start = env()->NowMicros();
+  for(int i = 0; i < n; i++) {
+    uint64 t = env()->NowMicros();
+    if(!stub.Echo(&args, &reply).IsNil()) {
+      fprintf(stderr, "%s: EchoService.Echo failed\n", name);
+      return false;
+    }
+    samples[i] = env()->NowMicros() - t;
+  }
+  report(name, &samples, env()->NowMicros() - start);
+  return true;
+}
+
+static bool benchTransport() {
+  auto server = new ::google::protobuf::rpc::Server;
+  server->AddService(new EchoService, true);
+  if(!server->ListenTCP(kTransportPort)) {
+    fprintf(stderr, "transport: ListenTCP failed\n");
+    return false;
+  }
+  bool has_unix = server->ListenUnix(kTransportUnixPath);
+  bool has_shm = server->ListenShm(kTransportShmPath);
+  env()->StartThread(serveTransport, server);
+
+  const int n = 20000;
+  ::google::protobuf::rpc::Client tcp("127.0.0.1", kTransportPort);
+  if(!benchEcho("echo/tcp-loopback", &tcp, n)) {
+    return false;
+  }
+  if(has_unix) {
+    ::google::protobuf::rpc::Client uds(
+      (std::string("unix:") + kTransportUnixPath).c_str(), 0
+    );
+    if(!benchEcho("echo/unix", &uds, n)) {
+      return false;
+    }
+  } else {
+    printf("%-24s skipped, unix domain sockets not supported\n", "echo/unix");
+  }
+  if(has_shm) {
+    ::google::protobuf::rpc::Client shm(
+      (std::string("shm:") + kTransportShmPath).c_str(), 0
+    );
+    if(!benchEcho("echo/shm", &shm, n)) {
+      return false;
+    }
+  } else {
+    printf("%-24s skipped, shared memory transport not supported\n", "echo/shm");
+  }
+  return true;
+}
+
+// --------------------------------------------------------
+// Event loop backends: epoll vs io_uring, one connection and many
+// connections with pipelined calls.
+
+static const int kEpollPort = 12352;
+static const int kUringPort = 12353;
+
+static bool benchPipelined(const char* name, int port, int conns, int window, int rounds) {
+  std::vector<::google::protobuf::rpc::Client*> clients;
+  std::vector<service::EchoService::Stub*> stubs;
+  for(int i = 0; i < conns; i++) {
+    clients.push_back(new ::google::protobuf::rpc::Client("127.0.0.1", port));
+    stubs.push_back(new service::EchoService::Stub(clients.back()));
+  }
+  ::service::EchoRequest args;
+  args.set_msg(std::string(64, 'x'));
+  std::vector< ::service::EchoResponse> replies(conns*window);
+  std::vector< std::shared_ptr< ::google::protobuf::rpc::Future> > futures(conns*window);
+
+  bool ok = true;
+  uint64 start = env()->NowMicros();
+  for(int r = 0; r < rounds && ok; r++) {
+    for(int i = 0; i < conns*window; i++) {
+      futures[i] = stubs[i/window]->EchoAsync(&args, &replies[i]);
+    }
+    for(int i = 0; i < conns*window; i++) {
+      if(!futures[i]->Wait().IsNil()) {
+        fprintf(stderr, "%s: EchoService.Echo failed\n", name);
+        ok = false;
+      }
+    }
+  }
+  uint64 elapsed = env()->NowMicros() - start;
+  if(ok) {
+    int n = rounds*conns*window;
+    printf("%-24s %8d calls  %d conns x %d in flight  %8.0f calls/s\n",
+      name, n, conns, window, double(n)*1e6/double(elapsed)
+    );
+  }
+  for(int i = 0; i < conns; i++) {
+    delete stubs[i];
+    delete clients[i];
+  }
+  return ok;
+}
+
+static void serveEventLoop(void* arg) {
+  auto server = (::google::protobuf::rpc::Server*)arg;
+  server->ServeEventLoop(1);
+}
+
+static bool benchEventLoop() {
+  struct { const char* name; const char* many; int port; bool io_uring; } backends[] = {
+    { "loop/epoll", "loop/epoll-64conns", kEpollPort, false },
+    { "loop/io_uring", "loop/io_uring-64conns", kUringPort, true },
+  };
+  for(int i = 0; i < 2; i++) {
+    auto server = new ::google::protobuf::rpc::Server;
+    server->AddService(new EchoService, true);
+    server->SetIoUring(backends[i].io_uring);
+    if(!server->ListenTCP(backends[i].port)) {
+      fprintf(stderr, "%s: ListenTCP failed\n", backends[i].name);
+      return false;
+    }
+    env()->StartThread(serveEventLoop, server);
+
+    ::google::protobuf::rpc::Client client("127.0.0.1", backends[i].port);
+    if(!benchEcho(backends[i].name, &client, 20000)) {
+      return false;
+    }
+    if(!benchPipelined(backends[i].many, backends[i].port, 64, 8, 100)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// --------------------------------------------------------
+
+// --------------------------------------------------------
+// Request body decoding: copies (uncompress and parse strings) vs
+// wire::DecodeRequestBody (reused uncompress buffer, parse in place).
+
+static bool benchDecode() {
+  const int sizes[] = { 1024, 64*1024, 1024*1024 };
+  for(size_t k = 0; k < sizeof(sizes)/sizeof(sizes[0]); k++) {
+    ::service::EchoRequest args, req;
+    std::string msg(sizes[k], 'x');
+    for(size_t i = 0; i < msg.size(); i += 7) {
+      msg[i] = char('a' + i%26);
+    }
+    args.set_msg(msg);
+
+    std::string hdr, body;
+    ::google::protobuf::rpc::wire::MarshalRequest(1, "EchoService.Echo", &args, &hdr, &body);
+    ::google::protobuf::rpc::wire::RequestHeader header;
+    header.ParseFromString(hdr);
+
+    const int n = int(256*1024*1024 / (sizes[k] + 64*1024));
+    char name[2][64];
+    snprintf(name[0], sizeof(name[0]), "decode/copy-%dk", sizes[k]/1024);
+    snprintf(name[1], sizeof(name[1]), "decode/in-place-%dk", sizes[k]/1024);
+
+    for(int mode = 0; mode < 2; mode++) {
+      std::vector<uint64> samples(n);
+      uint64 start = env()->NowMicros();
+      for(int i = 0; i < n; i++) {
+        uint64 t = env()->NowMicros();
+        if(mode == 0) {
+          std::string frame(body), raw;
+          ::google::protobuf::rpc::HashCRC32(frame.data(), frame.size());
+          snappy::Uncompress(frame.data(), frame.size(), &raw);
+          req.ParseFromString(raw);
+        } else {
+          ::google::protobuf::rpc::wire::DecodeRequestBody(&header, body.data(), body.size(), &req);
+        }
+        samples[i] = env()->NowMicros() - t;
+      }
+      report(name[mode], &samples, env()->NowMicros() - start);
+      if(req.msg() != msg) {
+        fprintf(stderr, "%s: wrong message\n", name[mode]);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// --------------------------------------------------------
+// Heap allocations per call (client and server in this process) with
+// and without reusing the request/response messages.
+
+static const int kAllocPortBase = 12354;
+
+static void serveBlocking(void* arg) {
+  auto server = (::google::protobuf::rpc::Server*)arg;
+  server->Serve();
+}
+
+static bool benchAlloc() {
+  const struct {
+    const char* name;
+    bool event_loop;
+    int pool_size;
+  } modes[] = {
+    { "alloc/blocking-new", false, 0 },
+    { "alloc/blocking-pool", false, 4 },
+    { "alloc/loop-new", true, 0 },
+    { "alloc/loop-pool", true, 4 },
+  };
+  for(size_t k = 0; k < sizeof(modes)/sizeof(modes[0]); k++) {
+    int port = kAllocPortBase + int(k);
+    auto server = new ::google::protobuf::rpc::Server;
+    server->AddService(new EchoService, true);
+    server->SetMessagePoolSize(modes[k].pool_size);
+    if(!server->ListenTCP(port)) {
+      fprintf(stderr, "%s: ListenTCP failed\n", modes[k].name);
+      return false;
+    }
+    env()->StartThread(modes[k].event_loop? serveTransport: serveBlocking, server);
+
+    ::google::protobuf::rpc::Client client("127.0.0.1", port);
+    service::EchoService::Stub stub(&client);
+    ::service::EchoRequest args;
+    ::service::EchoResponse reply;
+    args.set_msg(std::string(1024, 'x'));
+
+    // warm up: connect and fill the pools and buffers
+    for(int i = 0; i < 200; i++) {
+      if(!stub.Echo(&args, &reply).IsNil()) {
+        if(i == 199) {
+          fprintf(stderr, "%s: EchoService.Echo failed\n", modes[k].name);
+          return false;
+        }
+        sleepMillis(20);
+      }
+    }
+
+    const int n = 10000;
+    uint64 allocs = numAllocs.load();
+    uint64 start = env()->NowMicros();
+    for(int i = 0; i < n; i++) {
+      if(!stub.Echo(&args, &reply).IsNil()) {
+        fprintf(stderr, "%s: EchoService.Echo failed\n", modes[k].name);
+        return false;
+      }
+    }
+    uint64 elapsed = env()->NowMicros() - start;
+    allocs = numAllocs.load() - allocs;
+    printf("%-24s %8d calls  %6.2f allocs/call  %8.0f calls/s\n",
+      modes[k].name, n, double(allocs)/double(n), double(n)*1e6/double(elapsed)
+    );
+  }
+  return true;
+}
+
+// --------------------------------------------------------
+// Method dispatch: exact wire names (dispatch table) vs names which are
+// CamelCased first (the cost of every lookup before the table).
+
+static bool benchDispatch() {
+  ::google::protobuf::rpc::Server server;
+  server.AddService(new EchoService, true);
+
+  const char* names[2][2] = {
+    { "dispatch/exact", "EchoService.Echo" },
+    { "dispatch/camel-case", "echo_service.echo" },
+  };
+  for(int k = 0; k < 2; k++) {
+    const std::string method(names[k][1]);
+    ::google::protobuf::rpc::Service* service;
+    ::google::protobuf::MethodDescriptor* desc;
+
+    const int n = 2000000;
+    uint64 allocs = numAllocs.load();
+    uint64 start = env()->NowMicros();
+    for(int i = 0; i < n; i++) {
+      if(!server.FindMethod(method, &service, &desc)) {
+        fprintf(stderr, "%s: FindMethod failed\n", names[k][0]);
+        return false;
+      }
+    }
+    uint64 elapsed = env()->NowMicros() - start;
+    allocs = numAllocs.load() - allocs;
+    printf("%-24s %8d calls  %6.1f ns/call  %6.2f allocs/call\n",
+      names[k][0], n, double(elapsed)*1e3/double(n), double(allocs)/double(n)
+    );
+  }
+  return true;
+}
+
+// --------------------------------------------------------
+// Header frames of protocol v1 (protobuf, method names) vs v2 (fixed
+// binary layout, method ids): encode + decode + dispatch of a request
+// header and a response header, then echo round trips on each version.
+
+static const int kHeaderPort = 12358;
+
+static bool benchHeader() {
+  namespace wire = ::google::protobuf::rpc::wire;
+
+  ::google::protobuf::rpc::Server server;
+  server.AddService(new EchoService, true);
+  ::google::protobuf::rpc::Service* service;
+  ::google::protobuf::MethodDescriptor* desc;
+
+  const char* names[2] = { "header/v1", "header/v2" };
+  for(int k = 0; k < 2; k++) {
+    const int version = (k == 0)? wire::kProtocolV1: wire::kProtocolV2;
+    wire::RequestHeader req, reqOut;
+    wire::ResponseHeader resp, respOut;
+    req.set_id(12345);
+    req.set_raw_request_len(1024);
+    req.set_snappy_compressed_request_len(100);
+    req.set_checksum(0xdeadbeef);
+    req.set_timeout_ms(500);
+    resp.set_id(12345);
+    resp.set_raw_response_len(1024);
+    resp.set_snappy_compressed_response_len(100);
+    resp.set_checksum(0xdeadbeef);
+    if(version == wire::kProtocolV2) {
+      req.set_method_id(0);
+      req.set_flags(wire::FLAG_CHECKSUM | wire::FLAG_COMPRESSED);
+      resp.set_flags(wire::FLAG_CHECKSUM | wire::FLAG_COMPRESSED);
+    } else {
+      req.set_method("EchoService.Echo");
+      resp.set_error("");
+    }
+
+    std::string reqFrame, respFrame;
+    const int n = 2000000;
+    uint64 start = env()->NowMicros();
+    for(int i = 0; i < n; i++) {
+      bool ok = wire::EncodeRequestHeader(req, version, &reqFrame).IsNil() &&
+        wire::DecodeRequestHeader(reqFrame.data(), reqFrame.size(), version, &reqOut).IsNil() &&
+        ((version == wire::kProtocolV2)?
+          server.FindMethodById(reqOut.method_id(), &service, &desc):
+          server.FindMethod(reqOut.method(), &service, &desc)) &&
+        wire::EncodeResponseHeader(resp, version, &respFrame).IsNil() &&
+        wire::DecodeResponseHeader(respFrame.data(), respFrame.size(), version, &respOut).IsNil();
+      if(!ok || reqOut.id() != req.id() || respOut.checksum() != resp.checksum()) {
+        fprintf(stderr, "%s: wrong header\n", names[k]);
+        return false;
+      }
+    }
+    uint64 elapsed = env()->NowMicros() - start;
+    printf("%-24s %8d calls  %6.1f ns/call  %d+%d header bytes\n",
+      names[k], n, double(elapsed)*1e3/double(n), int(reqFrame.size()), int(respFrame.size())
+    );
+  }
+
+  auto echoServer = new ::google::protobuf::rpc::Server;
+  echoServer->AddService(new EchoService, true);
+  if(!echoServer->ListenTCP(kHeaderPort)) {
+    fprintf(stderr, "header: ListenTCP failed\n");
+    return false;
+  }
+  env()->StartThread(serveTransport, echoServer);
+  const char* echoNames[2] = { "echo/tcp-v1", "echo/tcp-v2" };
+  for(int k = 0; k < 2; k++) {
+    ::google::protobuf::rpc::Client client("127.0.0.1", kHeaderPort);
+    client.SetProtocolV2(k == 1);
+    if(!benchEcho(echoNames[k], &client, 20000)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// --------------------------------------------------------
+// Body compression policy on v2: encode + decode of a small and an
+// incompressible body, always compressed vs wire::Compression defaults
+// (size threshold and probe).
+
+static bool benchCompress() {
+  namespace wire = ::google::protobuf::rpc::wire;
+
+  std::string noise(4*1024*1024, ' ');
+  uint64 x = 88172645463325252ULL;
+  for(size_t i = 0; i < noise.size(); i++) {
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    noise[i] = char(' ' + x%95);
+  }
+  const struct {
+    const char* name;
+    std::string msg;
+    int n;
+  } bodies[] = {
+    { "small-16", std::string(16, 'x'), 1000000 },
+    { "text-64k", std::string(64*1024, 'x'), 20000 },
+    { "noise-256k", noise.substr(0, 256*1024), 5000 },
+    { "text-4m", std::string(4*1024*1024, 'x'), 300 },
+    { "noise-4m", noise, 300 },
+  };
+  const wire::Compression policy;
+  for(size_t k = 0; k < sizeof(bodies)/sizeof(bodies[0]); k++) {
+    ::service::EchoRequest args, req;
+    args.set_msg(bodies[k].msg);
+    for(int mode = 0; mode < 2; mode++) {
+      char name[64];
+      snprintf(name, sizeof(name), "compress/%s-%s", (mode == 0)? "always": "policy", bodies[k].name);
+
+      std::string hdr, body;
+      wire::RequestHeader header;
+      const int n = bodies[k].n;
+      uint64 start = env()->NowMicros();
+      for(int i = 0; i < n; i++) {
+        wire::MarshalRequest(1, "", &args, &hdr, &body, 0, wire::kProtocolV2, 0,
+          (mode == 0)? NULL: &policy
+        );
+        wire::DecodeRequestHeader(hdr.data(), hdr.size(), wire::kProtocolV2, &header);
+        if(!wire::DecodeRequestBody(&header, body.data(), body.size(), &req).IsNil()) {
+          fprintf(stderr, "%s: DecodeRequestBody failed\n", name);
+          return false;
+        }
+      }
+      uint64 elapsed = env()->NowMicros() - start;
+      if(req.msg() != args.msg()) {
+        fprintf(stderr, "%s: wrong message\n", name);
+        return false;
+      }
+      printf("%-24s %8d calls  %8.2f us/call  %8d body bytes\n",
+        name, n, double(elapsed)/double(n), int(body.size())
+      );
+    }
+  }
+  return true;
+}
+
+// --------------------------------------------------------
+// Checksum throughput: the HashCRC32 implementations and HashCRC32C.
+
+static bool benchCRC32() {
+  std::vector< ::google::protobuf::rpc::CRC32Impl> impls;
+  ::google::protobuf::rpc::GetCRC32Impls(&impls);
+  impls.push_back(::google::protobuf::rpc::CRC32Impl(
+    ::google::protobuf::rpc::HasHardwareCRC32C()? "crc32c-sse4.2": "crc32c",
+    ::google::protobuf::rpc::HashCRC32C
+  ));
+
+  const int sizes[] = { 64, 1024, 16*1024, 1024*1024 };
+  std::string data(sizes[3], ' ');
+  for(size_t i = 0; i < data.size(); i++) {
+    data[i] = char(i*2654435761u >> 24);
+  }
+  for(size_t k = 0; k < sizeof(sizes)/sizeof(sizes[0]); k++) {
+    uint32_t want = impls[impls.size() - 2].hash(data.data(), sizes[k]);
+    for(size_t j = 0; j < impls.size(); j++) {
+      const int n = int(1024*1024*1024 / (sizes[k] + 256)) / 4;
+      uint32_t sum = 0;
+      uint64 start = env()->NowMicros();
+      for(int i = 0; i < n; i++) {
+        sum = impls[j].hash(data.data(), sizes[k]);
+      }
+      uint64 elapsed = env()->NowMicros() - start;
+      if(j + 1 < impls.size() && sum != want) {
+        fprintf(stderr, "crc32/%s: wrong checksum\n", impls[j].name);
+        return false;
+      }
+      char name[64];
+      snprintf(name, sizeof(name), "crc32/%s-%d", impls[j].name, sizes[k]);
+      printf("%-24s %8d calls  %8.1f ns/call  %8.2f GB/s\n",
+        name, n, double(elapsed)*1e3/double(n),
+        double(n)*double(sizes[k])/double(elapsed)/1e3
+      );
+    }
+  }
+  return true;
+}
+
+// --------------------------------------------------------
+// Exporting rows: one giant response message vs a server streaming
+// call, time to the first row and to the last one.
+
+static const int kStreamPort = 12359;
+
+static bool benchStream() {
+  auto server = new ::google::protobuf::rpc::Server;
+  server->AddService(new StreamService, true);
+  if(!server->ListenTCP(kStreamPort)) {
+    fprintf(stderr, "stream: ListenTCP failed\n");
+    return false;
+  }
+  env()->StartThread(serveBlocking, server);
+
+  ::google::protobuf::rpc::Client client("127.0.0.1", kStreamPort);
+  client.SetProtocolV2(true);
+  service::StreamService::Stub stub(&client);
+  ::service::StreamRequest req;
+  ::service::StreamResponse resp;
+  req.set_data(std::string(64, 'x'));
+
+  // warm up, the server may still be starting
+  req.set_n(1);
+  for(int i = 0; !stub.Echo(&req, &resp).IsNil(); i++) {
+    if(i == 99) {
+      fprintf(stderr, "stream: StreamService.Echo failed\n");
+      return false;
+    }
+    sleepMillis(20);
+  }
+
+  const int rows[] = { 1000, 100000, 1000000 };
+  for(size_t k = 0; k < sizeof(rows)/sizeof(rows[0]); k++) {
+    req.set_n(rows[k]);
+    for(int mode = 0; mode < 2; mode++) {
+      char name[64];
+      snprintf(name, sizeof(name), "stream/%s-%d", (mode == 0)? "message": "rows", rows[k]);
+
+      uint64 start = env()->NowMicros(), first = 0;
+      uint64 bytes = 0;
+      if(mode == 0) {
+        if(!stub.Echo(&req, &resp).IsNil() || resp.n() != rows[k]) {
+          fprintf(stderr, "%s: StreamService.Echo failed\n", name);
+          return false;
+        }
+        first = env()->NowMicros() - start;
+        bytes = resp.data().size();
+      } else {
+        auto reader = stub.List(&req);
+        int n = 0;
+        for(; reader->Read(&resp); n++) {
+          if(n == 0) first = env()->NowMicros() - start;
+          bytes += resp.data().size();
+        }
+        if(!reader->Finish().IsNil() || n != rows[k]) {
+          fprintf(stderr, "%s: StreamService.List failed\n", name);
+          return false;
+        }
+      }
+      uint64 elapsed = env()->NowMicros() - start;
+      printf("%-24s %8d rows  first %8d us  total %8d us  %8.1f MB/s\n",
+        name, rows[k], int(first), int(elapsed), double(bytes)/double(elapsed)
+      );
+    }
+  }
+  return true;
+}
+
+// --------------------------------------------------------
+// A large incompressible echo, whole bodies (v1) vs chunked bodies (v2 on
+// the blocking server): time and peak heap of the call (client and
+// server), over the request, response and reply messages.
+
+static const int kChunkedPort = 12360;
+
+static bool benchChunked() {
+  auto server = new ::google::protobuf::rpc::Server;
+  server->AddService(new EchoService, true);
+  server->SetMaxBodyLen(256*1024*1024);
+  if(!server->ListenTCP(kChunkedPort)) {
+    fprintf(stderr, "chunked: ListenTCP failed\n");
+    return false;
+  }
+  env()->StartThread(serveBlocking, server);
+
+  ::service::EchoRequest ping, args;
+  ::service::EchoResponse reply;
+  {
+    std::string noise(128*1024*1024, ' ');
+    uint64 x = 88172645463325252ULL;
+    for(size_t i = 0; i < noise.size(); i++) {
+      x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+      noise[i] = char(' ' + x%95);
+    }
+    args.set_msg(noise);
+  }
+
+  const char* names[2] = { "chunked/v2-128m", "chunked/v1-128m" };
+  for(int k = 0; k < 2; k++) {
+    ::google::protobuf::rpc::Client client("127.0.0.1", kChunkedPort);
+    client.SetProtocolV2(k == 0);
+    client.SetMaxBodyLen(256*1024*1024);
+    for(int i = 0; !client.CallMethod("EchoService.Echo", &ping, &reply).IsNil(); i++) {
+      if(i == 99) {
+        fprintf(stderr, "%s: EchoService.Echo failed\n", names[k]);
+        return false;
+      }
+      sleepMillis(20);
+    }
+    uint64 heap = heapBytes.load();
+    peakHeapBytes = heap;
+    uint64 start = env()->NowMicros();
+    if(!client.CallMethod("EchoService.Echo", &args, &reply).IsNil() || reply.msg() != args.msg()) {
+      fprintf(stderr, "%s: EchoService.Echo failed\n", names[k]);
+      return false;
+    }
+    uint64 elapsed = env()->NowMicros() - start;
+    // the server's request and response, and reply
+    uint64 messages = 3*args.msg().size();
+    printf("%-24s %8.1f ms  peak heap +%4d MB over the messages\n",
+      names[k], double(elapsed)/1e3, int((peakHeapBytes.load() - heap - messages) >> 20)
+    );
+    reply.Clear();
+  }
+  return true;
+}
+
+// --------------------------------------------------------
+// Open loop overload: 4 connections offer about twice what the blocking
+// server serves with a 0.5ms CPU bound handler, for one second. Without admission
+// control the queue and the latency grow for the whole run, with it the
+// calls over the limits are answered overloaded at once and the served
+// ones stay fast.
+
+static const int kOverloadPortBase = 12361;
+
+class SlowEchoService: public service::EchoService {
+ public:
+  inline SlowEchoService() {}
+  virtual ~SlowEchoService() {}
+
+  virtual const ::google::protobuf::rpc::Error Echo(
+    const ::service::EchoRequest* request,
+    ::service::EchoResponse* response
+  ) {
+    // busy, the CPU is what runs out
+    uint64 until = env()->NowMicros() + 500;
+    while(env()->NowMicros() < until) {
+    }
+    response->set_msg(request->msg());
+    return ::google::protobuf::rpc::Error::Nil();
+  }
+  virtual const ::google::protobuf::rpc::Error EchoTwice(
+    const ::service::EchoRequest* request,
+    ::service::EchoResponse* response
+  ) {
+    response->set_msg(request->msg() + request->msg());
+    return ::google::protobuf::rpc::Error::Nil();
+  }
+};
+
+static bool benchOverload() {
+  const struct {
+    const char* name;
+    int max_inflight;
+    int target_delay_ms;
+  } cases[] = {
+    { "overload/off", 0, 0 },
+    { "overload/inflight-32", 32, 0 },
+    { "overload/codel-5ms", 0, 5 },
+  };
+  const int kConns = 4, kBatch = 10, kRounds = 100;  // a batch every 10ms
+  const int n = kConns*kBatch*kRounds;
+
+  for(int k = 0; k < 3; k++) {
+    auto server = new ::google::protobuf::rpc::Server;
+    server->AddService(new SlowEchoService, true);
+    ::google::protobuf::rpc::Admission::Limits limits;
+    limits.max_inflight = cases[k].max_inflight;
+    limits.target_delay_ms = cases[k].target_delay_ms;
+    server->SetAdmission(limits);
+    if(!server->ListenTCP(kOverloadPortBase + k)) {
+      fprintf(stderr, "%s: ListenTCP failed\n", cases[k].name);
+      return false;
+    }
+    env()->StartThread(serveBlocking, server);
+
+    std::vector<::google::protobuf::rpc::Client*> clients;
+    std::vector<service::EchoService::Stub*> stubs;
+    ::service::EchoRequest args;
+    ::service::EchoResponse reply;
+    for(int i = 0; i < kConns; i++) {
+      clients.push_back(new ::google::protobuf::rpc::Client("127.0.0.1", kOverloadPortBase + k));
+      stubs.push_back(new service::EchoService::Stub(clients.back()));
+      for(int j = 0; !stubs[i]->Echo(&args, &reply).IsNil(); j++) {
+        if(j == 99) {
+          fprintf(stderr, "%s: EchoService.Echo failed\n", cases[k].name);
+          return false;
+        }
+        sleepMillis(20);
+      }
+    }
+
+    args.set_msg(std::string(64, 'x'));
+    std::vector< ::service::EchoResponse> replies(n);
+    std::vector< std::shared_ptr< ::google::protobuf::rpc::Future> > futures(n);
+    std::vector<uint64> sent(n), done(n);
+    std::vector<std::string> errors(n);
+    uint64 start = env()->NowMicros();
+    for(int r = 0; r < kRounds; r++) {
+      for(int i = r*kConns*kBatch; i < (r+1)*kConns*kBatch; i++) {
+        sent[i] = env()->NowMicros();
+        futures[i] = stubs[i%kConns]->EchoAsync(&args, &replies[i],
+          [&, i](const ::google::protobuf::rpc::Error& err) {
+            done[i] = env()->NowMicros();
+            errors[i] = err.String();
+          }
+        );
+      }
+      sleepMillis(10);
+    }
+    std::vector<uint64> served, overloaded;
+    for(int i = 0; i < n; i++) {
+      futures[i]->Wait();
+      if(errors[i].empty()) {
+        served.push_back(done[i] - sent[i]);
+      } else if(errors[i] == ::google::protobuf::rpc::kOverloadedError) {
+        overloaded.push_back(done[i] - sent[i]);
+      } else {
+        fprintf(stderr, "%s: EchoService.Echo: %s\n", cases[k].name, errors[i].c_str());
+        return false;
+      }
+    }
+    uint64 elapsed = env()->NowMicros() - start;
+    report(cases[k].name, &served, elapsed);
+    if(!overloaded.empty()) {
+      std::sort(overloaded.begin(), overloaded.end());
+      printf("%-24s %8d overloaded, answered in p50 %5d us  p99 %5d us\n", "",
+        int(overloaded.size()), int(overloaded[overloaded.size()/2]),
+        int(overloaded[overloaded.size()*99/100])
+      );
+    }
+    for(int i = 0; i < kConns; i++) {
+      delete stubs[i];
+      delete clients[i];
+    }
+  }
+  return true;
+}
+
+// --------------------------------------------------------
+// Priority lanes: 4 connections flood the 0.5ms EchoService.Echo at
+// twice what the server serves while a fifth calls the cheap
+// EchoService.EchoTwice every 10ms. Capping Echo to one call at once in
+// the low lane and putting EchoTwice in the high lane keeps the latency
+// of the probe bounded.
+
+static const int kLanesPortBase = 12364;
+
+static bool benchLanes() {
+  const struct {
+    const char* name;
+    bool limits;
+  } cases[] = {
+    { "lanes/off", false },
+    { "lanes/capped", true },
+  };
+  const int kConns = 4, kBatch = 10, kRounds = 100;  // a batch every 10ms
+  const int n = kConns*kBatch*kRounds;
+
+  for(int k = 0; k < 2; k++) {
+    auto server = new ::google::protobuf::rpc::Server;
+    server->AddService(new SlowEchoService, true);
+    if(cases[k].limits) {
+      server->SetMethodLimits("EchoService.Echo",
+        ::google::protobuf::rpc::CallLimits(1, ::google::protobuf::rpc::PRIORITY_LOW)
+      );
+      server->SetMethodLimits("EchoService.EchoTwice",
+        ::google::protobuf::rpc::CallLimits(0, ::google::protobuf::rpc::PRIORITY_HIGH)
+      );
+    }
+    if(!server->ListenTCP(kLanesPortBase + k)) {
+      fprintf(stderr, "%s: ListenTCP failed\n", cases[k].name);
+      return false;
+    }
+    env()->StartThread(serveBlocking, server);
+
+    std::vector<::google::protobuf::rpc::Client*> clients;
+    std::vector<service::EchoService::Stub*> stubs;
+    ::service::EchoRequest args;
+    ::service::EchoResponse reply;
+    for(int i = 0; i <= kConns; i++) {
+      clients.push_back(new ::google::protobuf::rpc::Client("127.0.0.1", kLanesPortBase + k));
+      stubs.push_back(new service::EchoService::Stub(clients.back()));
+      for(int j = 0; !stubs[i]->Echo(&args, &reply).IsNil(); j++) {
+        if(j == 99) {
+          fprintf(stderr, "%s: EchoService.Echo failed\n", cases[k].name);
+          return false;
+        }
+        sleepMillis(20);
+      }
+    }
+    auto probe = stubs[kConns];
+
+    args.set_msg(std::string(64, 'x'));
+    std::vector< ::service::EchoResponse> replies(n), probeReplies(kRounds);
+    std::vector< std::shared_ptr< ::google::protobuf::rpc::Future> > futures(n), probes(kRounds);
+    std::vector<uint64> sent(kRounds), done(kRounds);
+    uint64 start = env()->NowMicros();
+    for(int r = 0; r < kRounds; r++) {
+      for(int i = r*kConns*kBatch; i < (r+1)*kConns*kBatch; i++) {
+        futures[i] = stubs[i%kConns]->EchoAsync(&args, &replies[i]);
+      }
+      sent[r] = env()->NowMicros();
+      probes[r] = probe->EchoTwiceAsync(&args, &probeReplies[r],
+        [&, r](const ::google::protobuf::rpc::Error& err) {
+          done[r] = env()->NowMicros();
+        }
+      );
+      sleepMillis(10);
+    }
+    std::vector<uint64> latency;
+    for(int r = 0; r < kRounds; r++) {
+      if(!probes[r]->Wait().IsNil()) {
+        fprintf(stderr, "%s: EchoService.EchoTwice failed\n", cases[k].name);
+        return false;
+      }
+      latency.push_back(done[r] - sent[r]);
+    }
+    uint64 elapsed = env()->NowMicros() - start;
+    for(int i = 0; i < n; i++) {
+      if(!futures[i]->Wait().IsNil()) {
+        fprintf(stderr, "%s: EchoService.Echo failed\n", cases[k].name);
+        return false;
+      }
+    }
+    report(cases[k].name, &latency, elapsed);
+    for(int i = 0; i <= kConns; i++) {
+      delete stubs[i];
+      delete clients[i];
+    }
+  }
+  return true;
+}
+
+// --------------------------------------------------------
+// Restart under load: 4 clients call EchoService.Echo in turn, retrying
+// the failed calls every millisecond, while the server is replaced by
+// one that takes 50ms to start. A cold restart shuts the old server
+// down first; with the handoff the old one serves until the new one is
+// ready and hands it the listening socket.
+
+static const int kRestartPortBase = 12366;
+static const char* kRestartHandoffPath = "@protorpc-rpcbench-handoff";
+
+struct RestartArg {
+  ::google::protobuf::rpc::Server* old_server;
+  ::google::protobuf::rpc::Server* new_server;
+  int port;
+  bool handoff;
+};
+
+static void inheritAndServe(void* arg) {
+  auto server = (::google::protobuf::rpc::Server*)arg;
+  if(server->InheritListeners(kRestartHandoffPath, 2000)) {
+    server->Serve();
+  }
+}
+
+static void restartProc(void* p) {
+  auto arg = (RestartArg*)p;
+  sleepMillis(300);
+  if(arg->handoff) {
+    env()->StartThread(inheritAndServe, arg->new_server);
+    sleepMillis(50);
+    arg->old_server->Shutdown(1000, kRestartHandoffPath);
+  } else {
+    arg->old_server->Shutdown(1000);
+    sleepMillis(50);
+    if(arg->new_server->ListenTCP(arg->port)) {
+      env()->StartThread(serveBlocking, arg->new_server);
+    }
+  }
+}
+
+static bool benchRestart() {
+  const struct {
+    const char* name;
+    bool handoff;
+  } cases[] = {
+    { "restart/cold", false },
+    { "restart/handoff", true },
+  };
+  const int kConns = 4;
+  const uint64 kRunMicros = 1000*1000;
+
+  for(int k = 0; k < 2; k++) {
+    const int port = kRestartPortBase + k;
+    auto server = new ::google::protobuf::rpc::Server;
+    server->AddService(new EchoService, true);
+    if(!server->ListenTCP(port)) {
+      fprintf(stderr, "%s: ListenTCP failed\n", cases[k].name);
+      return false;
+    }
+    env()->StartThread(serveBlocking, server);
+
+    std::vector<::google::protobuf::rpc::Client*> clients;
+    std::vector<service::EchoService::Stub*> stubs;
+    ::service::EchoRequest args;
+    ::service::EchoResponse reply;
+    for(int i = 0; i < kConns; i++) {
+      clients.push_back(new ::google::protobuf::rpc::Client("127.0.0.1", port));
+      stubs.push_back(new service::EchoService::Stub(clients.back()));
+      for(int j = 0; !stubs[i]->Echo(&args, &reply).IsNil(); j++) {
+        if(j == 99) {
+          fprintf(stderr, "%s: EchoService.Echo failed\n", cases[k].name);
+          return false;
+        }
+        sleepMillis(20);
+      }
+    }
+
+    RestartArg restart;
+    restart.old_server = server;
+    restart.new_server = new ::google::protobuf::rpc::Server;
+    restart.new_server->AddService(new EchoService, true);
+    restart.port = port;
+    restart.handoff = cases[k].handoff;
+    env()->StartThread(restartProc, &restart);
+
+    args.set_msg(std::string(64, 'x'));
+    std::vector<uint64> samples;
+    int failed = 0;
+    uint64 start = env()->NowMicros();
+    for(int i = 0; env()->NowMicros() - start < kRunMicros; i++) {
+      uint64 t0 = env()->NowMicros();
+      while(!stubs[i%kConns]->Echo(&args, &reply).IsNil()) {
+        failed++;
+        sleepMillis(1);
+      }
+      samples.push_back(env()->NowMicros() - t0);
+    }
+    uint64 elapsed = env()->NowMicros() - start;
+    report(cases[k].name, &samples, elapsed);
+    printf("%-24s %8d failed calls retried, max %5d us\n", "", failed, int(samples.back()));
+    for(int i = 0; i < kConns; i++) {
+      delete stubs[i];
+      delete clients[i];
+    }
+    delete server;
+  }
+  return true;
+}
+
+// --------------------------------------------------------
+// Heap held per connection after a burst of large calls, once the
+// connections are idle: kept open, or closed by the idle timeout of the
+// server (client and server in this process).
+
+static const int kIdlePortBase = 12368;
+
+static bool benchIdle() {
+  const struct {
+    const char* name;
+    int idle_timeout_ms;
+  } cases[] = {
+    { "idle/keep", 0 },
+    { "idle/reap-200ms", 200 },
+  };
+  const int kConns = 64;
+
+  for(int k = 0; k < 2; k++) {
+    auto server = new ::google::protobuf::rpc::Server;
+    server->AddService(new EchoService, true);
+    server->SetIdleTimeout(cases[k].idle_timeout_ms);
+    if(!server->ListenTCP(kIdlePortBase + k)) {
+      fprintf(stderr, "%s: ListenTCP failed\n", cases[k].name);
+      return false;
+    }
+    env()->StartThread(serveEventLoop, server);
+
+    std::vector<::google::protobuf::rpc::Client*> clients;
+    ::service::EchoRequest args;
+    ::service::EchoResponse reply;
+    for(int i = 0; i < kConns; i++) {
+      clients.push_back(new ::google::protobuf::rpc::Client("127.0.0.1", kIdlePortBase + k));
+      for(int j = 0; !clients[i]->CallMethod("EchoService.Echo", &args, &reply).IsNil(); j++) {
+        if(j == 99) {
+          fprintf(stderr, "%s: EchoService.Echo failed\n", cases[k].name);
+          return false;
+        }
+        sleepMillis(20);
+      }
+    }
+
+    uint64 before = heapBytes.load();
+    args.set_msg(std::string(256*1024, 'x'));
+    for(int i = 0; i < kConns; i++) {
+      if(!clients[i]->CallMethod("EchoService.Echo", &args, &reply).IsNil()) {
+        fprintf(stderr, "%s: EchoService.Echo(256KB) failed\n", cases[k].name);
+        return false;
+      }
+    }
+    uint64 burst = heapBytes.load();
+    sleepMillis(600);
+    uint64 idle = heapBytes.load();
+    printf("%-24s %8d KB/conn after the burst, %5d KB/conn idle\n", cases[k].name,
+      int((burst - before)/kConns/1024), int((idle > before? idle - before: 0)/kConns/1024)
+    );
+    for(int i = 0; i < kConns; i++) {
+      delete clients[i];
+    }
+  }
+  return true;
+}
+
+// --------------------------------------------------------
+
+static const struct {
+  const char* name;
+  bool (*run)();
+} benchmarks[] = {
+  { "transport", benchTransport },
+  { "eventloop", benchEventLoop },
+  { "decode", benchDecode },
+  { "alloc", benchAlloc },
+  { "dispatch", benchDispatch },
+  { "header", benchHeader },
+  { "compress", benchCompress },
+  { "crc32", benchCRC32 },
+  { "stream", benchStream },
+  { "chunked", benchChunked },
+  { "overload", benchOverload },
+  { "lanes", benchLanes },
+  { "restart", benchRestart },
+  { "idle", benchIdle },
+};
+
+int main(int argc, char* argv[]) {
+  const char* filter = (argc > 1)? argv[1]: NULL;
+  for(size_t i = 0; i < sizeof(benchmarks)/sizeof(benchmarks[0]); i++) {
+    if(filter != NULL && strcmp(filter, benchmarks[i].name) != 0) {
+      continue;
+    }
+    if(!benchmarks[i].run()) {
+      return -1;
+    }
+  }
+  fflush(stdout);
+  // the servers run in detached threads
+  _exit(0);
+}
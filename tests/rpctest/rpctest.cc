@@ -4,62 +4,2071 @@
 
 #include <stdio.h>
 
+#if (defined(_WIN32) || defined(_WIN64))
+#  include <windows.h>
+#  define sleepMillis(ms) Sleep(ms)
+#else
+#  include <unistd.h>
+#  define sleepMillis(ms) usleep((ms)*1000)
+#endif
+#if defined(__linux__)
+#  include <sys/mman.h>
+#  include <sys/socket.h>
+#  include <sys/stat.h>
+#  include <sys/syscall.h>
+#endif
+
+#include <google/protobuf/rpc/rpc_env.h>
 #include <google/protobuf/rpc/rpc_server.h>
 #include <google/protobuf/rpc/rpc_client.h>
+#include <google/protobuf/rpc/rpc_client_pool.h>
+#include <google/protobuf/rpc/rpc_crc32.h>
+#include <google/protobuf/rpc/rpc_shm.h>
+#include <google/protobuf/rpc/rpc_timer_wheel.h>
+#include <google/protobuf/rpc/rpc_wire.h>
+#include <google/protobuf/stubs/atomicops.h>
+
+#include <vector>
+
+#include "./service.pb/arith.pb.h"
+#include "./service.pb/echo.pb.h"
+#include "./service.pb/stream.pb.h"
+
+class ArithService: public service::ArithService {
+ public:
+  inline ArithService() {}
+  virtual ~ArithService() {}
+
+  virtual const ::google::protobuf::rpc::Error add(
+    const ::service::ArithRequest* request,
+    ::service::ArithResponse* response
+  ) {
+    response->set_c(request->a() + request->b());
+    return ::google::protobuf::rpc::Error::Nil();
+  }
+  virtual const ::google::protobuf::rpc::Error mul(
+    const ::service::ArithRequest* request,
+    ::service::ArithResponse* response
+  ) {
+    response->set_c(request->a() * request->b());
+    return ::google::protobuf::rpc::Error::Nil();
+  }
+  virtual const ::google::protobuf::rpc::Error div(
+    const ::service::ArithRequest* request,
+    ::service::ArithResponse* response
+  ) {
+    if(request->b() == 0) {
+      return ::google::protobuf::rpc::Error::New("divide by zero");
+    }
+    response->set_c(request->a() / request->b());
+    return ::google::protobuf::rpc::Error::Nil();
+  }
+  virtual const ::google::protobuf::rpc::Error error(
+    const ::service::ArithRequest* request,
+    ::service::ArithResponse* response
+  ) {
+    return ::google::protobuf::rpc::Error::New("ArithError");
+  }
+};
+
+class EchoService: public service::EchoService {
+ public:
+  inline EchoService() {}
+  virtual ~EchoService() {}
+
+  virtual const ::google::protobuf::rpc::Error Echo(
+    const ::service::EchoRequest* request,
+    ::service::EchoResponse* response
+  ) {
+    if(request->msg() == "sleep") {
+      sleepMillis(200);
+    }
+    response->set_msg(request->msg());
+    return ::google::protobuf::rpc::Error::Nil();
+  }
+};
+
+class StreamService: public service::StreamService {
+ public:
+  inline StreamService() {}
+  virtual ~StreamService() {}
+
+  virtual const ::google::protobuf::rpc::Error List(
+    const ::service::StreamRequest* request,
+    ::google::protobuf::rpc::StreamWriter< ::service::StreamResponse>* writer
+  ) {
+    ::service::StreamResponse resp;
+    resp.set_data(request->data());
+    for(int i = 0; i < request->n(); i++) {
+      resp.set_n(i);
+      auto err = writer->Write(resp);
+      if(!err.IsNil()) return err;
+    }
+    return ::google::protobuf::rpc::Error::Nil();
+  }
+  virtual const ::google::protobuf::rpc::Error Sum(
+    ::google::protobuf::rpc::StreamReader< ::service::StreamRequest>* reader,
+    ::service::StreamResponse* response
+  ) {
+    ::service::StreamRequest req;
+    int sum = 0;
+    while(reader->Read(&req)) sum += req.n();
+    response->set_n(sum);
+    return ::google::protobuf::rpc::Error::Nil();
+  }
+  virtual const ::google::protobuf::rpc::Error Chat(
+    ::google::protobuf::rpc::StreamReaderWriter< ::service::StreamResponse, ::service::StreamRequest>* stream
+  ) {
+    ::service::StreamRequest req;
+    ::service::StreamResponse resp;
+    while(stream->Read(&req)) {
+      if(req.data() == "fail") {
+        return ::google::protobuf::rpc::Error::New("ChatError");
+      }
+      resp.set_n(req.n());
+      resp.set_data(req.data());
+      auto err = stream->Write(resp);
+      if(!err.IsNil()) return err;
+    }
+    return ::google::protobuf::rpc::Error::Nil();
+  }
+  virtual const ::google::protobuf::rpc::Error Echo(
+    const ::service::StreamRequest* request,
+    ::service::StreamResponse* response
+  ) {
+    response->set_data(request->data());
+    return ::google::protobuf::rpc::Error::Nil();
+  }
+};
+
+static const int kEventLoopPort = 12341;
+
+static void serveEventLoop(void* arg) {
+  auto server = (::google::protobuf::rpc::Server*)arg;
+  server->BindAndServeEventLoop(kEventLoopPort, 128, 2);
+}
+
+// Call EchoService.Echo, retry while the server is starting.
+static ::google::protobuf::rpc::Error callEcho(
+  ::google::protobuf::rpc::Client* client,
+  const std::string& msg, std::string* reply
+) {
+  ::service::EchoRequest args;
+  ::service::EchoResponse resp;
+  ::google::protobuf::rpc::Error err;
+
+  args.set_msg(msg);
+  for(int i = 0; i < 50; i++) {
+    err = client->CallMethod("EchoService.Echo", &args, &resp);
+    if(err.IsNil()) break;
+    sleepMillis(20);
+  }
+  *reply = resp.msg();
+  return err;
+}
+
+// Two connections served at the same time by the event loop server.
+static int testEventLoop() {
+  auto server = new ::google::protobuf::rpc::Server;
+  server->AddService(new EchoService, true);
+  ::google::protobuf::rpc::Env::Default()->StartThread(serveEventLoop, server);
+
+  ::google::protobuf::rpc::Client client1("127.0.0.1", kEventLoopPort);
+  ::google::protobuf::rpc::Client client2("127.0.0.1", kEventLoopPort);
+  ::google::protobuf::rpc::Error err;
+  std::string reply;
+
+  for(int i = 0; i < 3; i++) {
+    auto client = (i%2 == 0)? &client1: &client2;
+    err = callEcho(client, "Hello EventLoop!", &reply);
+    if(!err.IsNil()) {
+      fprintf(stderr, "EventLoop: EchoService.Echo: %s\n", err.String().c_str());
+      return -1;
+    }
+    if(reply != "Hello EventLoop!") {
+      fprintf(stderr, "EventLoop: EchoService.Echo: expected = \"%s\", got = \"%s\"\n",
+        "Hello EventLoop!", reply.c_str()
+      );
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// Concurrent calls multiplexed on one connection.
+// Runs after testEventLoop, which started the server.
+static int testAsync() {
+  ::google::protobuf::rpc::Client client("127.0.0.1", kEventLoopPort);
+  service::EchoService::Stub echoStub(&client);
+
+  const int kCalls = 8;
+  ::service::EchoRequest args[kCalls];
+  ::service::EchoResponse replies[kCalls];
+  std::shared_ptr< ::google::protobuf::rpc::Future> futures[kCalls];
+  ::google::protobuf::rpc::Error err;
+
+  for(int i = 0; i < kCalls; i++) {
+    args[i].set_msg(std::string("Hello Async ") + std::to_string(static_cast<long long>(i)));
+    futures[i] = echoStub.EchoAsync(&args[i], &replies[i]);
+  }
+  for(int i = 0; i < kCalls; i++) {
+    err = futures[i]->Wait();
+    if(!err.IsNil()) {
+      fprintf(stderr, "Async: EchoService.Echo: %s\n", err.String().c_str());
+      return -1;
+    }
+    if(replies[i].msg() != args[i].msg()) {
+      fprintf(stderr, "Async: EchoService.Echo: expected = \"%s\", got = \"%s\"\n",
+        args[i].msg().c_str(), replies[i].msg().c_str()
+      );
+      return -1;
+    }
+  }
+
+  // callback form
+  bool called = false;
+  auto future = echoStub.EchoAsync(&args[0], &replies[0],
+    [&called](const ::google::protobuf::rpc::Error& err) { called = err.IsNil(); }
+  );
+  future->Wait();
+  if(!called) {
+    fprintf(stderr, "Async: EchoService.Echo: callback not called\n");
+    return -1;
+  }
+  return 0;
+}
+
+// Concurrent calls through a pool of two connections.
+struct PoolTest {
+  service::EchoService::Stub* stub;
+  ::google::protobuf::rpc::CondVar cv;
+  int done;
+};
+static void poolProc(void* arg) {
+  auto t = (PoolTest*)arg;
+  ::service::EchoRequest args;
+  ::service::EchoResponse reply;
+  args.set_msg("Hello ClientPool!");
+  for(int i = 0; i < 100; i++) {
+    if(!t->stub->Echo(&args, &reply).IsNil() || reply.msg() != args.msg()) {
+      fprintf(stderr, "ClientPool: EchoService.Echo failed\n");
+      exit(-1);
+    }
+  }
+  ::google::protobuf::rpc::CondVarLock locker(&t->cv);
+  t->done++;
+  t->cv.Signal();
+}
+static int testClientPool() {
+  ::google::protobuf::rpc::ClientPool pool("127.0.0.1", kEventLoopPort, 2, 1);
+  service::EchoService::Stub echoStub(&pool);
+
+  if(pool.NumConns() != 1) {
+    fprintf(stderr, "ClientPool: expected = %d conns, got = %d\n", 1, pool.NumConns());
+    return -1;
+  }
+
+  PoolTest t;
+  t.stub = &echoStub;
+  t.done = 0;
+  for(int i = 0; i < 3; i++) {
+    ::google::protobuf::rpc::Env::Default()->StartThread(poolProc, &t);
+  }
+  {
+    ::google::protobuf::rpc::CondVarLock locker(&t.cv);
+    while(t.done < 3) t.cv.Wait();
+  }
+  if(pool.NumConns() > 2) {
+    fprintf(stderr, "ClientPool: expected <= %d conns, got = %d\n", 2, pool.NumConns());
+    return -1;
+  }
+  return 0;
+}
+
+// Calls give up after their timeout, the client stays usable.
+static const int kStuckTestPort = 12339;
+
+static int testTimeout() {
+  ::google::protobuf::rpc::Client client("127.0.0.1", kEventLoopPort);
+  service::EchoService::Stub echoStub(&client);
+  ::service::EchoRequest args;
+  ::service::EchoResponse reply;
+  ::google::protobuf::rpc::Error err;
+
+  client.SetConnectTimeout(1000);
+  args.set_msg("sleep");
+  err = client.CallMethod("EchoService.Echo", &args, &reply, 50);
+  if(err.IsNil()) {
+    fprintf(stderr, "Timeout: EchoService.Echo: expected timeout error\n");
+    return -1;
+  }
+
+  args.set_msg("Hello Timeout!");
+  err = client.CallMethod("EchoService.Echo", &args, &reply, 1000);
+  if(!err.IsNil() || reply.msg() != args.msg()) {
+    fprintf(stderr, "Timeout: EchoService.Echo: %s\n", err.String().c_str());
+    return -1;
+  }
+
+  // asynchronous
+  args.set_msg("sleep");
+  err = client.CallMethodAsync(
+    service::EchoService::descriptor()->method(0), &args, &reply,
+    ::google::protobuf::rpc::Callback(), 50
+  )->Wait();
+  if(err.IsNil()) {
+    fprintf(stderr, "Timeout: EchoService.EchoAsync: expected timeout error\n");
+    return -1;
+  }
+
+  // a peer which never reads: the send gives up at the deadline
+  ::google::protobuf::rpc::Conn listener;
+  if(!listener.ListenTCP(kStuckTestPort)) {
+    fprintf(stderr, "Timeout: ListenTCP failed\n");
+    return -1;
+  }
+  ::google::protobuf::rpc::Client stuck("127.0.0.1", kStuckTestPort);
+  std::string noise(32*1024*1024, ' ');
+  ::google::protobuf::uint64 x = 88172645463325252ULL;
+  for(size_t i = 0; i < noise.size(); i++) {
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    noise[i] = char(' ' + x%95);
+  }
+  args.set_msg(noise);
+  auto env = ::google::protobuf::rpc::Env::Default();
+  auto start = env->NowMicros();
+  err = stuck.CallMethodAsync(
+    service::EchoService::descriptor()->method(0), &args, &reply,
+    ::google::protobuf::rpc::Callback(), 100
+  )->Wait();
+  if(err.IsNil() || env->NowMicros() - start > 5*1000*1000) {
+    fprintf(stderr, "Timeout: EchoService.EchoAsync(32MB): %s\n", err.String().c_str());
+    return -1;
+  }
+  // without a timeout, keepalive gives up on it
+  ::google::protobuf::rpc::Client dead("127.0.0.1", kStuckTestPort);
+  dead.SetKeepalive(50, 100);
+  start = env->NowMicros();
+  err = dead.CallMethodAsync(
+    service::EchoService::descriptor()->method(0), &args, &reply
+  )->Wait();
+  if(err.IsNil() || env->NowMicros() - start > 5*1000*1000) {
+    fprintf(stderr, "Timeout: keepalive EchoService.EchoAsync(32MB): %s\n", err.String().c_str());
+    return -1;
+  }
+  listener.Close();
+  return 0;
+}
+
+static const int kUnixTestPort = 12342;
+static const char* kUnixTestPath = "@protorpc-rpctest";
+static const char* kShmTestPath = "@protorpc-rpctest-shm";
+
+static void serveListeners(void* arg) {
+  auto server = (::google::protobuf::rpc::Server*)arg;
+  server->Serve();
+}
+
+// One blocking server listening on TCP, a unix domain socket and
+// the shared memory transport.
+static int testUnix() {
+  auto server = new ::google::protobuf::rpc::Server;
+  server->AddService(new EchoService, true);
+  server->AddService(new StreamService, true);
+  if(!server->ListenTCP(kUnixTestPort)) {
+    fprintf(stderr, "Unix: ListenTCP failed\n");
+    return -1;
+  }
+  if(!server->ListenUnix(kUnixTestPath)) {
+    return 0;  // not supported
+  }
+  bool has_shm = server->ListenShm(kShmTestPath);
+  ::google::protobuf::rpc::Env::Default()->StartThread(serveListeners, server);
+
+  ::google::protobuf::rpc::Client tcp("127.0.0.1", kUnixTestPort);
+  ::google::protobuf::rpc::Client uds((std::string("unix:") + kUnixTestPath).c_str(), 0);
+  ::google::protobuf::rpc::Client shm((std::string("shm:") + kShmTestPath).c_str(), 0);
+  ::google::protobuf::rpc::Error err;
+  std::string reply;
+
+  for(int i = 0; i < (has_shm? 3: 2); i++) {
+    auto client = (i == 0)? &tcp: (i == 1)? &uds: &shm;
+    err = callEcho(client, "Hello Unix!", &reply);
+    if(!err.IsNil() || reply != "Hello Unix!") {
+      fprintf(stderr, "Unix: EchoService.Echo: %s\n", err.String().c_str());
+      return -1;
+    }
+  }
+
+  // larger than the shared memory rings
+  if(has_shm) {
+    std::string big(1024*1024, 'x');
+    for(size_t i = 0; i < big.size(); i += 4093) {
+      big[i] = char('a' + i%26);
+    }
+    err = callEcho(&shm, big, &reply);
+    if(!err.IsNil() || reply != big) {
+      fprintf(stderr, "Unix: shm EchoService.Echo(1MB): %s\n", err.String().c_str());
+      return -1;
+    }
+
+    // a client which never sends its segment doesn't hold up the others
+    ::google::protobuf::rpc::Conn silent;
+    if(!silent.DialUnix(kShmTestPath)) {
+      fprintf(stderr, "Unix: DialUnix(%s) failed\n", kShmTestPath);
+      return -1;
+    }
+    sleepMillis(20);
+    auto env = ::google::protobuf::rpc::Env::Default();
+    auto start = env->NowMicros();
+    ::google::protobuf::rpc::Client next((std::string("shm:") + kShmTestPath).c_str(), 0);
+    err = callEcho(&next, "Hello Unix!", &reply);
+    if(!err.IsNil() || reply != "Hello Unix!" || env->NowMicros() - start > 500*1000) {
+      fprintf(stderr, "Unix: shm EchoService.Echo after a silent client: %s\n", err.String().c_str());
+      return -1;
+    }
+    silent.Close();
+  }
+  return 0;
+}
+
+static const int kPipelineTestPort = 12340;
+static const int kOutOfOrderTestPort = 12334;
+
+// Send the Echo requests of msgs pipelined in one write (ids from 1),
+// return their ids in the order of the responses.
+static ::google::protobuf::rpc::Error echoPipelined(::google::protobuf::rpc::Conn* conn,
+  const std::vector<std::string>& msgs, std::vector<int>* ids
+) {
+  namespace wire = ::google::protobuf::rpc::wire;
+  std::string out;
+  ::service::EchoRequest args;
+  for(size_t i = 0; i < msgs.size(); i++) {
+    args.set_msg(msgs[i]);
+    wire::EncodeRequest(&out, i + 1, "EchoService.Echo", &args);
+  }
+  if(!conn->Write(&out[0], int(out.size()))) {
+    return ::google::protobuf::rpc::Error::New("Write failed");
+  }
+  ids->clear();
+  for(size_t i = 0; i < msgs.size(); i++) {
+    wire::ResponseHeader header;
+    ::service::EchoResponse reply;
+    auto err = wire::RecvResponseHeader(conn, &header);
+    if(err.IsNil()) {
+      err = wire::RecvResponseBody(conn, &header, &reply);
+    }
+    if(!err.IsNil()) {
+      return err;
+    }
+    if(header.id() < 1 || header.id() > msgs.size() || reply.msg() != msgs[header.id() - 1]) {
+      return ::google::protobuf::rpc::Error::New("bad response");
+    }
+    ids->push_back(int(header.id()));
+  }
+  return ::google::protobuf::rpc::Error::Nil();
+}
+
+// The responses of pipelined requests go out as the calls complete, and
+// at most MaxInflightPerConn calls of a connection are queued at once.
+static int testOutOfOrder() {
+  auto env = ::google::protobuf::rpc::Env::New();
+  env->SetBackgroundThreads(4);
+  auto server = new ::google::protobuf::rpc::Server(env);
+  server->AddService(new EchoService, true);
+  server->SetMaxInflightPerConn(3);
+  if(!server->ListenTCP(kOutOfOrderTestPort)) {
+    fprintf(stderr, "OutOfOrder: ListenTCP failed\n");
+    return -1;
+  }
+  env->StartThread(serveListeners, server);
+
+  ::google::protobuf::rpc::Conn conn(0, env);
+  if(!conn.DialTCP("127.0.0.1", kOutOfOrderTestPort)) {
+    fprintf(stderr, "OutOfOrder: DialTCP failed\n");
+    return -1;
+  }
+  conn.SetTimeout(5000);
+
+  // the slow first call answers last: 3 calls queued, the last one
+  // run by the reader
+  std::vector<std::string> msgs;
+  msgs.push_back("sleep");
+  msgs.push_back("Hello 2");
+  msgs.push_back("Hello 3");
+  msgs.push_back("Hello 4");
+  std::vector<int> ids;
+  auto err = echoPipelined(&conn, msgs, &ids);
+  if(!err.IsNil() || ids.back() != 1) {
+    fprintf(stderr, "OutOfOrder: EchoService.Echo: %s, id %d answered last\n",
+      err.String().c_str(), ids.empty()? 0: ids.back()
+    );
+    return -1;
+  }
+
+  // 5 slow calls: 3 queued, the 4th once they return, the last one on
+  // the reader, about 400ms (1s one by one)
+  msgs.assign(5, "sleep");
+  auto start = env->NowMicros();
+  err = echoPipelined(&conn, msgs, &ids);
+  auto elapsed = env->NowMicros() - start;
+  if(!err.IsNil() || elapsed < 380*1000 || elapsed > 900*1000) {
+    fprintf(stderr, "OutOfOrder: %d slow calls in %d ms: %s\n",
+      int(msgs.size()), int(elapsed/1000), err.String().c_str()
+    );
+    return -1;
+  }
+  conn.Close();
+  return 0;
+}
+
+// Large asynchronous calls sent while the responses of the previous ones
+// come back: the sends must not hold up the reader.
+static int testPipeline() {
+  auto server = new ::google::protobuf::rpc::Server;
+  server->AddService(new EchoService, true);
+  server->SetMaxInflightPerConn(1);
+  if(!server->ListenTCP(kPipelineTestPort)) {
+    fprintf(stderr, "Pipeline: ListenTCP failed\n");
+    return -1;
+  }
+  ::google::protobuf::rpc::Env::Default()->StartThread(serveListeners, server);
+
+  ::google::protobuf::rpc::Client client("127.0.0.1", kPipelineTestPort);
+  std::string msg;
+  for(int i = 0; !callEcho(&client, "Hello Pipeline!", &msg).IsNil(); i++) {
+    if(i == 99) {
+      fprintf(stderr, "Pipeline: EchoService.Echo failed\n");
+      return -1;
+    }
+    sleepMillis(20);
+  }
+
+  const int kCalls = 4;
+  std::string noise(8*1024*1024, ' ');
+  ::google::protobuf::uint64 x = 88172645463325252ULL;
+  for(size_t i = 0; i < noise.size(); i++) {
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    noise[i] = char(' ' + x%95);
+  }
+  ::service::EchoRequest args[kCalls];
+  ::service::EchoResponse replies[kCalls];
+  std::shared_ptr< ::google::protobuf::rpc::Future> futures[kCalls];
+  for(int i = 0; i < kCalls; i++) {
+    args[i].set_msg(noise);
+    futures[i] = client.CallMethodAsync("EchoService.Echo", &args[i], &replies[i]);
+  }
+  for(int i = 0; i < kCalls; i++) {
+    auto err = futures[i]->Wait();
+    if(!err.IsNil() || replies[i].msg() != noise) {
+      fprintf(stderr, "Pipeline: EchoService.Echo(8MB): %s\n", err.String().c_str());
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// A shared memory segment is only attached sealed, and the indexes the
+// peer writes are checked against the ring size.
+static int testShmRing() {
+#if defined(__linux__)
+  using ::google::protobuf::rpc::ShmChannel;
+  auto env = ::google::protobuf::rpc::Env::Default();
+  int sv[2];
+  if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+    fprintf(stderr, "ShmRing: socketpair failed\n");
+    return -1;
+  }
+  auto creator = ShmChannel::Create(sv[0], 4096, 0, env);
+  if(creator == NULL) {
+    fprintf(stderr, "ShmRing: Create failed\n");
+    return -1;
+  }
+  struct stat st;
+  fstat(creator->Fd(), &st);
+
+  int fd = int(syscall(SYS_memfd_create, "rpctest-shm", 0));
+  if(fd < 0 || ftruncate(fd, st.st_size) != 0) {
+    fprintf(stderr, "ShmRing: memfd_create failed\n");
+    return -1;
+  }
+  if(ShmChannel::Attach(sv[1], fd, 0, env) != NULL) {
+    fprintf(stderr, "ShmRing: attached an unsealed segment\n");
+    return -1;
+  }
+  if(ftruncate(creator->Fd(), st.st_size/2) == 0) {
+    fprintf(stderr, "ShmRing: the segment can be truncated\n");
+    return -1;
+  }
+
+  auto peer = ShmChannel::Attach(sv[1], dup(creator->Fd()), 0, env);
+  char buf[16] = "Hello ring!";
+  ::google::protobuf::rpc::IoVec iov = { buf, 11 };
+  if(peer == NULL || creator->Send(&iov, 1, 0) != 1 || peer->TryRecv(buf, sizeof(buf)) != 11) {
+    fprintf(stderr, "ShmRing: Send/TryRecv failed\n");
+    return -1;
+  }
+  // move the tail of the creator's ring (after the 64 bytes header)
+  // out of the ring
+  void* base = mmap(NULL, size_t(st.st_size), PROT_READ|PROT_WRITE, MAP_SHARED, creator->Fd(), 0);
+  *(volatile ::google::protobuf::uint32*)((char*)base + 64) += 1 << 20;
+  if(peer->TryRecv(buf, sizeof(buf)) != -1 || creator->Send(&iov, 1, 0) != -1) {
+    fprintf(stderr, "ShmRing: corrupt ring not detected\n");
+    return -1;
+  }
+  munmap(base, size_t(st.st_size));
+  delete peer;
+  delete creator;
+  close(sv[0]);
+  close(sv[1]);
+#endif
+  return 0;
+}
+
+// The buffered reader of Conn gets frames split across reads at any
+// byte, varint lengths included, and frames larger than its buffer.
+struct ConnReaderTest {
+  ::google::protobuf::rpc::Conn* writer;
+  std::string stream;  // the frames, sent a few bytes at a time
+  ::google::protobuf::rpc::CondVar cv;
+  bool done;
+};
+static void connReaderWriter(void* arg) {
+  auto t = (ConnReaderTest*)arg;
+  size_t pos = 0;
+  for(int i = 0; pos < t->stream.size(); i++) {
+    // 1 to 7 bytes, then the large frame in a few pieces
+    size_t n = (pos < 400)? size_t(1 + i%7): size_t(40000);
+    n = std::min(n, t->stream.size() - pos);
+    if(!t->writer->Write(&t->stream[pos], int(n))) {
+      break;
+    }
+    pos += n;
+    sleepMillis(1);
+  }
+  ::google::protobuf::rpc::CondVarLock locker(&t->cv);
+  t->done = true;
+  t->cv.Signal();
+}
+static int testConnReader() {
+#if defined(__linux__)
+  int sv[2];
+  if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+    fprintf(stderr, "ConnReader: socketpair failed\n");
+    return -1;
+  }
+  ::google::protobuf::rpc::Conn writer(sv[0]), reader(sv[1]);
+  reader.SetTimeout(5000);
+
+  // varint lengths of 1 to 3 bytes, an empty frame and a 10 bytes varint
+  std::string frames[4] = { "Hello ConnReader!", std::string(300, 'y'), "", std::string(100000, 'z') };
+  for(size_t i = 0; i < frames[3].size(); i += 4093) {
+    frames[3][i] = char('a' + i%26);
+  }
+  ConnReaderTest t;
+  t.writer = &writer;
+  t.done = false;
+  for(int i = 0; i < 4; i++) {
+    ::google::protobuf::uint8 buf[10];
+    int n = ::google::protobuf::rpc::PutUvarint(buf, frames[i].size());
+    t.stream.append((const char*)buf, n);
+    t.stream.append(frames[i]);
+    if(i == 2) {
+      n = ::google::protobuf::rpc::PutUvarint(buf, ~0ULL);
+      t.stream.append((const char*)buf, n);
+    }
+  }
+  ::google::protobuf::rpc::Env::Default()->StartThread(connReaderWriter, &t);
+
+  std::string data;
+  for(int i = 0; i < 4; i++) {
+    if(!reader.RecvFrame(&data) || data != frames[i]) {
+      fprintf(stderr, "ConnReader: frame %d not read\n", i);
+      return -1;
+    }
+    ::google::protobuf::uint64 x;
+    if(i == 2 && (!reader.ReadUvarint(&x) || x != ~0ULL)) {
+      fprintf(stderr, "ConnReader: 10 bytes varint not read\n");
+      return -1;
+    }
+  }
+  {
+    ::google::protobuf::rpc::CondVarLock locker(&t.cv);
+    while(!t.done) t.cv.Wait();
+  }
+  writer.Close();
+  if(reader.RecvFrame(&data)) {
+    fprintf(stderr, "ConnReader: frame read after EOF\n");
+    return -1;
+  }
+  reader.Close();
+#endif
+  return 0;
+}
+
+// Writev resumes after short writes at any byte of any buffer, with and
+// without a write deadline, past the iovecs of one sendmsg.
+struct ShortWriteTest {
+  ::google::protobuf::rpc::Conn* reader;
+  size_t len;
+  std::string got;
+  ::google::protobuf::rpc::CondVar cv;
+  bool done;
+};
+static void shortWriteReader(void* arg) {
+  auto t = (ShortWriteTest*)arg;
+  char buf[1000];
+  for(int i = 0; t->got.size() < t->len; i++) {
+    int n = int(std::min(sizeof(buf), t->len - t->got.size()));
+    if(!t->reader->Read(buf, n)) {
+      break;
+    }
+    t->got.append(buf, n);
+    if(i%64 == 0) {
+      sleepMillis(1);
+    }
+  }
+  ::google::protobuf::rpc::CondVarLock locker(&t->cv);
+  t->done = true;
+  t->cv.Signal();
+}
+static int testShortWrite() {
+#if defined(__linux__)
+  int sv[2];
+  if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+    fprintf(stderr, "ShortWrite: socketpair failed\n");
+    return -1;
+  }
+  int size = 4096;
+  setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+  setsockopt(sv[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  ::google::protobuf::rpc::Conn writer(sv[0]), reader(sv[1]);
+  reader.SetTimeout(10000);
+
+  // 100 buffers of 1 byte to 300KB
+  std::string data(4*1024*1024, ' ');
+  ::google::protobuf::uint64 x = 88172645463325252ULL;
+  for(size_t i = 0; i < data.size(); i++) {
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    data[i] = char(x);
+  }
+  std::vector< ::google::protobuf::rpc::IoVec> iov;
+  std::string expect;
+  size_t pos = 0;
+  for(int i = 0; i < 100; i++) {
+    size_t n = (i%10 == 9)? 300*1000: size_t(1 + (i*7919)%5000);
+    ::google::protobuf::rpc::IoVec v = { &data[pos], n };
+    iov.push_back(v);
+    expect.append(&data[pos], n);
+    pos += n;
+  }
+
+  ShortWriteTest t;
+  t.reader = &reader;
+  t.len = 2*expect.size();
+  t.done = false;
+  ::google::protobuf::rpc::Env::Default()->StartThread(shortWriteReader, &t);
+  for(int i = 0; i < 2; i++) {
+    writer.SetWriteTimeout((i == 0)? 0: 10000);
+    if(!writer.Writev(&iov[0], int(iov.size()))) {
+      fprintf(stderr, "ShortWrite: Writev(%d) failed\n", i);
+      return -1;
+    }
+  }
+  {
+    ::google::protobuf::rpc::CondVarLock locker(&t.cv);
+    while(!t.done) t.cv.Wait();
+  }
+  if(t.got != expect + expect) {
+    fprintf(stderr, "ShortWrite: %d bytes read, %d sent\n", int(t.got.size()), int(t.len));
+    return -1;
+  }
+  writer.Close();
+  reader.Close();
+#endif
+  return 0;
+}
+
+// PeekFrame reads frames larger than the read buffer and the ones after
+// them, and refuses a frame over the default max body len.
+struct PeekFrameTest {
+  ::google::protobuf::rpc::Conn* writer;
+  std::string big, small;
+  ::google::protobuf::rpc::CondVar cv;
+  bool done;
+};
+static void peekFrameWriter(void* arg) {
+  auto t = (PeekFrameTest*)arg;
+  t->writer->SendFrame(&t->big);
+  t->writer->SendFrame(&t->small);
+  t->writer->WriteUvarint(::google::protobuf::rpc::wire::kDefaultMaxBodyLen + 1);
+  ::google::protobuf::rpc::CondVarLock locker(&t->cv);
+  t->done = true;
+  t->cv.Signal();
+}
+static int testPeekFrame() {
+#if defined(__linux__)
+  int sv[2];
+  if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+    fprintf(stderr, "PeekFrame: socketpair failed\n");
+    return -1;
+  }
+  ::google::protobuf::rpc::Conn writer(sv[0]), reader(sv[1]);
+  reader.SetTimeout(5000);
+  PeekFrameTest t;
+  t.writer = &writer;
+  t.big.assign(1 << 20, 'x');
+  t.small = "Hello PeekFrame!";
+  t.done = false;
+  ::google::protobuf::rpc::Env::Default()->StartThread(peekFrameWriter, &t);
+
+  const std::string* frames[] = { &t.big, &t.small };
+  for(int i = 0; i < 2; i++) {
+    int len;
+    auto data = reader.PeekFrame(&len);
+    if(data == NULL || std::string(data, len) != *frames[i]) {
+      fprintf(stderr, "PeekFrame: frame %d not read\n", i);
+      return -1;
+    }
+    reader.Consume(len);
+  }
+  int len;
+  if(reader.PeekFrame(&len) != NULL) {
+    fprintf(stderr, "PeekFrame: frame over the max body len read\n");
+    return -1;
+  }
+  {
+    ::google::protobuf::rpc::CondVarLock locker(&t.cv);
+    while(!t.done) t.cv.Wait();
+  }
+  writer.Close();
+  reader.Close();
+#endif
+  return 0;
+}
+
+static const int kShardedTestPort = 12343;
+static ::google::protobuf::rpc::Server* shardedServer = NULL;
+static volatile bool shardedServeDone = false;
+
+static void serveSharded(void* arg) {
+  shardedServer->ServeSharded(kShardedTestPort, 2);
+  shardedServeDone = true;
+}
+
+static int testSharded() {
+  shardedServer = new ::google::protobuf::rpc::Server;
+  shardedServer->AddService(new EchoService, true);
+  ::google::protobuf::rpc::Env::Default()->StartThread(serveSharded, NULL);
+
+  const int kClients = 8;
+  for(int i = 0; i < kClients; i++) {
+    ::google::protobuf::rpc::Client client("127.0.0.1", kShardedTestPort);
+    std::string reply;
+    auto err = callEcho(&client, "Hello Shard!", &reply);
+    if(!err.IsNil() || reply != "Hello Shard!") {
+      fprintf(stderr, "Sharded: EchoService.Echo: %s\n", err.String().c_str());
+      return -1;
+    }
+  }
+
+  // every call is counted by the shard which served it
+  std::vector<::google::protobuf::rpc::Server::ShardStats> stats;
+  shardedServer->GetShardStats(&stats);
+  ::google::protobuf::uint64 calls = 0;
+  for(size_t i = 0; i < stats.size(); i++) {
+    calls += stats[i].calls;
+  }
+#if defined(__linux__) && defined(SO_REUSEPORT)
+  if(stats.size() != 2) {
+    fprintf(stderr, "Sharded: %d shards, expected 2\n", int(stats.size()));
+    return -1;
+  }
+#endif
+  if(!stats.empty() && calls != kClients) {
+    fprintf(stderr, "Sharded: %d shards counted %d calls\n", int(stats.size()), int(calls));
+    return -1;
+  }
+
+  if(!shardedServer->Shutdown(1000)) {
+    fprintf(stderr, "Sharded: not drained\n");
+    return -1;
+  }
+  for(int i = 0; i < 50 && !shardedServeDone; i++) {
+    sleepMillis(20);
+  }
+  if(!shardedServeDone) {
+    fprintf(stderr, "Sharded: ServeSharded did not return\n");
+    return -1;
+  }
+  delete shardedServer;
+  shardedServer = NULL;
+  return 0;
+}
+
+static const int kAdmissionTestPort = 12345;
+
+// A server admitting one call at a time answers the others at once.
+static int testAdmission() {
+  auto server = new ::google::protobuf::rpc::Server;
+  server->AddService(new EchoService, true);
+  ::google::protobuf::rpc::Admission::Limits limits;
+  limits.max_inflight = 1;
+  server->SetAdmission(limits);
+  if(!server->ListenTCP(kAdmissionTestPort)) {
+    fprintf(stderr, "Admission: ListenTCP failed\n");
+    return -1;
+  }
+  ::google::protobuf::rpc::Env::Default()->StartThread(serveListeners, server);
+
+  ::google::protobuf::rpc::Client slow("127.0.0.1", kAdmissionTestPort);
+  ::google::protobuf::rpc::Client client("127.0.0.1", kAdmissionTestPort);
+  ::service::EchoRequest args;
+  ::service::EchoResponse reply;
+  std::string msg;
+  auto err = callEcho(&client, "Hello Admission!", &msg);
+  if(!err.IsNil() || msg != "Hello Admission!") {
+    fprintf(stderr, "Admission: EchoService.Echo: %s\n", err.String().c_str());
+    return -1;
+  }
+
+  ::service::EchoRequest slowArgs;
+  ::service::EchoResponse slowReply;
+  slowArgs.set_msg("sleep");
+  auto call = slow.CallMethodAsync(service::EchoService::descriptor()->method(0), &slowArgs, &slowReply);
+  sleepMillis(50);
+  args.set_msg("Hello Admission!");
+  err = client.CallMethod("EchoService.Echo", &args, &reply);
+  if(err.String() != ::google::protobuf::rpc::kOverloadedError) {
+    fprintf(stderr, "Admission: expected overloaded, got: %s\n", err.String().c_str());
+    return -1;
+  }
+  if(!call->Wait().IsNil() || slowReply.msg() != "sleep") {
+    fprintf(stderr, "Admission: the admitted call failed\n");
+    return -1;
+  }
+  err = callEcho(&client, "Hello Admission!", &msg);
+  if(!err.IsNil() || msg != "Hello Admission!") {
+    fprintf(stderr, "Admission: EchoService.Echo after: %s\n", err.String().c_str());
+    return -1;
+  }
+
+  ::google::protobuf::rpc::Admission::Stats stats;
+  server->GetAdmission()->GetStats(&stats);
+  if(stats.admitted != 3 || stats.rejected != 1 || stats.inflight != 0 || stats.queued_bytes != 0) {
+    fprintf(stderr, "Admission: admitted %d, rejected %d, inflight %d\n",
+      int(stats.admitted), int(stats.rejected), stats.inflight);
+    return -1;
+  }
+  return 0;
+}
+
+// The calls are admitted again once an overloaded queue has drained.
+static int testAdmissionIdle() {
+  ::google::protobuf::rpc::Admission admission;
+  ::google::protobuf::rpc::Admission::Limits limits;
+  limits.target_delay_ms = 5;
+  admission.SetLimits(limits);
+
+  // a standing queue of calls waiting 50ms
+  const ::google::protobuf::uint64 ms = 1000;
+  std::vector< ::google::protobuf::uint64> queue;
+  ::google::protobuf::uint64 now = 1000*ms;
+  for(int i = 0; i < 200; i++, now += 5*ms) {
+    if(admission.Admit(10, now)) {
+      queue.push_back(now);
+    }
+    if(!queue.empty() && now >= queue.front() + 50*ms) {
+      admission.Start(10, queue.front(), now);
+      admission.Done();
+      queue.erase(queue.begin());
+    }
+  }
+  while(!queue.empty()) {
+    if(now < queue.front() + 50*ms) {
+      now = queue.front() + 50*ms;
+    }
+    admission.Start(10, queue.front(), now);
+    admission.Done();
+    queue.erase(queue.begin());
+  }
+  ::google::protobuf::rpc::Admission::Stats stats;
+  admission.GetStats(&stats);
+  if(stats.shed == 0) {
+    fprintf(stderr, "AdmissionIdle: nothing shed in the overload\n");
+    return -1;
+  }
+
+  // light traffic after an idle second
+  now += 1000*ms;
+  int admitted = 0;
+  for(int i = 0; i < 1000; i++, now += ms) {
+    if(!admission.Admit(10, now)) {
+      continue;
+    }
+    if(admission.Start(10, now, now + 100)) {
+      admitted++;
+    }
+    admission.Done();
+  }
+  if(admitted != 1000) {
+    fprintf(stderr, "AdmissionIdle: admitted %d of 1000 calls\n", admitted);
+    return -1;
+  }
+  return 0;
+}
+
+static const int kLimitsTestPort = 12346;
+static const int kLoopLimitsTestPort = 12337;  // and 12338
+static ::google::protobuf::rpc::Server* loopLimitsServer = NULL;
+static volatile bool loopLimitsServeDone = false;
+
+static void serveLoopLimits(void* arg) {
+  loopLimitsServer->ServeSharded(int((intptr_t)arg), 1);
+  loopLimitsServeDone = true;
+}
+
+struct HalfCloseTest {
+  ::google::protobuf::rpc::Conn* conn;
+  std::string requests;
+  ::google::protobuf::rpc::CondVar cv;
+  bool done;
+};
+static void halfCloseProc(void* p) {
+  auto t = (HalfCloseTest*)p;
+  t->conn->Write(&t->requests[0], int(t->requests.size()));
+  t->conn->ShutdownWrite();
+  ::google::protobuf::rpc::CondVarLock locker(&t->cv);
+  t->done = true;
+  t->cv.Signal();
+}
+
+// The event loops (epoll and io_uring) drop a connection sending a body
+// over the max body len, stop reading the requests of a client which
+// doesn't read the responses, and answer all the requests of a client
+// which shut down its sending side.
+static int testLoopLimits() {
+  auto env = ::google::protobuf::rpc::Env::Default();
+  std::string noise(64*1024, ' ');
+  ::google::protobuf::uint64 x = 88172645463325252ULL;
+  for(size_t j = 0; j < noise.size(); j++) {
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    noise[j] = char(' ' + x%95);
+  }
+
+  for(int i = 0; i < 2; i++) {
+    const int port = kLoopLimitsTestPort + i;
+    loopLimitsServer = new ::google::protobuf::rpc::Server;
+    loopLimitsServer->AddService(new EchoService, true);
+    loopLimitsServer->SetIoUring(i == 1);
+    loopLimitsServer->SetMaxBodyLen(256*1024);
+    loopLimitsServeDone = false;
+    env->StartThread(serveLoopLimits, (void*)(intptr_t)port);
+
+    ::google::protobuf::rpc::Client client("127.0.0.1", port);
+    std::string reply;
+    if(!callEcho(&client, "Hello Loop!", &reply).IsNil() || reply != "Hello Loop!") {
+      fprintf(stderr, "LoopLimits(%d): EchoService.Echo failed\n", port);
+      return -1;
+    }
+    // compressed under the limit, the call fails
+    ::service::EchoRequest args;
+    ::service::EchoResponse resp;
+    args.set_msg(std::string(1024*1024, 'x'));
+    if(client.CallMethod("EchoService.Echo", &args, &resp).IsNil() ||
+      !callEcho(&client, "Hello Loop!", &reply).IsNil() || reply != "Hello Loop!"
+    ) {
+      fprintf(stderr, "LoopLimits(%d): EchoService.Echo(1MB compressed) not turned down\n", port);
+      return -1;
+    }
+    // the body frame itself over the limit, the connection is dropped
+    args.clear_msg();
+    for(int j = 0; j < 16; j++) {
+      args.mutable_msg()->append(noise);
+    }
+    ::google::protobuf::rpc::Client raw("127.0.0.1", port);
+    raw.SetProtocolV2(true);
+    raw.SetMethodCompression("EchoService.Echo", ::google::protobuf::rpc::wire::Compression(false));
+    if(raw.CallMethod("EchoService.Echo", &args, &resp).IsNil()) {
+      fprintf(stderr, "LoopLimits(%d): EchoService.Echo(1MB raw) not turned down\n", port);
+      return -1;
+    }
+
+    // pipelined calls which are never read
+    const int n = 512;
+    args.set_msg(noise);
+    std::string requests;
+    for(int j = 0; j < n; j++) {
+      ::google::protobuf::rpc::wire::EncodeRequest(&requests, j + 1, "EchoService.Echo", &args);
+    }
+    ::google::protobuf::rpc::Conn flood(0, env);
+    if(!flood.DialTCP("127.0.0.1", port) || !flood.SetNonBlocking(true)) {
+      fprintf(stderr, "LoopLimits(%d): DialTCP failed\n", port);
+      return -1;
+    }
+    size_t sent = 0;
+    for(int j = 0; j < 100 && sent < requests.size(); j++) {
+      int k = flood.TryWrite(requests.data() + sent, int(requests.size() - sent));
+      if(k < 0) {
+        break;
+      }
+      sent += size_t(k);
+      if(k == 0) {
+        sleepMillis(10);
+      }
+    }
+    sleepMillis(100);
+    std::vector<::google::protobuf::rpc::Server::ShardStats> stats;
+    loopLimitsServer->GetShardStats(&stats);
+    ::google::protobuf::uint64 calls = 0;
+    for(size_t j = 0; j < stats.size(); j++) {
+      calls += stats[j].calls;
+    }
+    flood.Close();
+    if(stats.empty() || calls >= n/2) {
+      fprintf(stderr, "LoopLimits(%d): %d calls served to a client not reading\n", port, int(calls));
+      return -1;
+    }
+
+    // pipelined calls and EOF while the responses are backlogged
+    const int m = 64;
+    HalfCloseTest t;
+    for(int j = 0; j < m; j++) {
+      ::google::protobuf::rpc::wire::EncodeRequest(&t.requests, j + 1, "EchoService.Echo", &args);
+    }
+    ::google::protobuf::rpc::Conn half(0, env);
+    if(!half.DialTCP("127.0.0.1", port)) {
+      fprintf(stderr, "LoopLimits(%d): DialTCP failed\n", port);
+      return -1;
+    }
+    t.conn = &half;
+    t.done = false;
+    env->StartThread(halfCloseProc, &t);
+    {
+      ::google::protobuf::rpc::CondVarLock locker(&t.cv);
+      for(int j = 0; j < 25 && !t.done; j++) {
+        t.cv.TimedWait(20*1000);
+      }
+    }
+    int answered = 0;
+    std::string hdr, body;
+    while(half.RecvFrame(&hdr) && half.RecvFrame(&body)) {
+      ::google::protobuf::rpc::wire::ResponseHeader respHeader;
+      if(::google::protobuf::rpc::wire::DecodeResponseHeader(hdr.data(), hdr.size(),
+          ::google::protobuf::rpc::wire::kProtocolV1, &respHeader).IsNil() &&
+        respHeader.error().empty()
+      ) {
+        answered++;
+      }
+    }
+    {
+      ::google::protobuf::rpc::CondVarLock locker(&t.cv);
+      while(!t.done) {
+        t.cv.Wait();
+      }
+    }
+    half.Close();
+    if(answered != m) {
+      fprintf(stderr, "LoopLimits(%d): %d of %d calls answered after EOF\n", port, answered, m);
+      return -1;
+    }
+
+    if(!loopLimitsServer->Shutdown(1000)) {
+      fprintf(stderr, "LoopLimits(%d): not drained\n", port);
+      return -1;
+    }
+    for(int j = 0; j < 50 && !loopLimitsServeDone; j++) {
+      sleepMillis(20);
+    }
+    delete loopLimitsServer;
+    loopLimitsServer = NULL;
+  }
+  return 0;
+}
+
+static const int kLoopOffloadTestPort = 12335;  // and 12336
+
+// On the event loops the calls of the methods with a priority run on the
+// dispatcher: a slow one doesn't hold up the calls run on the loop, and
+// the server drains it.
+static int testLoopOffload() {
+  auto env = ::google::protobuf::rpc::Env::Default();
+  for(int i = 0; i < 2; i++) {
+    const int port = kLoopOffloadTestPort + i;
+    loopLimitsServer = new ::google::protobuf::rpc::Server;
+    loopLimitsServer->AddService(new ArithService, true);
+    loopLimitsServer->AddService(new EchoService, true);
+    loopLimitsServer->SetIoUring(i == 1);
+    loopLimitsServer->SetMethodLimits("EchoService.Echo",
+      ::google::protobuf::rpc::CallLimits(0, ::google::protobuf::rpc::PRIORITY_LOW)
+    );
+    loopLimitsServeDone = false;
+    env->StartThread(serveLoopLimits, (void*)(intptr_t)port);
+
+    ::google::protobuf::rpc::Client c1("127.0.0.1", port);
+    ::google::protobuf::rpc::Client c2("127.0.0.1", port);
+    std::string reply;
+    if(!callEcho(&c1, "Hello Offload!", &reply).IsNil() || !callEcho(&c2, "Hello Offload!", &reply).IsNil()) {
+      fprintf(stderr, "LoopOffload(%d): EchoService.Echo failed\n", port);
+      return -1;
+    }
+    ::service::EchoRequest args;
+    ::service::EchoResponse r1;
+    args.set_msg("sleep");
+    auto f1 = c1.CallMethodAsync(service::EchoService::descriptor()->method(0), &args, &r1);
+    sleepMillis(50);
+    ::service::ArithRequest arithArgs;
+    ::service::ArithResponse arithReply;
+    arithArgs.set_a(1);
+    arithArgs.set_b(2);
+    auto start = env->NowMicros();
+    auto err = c2.CallMethod("ArithService.add", &arithArgs, &arithReply);
+    if(!err.IsNil() || arithReply.c() != 3) {
+      fprintf(stderr, "LoopOffload(%d): ArithService.add: %s\n", port, err.String().c_str());
+      return -1;
+    }
+    auto elapsed = env->NowMicros() - start;
+    if(elapsed > 100*1000) {
+      fprintf(stderr, "LoopOffload(%d): the loop waited for the slow call (%d ms)\n", port, int(elapsed/1000));
+      return -1;
+    }
+
+    // the slow call still running is answered before the server stops
+    if(!loopLimitsServer->Shutdown(1000)) {
+      fprintf(stderr, "LoopOffload(%d): not drained\n", port);
+      return -1;
+    }
+    if(!f1->Wait().IsNil() || r1.msg() != "sleep") {
+      fprintf(stderr, "LoopOffload(%d): EchoService.Echo(sleep) failed\n", port);
+      return -1;
+    }
+    for(int j = 0; j < 50 && !loopLimitsServeDone; j++) {
+      sleepMillis(20);
+    }
+    delete loopLimitsServer;
+    loopLimitsServer = NULL;
+  }
+  return 0;
+}
+
+// Caps from the proto options and from Server::SetMethodLimits.
+static int testLimits() {
+  auto server = new ::google::protobuf::rpc::Server;
+  server->AddService(new ArithService, true);
+  server->AddService(new EchoService, true);
+  auto div = server->GetCallClass(service::ArithService::descriptor()->FindMethodByName("div"));
+  if(div == NULL || div->priority != ::google::protobuf::rpc::PRIORITY_LOW || div->method == NULL) {
+    fprintf(stderr, "Limits: ArithService.div options not applied\n");
+    return -1;
+  }
+  server->SetMethodLimits("EchoService.Echo", ::google::protobuf::rpc::CallLimits(1, ::google::protobuf::rpc::PRIORITY_HIGH));
+  if(!server->ListenTCP(kLimitsTestPort)) {
+    fprintf(stderr, "Limits: ListenTCP failed\n");
+    return -1;
+  }
+  ::google::protobuf::rpc::Env::Default()->StartThread(serveListeners, server);
+
+  // two slow calls on two connections run one after the other
+  ::google::protobuf::rpc::Client c1("127.0.0.1", kLimitsTestPort);
+  ::google::protobuf::rpc::Client c2("127.0.0.1", kLimitsTestPort);
+  std::string msg;
+  if(!callEcho(&c1, "Hello Limits!", &msg).IsNil() || !callEcho(&c2, "Hello Limits!", &msg).IsNil()) {
+    fprintf(stderr, "Limits: EchoService.Echo failed\n");
+    return -1;
+  }
+  ::service::EchoRequest args;
+  ::service::EchoResponse r1, r2;
+  args.set_msg("sleep");
+  auto start = ::google::protobuf::rpc::Env::Default()->NowMicros();
+  auto f1 = c1.CallMethodAsync(service::EchoService::descriptor()->method(0), &args, &r1);
+  auto f2 = c2.CallMethodAsync(service::EchoService::descriptor()->method(0), &args, &r2);
+  if(!f1->Wait().IsNil() || !f2->Wait().IsNil() || r1.msg() != "sleep" || r2.msg() != "sleep") {
+    fprintf(stderr, "Limits: EchoService.Echo(sleep) failed\n");
+    return -1;
+  }
+  auto elapsed = ::google::protobuf::rpc::Env::Default()->NowMicros() - start;
+  if(elapsed < 380*1000 || server->GetDispatcher()->Parked() != 1) {
+    fprintf(stderr, "Limits: the calls ran at once (%d ms)\n", int(elapsed/1000));
+    return -1;
+  }
+  return 0;
+}
+
+// Compressed bodies claiming a raw length past the max body len, or past
+// what snappy expands their size to, are refused before being allocated.
+static int testForgedBody() {
+  namespace wire = ::google::protobuf::rpc::wire;
+  const ::google::protobuf::uint32 rawLens[] = { 0x7fffffffu, 32*1024*1024 };
+  for(int i = 0; i < 2; i++) {
+    // snappy stream: the raw length, then a 1 byte literal
+    std::string body;
+    for(auto x = rawLens[i]; ; x >>= 7) {
+      if(x < 0x80) { body += char(x); break; }
+      body += char((x & 0x7f) | 0x80);
+    }
+    body += std::string("\x00x", 2);
+
+    wire::RequestHeader header;
+    header.set_id(1);
+    header.set_method("EchoService.Echo");
+    header.set_raw_request_len(rawLens[i]);
+    header.set_flags(wire::FLAG_COMPRESSED);
+    ::service::EchoRequest args;
+    auto err = wire::DecodeRequestBody(&header, body.data(), body.size(), &args);
+    if(err.IsNil() || err.String().find("body too long") == std::string::npos) {
+      fprintf(stderr, "ForgedBody: DecodeRequestBody(%u): %s\n", rawLens[i], err.String().c_str());
+      return -1;
+    }
+
+    // and from the wire, on the event loop and a blocking server
+    const int ports[] = { kEventLoopPort, kUnixTestPort };
+    for(int j = 0; j < 2; j++) {
+      ::google::protobuf::rpc::Conn conn;
+      std::string hdr, reply;
+      header.clear_flags();
+      if(!conn.DialTCP("127.0.0.1", ports[j]) ||
+        !wire::EncodeRequestHeader(header, wire::kProtocolV1, &hdr).IsNil() ||
+        !conn.SendFrame(&hdr)
+      ) {
+        fprintf(stderr, "ForgedBody: send to %d failed\n", ports[j]);
+        return -1;
+      }
+      // the server may drop the connection on the header alone
+      conn.SendFrame(&body);
+      wire::ResponseHeader respHeader;
+      if(conn.RecvFrame(&reply) &&
+        (!wire::DecodeResponseHeader(reply.data(), reply.size(), wire::kProtocolV1, &respHeader).IsNil() ||
+        respHeader.error().find("body too long") == std::string::npos)
+      ) {
+        fprintf(stderr, "ForgedBody: %d answered \"%s\"\n", ports[j], respHeader.error().c_str());
+        return -1;
+      }
+      conn.Close();
+    }
+  }
+  return 0;
+}
+
+static const int kShutdownTestPort = 12347;
+static const char* kHandoffPath = "@protorpc-rpctest-handoff";
+static volatile bool shutdownServeDone = false;
+
+static void serveUntilShutdown(void* arg) {
+  auto server = (::google::protobuf::rpc::Server*)arg;
+  server->Serve();
+  shutdownServeDone = true;
+}
+
+static void inheritAndServe(void* arg) {
+  auto server = (::google::protobuf::rpc::Server*)arg;
+  if(server->InheritListeners(kHandoffPath, 2000)) {
+    server->ServeEventLoop();
+  }
+  shutdownServeDone = true;
+}
+
+// Restart: the call in flight answers, the successor takes the port.
+static int testShutdown() {
+  auto server = new ::google::protobuf::rpc::Server;
+  server->AddService(new EchoService, true);
+  if(!server->ListenTCP(kShutdownTestPort)) {
+    fprintf(stderr, "Shutdown: ListenTCP failed\n");
+    return -1;
+  }
+  ::google::protobuf::rpc::Env::Default()->StartThread(serveUntilShutdown, server);
+
+  ::google::protobuf::rpc::Client c1("127.0.0.1", kShutdownTestPort);
+  ::google::protobuf::rpc::Client c2("127.0.0.1", kShutdownTestPort);
+  std::string msg;
+  if(!callEcho(&c1, "Hello Shutdown!", &msg).IsNil() || !callEcho(&c2, "Hello Shutdown!", &msg).IsNil()) {
+    fprintf(stderr, "Shutdown: EchoService.Echo failed\n");
+    return -1;
+  }
+  ::service::EchoRequest args;
+  ::service::EchoResponse reply;
+  args.set_msg("sleep");
+  auto f = c2.CallMethodAsync(service::EchoService::descriptor()->method(0), &args, &reply);
+
+  auto successor = new ::google::protobuf::rpc::Server;
+  successor->AddService(new EchoService, true);
+  ::google::protobuf::rpc::Env::Default()->StartThread(inheritAndServe, successor);
+  sleepMillis(50);
+
+  if(!server->Shutdown(2000, kHandoffPath)) {
+    fprintf(stderr, "Shutdown: not drained\n");
+    return -1;
+  }
+  if(!f->Wait().IsNil() || reply.msg() != "sleep") {
+    fprintf(stderr, "Shutdown: the call in flight failed\n");
+    return -1;
+  }
+  for(int i = 0; i < 50 && !shutdownServeDone; i++) {
+    sleepMillis(20);
+  }
+  if(!shutdownServeDone) {
+    fprintf(stderr, "Shutdown: Serve did not return\n");
+    return -1;
+  }
+  delete server;
+
+  // the idle connection reconnects to the successor
+  shutdownServeDone = false;
+  ::google::protobuf::rpc::Client c3("127.0.0.1", kShutdownTestPort);
+  if(!callEcho(&c1, "Hello Successor!", &msg).IsNil() || !callEcho(&c3, "Hello Successor!", &msg).IsNil()) {
+    fprintf(stderr, "Shutdown: the successor failed\n");
+    return -1;
+  }
+  if(!successor->Shutdown(1000)) {
+    fprintf(stderr, "Shutdown: successor not drained\n");
+    return -1;
+  }
+  for(int i = 0; i < 50 && !shutdownServeDone; i++) {
+    sleepMillis(20);
+  }
+  if(!shutdownServeDone) {
+    fprintf(stderr, "Shutdown: ServeEventLoop did not return\n");
+    return -1;
+  }
+  delete successor;
+
+  // an idle server wakes its accept loop up rather than waiting for it
+  // to look
+  auto env = ::google::protobuf::rpc::Env::Default();
+  ::google::protobuf::uint64 elapsed = 0;
+  for(int i = 0; i < 5; i++) {
+    shutdownServeDone = false;
+    server = new ::google::protobuf::rpc::Server;
+    server->AddService(new EchoService, true);
+    if(!server->ListenTCP(kShutdownTestPort)) {
+      fprintf(stderr, "Shutdown: ListenTCP failed\n");
+      return -1;
+    }
+    ::google::protobuf::rpc::Env::Default()->StartThread(serveUntilShutdown, server);
+    if(!callEcho(&c1, "Hello Shutdown!", &msg).IsNil()) {
+      fprintf(stderr, "Shutdown: EchoService.Echo failed\n");
+      return -1;
+    }
+    c1.Close();
+    auto start = env->NowMicros();
+    server->Shutdown(1000);
+    elapsed += env->NowMicros() - start;
+    for(int j = 0; j < 50 && !shutdownServeDone; j++) {
+      sleepMillis(20);
+    }
+    delete server;
+  }
+  if(elapsed > 100*1000) {
+    fprintf(stderr, "Shutdown: 5 idle shutdowns took %d ms\n", int(elapsed/1000));
+    return -1;
+  }
+  return 0;
+}
+
+// Bit at a time crc, poly reflected.
+static uint32_t crc32Bitwise(uint32_t poly, const char* data, size_t n) {
+  uint32_t crc = ~0u;
+  for(size_t i = 0; i < n; i++) {
+    crc ^= uint8_t(data[i]);
+    for(int k = 0; k < 8; k++) {
+      crc = (crc >> 1) ^ (poly & (0u - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+// The crc32 implementations agree with the bitwise crc for all the
+// lengths to 2000 at unaligned offsets, and on the known answers.
+static int testCRC32() {
+  using ::google::protobuf::rpc::CRC32Impl;
+
+  const char* check = "123456789";
+  if(::google::protobuf::rpc::HashCRC32(check, 9) != 0xcbf43926) {
+    fprintf(stderr, "CRC32: HashCRC32(\"%s\") failed\n", check);
+    return -1;
+  }
+  if(::google::protobuf::rpc::HashCRC32C(check, 9) != 0xe3069283) {
+    fprintf(stderr, "CRC32: HashCRC32C(\"%s\") failed\n", check);
+    return -1;
+  }
+
+  std::vector<CRC32Impl> impls;
+  ::google::protobuf::rpc::GetCRC32Impls(&impls);
+  std::string buf(2000 + 16, '\0');
+  uint32_t x = 2463534242u;
+  for(size_t i = 0; i < buf.size(); i++) {
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    buf[i] = char(x);
+  }
+  const size_t offsets[] = { 1, 3, 7 };
+  for(size_t k = 0; k < sizeof(offsets)/sizeof(offsets[0]); k++) {
+    const char* p = buf.data() + offsets[k];
+    for(size_t n = 0; n <= 2000; n++) {
+      uint32_t want = crc32Bitwise(0xedb88320, p, n);
+      for(size_t i = 0; i < impls.size(); i++) {
+        if(impls[i].hash(p, n) != want) {
+          fprintf(stderr, "CRC32: %s(offset %d, len %d) failed\n",
+            impls[i].name, int(offsets[k]), int(n)
+          );
+          return -1;
+        }
+      }
+      if(::google::protobuf::rpc::ExtendCRC32(
+        ::google::protobuf::rpc::HashCRC32(p, n/3), p + n/3, n - n/3) != want
+      ) {
+        fprintf(stderr, "CRC32: ExtendCRC32(offset %d, len %d) failed\n",
+          int(offsets[k]), int(n)
+        );
+        return -1;
+      }
+      if(::google::protobuf::rpc::HashCRC32C(p, n) != crc32Bitwise(0x82f63b78, p, n)) {
+        fprintf(stderr, "CRC32: HashCRC32C(offset %d, len %d) failed\n",
+          int(offsets[k]), int(n)
+        );
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+struct WheelTimer {
+  ::google::protobuf::uint64 expires;
+  ::google::protobuf::rpc::TimerWheel::Id id;
+  int state;  // 0: pending, 1: canceled, 2: expired
+};
+
+// Random timers of all the levels expire at their tick, the canceled
+// ones never.
+static int testTimerWheel() {
+  using ::google::protobuf::uint64;
+  using ::google::protobuf::rpc::TimerWheel;
+
+  const int n = 3000;
+  const uint64 ranges[] = { 300, 70000, 1ULL << 26, 1ULL << 34 };
+  std::vector<WheelTimer> timers(n);
+  TimerWheel wheel(1000);
+  uint64 x = 88172645463325252ULL;
+  for(int i = 0; i < n; i++) {
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    timers[i].expires = 1001 + x % ranges[(i%16 == 0)? 3: i%3];
+    timers[i].id = wheel.Add(timers[i].expires, NULL, &timers[i]);
+    timers[i].state = 0;
+  }
+  for(int i = 0; i < n; i += 3) {
+    if(!wheel.Cancel(timers[i].id) || wheel.Cancel(timers[i].id)) {
+      fprintf(stderr, "TimerWheel: Cancel(%d) failed\n", i);
+      return -1;
+    }
+    timers[i].state = 1;
+  }
 
-#include "./service.pb/arith.pb.h"
-#include "./service.pb/echo.pb.h"
+  std::vector<TimerWheel::Timer> expired;
+  while(wheel.Size() > 0) {
+    uint64 t = wheel.NextExpiry();
+    if(t <= wheel.Now() || t == TimerWheel::kNever) {
+      fprintf(stderr, "TimerWheel: bad NextExpiry %llu\n", (unsigned long long)t);
+      return -1;
+    }
+    wheel.Advance(t, &expired);
+    for(size_t i = 0; i < expired.size(); i++) {
+      auto timer = (WheelTimer*)expired[i].arg;
+      if(timer->state != 0 || timer->expires != t) {
+        fprintf(stderr, "TimerWheel: timer of tick %llu expired at %llu\n",
+          (unsigned long long)timer->expires, (unsigned long long)t
+        );
+        return -1;
+      }
+      timer->state = 2;
+      // cancel the next one while the wheel turns
+      int next = int(timer - &timers[0]) + 1;
+      if(next%5 == 0 && next < n && timers[next].state == 0) {
+        if(!wheel.Cancel(timers[next].id)) {
+          fprintf(stderr, "TimerWheel: Cancel(%d) failed\n", next);
+          return -1;
+        }
+        timers[next].state = 1;
+      }
+    }
+    expired.clear();
+  }
+  for(int i = 0; i < n; i++) {
+    if(timers[i].state == 0 || (timers[i].state == 2 && wheel.Cancel(timers[i].id))) {
+      fprintf(stderr, "TimerWheel: timer %d not expired\n", i);
+      return -1;
+    }
+  }
+  return 0;
+}
 
-class ArithService: public service::ArithService {
- public:
-  inline ArithService() {}
-  virtual ~ArithService() {}
+static volatile ::google::protobuf::uint64 timerFiredAt[2];
 
-  virtual const ::google::protobuf::rpc::Error add(
-    const ::service::ArithRequest* request,
-    ::service::ArithResponse* response
-  ) {
-    response->set_c(request->a() + request->b());
-    return ::google::protobuf::rpc::Error::Nil();
+static void fireTimer(void* arg) {
+  timerFiredAt[(size_t)arg] = ::google::protobuf::rpc::Env::Default()->NowMicros();
+}
+
+// Env::ScheduleAfter never runs early, a canceled timer never runs.
+static int testTimers() {
+  auto env = ::google::protobuf::rpc::Env::Default();
+  auto start = env->NowMicros();
+  auto h1 = env->ScheduleAfter(20, fireTimer, (void*)0);
+  auto h2 = env->ScheduleAfter(30, fireTimer, (void*)1);
+  if(h1 == 0 || h2 == 0 || !env->CancelTimer(h2)) {
+    fprintf(stderr, "Timers: CancelTimer failed\n");
+    return -1;
   }
-  virtual const ::google::protobuf::rpc::Error mul(
-    const ::service::ArithRequest* request,
-    ::service::ArithResponse* response
-  ) {
-    response->set_c(request->a() * request->b());
-    return ::google::protobuf::rpc::Error::Nil();
+  for(int i = 0; i < 100 && timerFiredAt[0] == 0; i++) {
+    sleepMillis(5);
   }
-  virtual const ::google::protobuf::rpc::Error div(
-    const ::service::ArithRequest* request,
-    ::service::ArithResponse* response
-  ) {
-    if(request->b() == 0) {
-      return ::google::protobuf::rpc::Error::New("divide by zero");
-    }
-    response->set_c(request->a() / request->b());
-    return ::google::protobuf::rpc::Error::Nil();
+  if(timerFiredAt[0] == 0 || timerFiredAt[0] - start < 20*1000) {
+    fprintf(stderr, "Timers: fired after %d us\n", int(timerFiredAt[0] - start));
+    return -1;
   }
-  virtual const ::google::protobuf::rpc::Error error(
-    const ::service::ArithRequest* request,
-    ::service::ArithResponse* response
-  ) {
-    return ::google::protobuf::rpc::Error::New("ArithError");
+  sleepMillis(30);
+  if(timerFiredAt[1] != 0 || env->CancelTimer(h1)) {
+    fprintf(stderr, "Timers: a canceled timer fired\n");
+    return -1;
   }
+  return 0;
+}
+
+// Schedule under contention on an Env of its own: producer threads and
+// the workers (on their deques, stolen by the others) schedule, every
+// function runs exactly once, deleting the Env runs the ones left.
+struct ScheduleTest;
+struct ScheduleItem {
+  ScheduleTest* t;
+  ScheduleItem* child;  // scheduled by the worker running this one
+  volatile ::google::protobuf::internal::Atomic32 runs;
 };
+struct ScheduleTest {
+  ::google::protobuf::rpc::Env* env;
+  std::vector<ScheduleItem> items;
+  int per_producer;
+  ::google::protobuf::rpc::CondVar cv;
+  int producers;  // started
+  int done;
+};
+static void runScheduleItem(void* arg) {
+  auto item = (ScheduleItem*)arg;
+  ::google::protobuf::internal::NoBarrier_AtomicIncrement(&item->runs, 1);
+  if(item->child != NULL) {
+    item->t->env->Schedule(runScheduleItem, item->child);
+  }
+}
+static void scheduleProc(void* arg) {
+  auto t = (ScheduleTest*)arg;
+  int first;
+  {
+    ::google::protobuf::rpc::CondVarLock locker(&t->cv);
+    first = t->producers++ * t->per_producer;
+  }
+  for(int i = first; i < first + t->per_producer; i++) {
+    t->env->Schedule(runScheduleItem, &t->items[i]);
+  }
+  ::google::protobuf::rpc::CondVarLock locker(&t->cv);
+  t->done++;
+  t->cv.Signal();
+}
+static int testSchedule() {
+  const int kProducers = 4;
+  ScheduleTest t;
+  t.env = ::google::protobuf::rpc::Env::New();
+  t.env->SetBackgroundThreads(4);
+  t.per_producer = 20000;
+  t.producers = 0;
+  t.done = 0;
+  int n = kProducers * t.per_producer;
+  t.items.resize(2*n);
+  for(int i = 0; i < 2*n; i++) {
+    t.items[i].t = &t;
+    t.items[i].child = (i < n)? &t.items[n+i]: NULL;
+    t.items[i].runs = 0;
+  }
+  for(int i = 0; i < kProducers; i++) {
+    ::google::protobuf::rpc::Env::Default()->StartThread(scheduleProc, &t);
+  }
+  {
+    ::google::protobuf::rpc::CondVarLock locker(&t.cv);
+    while(t.done < kProducers) t.cv.Wait();
+  }
+  ::google::protobuf::rpc::Env::ScheduleStats stats;
+  t.env->GetScheduleStats(&stats);
+  if(stats.num_threads != 4 || stats.scheduled < uint64_t(n)) {
+    fprintf(stderr, "Schedule: %d threads, %llu scheduled\n",
+      stats.num_threads, (unsigned long long)stats.scheduled
+    );
+    return -1;
+  }
+  delete t.env;
+  for(int i = 0; i < 2*n; i++) {
+    if(t.items[i].runs != 1) {
+      fprintf(stderr, "Schedule: function %d ran %d times\n", i, int(t.items[i].runs));
+      return -1;
+    }
+  }
+  return 0;
+}
 
-class EchoService: public service::EchoService {
- public:
-  inline EchoService() {}
-  virtual ~EchoService() {}
+static const int kIdleTestPort = 12348;
+static const int kIdleLoopTestPort = 12349;
 
-  virtual const ::google::protobuf::rpc::Error Echo(
-    const ::service::EchoRequest* request,
-    ::service::EchoResponse* response
+static void serveListenersEventLoop(void* arg) {
+  auto server = (::google::protobuf::rpc::Server*)arg;
+  server->ServeEventLoop();
+}
+
+// Idle connections are closed on both kinds of servers, despite the
+// keepalive pings, and the clients dial again.
+static int testIdleTimeout() {
+  const int ports[] = { kIdleTestPort, kIdleLoopTestPort };
+  for(int i = 0; i < 2; i++) {
+    auto server = new ::google::protobuf::rpc::Server;
+    server->AddService(new EchoService, true);
+    server->SetIdleTimeout(100);
+    if(!server->ListenTCP(ports[i])) {
+      fprintf(stderr, "IdleTimeout: ListenTCP failed\n");
+      return -1;
+    }
+    ::google::protobuf::rpc::Env::Default()->StartThread(
+      (i == 0)? serveListeners: serveListenersEventLoop, server
+    );
+
+    ::google::protobuf::rpc::Client c1("127.0.0.1", ports[i]);
+    ::google::protobuf::rpc::Client c2("127.0.0.1", ports[i]);
+    c2.SetKeepalive(20, 200);
+    std::string msg;
+    if(!callEcho(&c1, "Hello Idle!", &msg).IsNil() || !callEcho(&c2, "Hello Idle!", &msg).IsNil()) {
+      fprintf(stderr, "IdleTimeout: EchoService.Echo(%d) failed\n", ports[i]);
+      return -1;
+    }
+
+    auto env = ::google::protobuf::rpc::Env::Default();
+    auto start = env->NowMicros();
+    ::google::protobuf::rpc::Conn conn(0, env);
+    if(!conn.DialTCP("127.0.0.1", ports[i]) || !conn.WaitReadable(2000)) {
+      fprintf(stderr, "IdleTimeout: connection %d not closed\n", ports[i]);
+      return -1;
+    }
+    auto elapsed = env->NowMicros() - start;
+    conn.Close();
+    if(elapsed < 100*1000) {
+      fprintf(stderr, "IdleTimeout: connection %d closed after %d ms\n", ports[i], int(elapsed/1000));
+      return -1;
+    }
+
+    sleepMillis(50);
+    ::service::EchoRequest args;
+    ::service::EchoResponse reply;
+    args.set_msg("Hello again!");
+    for(int j = 0; j < 2; j++) {
+      auto client = (j == 0)? &c1: &c2;
+      auto err = client->CallMethod("EchoService.Echo", &args, &reply);
+      if(!err.IsNil() || reply.msg() != args.msg()) {
+        fprintf(stderr, "IdleTimeout: client %d did not dial again: %s\n", j, err.String().c_str());
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+static const int kProtocolV1TestPort = 12344;
+
+// Whether a v2 request of msg is sent raw (FLAG_COMPRESSED cleared)
+// under compression.
+static bool isRawBody(const std::string& msg, const ::google::protobuf::rpc::wire::Compression& compression) {
+  namespace wire = ::google::protobuf::rpc::wire;
+  ::service::EchoRequest args;
+  args.set_msg(msg);
+  std::string pbHeader, body;
+  wire::RequestHeader header;
+  if(!wire::MarshalRequest(1, "EchoService.Echo", &args, &pbHeader, &body,
+      0, wire::kProtocolV2, 0, &compression
+    ).IsNil() ||
+    !wire::DecodeRequestHeader(pbHeader.data(), pbHeader.size(), wire::kProtocolV2, &header).IsNil()
   ) {
-    response->set_msg(request->msg());
-    return ::google::protobuf::rpc::Error::Nil();
+    return false;
   }
-};
+  return (header.flags() & wire::FLAG_COMPRESSED) == 0 && body == args.SerializeAsString();
+}
+
+// v2 clients on the event loop and blocking servers, and on a server
+// without v2. Runs after testEventLoop and testUnix.
+static int testProtocolV2() {
+  auto server = new ::google::protobuf::rpc::Server;
+  server->AddService(new EchoService, true);
+  server->SetProtocolV2(false);
+  if(!server->ListenTCP(kProtocolV1TestPort)) {
+    fprintf(stderr, "ProtocolV2: ListenTCP failed\n");
+    return -1;
+  }
+  ::google::protobuf::rpc::Env::Default()->StartThread(serveListeners, server);
+
+  const int ports[] = { kEventLoopPort, kUnixTestPort, kProtocolV1TestPort };
+  for(int i = 0; i < 3; i++) {
+    ::google::protobuf::rpc::Client client("127.0.0.1", ports[i]);
+    client.SetProtocolV2(true);
+    client.SetCRC32C(i != 0);
+    std::string reply;
+    auto err = callEcho(&client, "Hello v2!", &reply);
+    if(!err.IsNil() || reply != "Hello v2!") {
+      fprintf(stderr, "ProtocolV2: EchoService.Echo(%d): %s\n", ports[i], err.String().c_str());
+      return -1;
+    }
+
+    ::service::EchoRequest args;
+    ::service::EchoResponse resp;
+    args.set_msg("Hello v2 async!");
+    err = client.CallMethodAsync("EchoService.Echo", &args, &resp)->Wait();
+    if(!err.IsNil() || resp.msg() != args.msg()) {
+      fprintf(stderr, "ProtocolV2: EchoService.EchoAsync(%d): %s\n", ports[i], err.String().c_str());
+      return -1;
+    }
+    err = client.CallMethod("EchoService.Pow", &args, &resp);
+    if(err.IsNil()) {
+      fprintf(stderr, "ProtocolV2: EchoService.Pow(%d): no error\n", ports[i]);
+      return -1;
+    }
+
+    // raw bodies: incompressible (probe) and without compression
+    std::string noise(64*1024, ' ');
+    ::google::protobuf::uint64 x = 88172645463325252ULL;
+    for(size_t j = 0; j < noise.size(); j++) {
+      x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+      noise[j] = char(' ' + x%95);
+    }
+    for(int j = 0; j < 2; j++) {
+      ::google::protobuf::rpc::wire::Compression compression(j == 0);
+      if(!isRawBody(noise, compression) || isRawBody(std::string(noise.size(), 'x'), compression) != (j == 1)) {
+        fprintf(stderr, "ProtocolV2: MarshalRequest(64KB, compression %d): wrong body kind\n", j == 0);
+        return -1;
+      }
+      client.SetMethodCompression("EchoService.Echo", compression);
+      err = callEcho(&client, noise, &reply);
+      if(!err.IsNil() || reply != noise) {
+        fprintf(stderr, "ProtocolV2: EchoService.Echo(%d, 64KB): %s\n", ports[i], err.String().c_str());
+        return -1;
+      }
+    }
+
+    // chunked bodies (blocking server): raw and compressed chunks, with
+    // a small call sent meanwhile
+    std::string large = std::string(3*1024*1024, 'x') + noise + noise;
+    client.SetMethodCompression("EchoService.Echo", ::google::protobuf::rpc::wire::Compression());
+    args.set_msg(large);
+    ::service::EchoRequest small;
+    ::service::EchoResponse smallResp;
+    small.set_msg("Hello chunks!");
+    auto future = client.CallMethodAsync("EchoService.Echo", &args, &resp);
+    err = client.CallMethodAsync("EchoService.Echo", &small, &smallResp)->Wait();
+    if(err.IsNil()) {
+      err = future->Wait();
+    }
+    if(!err.IsNil() || resp.msg() != large || smallResp.msg() != small.msg()) {
+      fprintf(stderr, "ProtocolV2: EchoService.Echo(%d, 3MB): %s\n", ports[i], err.String().c_str());
+      return -1;
+    }
+
+    // a response longer than the client accepts fails the call
+    client.SetMaxBodyLen(1024*1024);
+    err = client.CallMethod("EchoService.Echo", &args, &resp);
+    client.SetMaxBodyLen(0);
+    if(err.IsNil()) {
+      fprintf(stderr, "ProtocolV2: EchoService.Echo(%d, 3MB) over the max body len\n", ports[i]);
+      return -1;
+    }
+    err = callEcho(&client, "Hello again!", &reply);
+    if(!err.IsNil() || reply != "Hello again!") {
+      fprintf(stderr, "ProtocolV2: EchoService.Echo(%d) after: %s\n", ports[i], err.String().c_str());
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// Streaming calls on the blocking server, more data than the flow
+// control window in both directions. Runs after testUnix.
+static int testStream() {
+  ::google::protobuf::rpc::Client client("127.0.0.1", kUnixTestPort);
+  client.SetProtocolV2(true);
+  service::StreamService::Stub stub(&client);
+  ::service::StreamRequest req;
+  ::service::StreamResponse resp;
+  ::google::protobuf::rpc::Error err;
+
+  // server streaming
+  const int kMessages = 1000;
+  req.set_n(kMessages);
+  req.set_data(std::string(1024, 'x'));
+  {
+    auto reader = stub.List(&req);
+    int n = 0;
+    while(reader->Read(&resp)) {
+      if(resp.n() != n || resp.data() != req.data()) {
+        fprintf(stderr, "Stream: List: expected = %d, got = %d\n", n, resp.n());
+        return -1;
+      }
+      n++;
+    }
+    err = reader->Finish();
+    if(!err.IsNil() || n != kMessages) {
+      fprintf(stderr, "Stream: List: %d messages, %s\n", n, err.String().c_str());
+      return -1;
+    }
+  }
+
+  // client streaming
+  {
+    auto writer = stub.Sum(&resp);
+    int sum = 0;
+    for(int i = 0; i < kMessages; i++) {
+      req.set_n(i);
+      sum += i;
+      err = writer->Write(req);
+      if(!err.IsNil()) {
+        fprintf(stderr, "Stream: Sum: Write: %s\n", err.String().c_str());
+        return -1;
+      }
+    }
+    err = writer->Finish();
+    if(!err.IsNil() || resp.n() != sum) {
+      fprintf(stderr, "Stream: Sum: expected = %d, got = %d, %s\n", sum, resp.n(), err.String().c_str());
+      return -1;
+    }
+  }
+
+  // bidirectional, then the server method fails
+  {
+    auto rw = stub.Chat();
+    for(int i = 0; i < 10; i++) {
+      req.set_n(i);
+      req.set_data("Hello Stream!");
+      if(!rw->Write(req).IsNil() || !rw->Read(&resp) || resp.n() != i) {
+        fprintf(stderr, "Stream: Chat: message %d failed\n", i);
+        return -1;
+      }
+    }
+    req.set_data("fail");
+    rw->Write(req);
+    if(rw->Read(&resp)) {
+      fprintf(stderr, "Stream: Chat: unexpected message\n");
+      return -1;
+    }
+    err = rw->Finish();
+    if(err.IsNil() || err.String() != "ChatError") {
+      fprintf(stderr, "Stream: Chat: expected = \"%s\", got = \"%s\"\n",
+        "ChatError", err.String().c_str()
+      );
+      return -1;
+    }
+  }
+
+  // early Finish skips the rest, deleting an unfinished call cancels it
+  req.set_n(kMessages);
+  for(int i = 0; i < 2; i++) {
+    auto reader = stub.List(&req);
+    if(!reader->Read(&resp)) {
+      fprintf(stderr, "Stream: List: no message\n");
+      return -1;
+    }
+    if(i == 0 && !reader->Finish().IsNil()) {
+      fprintf(stderr, "Stream: List: early Finish failed\n");
+      return -1;
+    }
+  }
+
+  // unary calls share the connection
+  req.set_data("Hello Unary!");
+  err = client.CallMethod("StreamService.Echo", &req, &resp);
+  if(!err.IsNil() || resp.data() != req.data()) {
+    fprintf(stderr, "Stream: StreamService.Echo: %s\n", err.String().c_str());
+    return -1;
+  }
+
+  // no streams without v2, nor on the event loop server
+  ::google::protobuf::rpc::Client v1("127.0.0.1", kUnixTestPort);
+  ::google::protobuf::rpc::Client loop("127.0.0.1", kEventLoopPort);
+  loop.SetProtocolV2(true);
+  for(int i = 0; i < 2; i++) {
+    service::StreamService::Stub other(i == 0? &v1: &loop);
+    auto rw = other.Chat();
+    rw->Write(req);
+    if(rw->Read(&resp) || rw->Finish().IsNil()) {
+      fprintf(stderr, "Stream: Chat(%d): expected error\n", i);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// A client sending past its stream window, without reading the responses
+// nor waiting for STREAM_WINDOW frames, has its call ended with an error.
+static int testStreamWindow() {
+  namespace wire = ::google::protobuf::rpc::wire;
+  ::google::protobuf::rpc::Conn conn;
+  if(!conn.DialTCP("127.0.0.1", kUnixTestPort)) {
+    fprintf(stderr, "StreamWindow: DialTCP failed\n");
+    return -1;
+  }
+  conn.SetTimeout(5000);
+  wire::HandshakeRequest hello;
+  wire::HandshakeResponse helloReply;
+  hello.set_version(wire::kProtocolV2);
+  auto err = wire::RoundTrip(&conn, 0, wire::kHandshakeMethod, &hello, &helloReply);
+  int methodId = -1;
+  for(int i = 0; i < helloReply.methods_size(); i++) {
+    if(helloReply.methods(i) == "StreamService.Chat") {
+      methodId = i;
+    }
+  }
+  if(!err.IsNil() || helloReply.version() != uint32_t(wire::kProtocolV2) || methodId < 0) {
+    fprintf(stderr, "StreamWindow: handshake: %s\n", err.String().c_str());
+    return -1;
+  }
+
+  // 2MB of messages which don't compress, 8 times the window
+  std::string noise(64*1024, ' ');
+  ::google::protobuf::uint64 x = 88172645463325252ULL;
+  for(size_t j = 0; j < noise.size(); j++) {
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    noise[j] = char(' ' + x%95);
+  }
+  ::service::StreamRequest req;
+  req.set_data(noise);
+  std::string pbHeader, body;
+  for(int i = 0; i < 33; i++) {
+    auto frame = (i == 0)? wire::STREAM_OPEN: wire::STREAM_MESSAGE;
+    wire::MarshalStreamRequest(1, uint32_t(methodId), frame, 0, (i == 0)? NULL: &req, &pbHeader, &body,
+      NULL, wire::kCRC32
+    );
+    const std::string* frames[2] = { &pbHeader, &body };
+    if(!conn.SendFrames(frames, 2)) {
+      fprintf(stderr, "StreamWindow: SendFrames failed\n");
+      return -1;
+    }
+  }
+
+  // the messages echoed, then the end of the call
+  std::string hdr;
+  wire::ResponseHeader respHeader;
+  for(;;) {
+    if(!conn.RecvFrame(&hdr) ||
+      !wire::DecodeResponseHeader(hdr.data(), hdr.size(), wire::kProtocolV2, &respHeader).IsNil() ||
+      !conn.RecvFrame(&body)
+    ) {
+      fprintf(stderr, "StreamWindow: the call was not ended\n");
+      return -1;
+    }
+    if(respHeader.stream() == wire::STREAM_NONE) {
+      break;
+    }
+  }
+  if(respHeader.id() != 1 || respHeader.error().find("window exceeded") == std::string::npos) {
+    fprintf(stderr, "StreamWindow: ended with \"%s\"\n", respHeader.error().c_str());
+    return -1;
+  }
+  return 0;
+}
 
 int main(int argc, char* argv[]) {
   ::google::protobuf::rpc::Server client;
@@ -93,6 +2102,26 @@ int main(int argc, char* argv[]) {
     }
   }
 
+  // Test checksums, before the wire depends on them
+  if(testCRC32() != 0) {
+    return -1;
+  }
+
+  // Test method dispatch: wire names and other spellings
+  const char* dispatchNames[] = { "ArithService.Add", "arith_service.add", "ArithService.add" };
+  for(size_t i = 0; i < sizeof(dispatchNames)/sizeof(dispatchNames[0]); i++) {
+    ::google::protobuf::rpc::Service* service = NULL;
+    ::google::protobuf::MethodDescriptor* method = NULL;
+    if(!client.FindMethod(dispatchNames[i], &service, &method) || method->name() != "add") {
+      fprintf(stderr, "Server::FindMethod: %s not found\n", dispatchNames[i]);
+      return -1;
+    }
+  }
+  if(client.FindMethodDescriptor("ArithService.Pow") != NULL) {
+    fprintf(stderr, "Server::FindMethodDescriptor: found ArithService.Pow\n");
+    return -1;
+  }
+
   // EchoService.add
   arithArgs.set_a(1);
   arithArgs.set_b(2);
@@ -180,6 +2209,113 @@ int main(int argc, char* argv[]) {
     return -1;
   }
 
+  // EchoService.Echo: async call on the in-process Server
+  err = echoStub.EchoAsync(&echoArgs, &echoReply)->Wait();
+  if(!err.IsNil() || echoReply.msg() != echoArgs.msg()) {
+    fprintf(stderr, "echoStub.EchoAsync: %s\n", err.String().c_str());
+    return -1;
+  }
+
+  // Server.BindAndServeEventLoop
+  if(testEventLoop() != 0) {
+    return -1;
+  }
+
+  // Client.CallMethodAsync
+  if(testAsync() != 0) {
+    return -1;
+  }
+
+  // ClientPool
+  if(testClientPool() != 0) {
+    return -1;
+  }
+
+  // Client timeouts
+  if(testTimeout() != 0) {
+    return -1;
+  }
+
+  // Server.ListenUnix
+  if(testUnix() != 0) {
+    return -1;
+  }
+  if(testSharded() != 0) {
+    return -1;
+  }
+  if(testPipeline() != 0) {
+    return -1;
+  }
+  if(testOutOfOrder() != 0) {
+    return -1;
+  }
+  if(testShmRing() != 0) {
+    return -1;
+  }
+  if(testConnReader() != 0) {
+    return -1;
+  }
+  if(testShortWrite() != 0) {
+    return -1;
+  }
+  if(testPeekFrame() != 0) {
+    return -1;
+  }
+
+  // Client.NewStream
+  if(testStream() != 0) {
+    return -1;
+  }
+  if(testStreamWindow() != 0) {
+    return -1;
+  }
+
+  // Client.SetProtocolV2
+  if(testProtocolV2() != 0) {
+    return -1;
+  }
+
+  // Server.SetAdmission
+  if(testAdmission() != 0) {
+    return -1;
+  }
+  if(testAdmissionIdle() != 0) {
+    return -1;
+  }
+
+  // Server.SetMethodLimits
+  if(testLimits() != 0) {
+    return -1;
+  }
+  if(testLoopLimits() != 0) {
+    return -1;
+  }
+  if(testLoopOffload() != 0) {
+    return -1;
+  }
+  if(testForgedBody() != 0) {
+    return -1;
+  }
+
+  // Server.Shutdown
+  if(testShutdown() != 0) {
+    return -1;
+  }
+
+  // Env timers and workers, Server.SetIdleTimeout
+  if(testTimerWheel() != 0) {
+    return -1;
+  }
+  if(testTimers() != 0) {
+    return -1;
+  }
+  if(testSchedule() != 0) {
+    return -1;
+  }
+  if(testIdleTimeout() != 0) {
+    return -1;
+  }
+
   printf("RpcTest Done.\n");
   return 0;
 }
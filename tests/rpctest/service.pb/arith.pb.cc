@@ -102,16 +102,18 @@ void protobuf_AddDesc_arith_2eproto() {
   already_here = true;
   GOOGLE_PROTOBUF_VERIFY_VERSION;
 
+  ::google::protobuf::rpc::protobuf_AddDesc_google_2fprotobuf_2frpc_2foptions_2eproto();
   ::google::protobuf::DescriptorPool::InternalAddGeneratedFile(
-    "\n\013arith.proto\022\007service\"$\n\014ArithRequest\022\t"
-    "\n\001a\030\001 \001(\005\022\t\n\001b\030\002 \001(\005\"\032\n\rArithResponse\022\t\n"
-    "\001c\030\001 \001(\0052\350\001\n\014ArithService\0224\n\003add\022\025.servi"
-    "ce.ArithRequest\032\026.service.ArithResponse\022"
-    "4\n\003mul\022\025.service.ArithRequest\032\026.service."
-    "ArithResponse\0224\n\003div\022\025.service.ArithRequ"
-    "est\032\026.service.ArithResponse\0226\n\005error\022\025.s"
-    "ervice.ArithRequest\032\026.service.ArithRespo"
-    "nseB\003\200\001\001", 328);
+    "\n\013arith.proto\022\007service\032!google/protobuf/"
+    "rpc/options.proto\"$\n\014ArithRequest\022\t\n\001a\030\001"
+    " \001(\005\022\t\n\001b\030\002 \001(\005\"\032\n\rArithResponse\022\t\n\001c\030\001 "
+    "\001(\0052\362\001\n\014ArithService\0224\n\003add\022\025.service.Ar"
+    "ithRequest\032\026.service.ArithResponse\0224\n\003mu"
+    "l\022\025.service.ArithRequest\032\026.service.Arith"
+    "Response\022>\n\003div\022\025.service.ArithRequest\032\026"
+    ".service.ArithResponse\"\010\300\363\030\004\310\363\030\001\0226\n\005erro"
+    "r\022\025.service.ArithRequest\032\026.service.Arith"
+    "ResponseB\003\200\001\001", 373);
   ::google::protobuf::MessageFactory::InternalRegisterGeneratedFile(
     "arith.proto", &protobuf_RegisterTypes);
   ArithRequest::default_instance_ = new ArithRequest();
@@ -792,21 +794,45 @@ const ::google::protobuf::rpc::Error ArithService_Stub::add(
   ::service::ArithResponse* response) {
   return client_->CallMethod(descriptor()->method(0), request, response);
 }
+::std::shared_ptr< ::google::protobuf::rpc::Future> ArithService_Stub::addAsync(
+  const ::service::ArithRequest* request,
+  ::service::ArithResponse* response,
+  const ::google::protobuf::rpc::Callback& done) {
+  return client_->CallMethodAsync(descriptor()->method(0), request, response, done);
+}
 const ::google::protobuf::rpc::Error ArithService_Stub::mul(
   const ::service::ArithRequest* request,
   ::service::ArithResponse* response) {
   return client_->CallMethod(descriptor()->method(1), request, response);
 }
+::std::shared_ptr< ::google::protobuf::rpc::Future> ArithService_Stub::mulAsync(
+  const ::service::ArithRequest* request,
+  ::service::ArithResponse* response,
+  const ::google::protobuf::rpc::Callback& done) {
+  return client_->CallMethodAsync(descriptor()->method(1), request, response, done);
+}
 const ::google::protobuf::rpc::Error ArithService_Stub::div(
   const ::service::ArithRequest* request,
   ::service::ArithResponse* response) {
   return client_->CallMethod(descriptor()->method(2), request, response);
 }
+::std::shared_ptr< ::google::protobuf::rpc::Future> ArithService_Stub::divAsync(
+  const ::service::ArithRequest* request,
+  ::service::ArithResponse* response,
+  const ::google::protobuf::rpc::Callback& done) {
+  return client_->CallMethodAsync(descriptor()->method(2), request, response, done);
+}
 const ::google::protobuf::rpc::Error ArithService_Stub::error(
   const ::service::ArithRequest* request,
   ::service::ArithResponse* response) {
   return client_->CallMethod(descriptor()->method(3), request, response);
 }
+::std::shared_ptr< ::google::protobuf::rpc::Future> ArithService_Stub::errorAsync(
+  const ::service::ArithRequest* request,
+  ::service::ArithResponse* response,
+  const ::google::protobuf::rpc::Callback& done) {
+  return client_->CallMethodAsync(descriptor()->method(3), request, response, done);
+}
 
 // @@protoc_insertion_point(namespace_scope)
 
@@ -26,8 +26,10 @@
 #include <google/protobuf/generated_message_reflection.h>
 #include <google/protobuf/xml/xml_message.h>
 #include <google/protobuf/rpc/rpc_service.h>
+#include <google/protobuf/rpc/rpc_stream.h>
 #include <google/protobuf/rpc/rpc_client.h>
 #include <google/protobuf/unknown_field_set.h>
+#include "google/protobuf/rpc/options.pb.h"
 // @@protoc_insertion_point(includes)
 
 namespace service {
@@ -307,6 +309,25 @@ class ArithService_Stub : public ArithService {
     const ::service::ArithRequest* request,
     ::service::ArithResponse* response);
 
+  // asynchronous calls, see Caller::CallMethodAsync ------------------
+
+  ::std::shared_ptr< ::google::protobuf::rpc::Future> addAsync(
+    const ::service::ArithRequest* request,
+    ::service::ArithResponse* response,
+    const ::google::protobuf::rpc::Callback& done = ::google::protobuf::rpc::Callback());
+  ::std::shared_ptr< ::google::protobuf::rpc::Future> mulAsync(
+    const ::service::ArithRequest* request,
+    ::service::ArithResponse* response,
+    const ::google::protobuf::rpc::Callback& done = ::google::protobuf::rpc::Callback());
+  ::std::shared_ptr< ::google::protobuf::rpc::Future> divAsync(
+    const ::service::ArithRequest* request,
+    ::service::ArithResponse* response,
+    const ::google::protobuf::rpc::Callback& done = ::google::protobuf::rpc::Callback());
+  ::std::shared_ptr< ::google::protobuf::rpc::Future> errorAsync(
+    const ::service::ArithRequest* request,
+    ::service::ArithResponse* response,
+    const ::google::protobuf::rpc::Callback& done = ::google::protobuf::rpc::Callback());
+
  private:
   ::google::protobuf::rpc::Caller* client_;
   bool owns_client_;
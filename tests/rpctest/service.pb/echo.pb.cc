@@ -754,11 +754,23 @@ const ::google::protobuf::rpc::Error EchoService_Stub::Echo(
   ::service::EchoResponse* response) {
   return client_->CallMethod(descriptor()->method(0), request, response);
 }
+::std::shared_ptr< ::google::protobuf::rpc::Future> EchoService_Stub::EchoAsync(
+  const ::service::EchoRequest* request,
+  ::service::EchoResponse* response,
+  const ::google::protobuf::rpc::Callback& done) {
+  return client_->CallMethodAsync(descriptor()->method(0), request, response, done);
+}
 const ::google::protobuf::rpc::Error EchoService_Stub::EchoTwice(
   const ::service::EchoRequest* request,
   ::service::EchoResponse* response) {
   return client_->CallMethod(descriptor()->method(1), request, response);
 }
+::std::shared_ptr< ::google::protobuf::rpc::Future> EchoService_Stub::EchoTwiceAsync(
+  const ::service::EchoRequest* request,
+  ::service::EchoResponse* response,
+  const ::google::protobuf::rpc::Callback& done) {
+  return client_->CallMethodAsync(descriptor()->method(1), request, response, done);
+}
 
 // @@protoc_insertion_point(namespace_scope)
 
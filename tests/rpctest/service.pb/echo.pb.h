@@ -26,6 +26,7 @@
 #include <google/protobuf/generated_message_reflection.h>
 #include <google/protobuf/xml/xml_message.h>
 #include <google/protobuf/rpc/rpc_service.h>
+#include <google/protobuf/rpc/rpc_stream.h>
 #include <google/protobuf/rpc/rpc_client.h>
 #include <google/protobuf/unknown_field_set.h>
 // @@protoc_insertion_point(includes)
@@ -295,6 +296,17 @@ class EchoService_Stub : public EchoService {
     const ::service::EchoRequest* request,
     ::service::EchoResponse* response);
 
+  // asynchronous calls, see Caller::CallMethodAsync ------------------
+
+  ::std::shared_ptr< ::google::protobuf::rpc::Future> EchoAsync(
+    const ::service::EchoRequest* request,
+    ::service::EchoResponse* response,
+    const ::google::protobuf::rpc::Callback& done = ::google::protobuf::rpc::Callback());
+  ::std::shared_ptr< ::google::protobuf::rpc::Future> EchoTwiceAsync(
+    const ::service::EchoRequest* request,
+    ::service::EchoResponse* response,
+    const ::google::protobuf::rpc::Callback& done = ::google::protobuf::rpc::Callback());
+
  private:
   ::google::protobuf::rpc::Caller* client_;
   bool owns_client_;
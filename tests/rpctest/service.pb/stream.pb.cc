@@ -0,0 +1,926 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+// source: stream.proto
+
+#define INTERNAL_SUPPRESS_PROTOBUF_FIELD_DEPRECATION
+#include "stream.pb.h"
+
+#include <algorithm>
+
+#include <google/protobuf/stubs/common.h>
+#include <google/protobuf/stubs/once.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite_inl.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/generated_message_reflection.h>
+#include <google/protobuf/reflection_ops.h>
+#include <google/protobuf/wire_format.h>
+// @@protoc_insertion_point(includes)
+
+namespace service {
+
+namespace {
+
+const ::google::protobuf::Descriptor* StreamRequest_descriptor_ = NULL;
+const ::google::protobuf::internal::GeneratedMessageReflection*
+  StreamRequest_reflection_ = NULL;
+const ::google::protobuf::Descriptor* StreamResponse_descriptor_ = NULL;
+const ::google::protobuf::internal::GeneratedMessageReflection*
+  StreamResponse_reflection_ = NULL;
+const ::google::protobuf::ServiceDescriptor* StreamService_descriptor_ = NULL;
+
+}  // namespace
+
+
+void protobuf_AssignDesc_stream_2eproto() {
+  protobuf_AddDesc_stream_2eproto();
+  const ::google::protobuf::FileDescriptor* file =
+    ::google::protobuf::DescriptorPool::generated_pool()->FindFileByName(
+      "stream.proto");
+  GOOGLE_CHECK(file != NULL);
+  StreamRequest_descriptor_ = file->message_type(0);
+  static const int StreamRequest_offsets_[2] = {
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(StreamRequest, n_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(StreamRequest, data_),
+  };
+  StreamRequest_reflection_ =
+    new ::google::protobuf::internal::GeneratedMessageReflection(
+      StreamRequest_descriptor_,
+      StreamRequest::default_instance_,
+      StreamRequest_offsets_,
+      GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(StreamRequest, _has_bits_[0]),
+      GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(StreamRequest, _unknown_fields_),
+      -1,
+      ::google::protobuf::DescriptorPool::generated_pool(),
+      ::google::protobuf::MessageFactory::generated_factory(),
+      sizeof(StreamRequest));
+  StreamResponse_descriptor_ = file->message_type(1);
+  static const int StreamResponse_offsets_[2] = {
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(StreamResponse, n_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(StreamResponse, data_),
+  };
+  StreamResponse_reflection_ =
+    new ::google::protobuf::internal::GeneratedMessageReflection(
+      StreamResponse_descriptor_,
+      StreamResponse::default_instance_,
+      StreamResponse_offsets_,
+      GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(StreamResponse, _has_bits_[0]),
+      GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(StreamResponse, _unknown_fields_),
+      -1,
+      ::google::protobuf::DescriptorPool::generated_pool(),
+      ::google::protobuf::MessageFactory::generated_factory(),
+      sizeof(StreamResponse));
+  StreamService_descriptor_ = file->service(0);
+}
+
+namespace {
+
+GOOGLE_PROTOBUF_DECLARE_ONCE(protobuf_AssignDescriptors_once_);
+inline void protobuf_AssignDescriptorsOnce() {
+  ::google::protobuf::GoogleOnceInit(&protobuf_AssignDescriptors_once_,
+                 &protobuf_AssignDesc_stream_2eproto);
+}
+
+void protobuf_RegisterTypes(const ::std::string&) {
+  protobuf_AssignDescriptorsOnce();
+  ::google::protobuf::MessageFactory::InternalRegisterGeneratedMessage(
+    StreamRequest_descriptor_, &StreamRequest::default_instance());
+  ::google::protobuf::MessageFactory::InternalRegisterGeneratedMessage(
+    StreamResponse_descriptor_, &StreamResponse::default_instance());
+}
+
+}  // namespace
+
+void protobuf_ShutdownFile_stream_2eproto() {
+  delete StreamRequest::default_instance_;
+  delete StreamRequest_reflection_;
+  delete StreamResponse::default_instance_;
+  delete StreamResponse_reflection_;
+}
+
+void protobuf_AddDesc_stream_2eproto() {
+  static bool already_here = false;
+  if (already_here) return;
+  already_here = true;
+  GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+  ::google::protobuf::DescriptorPool::InternalAddGeneratedFile(
+    "\n\014stream.proto\022\007service\"(\n\rStreamRequest"
+    "\022\t\n\001n\030\001 \001(\005\022\014\n\004data\030\002 \001(\t\")\n\016StreamRespo"
+    "nse\022\t\n\001n\030\001 \001(\005\022\014\n\004data\030\002 \001(\t2\372\001\n\rStreamS"
+    "ervice\0229\n\004List\022\026.service.StreamRequest\032\027"
+    ".service.StreamResponse0\001\0228\n\003Sum\022\026.servi"
+    "ce.StreamRequest\032\027.service.StreamRespons"
+    "e(\001\022;\n\004Chat\022\026.service.StreamRequest\032\027.se"
+    "rvice.StreamResponse(\0010\001\0227\n\004Echo\022\026.servi"
+    "ce.StreamRequest\032\027.service.StreamRespons"
+    "eB\003\200\001\001", 366);
+  ::google::protobuf::MessageFactory::InternalRegisterGeneratedFile(
+    "stream.proto", &protobuf_RegisterTypes);
+  StreamRequest::default_instance_ = new StreamRequest();
+  StreamResponse::default_instance_ = new StreamResponse();
+  StreamRequest::default_instance_->InitAsDefaultInstance();
+  StreamResponse::default_instance_->InitAsDefaultInstance();
+  ::google::protobuf::internal::OnShutdown(&protobuf_ShutdownFile_stream_2eproto);
+}
+
+// Force AddDescriptors() to be called at static initialization time.
+struct StaticDescriptorInitializer_stream_2eproto {
+  StaticDescriptorInitializer_stream_2eproto() {
+    protobuf_AddDesc_stream_2eproto();
+  }
+} static_descriptor_initializer_stream_2eproto_;
+
+// ===================================================================
+
+#ifndef _MSC_VER
+const int StreamRequest::kNFieldNumber;
+const int StreamRequest::kDataFieldNumber;
+#endif  // !_MSC_VER
+
+StreamRequest::StreamRequest()
+  : ::google::protobuf::Message() {
+  SharedCtor();
+}
+
+void StreamRequest::InitAsDefaultInstance() {
+}
+
+StreamRequest::StreamRequest(const StreamRequest& from)
+  : ::google::protobuf::Message() {
+  SharedCtor();
+  MergeFrom(from);
+}
+
+void StreamRequest::SharedCtor() {
+  _cached_size_ = 0;
+  n_ = 0;
+  data_ = const_cast< ::std::string*>(&::google::protobuf::internal::kEmptyString);
+  ::memset(_has_bits_, 0, sizeof(_has_bits_));
+}
+
+StreamRequest::~StreamRequest() {
+  SharedDtor();
+}
+
+void StreamRequest::SharedDtor() {
+  if (data_ != &::google::protobuf::internal::kEmptyString) {
+    delete data_;
+  }
+  if (this != default_instance_) {
+  }
+}
+
+void StreamRequest::SetCachedSize(int size) const {
+  GOOGLE_SAFE_CONCURRENT_WRITES_BEGIN();
+  _cached_size_ = size;
+  GOOGLE_SAFE_CONCURRENT_WRITES_END();
+}
+const ::google::protobuf::Descriptor* StreamRequest::descriptor() {
+  protobuf_AssignDescriptorsOnce();
+  return StreamRequest_descriptor_;
+}
+
+const StreamRequest& StreamRequest::default_instance() {
+  if (default_instance_ == NULL) protobuf_AddDesc_stream_2eproto();
+  return *default_instance_;
+}
+
+StreamRequest* StreamRequest::default_instance_ = NULL;
+
+StreamRequest* StreamRequest::New() const {
+  return new StreamRequest;
+}
+
+void StreamRequest::Clear() {
+  if (_has_bits_[0 / 32] & (0xffu << (0 % 32))) {
+    n_ = 0;
+    if (has_data()) {
+      if (data_ != &::google::protobuf::internal::kEmptyString) {
+        data_->clear();
+      }
+    }
+  }
+  ::memset(_has_bits_, 0, sizeof(_has_bits_));
+  mutable_unknown_fields()->Clear();
+}
+
+bool StreamRequest::MergePartialFromCodedStream(
+    ::google::protobuf::io::CodedInputStream* input) {
+#define DO_(EXPRESSION) if (!(EXPRESSION)) return false
+  ::google::protobuf::uint32 tag;
+  while ((tag = input->ReadTag()) != 0) {
+    switch (::google::protobuf::internal::WireFormatLite::GetTagFieldNumber(tag)) {
+      // optional int32 n = 1;
+      case 1: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT) {
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   ::google::protobuf::int32, ::google::protobuf::internal::WireFormatLite::TYPE_INT32>(
+                 input, &n_)));
+          set_has_n();
+        } else {
+          goto handle_uninterpreted;
+        }
+        if (input->ExpectTag(18)) goto parse_data;
+        break;
+      }
+
+      // optional string data = 2;
+      case 2: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+         parse_data:
+          DO_(::google::protobuf::internal::WireFormatLite::ReadString(
+                input, this->mutable_data()));
+          ::google::protobuf::internal::WireFormat::VerifyUTF8String(
+            this->data().data(), this->data().length(),
+            ::google::protobuf::internal::WireFormat::PARSE);
+        } else {
+          goto handle_uninterpreted;
+        }
+        if (input->ExpectAtEnd()) return true;
+        break;
+      }
+
+      default: {
+      handle_uninterpreted:
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_END_GROUP) {
+          return true;
+        }
+        DO_(::google::protobuf::internal::WireFormat::SkipField(
+              input, tag, mutable_unknown_fields()));
+        break;
+      }
+    }
+  }
+  return true;
+#undef DO_
+}
+
+void StreamRequest::SerializeWithCachedSizes(
+    ::google::protobuf::io::CodedOutputStream* output) const {
+  // optional int32 n = 1;
+  if (has_n()) {
+    ::google::protobuf::internal::WireFormatLite::WriteInt32(1, this->n(), output);
+  }
+
+  // optional string data = 2;
+  if (has_data()) {
+    ::google::protobuf::internal::WireFormat::VerifyUTF8String(
+      this->data().data(), this->data().length(),
+      ::google::protobuf::internal::WireFormat::SERIALIZE);
+    ::google::protobuf::internal::WireFormatLite::WriteString(
+      2, this->data(), output);
+  }
+
+  if (!unknown_fields().empty()) {
+    ::google::protobuf::internal::WireFormat::SerializeUnknownFields(
+        unknown_fields(), output);
+  }
+}
+
+::google::protobuf::uint8* StreamRequest::SerializeWithCachedSizesToArray(
+    ::google::protobuf::uint8* target) const {
+  // optional int32 n = 1;
+  if (has_n()) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteInt32ToArray(1, this->n(), target);
+  }
+
+  // optional string data = 2;
+  if (has_data()) {
+    ::google::protobuf::internal::WireFormat::VerifyUTF8String(
+      this->data().data(), this->data().length(),
+      ::google::protobuf::internal::WireFormat::SERIALIZE);
+    target =
+      ::google::protobuf::internal::WireFormatLite::WriteStringToArray(
+        2, this->data(), target);
+  }
+
+  if (!unknown_fields().empty()) {
+    target = ::google::protobuf::internal::WireFormat::SerializeUnknownFieldsToArray(
+        unknown_fields(), target);
+  }
+  return target;
+}
+
+int StreamRequest::ByteSize() const {
+  int total_size = 0;
+
+  if (_has_bits_[0 / 32] & (0xffu << (0 % 32))) {
+    // optional int32 n = 1;
+    if (has_n()) {
+      total_size += 1 +
+        ::google::protobuf::internal::WireFormatLite::Int32Size(
+          this->n());
+    }
+
+    // optional string data = 2;
+    if (has_data()) {
+      total_size += 1 +
+        ::google::protobuf::internal::WireFormatLite::StringSize(
+          this->data());
+    }
+
+  }
+  if (!unknown_fields().empty()) {
+    total_size +=
+      ::google::protobuf::internal::WireFormat::ComputeUnknownFieldsSize(
+        unknown_fields());
+  }
+  GOOGLE_SAFE_CONCURRENT_WRITES_BEGIN();
+  _cached_size_ = total_size;
+  GOOGLE_SAFE_CONCURRENT_WRITES_END();
+  return total_size;
+}
+
+void StreamRequest::MergeFrom(const ::google::protobuf::Message& from) {
+  GOOGLE_CHECK_NE(&from, this);
+  const StreamRequest* source =
+    ::google::protobuf::internal::dynamic_cast_if_available<const StreamRequest*>(
+      &from);
+  if (source == NULL) {
+    ::google::protobuf::internal::ReflectionOps::Merge(from, this);
+  } else {
+    MergeFrom(*source);
+  }
+}
+
+void StreamRequest::MergeFrom(const StreamRequest& from) {
+  GOOGLE_CHECK_NE(&from, this);
+  if (from._has_bits_[0 / 32] & (0xffu << (0 % 32))) {
+    if (from.has_n()) {
+      set_n(from.n());
+    }
+    if (from.has_data()) {
+      set_data(from.data());
+    }
+  }
+  mutable_unknown_fields()->MergeFrom(from.unknown_fields());
+}
+
+void StreamRequest::CopyFrom(const ::google::protobuf::Message& from) {
+  if (&from == this) return;
+  Clear();
+  MergeFrom(from);
+}
+
+void StreamRequest::CopyFrom(const StreamRequest& from) {
+  if (&from == this) return;
+  Clear();
+  MergeFrom(from);
+}
+
+bool StreamRequest::IsInitialized() const {
+
+  return true;
+}
+
+bool StreamRequest::ParseFromXmlString(const std::string& data) {
+  ::google::protobuf::xml::XmlMessage stub(*const_cast<StreamRequest*>(this));
+  if(!stub.ParseFromString(data)) {
+    GOOGLE_LOG(WARNING) << "ParseFromXmlString failed: " << stub.GetErrorText();
+    return false;
+  }
+  if (!this->IsInitialized()) {
+    GOOGLE_LOG(WARNING)
+      << "ParseFromXmlString failed: missing required fields: "
+      << this->InitializationErrorString();
+    return false;
+  }
+  return true;
+}
+
+bool StreamRequest::ParsePartialFromXmlString(const std::string& data) {
+  ::google::protobuf::xml::XmlMessage stub(*const_cast<StreamRequest*>(this));
+  if(!stub.ParseFromString(data)) {
+    GOOGLE_LOG(WARNING) << "ParsePartialFromXmlString failed: " << stub.GetErrorText();
+    return false;
+  }
+  return true;
+}
+
+bool StreamRequest::SerializeToXmlString(std::string* output) const {
+  output->clear();
+  if (!this->IsInitialized()) {
+    GOOGLE_LOG(WARNING)
+      << "SerializeToXmlString failed: missing required fields: "
+      << this->InitializationErrorString();
+    return false;
+  }
+
+  ::google::protobuf::xml::XmlMessage stub(*const_cast<StreamRequest*>(this));
+  output->assign(stub.SerializeToString());
+  return true;
+}
+
+bool StreamRequest::SerializePartialToXmlString(std::string* output) const {
+  output->clear();
+
+  ::google::protobuf::xml::XmlMessage stub(*const_cast<StreamRequest*>(this));
+  output->assign(stub.SerializeToString());
+  return true;
+}
+
+void StreamRequest::Swap(StreamRequest* other) {
+  if (other != this) {
+    std::swap(n_, other->n_);
+    std::swap(data_, other->data_);
+    std::swap(_has_bits_[0], other->_has_bits_[0]);
+    _unknown_fields_.Swap(&other->_unknown_fields_);
+    std::swap(_cached_size_, other->_cached_size_);
+  }
+}
+
+::google::protobuf::Metadata StreamRequest::GetMetadata() const {
+  protobuf_AssignDescriptorsOnce();
+  ::google::protobuf::Metadata metadata;
+  metadata.descriptor = StreamRequest_descriptor_;
+  metadata.reflection = StreamRequest_reflection_;
+  return metadata;
+}
+
+
+// ===================================================================
+
+#ifndef _MSC_VER
+const int StreamResponse::kNFieldNumber;
+const int StreamResponse::kDataFieldNumber;
+#endif  // !_MSC_VER
+
+StreamResponse::StreamResponse()
+  : ::google::protobuf::Message() {
+  SharedCtor();
+}
+
+void StreamResponse::InitAsDefaultInstance() {
+}
+
+StreamResponse::StreamResponse(const StreamResponse& from)
+  : ::google::protobuf::Message() {
+  SharedCtor();
+  MergeFrom(from);
+}
+
+void StreamResponse::SharedCtor() {
+  _cached_size_ = 0;
+  n_ = 0;
+  data_ = const_cast< ::std::string*>(&::google::protobuf::internal::kEmptyString);
+  ::memset(_has_bits_, 0, sizeof(_has_bits_));
+}
+
+StreamResponse::~StreamResponse() {
+  SharedDtor();
+}
+
+void StreamResponse::SharedDtor() {
+  if (data_ != &::google::protobuf::internal::kEmptyString) {
+    delete data_;
+  }
+  if (this != default_instance_) {
+  }
+}
+
+void StreamResponse::SetCachedSize(int size) const {
+  GOOGLE_SAFE_CONCURRENT_WRITES_BEGIN();
+  _cached_size_ = size;
+  GOOGLE_SAFE_CONCURRENT_WRITES_END();
+}
+const ::google::protobuf::Descriptor* StreamResponse::descriptor() {
+  protobuf_AssignDescriptorsOnce();
+  return StreamResponse_descriptor_;
+}
+
+const StreamResponse& StreamResponse::default_instance() {
+  if (default_instance_ == NULL) protobuf_AddDesc_stream_2eproto();
+  return *default_instance_;
+}
+
+StreamResponse* StreamResponse::default_instance_ = NULL;
+
+StreamResponse* StreamResponse::New() const {
+  return new StreamResponse;
+}
+
+void StreamResponse::Clear() {
+  if (_has_bits_[0 / 32] & (0xffu << (0 % 32))) {
+    n_ = 0;
+    if (has_data()) {
+      if (data_ != &::google::protobuf::internal::kEmptyString) {
+        data_->clear();
+      }
+    }
+  }
+  ::memset(_has_bits_, 0, sizeof(_has_bits_));
+  mutable_unknown_fields()->Clear();
+}
+
+bool StreamResponse::MergePartialFromCodedStream(
+    ::google::protobuf::io::CodedInputStream* input) {
+#define DO_(EXPRESSION) if (!(EXPRESSION)) return false
+  ::google::protobuf::uint32 tag;
+  while ((tag = input->ReadTag()) != 0) {
+    switch (::google::protobuf::internal::WireFormatLite::GetTagFieldNumber(tag)) {
+      // optional int32 n = 1;
+      case 1: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT) {
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   ::google::protobuf::int32, ::google::protobuf::internal::WireFormatLite::TYPE_INT32>(
+                 input, &n_)));
+          set_has_n();
+        } else {
+          goto handle_uninterpreted;
+        }
+        if (input->ExpectTag(18)) goto parse_data;
+        break;
+      }
+
+      // optional string data = 2;
+      case 2: {
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+         parse_data:
+          DO_(::google::protobuf::internal::WireFormatLite::ReadString(
+                input, this->mutable_data()));
+          ::google::protobuf::internal::WireFormat::VerifyUTF8String(
+            this->data().data(), this->data().length(),
+            ::google::protobuf::internal::WireFormat::PARSE);
+        } else {
+          goto handle_uninterpreted;
+        }
+        if (input->ExpectAtEnd()) return true;
+        break;
+      }
+
+      default: {
+      handle_uninterpreted:
+        if (::google::protobuf::internal::WireFormatLite::GetTagWireType(tag) ==
+            ::google::protobuf::internal::WireFormatLite::WIRETYPE_END_GROUP) {
+          return true;
+        }
+        DO_(::google::protobuf::internal::WireFormat::SkipField(
+              input, tag, mutable_unknown_fields()));
+        break;
+      }
+    }
+  }
+  return true;
+#undef DO_
+}
+
+void StreamResponse::SerializeWithCachedSizes(
+    ::google::protobuf::io::CodedOutputStream* output) const {
+  // optional int32 n = 1;
+  if (has_n()) {
+    ::google::protobuf::internal::WireFormatLite::WriteInt32(1, this->n(), output);
+  }
+
+  // optional string data = 2;
+  if (has_data()) {
+    ::google::protobuf::internal::WireFormat::VerifyUTF8String(
+      this->data().data(), this->data().length(),
+      ::google::protobuf::internal::WireFormat::SERIALIZE);
+    ::google::protobuf::internal::WireFormatLite::WriteString(
+      2, this->data(), output);
+  }
+
+  if (!unknown_fields().empty()) {
+    ::google::protobuf::internal::WireFormat::SerializeUnknownFields(
+        unknown_fields(), output);
+  }
+}
+
+::google::protobuf::uint8* StreamResponse::SerializeWithCachedSizesToArray(
+    ::google::protobuf::uint8* target) const {
+  // optional int32 n = 1;
+  if (has_n()) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteInt32ToArray(1, this->n(), target);
+  }
+
+  // optional string data = 2;
+  if (has_data()) {
+    ::google::protobuf::internal::WireFormat::VerifyUTF8String(
+      this->data().data(), this->data().length(),
+      ::google::protobuf::internal::WireFormat::SERIALIZE);
+    target =
+      ::google::protobuf::internal::WireFormatLite::WriteStringToArray(
+        2, this->data(), target);
+  }
+
+  if (!unknown_fields().empty()) {
+    target = ::google::protobuf::internal::WireFormat::SerializeUnknownFieldsToArray(
+        unknown_fields(), target);
+  }
+  return target;
+}
+
+int StreamResponse::ByteSize() const {
+  int total_size = 0;
+
+  if (_has_bits_[0 / 32] & (0xffu << (0 % 32))) {
+    // optional int32 n = 1;
+    if (has_n()) {
+      total_size += 1 +
+        ::google::protobuf::internal::WireFormatLite::Int32Size(
+          this->n());
+    }
+
+    // optional string data = 2;
+    if (has_data()) {
+      total_size += 1 +
+        ::google::protobuf::internal::WireFormatLite::StringSize(
+          this->data());
+    }
+
+  }
+  if (!unknown_fields().empty()) {
+    total_size +=
+      ::google::protobuf::internal::WireFormat::ComputeUnknownFieldsSize(
+        unknown_fields());
+  }
+  GOOGLE_SAFE_CONCURRENT_WRITES_BEGIN();
+  _cached_size_ = total_size;
+  GOOGLE_SAFE_CONCURRENT_WRITES_END();
+  return total_size;
+}
+
+void StreamResponse::MergeFrom(const ::google::protobuf::Message& from) {
+  GOOGLE_CHECK_NE(&from, this);
+  const StreamResponse* source =
+    ::google::protobuf::internal::dynamic_cast_if_available<const StreamResponse*>(
+      &from);
+  if (source == NULL) {
+    ::google::protobuf::internal::ReflectionOps::Merge(from, this);
+  } else {
+    MergeFrom(*source);
+  }
+}
+
+void StreamResponse::MergeFrom(const StreamResponse& from) {
+  GOOGLE_CHECK_NE(&from, this);
+  if (from._has_bits_[0 / 32] & (0xffu << (0 % 32))) {
+    if (from.has_n()) {
+      set_n(from.n());
+    }
+    if (from.has_data()) {
+      set_data(from.data());
+    }
+  }
+  mutable_unknown_fields()->MergeFrom(from.unknown_fields());
+}
+
+void StreamResponse::CopyFrom(const ::google::protobuf::Message& from) {
+  if (&from == this) return;
+  Clear();
+  MergeFrom(from);
+}
+
+void StreamResponse::CopyFrom(const StreamResponse& from) {
+  if (&from == this) return;
+  Clear();
+  MergeFrom(from);
+}
+
+bool StreamResponse::IsInitialized() const {
+
+  return true;
+}
+
+bool StreamResponse::ParseFromXmlString(const std::string& data) {
+  ::google::protobuf::xml::XmlMessage stub(*const_cast<StreamResponse*>(this));
+  if(!stub.ParseFromString(data)) {
+    GOOGLE_LOG(WARNING) << "ParseFromXmlString failed: " << stub.GetErrorText();
+    return false;
+  }
+  if (!this->IsInitialized()) {
+    GOOGLE_LOG(WARNING)
+      << "ParseFromXmlString failed: missing required fields: "
+      << this->InitializationErrorString();
+    return false;
+  }
+  return true;
+}
+
+bool StreamResponse::ParsePartialFromXmlString(const std::string& data) {
+  ::google::protobuf::xml::XmlMessage stub(*const_cast<StreamResponse*>(this));
+  if(!stub.ParseFromString(data)) {
+    GOOGLE_LOG(WARNING) << "ParsePartialFromXmlString failed: " << stub.GetErrorText();
+    return false;
+  }
+  return true;
+}
+
+bool StreamResponse::SerializeToXmlString(std::string* output) const {
+  output->clear();
+  if (!this->IsInitialized()) {
+    GOOGLE_LOG(WARNING)
+      << "SerializeToXmlString failed: missing required fields: "
+      << this->InitializationErrorString();
+    return false;
+  }
+
+  ::google::protobuf::xml::XmlMessage stub(*const_cast<StreamResponse*>(this));
+  output->assign(stub.SerializeToString());
+  return true;
+}
+
+bool StreamResponse::SerializePartialToXmlString(std::string* output) const {
+  output->clear();
+
+  ::google::protobuf::xml::XmlMessage stub(*const_cast<StreamResponse*>(this));
+  output->assign(stub.SerializeToString());
+  return true;
+}
+
+void StreamResponse::Swap(StreamResponse* other) {
+  if (other != this) {
+    std::swap(n_, other->n_);
+    std::swap(data_, other->data_);
+    std::swap(_has_bits_[0], other->_has_bits_[0]);
+    _unknown_fields_.Swap(&other->_unknown_fields_);
+    std::swap(_cached_size_, other->_cached_size_);
+  }
+}
+
+::google::protobuf::Metadata StreamResponse::GetMetadata() const {
+  protobuf_AssignDescriptorsOnce();
+  ::google::protobuf::Metadata metadata;
+  metadata.descriptor = StreamResponse_descriptor_;
+  metadata.reflection = StreamResponse_reflection_;
+  return metadata;
+}
+
+
+// ===================================================================
+
+StreamService::~StreamService() {}
+
+const ::google::protobuf::ServiceDescriptor* StreamService::descriptor() {
+  protobuf_AssignDescriptorsOnce();
+  return StreamService_descriptor_;
+}
+
+const ::google::protobuf::ServiceDescriptor* StreamService::GetDescriptor() {
+  protobuf_AssignDescriptorsOnce();
+  return StreamService_descriptor_;
+}
+
+const ::google::protobuf::rpc::Error StreamService::List(
+  const ::service::StreamRequest*,
+  ::google::protobuf::rpc::StreamWriter< ::service::StreamResponse>*) {
+  return ::google::protobuf::rpc::Error("Method StreamService::List() not implemented.");
+}
+
+const ::google::protobuf::rpc::Error StreamService::Sum(
+  ::google::protobuf::rpc::StreamReader< ::service::StreamRequest>*,
+  ::service::StreamResponse*) {
+  return ::google::protobuf::rpc::Error("Method StreamService::Sum() not implemented.");
+}
+
+const ::google::protobuf::rpc::Error StreamService::Chat(
+  ::google::protobuf::rpc::StreamReaderWriter< ::service::StreamResponse, ::service::StreamRequest>*) {
+  return ::google::protobuf::rpc::Error("Method StreamService::Chat() not implemented.");
+}
+
+const ::google::protobuf::rpc::Error StreamService::Echo(
+  const ::service::StreamRequest*,
+  ::service::StreamResponse*) {
+  return ::google::protobuf::rpc::Error("Method StreamService::Echo() not implemented.");
+}
+
+const ::google::protobuf::rpc::Error StreamService::CallMethod(
+  const ::google::protobuf::MethodDescriptor* method,
+  const ::google::protobuf::Message* request,
+  ::google::protobuf::Message* response) {
+  GOOGLE_DCHECK_EQ(method->service(), StreamService_descriptor_);
+  switch(method->index()) {
+    case 0:
+      return ::google::protobuf::rpc::Error("Method StreamService::List() is a streaming method.");
+    case 1:
+      return ::google::protobuf::rpc::Error("Method StreamService::Sum() is a streaming method.");
+    case 2:
+      return ::google::protobuf::rpc::Error("Method StreamService::Chat() is a streaming method.");
+    case 3:
+      return Echo(
+        ::google::protobuf::down_cast<const ::service::StreamRequest*>(request),
+        ::google::protobuf::down_cast< ::service::StreamResponse*>(response));
+    default:
+      return ::google::protobuf::rpc::Error("Bad method index; this should never happen.");
+  }
+}
+
+const ::google::protobuf::rpc::Error StreamService::CallStreamMethod(
+  const ::google::protobuf::MethodDescriptor* method,
+  ::google::protobuf::rpc::Stream* stream) {
+  GOOGLE_DCHECK_EQ(method->service(), StreamService_descriptor_);
+  switch(method->index()) {
+    case 0: {
+      ::service::StreamRequest request;
+      if (!stream->Read(&request)) {
+        return ::google::protobuf::rpc::Error("Method StreamService::List(): no request.");
+      }
+      ::google::protobuf::rpc::StreamWriter< ::service::StreamResponse> writer(stream);
+      return List(&request, &writer);
+    }
+    case 1: {
+      ::google::protobuf::rpc::StreamReader< ::service::StreamRequest> reader(stream);
+      ::service::StreamResponse response;
+      ::google::protobuf::rpc::Error err = Sum(&reader, &response);
+      if (err.IsNil()) {
+        err = stream->Write(&response);
+      }
+      return err;
+    }
+    case 2: {
+      ::google::protobuf::rpc::StreamReaderWriter< ::service::StreamResponse, ::service::StreamRequest> rw(stream);
+      return Chat(&rw);
+    }
+    default:
+      return ::google::protobuf::rpc::Error("Bad method index; this should never happen.");
+  }
+}
+
+const ::google::protobuf::Message& StreamService::GetRequestPrototype(
+    const ::google::protobuf::MethodDescriptor* method) const {
+  GOOGLE_DCHECK_EQ(method->service(), descriptor());
+  switch(method->index()) {
+    case 0:
+      return ::service::StreamRequest::default_instance();
+    case 1:
+      return ::service::StreamRequest::default_instance();
+    case 2:
+      return ::service::StreamRequest::default_instance();
+    case 3:
+      return ::service::StreamRequest::default_instance();
+    default:
+      GOOGLE_LOG(FATAL) << "Bad method index; this should never happen.";
+      return *reinterpret_cast< ::google::protobuf::Message*>(NULL);
+  }
+}
+
+const ::google::protobuf::Message& StreamService::GetResponsePrototype(
+    const ::google::protobuf::MethodDescriptor* method) const {
+  GOOGLE_DCHECK_EQ(method->service(), descriptor());
+  switch(method->index()) {
+    case 0:
+      return ::service::StreamResponse::default_instance();
+    case 1:
+      return ::service::StreamResponse::default_instance();
+    case 2:
+      return ::service::StreamResponse::default_instance();
+    case 3:
+      return ::service::StreamResponse::default_instance();
+    default:
+      GOOGLE_LOG(FATAL) << "Bad method index; this should never happen.";
+      return *reinterpret_cast< ::google::protobuf::Message*>(NULL);
+  }
+}
+
+StreamService_Stub::StreamService_Stub(::google::protobuf::rpc::Caller* client)
+  : client_(client), owns_client_(false) {}
+StreamService_Stub::StreamService_Stub(
+    ::google::protobuf::rpc::Caller* client, bool client_ownership)
+  : client_(client),
+    owns_client_(client_ownership) {}
+StreamService_Stub::~StreamService_Stub() {
+  if (owns_client_) delete client_;
+}
+
+::std::unique_ptr< ::google::protobuf::rpc::ClientReader< ::service::StreamResponse> > StreamService_Stub::List(
+  const ::service::StreamRequest* request) {
+  ::std::unique_ptr< ::google::protobuf::rpc::ClientStream> stream(
+    client_->NewStream(descriptor()->method(0)));
+  stream->Write(request);
+  stream->CloseWrite();
+  return ::std::unique_ptr< ::google::protobuf::rpc::ClientReader< ::service::StreamResponse> >(
+    new ::google::protobuf::rpc::ClientReader< ::service::StreamResponse>(::std::move(stream)));
+}
+::std::unique_ptr< ::google::protobuf::rpc::ClientWriter< ::service::StreamRequest, ::service::StreamResponse> > StreamService_Stub::Sum(
+  ::service::StreamResponse* response) {
+  return ::std::unique_ptr< ::google::protobuf::rpc::ClientWriter< ::service::StreamRequest, ::service::StreamResponse> >(
+    new ::google::protobuf::rpc::ClientWriter< ::service::StreamRequest, ::service::StreamResponse>(
+      client_->NewStream(descriptor()->method(1)), response));
+}
+::std::unique_ptr< ::google::protobuf::rpc::ClientReaderWriter< ::service::StreamRequest, ::service::StreamResponse> > StreamService_Stub::Chat() {
+  return ::std::unique_ptr< ::google::protobuf::rpc::ClientReaderWriter< ::service::StreamRequest, ::service::StreamResponse> >(
+    new ::google::protobuf::rpc::ClientReaderWriter< ::service::StreamRequest, ::service::StreamResponse>(
+      client_->NewStream(descriptor()->method(2))));
+}
+const ::google::protobuf::rpc::Error StreamService_Stub::Echo(
+  const ::service::StreamRequest* request,
+  ::service::StreamResponse* response) {
+  return client_->CallMethod(descriptor()->method(3), request, response);
+}
+::std::shared_ptr< ::google::protobuf::rpc::Future> StreamService_Stub::EchoAsync(
+  const ::service::StreamRequest* request,
+  ::service::StreamResponse* response,
+  const ::google::protobuf::rpc::Callback& done) {
+  return client_->CallMethodAsync(descriptor()->method(3), request, response, done);
+}
+
+// @@protoc_insertion_point(namespace_scope)
+
+}  // namespace service
+
+// @@protoc_insertion_point(global_scope)
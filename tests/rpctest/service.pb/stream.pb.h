@@ -0,0 +1,557 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+// source: stream.proto
+
+#ifndef PROTOBUF_stream_2eproto__INCLUDED
+#define PROTOBUF_stream_2eproto__INCLUDED
+
+#include <string>
+
+#include <google/protobuf/stubs/common.h>
+
+#if GOOGLE_PROTOBUF_VERSION < 2005001
+#error This file was generated by a newer version of protoc which is
+#error incompatible with your Protocol Buffer headers.  Please update
+#error your headers.
+#endif
+#if 2005001 < GOOGLE_PROTOBUF_MIN_PROTOC_VERSION
+#error This file was generated by an older version of protoc which is
+#error incompatible with your Protocol Buffer headers.  Please
+#error regenerate this file with a newer version of protoc.
+#endif
+
+#include <google/protobuf/generated_message_util.h>
+#include <google/protobuf/message.h>
+#include <google/protobuf/repeated_field.h>
+#include <google/protobuf/extension_set.h>
+#include <google/protobuf/generated_message_reflection.h>
+#include <google/protobuf/xml/xml_message.h>
+#include <google/protobuf/rpc/rpc_service.h>
+#include <google/protobuf/rpc/rpc_stream.h>
+#include <google/protobuf/rpc/rpc_client.h>
+#include <google/protobuf/unknown_field_set.h>
+// @@protoc_insertion_point(includes)
+
+namespace service {
+
+// Internal implementation detail -- do not call these.
+void  protobuf_AddDesc_stream_2eproto();
+void protobuf_AssignDesc_stream_2eproto();
+void protobuf_ShutdownFile_stream_2eproto();
+
+class StreamRequest;
+class StreamResponse;
+
+// ===================================================================
+
+class StreamRequest : public ::google::protobuf::Message {
+ public:
+  StreamRequest();
+  virtual ~StreamRequest();
+
+  StreamRequest(const StreamRequest& from);
+
+  inline StreamRequest& operator=(const StreamRequest& from) {
+    CopyFrom(from);
+    return *this;
+  }
+
+  inline const ::google::protobuf::UnknownFieldSet& unknown_fields() const {
+    return _unknown_fields_;
+  }
+
+  inline ::google::protobuf::UnknownFieldSet* mutable_unknown_fields() {
+    return &_unknown_fields_;
+  }
+
+  static const ::google::protobuf::Descriptor* descriptor();
+  static const StreamRequest& default_instance();
+
+  void Swap(StreamRequest* other);
+
+  // implements Message ----------------------------------------------
+
+  StreamRequest* New() const;
+  void CopyFrom(const ::google::protobuf::Message& from);
+  void MergeFrom(const ::google::protobuf::Message& from);
+  void CopyFrom(const StreamRequest& from);
+  void MergeFrom(const StreamRequest& from);
+  void Clear();
+  bool IsInitialized() const;
+
+  int ByteSize() const;
+  bool MergePartialFromCodedStream(
+      ::google::protobuf::io::CodedInputStream* input);
+  void SerializeWithCachedSizes(
+      ::google::protobuf::io::CodedOutputStream* output) const;
+  ::google::protobuf::uint8* SerializeWithCachedSizesToArray(::google::protobuf::uint8* output) const;
+  int GetCachedSize() const { return _cached_size_; }
+  private:
+  void SharedCtor();
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  public:
+
+  ::google::protobuf::Metadata GetMetadata() const;
+
+  // xml support -----------------------------------------------------
+
+  // Parse a protocol buffer contained in a string.
+  bool ParseFromXmlString(const std::string& data);
+  // Like ParseFromXmlString(), but accepts messages that are missing
+  // required fields.
+  bool ParsePartialFromXmlString(const std::string& data);
+
+  // Serialize the message and store it in the given string.  All required
+  // fields must be set.
+  bool SerializeToXmlString(std::string* output) const;
+  // Like SerializeToXmlString(), but allows missing required fields.
+  bool SerializePartialToXmlString(std::string* output) const;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  // optional int32 n = 1;
+  inline bool has_n() const;
+  inline void clear_n();
+  static const int kNFieldNumber = 1;
+  inline ::google::protobuf::int32 n() const;
+  inline void set_n(::google::protobuf::int32 value);
+
+  // optional string data = 2;
+  inline bool has_data() const;
+  inline void clear_data();
+  static const int kDataFieldNumber = 2;
+  inline const ::std::string& data() const;
+  inline void set_data(const ::std::string& value);
+  inline void set_data(const char* value);
+  inline void set_data(const char* value, size_t size);
+  inline ::std::string* mutable_data();
+  inline ::std::string* release_data();
+  inline void set_allocated_data(::std::string* data);
+
+  // @@protoc_insertion_point(class_scope:service.StreamRequest)
+ private:
+  inline void set_has_n();
+  inline void clear_has_n();
+  inline void set_has_data();
+  inline void clear_has_data();
+
+  ::google::protobuf::UnknownFieldSet _unknown_fields_;
+
+  ::std::string* data_;
+  ::google::protobuf::int32 n_;
+
+  mutable int _cached_size_;
+  ::google::protobuf::uint32 _has_bits_[(2 + 31) / 32];
+
+  friend void  protobuf_AddDesc_stream_2eproto();
+  friend void protobuf_AssignDesc_stream_2eproto();
+  friend void protobuf_ShutdownFile_stream_2eproto();
+
+  void InitAsDefaultInstance();
+  static StreamRequest* default_instance_;
+};
+// -------------------------------------------------------------------
+
+class StreamResponse : public ::google::protobuf::Message {
+ public:
+  StreamResponse();
+  virtual ~StreamResponse();
+
+  StreamResponse(const StreamResponse& from);
+
+  inline StreamResponse& operator=(const StreamResponse& from) {
+    CopyFrom(from);
+    return *this;
+  }
+
+  inline const ::google::protobuf::UnknownFieldSet& unknown_fields() const {
+    return _unknown_fields_;
+  }
+
+  inline ::google::protobuf::UnknownFieldSet* mutable_unknown_fields() {
+    return &_unknown_fields_;
+  }
+
+  static const ::google::protobuf::Descriptor* descriptor();
+  static const StreamResponse& default_instance();
+
+  void Swap(StreamResponse* other);
+
+  // implements Message ----------------------------------------------
+
+  StreamResponse* New() const;
+  void CopyFrom(const ::google::protobuf::Message& from);
+  void MergeFrom(const ::google::protobuf::Message& from);
+  void CopyFrom(const StreamResponse& from);
+  void MergeFrom(const StreamResponse& from);
+  void Clear();
+  bool IsInitialized() const;
+
+  int ByteSize() const;
+  bool MergePartialFromCodedStream(
+      ::google::protobuf::io::CodedInputStream* input);
+  void SerializeWithCachedSizes(
+      ::google::protobuf::io::CodedOutputStream* output) const;
+  ::google::protobuf::uint8* SerializeWithCachedSizesToArray(::google::protobuf::uint8* output) const;
+  int GetCachedSize() const { return _cached_size_; }
+  private:
+  void SharedCtor();
+  void SharedDtor();
+  void SetCachedSize(int size) const;
+  public:
+
+  ::google::protobuf::Metadata GetMetadata() const;
+
+  // xml support -----------------------------------------------------
+
+  // Parse a protocol buffer contained in a string.
+  bool ParseFromXmlString(const std::string& data);
+  // Like ParseFromXmlString(), but accepts messages that are missing
+  // required fields.
+  bool ParsePartialFromXmlString(const std::string& data);
+
+  // Serialize the message and store it in the given string.  All required
+  // fields must be set.
+  bool SerializeToXmlString(std::string* output) const;
+  // Like SerializeToXmlString(), but allows missing required fields.
+  bool SerializePartialToXmlString(std::string* output) const;
+
+  // nested types ----------------------------------------------------
+
+  // accessors -------------------------------------------------------
+
+  // optional int32 n = 1;
+  inline bool has_n() const;
+  inline void clear_n();
+  static const int kNFieldNumber = 1;
+  inline ::google::protobuf::int32 n() const;
+  inline void set_n(::google::protobuf::int32 value);
+
+  // optional string data = 2;
+  inline bool has_data() const;
+  inline void clear_data();
+  static const int kDataFieldNumber = 2;
+  inline const ::std::string& data() const;
+  inline void set_data(const ::std::string& value);
+  inline void set_data(const char* value);
+  inline void set_data(const char* value, size_t size);
+  inline ::std::string* mutable_data();
+  inline ::std::string* release_data();
+  inline void set_allocated_data(::std::string* data);
+
+  // @@protoc_insertion_point(class_scope:service.StreamResponse)
+ private:
+  inline void set_has_n();
+  inline void clear_has_n();
+  inline void set_has_data();
+  inline void clear_has_data();
+
+  ::google::protobuf::UnknownFieldSet _unknown_fields_;
+
+  ::std::string* data_;
+  ::google::protobuf::int32 n_;
+
+  mutable int _cached_size_;
+  ::google::protobuf::uint32 _has_bits_[(2 + 31) / 32];
+
+  friend void  protobuf_AddDesc_stream_2eproto();
+  friend void protobuf_AssignDesc_stream_2eproto();
+  friend void protobuf_ShutdownFile_stream_2eproto();
+
+  void InitAsDefaultInstance();
+  static StreamResponse* default_instance_;
+};
+// ===================================================================
+
+class StreamService_Stub;
+
+class StreamService : public ::google::protobuf::rpc::Service {
+ protected:
+  // This class should be treated as an abstract interface.
+  inline StreamService() {};
+ public:
+  virtual ~StreamService();
+
+  typedef StreamService_Stub Stub;
+
+  static const ::google::protobuf::ServiceDescriptor* descriptor();
+
+  virtual const ::google::protobuf::rpc::Error List(
+    const ::service::StreamRequest* request,
+    ::google::protobuf::rpc::StreamWriter< ::service::StreamResponse>* writer);
+  virtual const ::google::protobuf::rpc::Error Sum(
+    ::google::protobuf::rpc::StreamReader< ::service::StreamRequest>* reader,
+    ::service::StreamResponse* response);
+  virtual const ::google::protobuf::rpc::Error Chat(
+    ::google::protobuf::rpc::StreamReaderWriter< ::service::StreamResponse, ::service::StreamRequest>* stream);
+  virtual const ::google::protobuf::rpc::Error Echo(
+    const ::service::StreamRequest* request,
+    ::service::StreamResponse* response);
+
+  // implements Service ----------------------------------------------
+
+  const ::google::protobuf::ServiceDescriptor* GetDescriptor();
+  const ::google::protobuf::rpc::Error CallMethod(
+    const ::google::protobuf::MethodDescriptor* method,
+    const ::google::protobuf::Message* request,
+    ::google::protobuf::Message* response);
+  const ::google::protobuf::Message& GetRequestPrototype(
+    const ::google::protobuf::MethodDescriptor* method) const;
+  const ::google::protobuf::Message& GetResponsePrototype(
+    const ::google::protobuf::MethodDescriptor* method) const;
+  const ::google::protobuf::rpc::Error CallStreamMethod(
+    const ::google::protobuf::MethodDescriptor* method,
+    ::google::protobuf::rpc::Stream* stream);
+
+ private:
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(StreamService);
+};
+
+class StreamService_Stub : public StreamService {
+ public:
+  StreamService_Stub(::google::protobuf::rpc::Caller* client);
+  StreamService_Stub(::google::protobuf::rpc::Caller* client, bool client_ownership);
+  ~StreamService_Stub();
+
+  // implements StreamService ------------------------------------------
+
+  const ::google::protobuf::rpc::Error Echo(
+    const ::service::StreamRequest* request,
+    ::service::StreamResponse* response);
+
+  // asynchronous calls, see Caller::CallMethodAsync ------------------
+
+  ::std::shared_ptr< ::google::protobuf::rpc::Future> EchoAsync(
+    const ::service::StreamRequest* request,
+    ::service::StreamResponse* response,
+    const ::google::protobuf::rpc::Callback& done = ::google::protobuf::rpc::Callback());
+
+  // streaming calls, see Caller::NewStream ---------------------------
+
+  ::std::unique_ptr< ::google::protobuf::rpc::ClientReader< ::service::StreamResponse> > List(
+    const ::service::StreamRequest* request);
+  ::std::unique_ptr< ::google::protobuf::rpc::ClientWriter< ::service::StreamRequest, ::service::StreamResponse> > Sum(
+    ::service::StreamResponse* response);
+  ::std::unique_ptr< ::google::protobuf::rpc::ClientReaderWriter< ::service::StreamRequest, ::service::StreamResponse> > Chat();
+
+ private:
+  ::google::protobuf::rpc::Caller* client_;
+  bool owns_client_;
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(StreamService_Stub);
+};
+
+
+// ===================================================================
+
+
+// ===================================================================
+
+// StreamRequest
+
+// optional int32 n = 1;
+inline bool StreamRequest::has_n() const {
+  return (_has_bits_[0] & 0x00000001u) != 0;
+}
+inline void StreamRequest::set_has_n() {
+  _has_bits_[0] |= 0x00000001u;
+}
+inline void StreamRequest::clear_has_n() {
+  _has_bits_[0] &= ~0x00000001u;
+}
+inline void StreamRequest::clear_n() {
+  n_ = 0;
+  clear_has_n();
+}
+inline ::google::protobuf::int32 StreamRequest::n() const {
+  return n_;
+}
+inline void StreamRequest::set_n(::google::protobuf::int32 value) {
+  set_has_n();
+  n_ = value;
+}
+
+// optional string data = 2;
+inline bool StreamRequest::has_data() const {
+  return (_has_bits_[0] & 0x00000002u) != 0;
+}
+inline void StreamRequest::set_has_data() {
+  _has_bits_[0] |= 0x00000002u;
+}
+inline void StreamRequest::clear_has_data() {
+  _has_bits_[0] &= ~0x00000002u;
+}
+inline void StreamRequest::clear_data() {
+  if (data_ != &::google::protobuf::internal::kEmptyString) {
+    data_->clear();
+  }
+  clear_has_data();
+}
+inline const ::std::string& StreamRequest::data() const {
+  return *data_;
+}
+inline void StreamRequest::set_data(const ::std::string& value) {
+  set_has_data();
+  if (data_ == &::google::protobuf::internal::kEmptyString) {
+    data_ = new ::std::string;
+  }
+  data_->assign(value);
+}
+inline void StreamRequest::set_data(const char* value) {
+  set_has_data();
+  if (data_ == &::google::protobuf::internal::kEmptyString) {
+    data_ = new ::std::string;
+  }
+  data_->assign(value);
+}
+inline void StreamRequest::set_data(const char* value, size_t size) {
+  set_has_data();
+  if (data_ == &::google::protobuf::internal::kEmptyString) {
+    data_ = new ::std::string;
+  }
+  data_->assign(reinterpret_cast<const char*>(value), size);
+}
+inline ::std::string* StreamRequest::mutable_data() {
+  set_has_data();
+  if (data_ == &::google::protobuf::internal::kEmptyString) {
+    data_ = new ::std::string;
+  }
+  return data_;
+}
+inline ::std::string* StreamRequest::release_data() {
+  clear_has_data();
+  if (data_ == &::google::protobuf::internal::kEmptyString) {
+    return NULL;
+  } else {
+    ::std::string* temp = data_;
+    data_ = const_cast< ::std::string*>(&::google::protobuf::internal::kEmptyString);
+    return temp;
+  }
+}
+inline void StreamRequest::set_allocated_data(::std::string* data) {
+  if (data_ != &::google::protobuf::internal::kEmptyString) {
+    delete data_;
+  }
+  if (data) {
+    set_has_data();
+    data_ = data;
+  } else {
+    clear_has_data();
+    data_ = const_cast< ::std::string*>(&::google::protobuf::internal::kEmptyString);
+  }
+}
+
+// -------------------------------------------------------------------
+
+// StreamResponse
+
+// optional int32 n = 1;
+inline bool StreamResponse::has_n() const {
+  return (_has_bits_[0] & 0x00000001u) != 0;
+}
+inline void StreamResponse::set_has_n() {
+  _has_bits_[0] |= 0x00000001u;
+}
+inline void StreamResponse::clear_has_n() {
+  _has_bits_[0] &= ~0x00000001u;
+}
+inline void StreamResponse::clear_n() {
+  n_ = 0;
+  clear_has_n();
+}
+inline ::google::protobuf::int32 StreamResponse::n() const {
+  return n_;
+}
+inline void StreamResponse::set_n(::google::protobuf::int32 value) {
+  set_has_n();
+  n_ = value;
+}
+
+// optional string data = 2;
+inline bool StreamResponse::has_data() const {
+  return (_has_bits_[0] & 0x00000002u) != 0;
+}
+inline void StreamResponse::set_has_data() {
+  _has_bits_[0] |= 0x00000002u;
+}
+inline void StreamResponse::clear_has_data() {
+  _has_bits_[0] &= ~0x00000002u;
+}
+inline void StreamResponse::clear_data() {
+  if (data_ != &::google::protobuf::internal::kEmptyString) {
+    data_->clear();
+  }
+  clear_has_data();
+}
+inline const ::std::string& StreamResponse::data() const {
+  return *data_;
+}
+inline void StreamResponse::set_data(const ::std::string& value) {
+  set_has_data();
+  if (data_ == &::google::protobuf::internal::kEmptyString) {
+    data_ = new ::std::string;
+  }
+  data_->assign(value);
+}
+inline void StreamResponse::set_data(const char* value) {
+  set_has_data();
+  if (data_ == &::google::protobuf::internal::kEmptyString) {
+    data_ = new ::std::string;
+  }
+  data_->assign(value);
+}
+inline void StreamResponse::set_data(const char* value, size_t size) {
+  set_has_data();
+  if (data_ == &::google::protobuf::internal::kEmptyString) {
+    data_ = new ::std::string;
+  }
+  data_->assign(reinterpret_cast<const char*>(value), size);
+}
+inline ::std::string* StreamResponse::mutable_data() {
+  set_has_data();
+  if (data_ == &::google::protobuf::internal::kEmptyString) {
+    data_ = new ::std::string;
+  }
+  return data_;
+}
+inline ::std::string* StreamResponse::release_data() {
+  clear_has_data();
+  if (data_ == &::google::protobuf::internal::kEmptyString) {
+    return NULL;
+  } else {
+    ::std::string* temp = data_;
+    data_ = const_cast< ::std::string*>(&::google::protobuf::internal::kEmptyString);
+    return temp;
+  }
+}
+inline void StreamResponse::set_allocated_data(::std::string* data) {
+  if (data_ != &::google::protobuf::internal::kEmptyString) {
+    delete data_;
+  }
+  if (data) {
+    set_has_data();
+    data_ = data;
+  } else {
+    clear_has_data();
+    data_ = const_cast< ::std::string*>(&::google::protobuf::internal::kEmptyString);
+  }
+}
+
+
+// @@protoc_insertion_point(namespace_scope)
+
+}  // namespace service
+
+#ifndef SWIG
+namespace google {
+namespace protobuf {
+
+
+}  // namespace google
+}  // namespace protobuf
+#endif  // SWIG
+
+// @@protoc_insertion_point(global_scope)
+
+#endif  // PROTOBUF_stream_2eproto__INCLUDED
@@ -3,6 +3,7 @@
 :: license that can be found in the LICENSE file.
 
 :: gen cxx code
-..\..\..\bin\protoc.exe --cxx_out=. arith.proto
+..\..\..\bin\protoc.exe -I. -I..\..\..\src --cxx_out=. arith.proto
 ..\..\..\bin\protoc.exe --cxx_out=. echo.proto
+..\..\..\bin\protoc.exe --cxx_out=. stream.proto
 